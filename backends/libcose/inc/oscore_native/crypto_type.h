@@ -15,8 +15,57 @@ typedef struct {
 
 typedef oscore_crypto_aead_encryptstate_t oscore_crypto_aead_decryptstate_t;
 
+typedef int oscore_cryptoerr_t;
+
+#ifndef OSCORE_FIXED_AEADALG
+
 #define OSCORE_CRYPTO_AEAD_IV_MAXLEN ((size_t)13)
 
 #define OSCORE_CRYPTO_AEAD_KEY_MAXLEN ((size_t)32)
 
-typedef int oscore_cryptoerr_t;
+#else
+
+// With only a single algorithm built in, buffers are sized for it, and its
+// properties are inlined as constants; libcose.c leaves out its own
+// definitions of these functions.
+
+#include <cose/crypto.h>
+
+#if OSCORE_FIXED_AEADALG == 24 /* COSE_ALGO_CHACHA20POLY1305 */
+#define OSCORE_LIBCOSE_FIXED_TAGLENGTH COSE_CRYPTO_AEAD_CHACHA20POLY1305_ABYTES
+#define OSCORE_CRYPTO_AEAD_IV_MAXLEN ((size_t)COSE_CRYPTO_AEAD_CHACHA20POLY1305_NONCEBYTES)
+#define OSCORE_CRYPTO_AEAD_KEY_MAXLEN ((size_t)COSE_CRYPTO_AEAD_CHACHA20POLY1305_KEYBYTES)
+#elif OSCORE_FIXED_AEADALG == 10 /* COSE_ALGO_AESCCM_16_64_128 */ && defined(HAVE_ALGO_AESCCM_16_64_128)
+#define OSCORE_LIBCOSE_FIXED_TAGLENGTH COSE_CRYPTO_AEAD_AESCCM_16_64_128_ABYTES
+#define OSCORE_CRYPTO_AEAD_IV_MAXLEN ((size_t)COSE_CRYPTO_AEAD_AESCCM_16_64_128_NONCEBYTES)
+#define OSCORE_CRYPTO_AEAD_KEY_MAXLEN ((size_t)COSE_CRYPTO_AEAD_AESCCM_16_64_128_KEYBYTES)
+#else
+#error "OSCORE_FIXED_AEADALG is not an algorithm supported by the libcose backend"
+#endif
+
+static inline oscore_cryptoerr_t oscore_crypto_aead_get_number(oscore_crypto_aeadalg_t alg, int32_t *number)
+{
+    (void)alg;
+    *number = OSCORE_FIXED_AEADALG;
+    return COSE_OK;
+}
+
+static inline size_t oscore_crypto_aead_get_taglength(oscore_crypto_aeadalg_t alg)
+{
+    (void)alg;
+    return OSCORE_LIBCOSE_FIXED_TAGLENGTH;
+}
+
+static inline size_t oscore_crypto_aead_get_keylength(oscore_crypto_aeadalg_t alg)
+{
+    (void)alg;
+    return OSCORE_CRYPTO_AEAD_KEY_MAXLEN;
+}
+
+static inline size_t oscore_crypto_aead_get_ivlength(oscore_crypto_aeadalg_t alg)
+{
+    (void)alg;
+    return OSCORE_CRYPTO_AEAD_IV_MAXLEN;
+}
+
+#endif
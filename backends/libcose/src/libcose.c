@@ -7,7 +7,11 @@
 oscore_cryptoerr_t oscore_crypto_aead_from_number(oscore_crypto_aeadalg_t *alg, int32_t number)
 {
     // Following libcose's practice to just numerically cast an int32_t to the enum
+#ifdef OSCORE_FIXED_AEADALG
+    if (number == OSCORE_FIXED_AEADALG) {
+#else
     if (cose_crypto_is_aead(number)) {
+#endif
         *alg = number;
         return COSE_OK;
     } else {
@@ -15,18 +19,21 @@ oscore_cryptoerr_t oscore_crypto_aead_from_number(oscore_crypto_aeadalg_t *alg,
     }
 }
 
+#ifndef OSCORE_FIXED_AEADALG
 oscore_cryptoerr_t oscore_crypto_aead_get_number(oscore_crypto_aeadalg_t alg, int32_t *number)
 {
     // Valid by the design of libcose's algorithm identifiers
     *number = alg;
     return COSE_OK;
 }
+#endif
 
 bool oscore_cryptoerr_is_error(oscore_cryptoerr_t err)
 {
     return err != COSE_OK;
 }
 
+#ifndef OSCORE_FIXED_AEADALG
 size_t oscore_crypto_aead_get_taglength(oscore_crypto_aeadalg_t alg)
 {
     switch (alg) {
@@ -68,6 +75,7 @@ size_t oscore_crypto_aead_get_ivlength(oscore_crypto_aeadalg_t alg)
             return SIZE_MAX;
     }
 }
+#endif
 
 oscore_cryptoerr_t oscore_crypto_aead_encrypt_start(
         oscore_crypto_aead_encryptstate_t *state,
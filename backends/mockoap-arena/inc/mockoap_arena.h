@@ -0,0 +1,123 @@
+#ifndef MOCKOAP_ARENA_H
+#define MOCKOAP_ARENA_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/** MoCKoAP arena variant: a minimal CoAP library that can be a backend to the
+ * OSCORE library without using any heap memory
+ *
+ * Like the original MoCKoAP, this exists to serve as a reference and testing
+ * backend. Unlike that, all memory comes from a caller-provided arena, options
+ * are kept in an array (so appending an option is a constant time operation),
+ * and messages can be converted to and from the CoAP wire format of
+ * [RFC7252](https://tools.ietf.org/html/rfc7252). That makes it suitable for
+ * measuring the library's cost without the noise of an allocator, and for
+ * feeding it messages that were captured from the network.
+ *
+ * Like the original, it silently accepts smaller option numbers for later
+ * options (with a warning); such messages can not be serialized.
+ */
+
+/** A region of memory that messages are allocated from
+ *
+ * Allocations are never freed individually; the arena is reset as a whole
+ * once none of its messages are used any more.
+ */
+struct mock_arena {
+    uint8_t *memory;
+    size_t size;
+    size_t used;
+};
+
+/** A single option of a CoAP message, stored in its message's option array */
+struct mock_opt {
+    uint16_t number;
+    uint16_t data_len;
+    uint8_t *data;
+};
+
+/** A CoAP message
+ *
+ * Code, payload and options are manipulated through the OSCORE library's
+ * generic CoAP API. The remaining header fields are only relevant for the wire
+ * format, and can be set directly.
+ *
+ * The option values are stored back to back in the @p values area, and
+ * described in the @p options array.
+ */
+struct mock_message {
+    uint8_t type;
+    uint16_t message_id;
+    uint8_t token_len;
+    uint8_t token[8];
+
+    uint8_t code;
+    uint8_t *payload;
+    size_t payload_len;
+
+    struct mock_opt *options;
+    size_t options_count;
+    size_t options_capacity;
+
+    uint8_t *values;
+    size_t values_used;
+    size_t values_size;
+};
+
+/** Set up an arena in @p memory of @p size bytes */
+void mock_arena_init(struct mock_arena *arena, void *memory, size_t size);
+
+/** Allocate @p size bytes (suitably aligned for any type) from the arena
+ *
+ * @return the allocated memory, or NULL if the arena is exhausted
+ */
+void *mock_arena_alloc(struct mock_arena *arena, size_t size);
+
+/** Release all allocations of the arena at once */
+void mock_arena_reset(struct mock_arena *arena);
+
+/** Allocate an empty message from an arena
+ *
+ * @param[inout] arena Arena to allocate the message and all its parts from
+ * @param[in] options_capacity Number of options the message can hold
+ * @param[in] values_size Total length of all option values the message can
+ *     hold
+ * @param[in] payload_size Size of the payload area
+ *
+ * @return the new message, or NULL if the arena is exhausted
+ */
+struct mock_message *mock_message_create(
+        struct mock_arena *arena,
+        size_t options_capacity,
+        size_t values_size,
+        size_t payload_size
+        );
+
+/** Write a message in CoAP wire format (for UDP) into @p buffer
+ *
+ * @return the number of bytes written, or 0 if the message does not fit into
+ * @p size bytes or its options are not in sequence
+ */
+size_t mock_message_serialize(
+        const struct mock_message *msg,
+        uint8_t *buffer,
+        size_t size
+        );
+
+/** Parse a message from CoAP wire format (for UDP)
+ *
+ * The data is copied into the arena, and the message's options and payload
+ * point into that copy. The parsed message has no room left for further
+ * options, but its payload can be modified in place.
+ *
+ * @return the parsed message, or NULL if the message is malformed or the
+ * arena is exhausted
+ */
+struct mock_message *mock_message_parse(
+        struct mock_arena *arena,
+        const uint8_t *buffer,
+        size_t length
+        );
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef MOCKOAP_ARENA_OSCORE_NATIVE_MSG_TYPE_H
+#define MOCKOAP_ARENA_OSCORE_NATIVE_MSG_TYPE_H
+
+#include <mockoap_arena.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct mock_message *oscore_msg_native_t;
+/** Index of the next option in the message's option array */
+typedef size_t oscore_msg_native_optiter_t;
+typedef bool oscore_msgerr_native_t;
+
+#endif
@@ -0,0 +1,206 @@
+#include <stdalign.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <oscore/coapoption.h>
+
+#include <mockoap_arena.h>
+
+void mock_arena_init(struct mock_arena *arena, void *memory, size_t size)
+{
+    arena->memory = memory;
+    arena->size = size;
+    arena->used = 0;
+}
+
+void *mock_arena_alloc(struct mock_arena *arena, size_t size)
+{
+    size_t align = alignof(max_align_t);
+    size_t start = (arena->used + align - 1) / align * align;
+    if (start > arena->size || size > arena->size - start) {
+        return NULL;
+    }
+    arena->used = start + size;
+    return &arena->memory[start];
+}
+
+void mock_arena_reset(struct mock_arena *arena)
+{
+    arena->used = 0;
+}
+
+struct mock_message *mock_message_create(
+        struct mock_arena *arena,
+        size_t options_capacity,
+        size_t values_size,
+        size_t payload_size
+        )
+{
+    struct mock_message *msg = mock_arena_alloc(arena, sizeof(struct mock_message));
+    struct mock_opt *options = mock_arena_alloc(arena, options_capacity * sizeof(struct mock_opt));
+    uint8_t *values = mock_arena_alloc(arena, values_size);
+    uint8_t *payload = mock_arena_alloc(arena, payload_size);
+    if (msg == NULL || options == NULL || values == NULL || payload == NULL) {
+        return NULL;
+    }
+
+    memset(msg, 0, sizeof(*msg));
+    msg->type = 1; // NON
+    msg->options = options;
+    msg->options_capacity = options_capacity;
+    msg->values = values;
+    msg->values_size = values_size;
+    msg->payload = payload;
+    msg->payload_len = payload_size;
+    return msg;
+}
+
+size_t mock_message_serialize(
+        const struct mock_message *msg,
+        uint8_t *buffer,
+        size_t size
+        )
+{
+    size_t header_len = 4 + msg->token_len;
+    if (msg->token_len > 8 || size < header_len) {
+        return 0;
+    }
+    buffer[0] = 0x40 | ((msg->type & 0x3) << 4) | msg->token_len;
+    buffer[1] = msg->code;
+    buffer[2] = msg->message_id >> 8;
+    buffer[3] = msg->message_id & 0xff;
+    memcpy(&buffer[4], msg->token, msg->token_len);
+
+    size_t cursor = header_len;
+    uint16_t last_number = 0;
+    for (size_t i = 0; i < msg->options_count; ++i) {
+        const struct mock_opt *o = &msg->options[i];
+        if (o->number < last_number) {
+            return 0;
+        }
+
+        uint16_t delta = o->number - last_number;
+        last_number = o->number;
+
+        size_t optlen = oscore_coapoption_header_length(delta, o->data_len) + o->data_len;
+        if (optlen > size - cursor) {
+            return 0;
+        }
+        cursor += oscore_coapoption_encode_header(&buffer[cursor], delta, o->data_len);
+        if (o->data_len != 0) {
+            memcpy(&buffer[cursor], o->data, o->data_len);
+        }
+        cursor += o->data_len;
+    }
+
+    if (msg->payload_len != 0) {
+        if (1 + msg->payload_len > size - cursor) {
+            return 0;
+        }
+        buffer[cursor++] = 0xff;
+        memcpy(&buffer[cursor], msg->payload, msg->payload_len);
+        cursor += msg->payload_len;
+    }
+
+    return cursor;
+}
+
+/** Walk the options of a message in wire format
+ *
+ * If @p options is NULL, this only counts the options into @p count;
+ * otherwise, it populates the options array (which is @p count long) with
+ * pointers into @p start.
+ *
+ * @return a pointer to the payload marker (or @p end if there is no payload),
+ * or NULL if the options are malformed
+ */
+static const uint8_t *parse_options(
+        const uint8_t *start,
+        const uint8_t *end,
+        struct mock_opt *options,
+        size_t *count
+        )
+{
+    const uint8_t *cursor = start;
+    uint32_t number = 0;
+    size_t index = 0;
+
+    while (cursor != end && *cursor != 0xff) {
+        uint32_t delta, length;
+        size_t header_length = oscore_coapoption_decode_header(cursor, end - cursor, &delta, &length);
+        if (header_length == 0) {
+            return NULL;
+        }
+        cursor += header_length;
+        number += delta;
+        if (number > UINT16_MAX || length > UINT16_MAX) {
+            return NULL;
+        }
+
+        if (options != NULL) {
+            options[index].number = number;
+            options[index].data = (uint8_t *)cursor;
+            options[index].data_len = length;
+        }
+        index += 1;
+        cursor += length;
+    }
+
+    if (options == NULL) {
+        *count = index;
+    }
+    return cursor;
+}
+
+struct mock_message *mock_message_parse(
+        struct mock_arena *arena,
+        const uint8_t *buffer,
+        size_t length
+        )
+{
+    if (length < 4 || (buffer[0] >> 6) != 1 || (buffer[0] & 0xf) > 8) {
+        return NULL;
+    }
+    uint8_t token_len = buffer[0] & 0xf;
+    if (length < 4 + (size_t)token_len) {
+        return NULL;
+    }
+
+    size_t options_count;
+    const uint8_t *end = &buffer[length];
+    const uint8_t *marker = parse_options(&buffer[4 + token_len], end, NULL, &options_count);
+    if (marker == NULL || (marker != end && marker + 1 == end)) {
+        // Malformed options, or a payload marker with no payload
+        return NULL;
+    }
+
+    struct mock_message *msg = mock_arena_alloc(arena, sizeof(struct mock_message));
+    struct mock_opt *options = mock_arena_alloc(arena, options_count * sizeof(struct mock_opt));
+    uint8_t *copy = mock_arena_alloc(arena, length);
+    if (msg == NULL || options == NULL || copy == NULL) {
+        return NULL;
+    }
+    memcpy(copy, buffer, length);
+
+    parse_options(&copy[4 + token_len], &copy[length], options, &options_count);
+
+    msg->type = (copy[0] >> 4) & 0x3;
+    msg->message_id = (copy[2] << 8) | copy[3];
+    msg->token_len = token_len;
+    memcpy(msg->token, &copy[4], token_len);
+    msg->code = copy[1];
+    if (marker == end) {
+        msg->payload = NULL;
+        msg->payload_len = 0;
+    } else {
+        msg->payload = &copy[marker - buffer + 1];
+        msg->payload_len = end - marker - 1;
+    }
+    msg->options = options;
+    msg->options_count = options_count;
+    msg->options_capacity = options_count;
+    msg->values = NULL;
+    msg->values_used = 0;
+    msg->values_size = 0;
+    return msg;
+}
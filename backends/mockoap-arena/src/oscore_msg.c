@@ -0,0 +1,155 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <oscore_native/message.h>
+
+uint8_t oscore_msg_native_get_code(oscore_msg_native_t msg)
+{
+    return msg->code;
+}
+
+void oscore_msg_native_set_code(oscore_msg_native_t msg, uint8_t code)
+{
+    msg->code = code;
+}
+
+oscore_msgerr_native_t oscore_msg_native_append_option(
+        oscore_msg_native_t msg,
+        uint16_t option_number,
+        const uint8_t *value,
+        size_t value_len
+        )
+{
+    if (msg->options_count == msg->options_capacity ||
+            value_len > msg->values_size - msg->values_used ||
+            value_len > UINT16_MAX) {
+        return true;
+    }
+
+    if (msg->options_count != 0 &&
+            msg->options[msg->options_count - 1].number > option_number) {
+        fprintf(stderr, "mockoap warning: Options were not added in sequence\n");
+    }
+
+    struct mock_opt *opt = &msg->options[msg->options_count];
+    opt->number = option_number;
+    opt->data = &msg->values[msg->values_used];
+    opt->data_len = value_len;
+    if (value_len != 0) {
+        memcpy(opt->data, value, value_len);
+    }
+
+    msg->values_used += value_len;
+    msg->options_count += 1;
+
+    return false;
+}
+
+bool oscore_msgerr_native_is_error(oscore_msgerr_native_t err)
+{
+    return err;
+}
+
+void oscore_msg_native_optiter_init(oscore_msg_native_t msg,
+        oscore_msg_native_optiter_t *iter
+        )
+{
+    *iter = 0;
+}
+
+bool oscore_msg_native_optiter_next(
+        oscore_msg_native_t msg,
+        oscore_msg_native_optiter_t *iter,
+        uint16_t *option_number,
+        const uint8_t **value,
+        size_t *value_len
+        )
+{
+    if (*iter >= msg->options_count) {
+        return false;
+    }
+
+    struct mock_opt *o = &msg->options[*iter];
+
+    *option_number = o->number;
+    *value = o->data;
+    *value_len = o->data_len;
+
+    *iter += 1;
+
+    return true;
+}
+
+oscore_msgerr_native_t oscore_msg_native_optiter_finish(
+        oscore_msg_native_t msg,
+        oscore_msg_native_optiter_t *iter
+        )
+{
+    // no-op: we didn't allocate anything for iteration
+    return false;
+}
+
+oscore_msgerr_native_t oscore_msg_native_update_option(
+        oscore_msg_native_t msg,
+        uint16_t option_number,
+        size_t option_occurrence,
+        const uint8_t *value,
+        size_t value_len
+        )
+{
+    size_t remaining = option_occurrence;
+    for (size_t i = 0; i < msg->options_count; ++i) {
+        struct mock_opt *o = &msg->options[i];
+        if (o->number != option_number) {
+            continue;
+        }
+
+        if (remaining > 0) {
+            remaining -= 1;
+            continue;
+        }
+
+        if (o->data_len != value_len) {
+            return true;
+        }
+
+        memcpy(o->data, value, value_len);
+        return false;
+    }
+    return true;
+}
+
+oscore_msgerr_native_t oscore_msg_native_map_payload(
+        oscore_msg_native_t msg,
+        uint8_t **payload,
+        size_t *payload_len
+        )
+{
+    *payload = msg->payload;
+    *payload_len = msg->payload_len;
+
+    return false;
+}
+
+oscore_msgerr_native_t oscore_msg_native_trim_payload(
+        oscore_msg_native_t msg,
+        size_t payload_len
+        )
+{
+    if (payload_len > msg->payload_len) {
+        return true;
+    }
+
+    msg->payload_len = payload_len;
+    return false;
+}
+
+void oscore_msg_native_set_payload_used(
+        oscore_msg_native_t msg,
+        size_t used_len
+        )
+{
+    // Options are kept apart from the payload, which thus never moves
+    (void)msg;
+    (void)used_len;
+}
@@ -0,0 +1,38 @@
+#include <oscore_native/test.h>
+
+#define MOCKOAP_DEFAULT_SIZE 1024
+#define MOCKOAP_DEFAULT_OPTIONS 32
+#define MOCKOAP_DEFAULT_VALUES 512
+
+/** Enough for the largest number of messages any test holds at a time */
+#define MOCKOAP_ARENA_SIZE (16 * 1024)
+
+static _Alignas(max_align_t) uint8_t arena_memory[MOCKOAP_ARENA_SIZE];
+static struct mock_arena arena = { arena_memory, sizeof(arena_memory), 0 };
+/** Number of created messages not destroyed yet; when this drops to zero, the
+ * arena is reset */
+static size_t live_messages;
+
+oscore_msg_native_t oscore_test_msg_create(void)
+{
+    struct mock_message *ret = mock_message_create(&arena,
+            MOCKOAP_DEFAULT_OPTIONS,
+            MOCKOAP_DEFAULT_VALUES,
+            MOCKOAP_DEFAULT_SIZE);
+    if (ret != NULL) {
+        live_messages += 1;
+    }
+    return ret;
+}
+
+void oscore_test_msg_destroy(oscore_msg_native_t message)
+{
+    if (message == NULL) {
+        return;
+    }
+
+    live_messages -= 1;
+    if (live_messages == 0) {
+        mock_arena_reset(&arena);
+    }
+}
@@ -148,3 +148,13 @@ oscore_msgerr_native_t oscore_msg_native_trim_payload(
     msg->payload_len = payload_len;
     return false;
 }
+
+void oscore_msg_native_set_payload_used(
+        oscore_msg_native_t msg,
+        size_t used_len
+        )
+{
+    // Options are kept apart from the payload, which thus never moves
+    (void)msg;
+    (void)used_len;
+}
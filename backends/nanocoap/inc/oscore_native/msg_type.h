@@ -21,4 +21,105 @@ typedef struct {
 } oscore_msg_native_optiter_t;
 typedef ssize_t oscore_msgerr_native_t;
 
+// The accessors that are used for every option and payload access are
+// defined here, either inline or (unless they are inlined) for
+// oscore_msg_native.c to emit; the remaining functions are only in there.
+#if defined(OSCORE_MSG_NATIVE_STATIC)
+#define OSCORE_NANOCOAP_MSG_ACCESSOR static inline
+#elif defined(OSCORE_NANOCOAP_MSG_DEFINE_ACCESSORS)
+#define OSCORE_NANOCOAP_MSG_ACCESSOR
+#endif
+
+#ifdef OSCORE_NANOCOAP_MSG_ACCESSOR
+
+OSCORE_NANOCOAP_MSG_ACCESSOR uint8_t oscore_msg_native_get_code(oscore_msg_native_t msg)
+{
+    // The get_code / set_code helpers all try to transform the code into the
+    // concatenated decimal form of the dotted representation
+    return msg.pkt->hdr->code;
+}
+
+OSCORE_NANOCOAP_MSG_ACCESSOR void oscore_msg_native_set_code(oscore_msg_native_t msg, uint8_t code)
+{
+    msg.pkt->hdr->code = code;
+}
+
+OSCORE_NANOCOAP_MSG_ACCESSOR bool oscore_msgerr_native_is_error(oscore_msgerr_native_t err)
+{
+    return err != 0;
+}
+
+OSCORE_NANOCOAP_MSG_ACCESSOR void oscore_msg_native_optiter_init(oscore_msg_native_t msg,
+        oscore_msg_native_optiter_t *iter
+        )
+{
+    // No properties of msg go into the iterator setup as long as it needs the
+    // is_first property
+    (void)msg;
+
+    iter->is_first = true;
+}
+
+OSCORE_NANOCOAP_MSG_ACCESSOR bool oscore_msg_native_optiter_next(
+        oscore_msg_native_t msg,
+        oscore_msg_native_optiter_t *iter,
+        uint16_t *option_number,
+        const uint8_t **value,
+        size_t *value_len
+        )
+{
+    ssize_t length = coap_opt_get_next(
+            msg.pkt,
+            &iter->pos,
+            (uint8_t **)value,
+            iter->is_first
+            );
+    if (length < 0) {
+        return false;
+    }
+
+    *value_len = length;
+    *option_number = iter->pos.opt_num;
+
+    iter->is_first = false;
+
+    return true;
+}
+
+OSCORE_NANOCOAP_MSG_ACCESSOR oscore_msgerr_native_t oscore_msg_native_optiter_finish(
+        oscore_msg_native_t msg,
+        oscore_msg_native_optiter_t *iter
+        )
+{
+    // no-op: we didn't allocate anything for iteration
+    (void)msg;
+    (void)iter;
+
+    // Infallible: Options are parsed and if need be rejected as a message on
+    // reception
+    return 0;
+}
+
+OSCORE_NANOCOAP_MSG_ACCESSOR oscore_msgerr_native_t oscore_msg_native_map_payload(
+        oscore_msg_native_t msg,
+        uint8_t **payload,
+        size_t *payload_len
+        )
+{
+    *payload = msg.pkt->payload;
+    *payload_len = msg.pkt->payload_len;
+
+    if (msg.pkt->payload_len != 0) {
+        **payload = 0xff;
+        (*payload) ++;
+        (*payload_len) --;
+    }
+
+    // Infallible: Options are parsed and if need be rejected as a message on
+    // reception
+    return 0;
+}
+
+#endif
+
 #endif
@@ -4,6 +4,10 @@
 #include <errno.h>
 #include <assert.h>
 
+// Unless they are inlined, the accessor functions defined in msg_type.h are
+// emitted here
+#define OSCORE_NANOCOAP_MSG_DEFINE_ACCESSORS
+
 #include <oscore_native/message.h>
 
 /** Access the coapk_pkt pointer inside a oscore_msg_native_t.
@@ -17,18 +21,6 @@ static inline coap_pkt_t *_pkt(oscore_msg_native_t msg) {
     return msg.pkt;
 }
 
-uint8_t oscore_msg_native_get_code(oscore_msg_native_t msg)
-{
-    // The get_code / set_code helpers all try to transform the code into the
-    // concatenated decimal form of the dotted representation
-    return _pkt(msg)->hdr->code;
-}
-
-void oscore_msg_native_set_code(oscore_msg_native_t msg, uint8_t code)
-{
-    _pkt(msg)->hdr->code = code;
-}
-
 oscore_msgerr_native_t oscore_msg_native_append_option(
         oscore_msg_native_t msg,
         uint16_t option_number,
@@ -68,62 +60,6 @@ oscore_msgerr_native_t oscore_msg_native_append_option(
     return result;
 }
 
-bool oscore_msgerr_native_is_error(oscore_msgerr_native_t err)
-{
-    return err != 0;
-}
-
-void oscore_msg_native_optiter_init(oscore_msg_native_t msg,
-        oscore_msg_native_optiter_t *iter
-        )
-{
-    // No properties of msg go into the iterator setup as long as it needs the
-    // is_first property
-    (void)msg;
-
-    iter->is_first = true;
-}
-
-bool oscore_msg_native_optiter_next(
-        oscore_msg_native_t msg,
-        oscore_msg_native_optiter_t *iter,
-        uint16_t *option_number,
-        const uint8_t **value,
-        size_t *value_len
-        )
-{
-    ssize_t length = coap_opt_get_next(
-            _pkt(msg),
-            &iter->pos,
-            (uint8_t **)value,
-            iter->is_first
-            );
-    if (length < 0) {
-        return false;
-    }
-
-    *value_len = length;
-    *option_number = iter->pos.opt_num;
-
-    iter->is_first = false;
-
-    return true;
-}
-
-oscore_msgerr_native_t oscore_msg_native_optiter_finish(
-        oscore_msg_native_t msg,
-        oscore_msg_native_optiter_t *iter
-        )
-{
-    // no-op: we didn't allocate anything for iteration
-    (void)msg;
-    (void)iter;
-
-    // Infallible: Options are parsed and if need be rejected as a message on
-    // reception
-    return 0;
-}
-
 oscore_msgerr_native_t oscore_msg_native_update_option(
         oscore_msg_native_t msg,
         uint16_t option_number,
@@ -170,26 +106,6 @@ oscore_msgerr_native_t oscore_msg_native_update_option(
     }
 }
 
-oscore_msgerr_native_t oscore_msg_native_map_payload(
-        oscore_msg_native_t msg,
-        uint8_t **payload,
-        size_t *payload_len
-        )
-{
-    *payload = _pkt(msg)->payload;
-    *payload_len = _pkt(msg)->payload_len;
-
-    if (_pkt(msg)->payload_len != 0) {
-        **payload = 0xff;
-        (*payload) ++;
-        (*payload_len) --;
-    }
-
-    // Infallible: Options are parsed and if need be rejected as a message on
-    // reception
-    return 0;
-}
-
 oscore_msgerr_native_t oscore_msg_native_trim_payload(
         oscore_msg_native_t msg,
         size_t payload_len
@@ -207,6 +123,17 @@ oscore_msgerr_native_t oscore_msg_native_trim_payload(
     return 0;
 }
 
+void oscore_msg_native_set_payload_used(
+        oscore_msg_native_t msg,
+        size_t used_len
+        )
+{
+    // Not used: nanocoap moves the whole payload area in
+    // OSCORE_NANOCOAP_MEMMOVE_MODE
+    (void)msg;
+    (void)used_len;
+}
+
 void oscore_msg_native_from_nanocoap_incoming(oscore_msg_native_t *msg, coap_pkt_t *pkt)
 {
     pkt->payload --;
@@ -0,0 +1,187 @@
+#ifndef POSIX_OSCORE_NATIVE_MSG_TYPE_H
+#define POSIX_OSCORE_NATIVE_MSG_TYPE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <oscore/coapoption.h>
+
+/** A CoAP message in wire format (for UDP or for reliable transports), see
+ * @ref oscore_posix_msg
+ *
+ * All fields are private; messages are set up through @ref
+ * oscore_posix_msg_init_outgoing, @ref oscore_posix_msg_parse or their
+ * `oscore_posix_tcp_msg_` counterparts.
+ */
+struct oscore_posix_msg {
+    /** @private Start of the CoAP header, or of the space reserved for it */
+    uint8_t *buf;
+    /** @private Size of @ref buf */
+    size_t size;
+    /** @private Position of the code */
+    size_t code_offset;
+    /** @private Position of the token; the options start behind it */
+    size_t token_offset;
+    /** @private Position of the first option */
+    size_t options_offset;
+    /** @private Position behind the last option, where the payload marker is
+     * or goes */
+    size_t payload_offset;
+    /** @private Length of the payload including its marker. In outgoing
+     * messages, this extends to the end of the buffer until trimmed. */
+    size_t payload_len;
+    /** @private Number of bytes at the start of the payload (including its
+     * marker) that may hold data; only those are moved when an option is
+     * appended */
+    size_t payload_used;
+    /** @private Number of the last option, against which the next option's
+     * delta is encoded */
+    uint16_t last_option;
+};
+
+typedef struct oscore_posix_msg *oscore_msg_native_t;
+typedef struct {
+    /** Position of the next option's header */
+    size_t offset;
+    /** Number of the previous option */
+    uint16_t number;
+} oscore_msg_native_optiter_t;
+/** 0 on success, or a negative errno value */
+typedef int oscore_msgerr_native_t;
+
+/** @private Read one option header at @p offset (which must be before @p end)
+ *
+ * @param[in] buf Message buffer
+ * @param[inout] offset Position of the option header; advanced to its value
+ * @param[in] end End of the option area
+ * @param[out] delta Option delta
+ * @param[out] length Length of the option value
+ *
+ * @return false if the option is malformed or exceeds @p end
+ */
+static inline bool oscore_posix_parse_option_header(const uint8_t *buf, size_t *offset, size_t end, uint32_t *delta, uint32_t *length)
+{
+    size_t header_length = oscore_coapoption_decode_header(&buf[*offset], end - *offset, delta, length);
+    *offset += header_length;
+    return header_length != 0;
+}
+
+// The accessors that are used for every option and payload access are
+// defined here, either inline or (unless they are inlined) for
+// oscore_msg_native.c to emit; the remaining functions are only in there.
+#if defined(OSCORE_MSG_NATIVE_STATIC)
+#define OSCORE_POSIX_MSG_ACCESSOR static inline
+#elif defined(OSCORE_POSIX_MSG_DEFINE_ACCESSORS)
+#define OSCORE_POSIX_MSG_ACCESSOR
+#endif
+
+#ifdef OSCORE_POSIX_MSG_ACCESSOR
+
+#include <errno.h>
+
+OSCORE_POSIX_MSG_ACCESSOR uint8_t oscore_msg_native_get_code(oscore_msg_native_t msg)
+{
+    return msg->buf[msg->code_offset];
+}
+
+OSCORE_POSIX_MSG_ACCESSOR void oscore_msg_native_set_code(oscore_msg_native_t msg, uint8_t code)
+{
+    msg->buf[msg->code_offset] = code;
+}
+
+OSCORE_POSIX_MSG_ACCESSOR bool oscore_msgerr_native_is_error(oscore_msgerr_native_t err)
+{
+    return err != 0;
+}
+
+OSCORE_POSIX_MSG_ACCESSOR void oscore_msg_native_optiter_init(oscore_msg_native_t msg,
+        oscore_msg_native_optiter_t *iter
+        )
+{
+    iter->offset = msg->options_offset;
+    iter->number = 0;
+}
+
+OSCORE_POSIX_MSG_ACCESSOR bool oscore_msg_native_optiter_next(
+        oscore_msg_native_t msg,
+        oscore_msg_native_optiter_t *iter,
+        uint16_t *option_number,
+        const uint8_t **value,
+        size_t *value_len
+        )
+{
+    if (iter->offset >= msg->payload_offset) {
+        return false;
+    }
+
+    uint32_t delta = 0, length = 0;
+    // Options were validated on parsing or written by us, so this can not
+    // fail
+    oscore_posix_parse_option_header(msg->buf, &iter->offset, msg->payload_offset, &delta, &length);
+
+    iter->number += delta;
+    *option_number = iter->number;
+    *value = &msg->buf[iter->offset];
+    *value_len = length;
+
+    iter->offset += length;
+    return true;
+}
+
+OSCORE_POSIX_MSG_ACCESSOR oscore_msgerr_native_t oscore_msg_native_optiter_finish(
+        oscore_msg_native_t msg,
+        oscore_msg_native_optiter_t *iter
+        )
+{
+    // no-op: we didn't allocate anything for iteration
+    (void)msg;
+    (void)iter;
+
+    // Infallible: Options are validated on reception
+    return 0;
+}
+
+OSCORE_POSIX_MSG_ACCESSOR oscore_msgerr_native_t oscore_msg_native_map_payload(
+        oscore_msg_native_t msg,
+        uint8_t **payload,
+        size_t *payload_len
+        )
+{
+    *payload = &msg->buf[msg->payload_offset];
+    *payload_len = msg->payload_len;
+    // Anything may be written from now on
+    msg->payload_used = msg->payload_len;
+
+    if (msg->payload_len != 0) {
+        **payload = 0xff;
+        (*payload) ++;
+        (*payload_len) --;
+    }
+
+    return 0;
+}
+
+OSCORE_POSIX_MSG_ACCESSOR oscore_msgerr_native_t oscore_msg_native_trim_payload(
+        oscore_msg_native_t msg,
+        size_t payload_len
+        )
+{
+    if (payload_len > 0) {
+        payload_len ++;
+    }
+
+    if (payload_len > msg->payload_len) {
+        return -ENOSPC;
+    }
+
+    msg->payload_len = payload_len;
+    if (msg->payload_used > payload_len) {
+        msg->payload_used = payload_len;
+    }
+    return 0;
+}
+
+#endif
+
+#endif
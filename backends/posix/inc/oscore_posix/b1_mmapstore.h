@@ -0,0 +1,130 @@
+#ifndef OSCORE_POSIX_B1_MMAPSTORE_H
+#define OSCORE_POSIX_B1_MMAPSTORE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#include <oscore/context_impl/b1_store.h>
+
+/** @file */
+
+/** @ingroup oscore_context_b1_store
+ *
+ * @addtogroup oscore_posix_b1_mmapstore Memory mapped file store for B.1 contexts
+ *
+ * @brief Persistence of many B.1 contexts in a single file on POSIX systems
+ *
+ * The file is an array of @ref oscore_context_b1_storeslot, indexed by an
+ * application defined context number, and mapped into memory shared with the
+ * file. Committing a context serializes its record into its slot and syncs
+ * only the pages covering the modified version using `msync`, so the cost of
+ * a commit does not depend on the number of contexts in the file.
+ *
+ * The file is created if absent, and extended with empty slots if shorter
+ * than requested. As the record format is platform independent, the file can
+ * be moved between machines as long as the same crypto backend algorithms are
+ * available.
+ *
+ * Like the rest of the library, this does not synchronize on its own. Commits
+ * to different slots may run concurrently; commits to the same slot need to be
+ * serialized by the application (which is naturally the case when they are
+ * driven by a single @ref oscore_context_b1_persist).
+ *
+ * @{
+ */
+
+/** @brief An open store file
+ *
+ * All fields are private.
+ */
+struct oscore_posix_b1_mmapstore {
+    /** @private */
+    int fd;
+    /** @private */
+    struct oscore_context_b1_storeslot *slots;
+    /** @private */
+    size_t count;
+};
+
+/** @brief Open (and if needed, create) a store file
+ *
+ * @param[out] store Store to initialize
+ * @param[in] path File name of the store
+ * @param[in] count Number of slots the store should have
+ *
+ * @return true on success; otherwise, errno indicates the error, and @p
+ * store is not to be used.
+ */
+OSCORE_NONNULL
+bool oscore_posix_b1_mmapstore_open(
+        struct oscore_posix_b1_mmapstore *store,
+        const char *path,
+        size_t count
+        );
+
+/** @brief Unmap and close a store file
+ *
+ * @param[inout] store Store to close
+ */
+OSCORE_NONNULL
+void oscore_posix_b1_mmapstore_close(
+        struct oscore_posix_b1_mmapstore *store
+        );
+
+/** @brief Durably store a record for a single context
+ *
+ * This is typically called by the background task of a @ref
+ * oscore_context_b1_persist between @ref oscore_context_b1_persist_take and
+ * @ref oscore_context_b1_persist_complete.
+ *
+ * @param[inout] store Open store
+ * @param[in] index Slot number of the context
+ * @param[in] immutables Key material of the context
+ * @param[in] record Record to store
+ *
+ * @return true if the record has been synced to the file; otherwise, errno
+ * indicates the error, and the record must not be considered persisted.
+ */
+OSCORE_NONNULL
+bool oscore_posix_b1_mmapstore_commit(
+        struct oscore_posix_b1_mmapstore *store,
+        size_t index,
+        const struct oscore_context_primitive_immutables *immutables,
+        const struct oscore_context_b1_persistrecord *record
+        );
+
+/** @brief Restore all contexts of a store
+ *
+ * For all slots of the store, this reads the stored key material and record.
+ * Any replay data found is cleared from the file, and the file is synced once
+ * for all of them. Only after that, all contexts found are initialized with
+ * @ref oscore_context_b1_initialize, using their replay data if present.
+ *
+ * All array arguments need to have the store's slot count as length.
+ *
+ * @param[in] store Open store
+ * @param[out] contexts Contexts to initialize
+ * @param[out] immutables Buffer for the key material of the contexts. This
+ *     needs to outlive @p contexts.
+ * @param[out] records Records as they were found in the file. The sequence
+ *     numbers in them are the ones the contexts were initialized with, and
+ *     are suitable for @ref oscore_context_b1_persist_init.
+ * @param[out] found Indicates for each slot whether a context was found in it
+ *     and initialized. Other entries of the above arrays are left
+ *     uninitialized.
+ *
+ * @return true on success. If false is returned, errno indicates the error,
+ * and no context has been initialized.
+ */
+OSCORE_NONNULL
+bool oscore_posix_b1_mmapstore_restore(
+        struct oscore_posix_b1_mmapstore *store,
+        struct oscore_context_b1 *contexts,
+        struct oscore_context_primitive_immutables *immutables,
+        struct oscore_context_b1_persistrecord *records,
+        bool *found
+        );
+
+/** @} */
+
+#endif
@@ -0,0 +1,196 @@
+#ifndef OSCORE_POSIX_MSG_H
+#define OSCORE_POSIX_MSG_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <oscore_native/message.h>
+#include <oscore/helpers.h>
+
+/** @file */
+
+/** @ingroup oscore_native_api
+ *
+ * @addtogroup oscore_posix_msg CoAP messages in wire format
+ *
+ * @brief Native message backend that works directly on UDP datagrams or
+ * stream frames
+ *
+ * This backend implements the @ref oscore_native_msg directly on buffers that
+ * hold CoAP messages in the wire format of [RFC7252](https://tools.ietf.org/html/rfc7252),
+ * without any further representation of the message. Received datagrams are
+ * parsed in place, and outgoing messages are built in the buffer they are sent
+ * from.
+ *
+ * Messages can alternatively be in the framing that [RFC8323](https://tools.ietf.org/html/rfc8323)
+ * defines for reliable transports like TCP and TLS: there is no
+ * message type or message ID, and the header carries the message's length,
+ * which is not limited by any MTU. Those messages are set up with the
+ * `oscore_posix_tcp_msg_` functions; once set up, they behave like any
+ * other message.
+ *
+ * Options are appended right behind the previous option. In outgoing
+ * messages, the payload initially extends to the end of the buffer; appending
+ * an option after the payload was written moves the payload behind it. Only
+ * the part of the payload that was written is moved: that is all of it once
+ * the payload was trimmed, and otherwise what the library reported through
+ * @ref oscore_msg_native_set_payload_used (or the whole mapped area, if
+ * nothing was reported).
+ *
+ * Messages built this way are usually sent through @ref oscore_posix_udp or
+ * @ref oscore_posix_tcp.
+ *
+ * @{
+ */
+
+/** @brief Set up an outgoing message in a buffer
+ *
+ * @param[out] msg Message to initialize
+ * @param[in] buf Buffer to build the message in
+ * @param[in] size Size of @p buf
+ * @param[in] type CoAP message type (0 for CON, 1 for NON, 2 for ACK, 3 for RST)
+ * @param[in] message_id CoAP message ID
+ * @param[in] token Token of the message (may be NULL if @p token_len is 0)
+ * @param[in] token_len Length of @p token
+ *
+ * The message has the empty code 0.00 set until @ref oscore_msg_native_set_code
+ * is called.
+ *
+ * @return false if the token is longer than 8 bytes or @p buf is too small to
+ * even hold the header
+ */
+bool oscore_posix_msg_init_outgoing(
+        struct oscore_posix_msg *msg,
+        uint8_t *buf,
+        size_t size,
+        uint8_t type,
+        uint16_t message_id,
+        const uint8_t *token,
+        size_t token_len
+        );
+
+/** @brief Discard the code, options and payload of an outgoing message
+ *
+ * The message is left as it was after @ref oscore_posix_msg_init_outgoing or
+ * @ref oscore_posix_tcp_msg_init_outgoing, with its type, message ID and token
+ * unchanged. This allows building a different response (eg. an error) after
+ * protecting a message failed halfway.
+ */
+OSCORE_NONNULL
+void oscore_posix_msg_clear(struct oscore_posix_msg *msg);
+
+/** @brief Set up a message from a received datagram
+ *
+ * @param[out] msg Message to initialize
+ * @param[in] buf Buffer holding the datagram
+ * @param[in] length Length of the datagram
+ *
+ * The header and all options are validated, so that later iteration over the
+ * options can not fail. The payload can be modified in place (which is what
+ * decryption does), but no options can be added.
+ *
+ * @return false if the datagram is not a well-formed CoAP message
+ */
+OSCORE_NONNULL
+bool oscore_posix_msg_parse(
+        struct oscore_posix_msg *msg,
+        uint8_t *buf,
+        size_t length
+        );
+
+/** @brief Number of bytes the message occupies in its buffer
+ *
+ * For outgoing messages, this is only meaningful after the payload was
+ * trimmed (which @ref oscore_encrypt_message does).
+ */
+OSCORE_NONNULL
+size_t oscore_posix_msg_length(const struct oscore_posix_msg *msg);
+
+/** @brief CoAP message type of a UDP message */
+OSCORE_NONNULL
+uint8_t oscore_posix_msg_get_type(const struct oscore_posix_msg *msg);
+
+/** @brief CoAP message ID of a UDP message */
+OSCORE_NONNULL
+uint16_t oscore_posix_msg_get_message_id(const struct oscore_posix_msg *msg);
+
+/** @brief Token of a message
+ *
+ * @param[in] msg Message to read
+ * @param[out] token Set to the start of the token inside the message buffer
+ *
+ * @return the token length
+ */
+OSCORE_NONNULL
+size_t oscore_posix_msg_get_token(const struct oscore_posix_msg *msg, const uint8_t **token);
+
+/** @brief Set up an outgoing message for a reliable transport in a buffer
+ *
+ * @param[out] msg Message to initialize
+ * @param[in] buf Buffer to build the message in
+ * @param[in] size Size of @p buf
+ * @param[in] token Token of the message (may be NULL if @p token_len is 0)
+ * @param[in] token_len Length of @p token
+ *
+ * Room for the longest length field the message can need in @p buf is
+ * reserved in front of the code; the actual header is written when the
+ * message is framed with @ref oscore_posix_tcp_msg_frame.
+ *
+ * @return false if the token is longer than 8 bytes or @p buf is too small to
+ * even hold the header
+ */
+bool oscore_posix_tcp_msg_init_outgoing(
+        struct oscore_posix_msg *msg,
+        uint8_t *buf,
+        size_t size,
+        const uint8_t *token,
+        size_t token_len
+        );
+
+/** @brief Determine the length of a frame from its start
+ *
+ * @param[in] buf Start of a frame received on a reliable transport
+ * @param[in] available Number of bytes received so far
+ *
+ * @return the total length of the frame (header, code, token, options and
+ * payload), or 0 if not enough bytes are available yet to tell. Lengths that
+ * do not fit a `size_t` are reported as `SIZE_MAX`.
+ */
+size_t oscore_posix_tcp_msg_frame_length(const uint8_t *buf, size_t available);
+
+/** @brief Set up a message from a complete received frame
+ *
+ * @param[out] msg Message to initialize
+ * @param[in] buf Buffer holding the frame
+ * @param[in] length Length of the frame, as reported by @ref
+ *     oscore_posix_tcp_msg_frame_length
+ *
+ * Like in @ref oscore_posix_msg_parse, everything is validated, and the
+ * payload can be modified in place.
+ *
+ * @return false if the frame is not a well-formed CoAP message of exactly @p
+ * length bytes
+ */
+OSCORE_NONNULL
+bool oscore_posix_tcp_msg_parse(
+        struct oscore_posix_msg *msg,
+        uint8_t *buf,
+        size_t length
+        );
+
+/** @brief Write the header of a message for a reliable transport
+ *
+ * @param[inout] msg Message set up by @ref oscore_posix_tcp_msg_init_outgoing
+ *     (whose payload was trimmed, as @ref oscore_encrypt_message does) or by
+ *     @ref oscore_posix_tcp_msg_parse
+ * @param[out] frame Set to the start of the frame inside the message buffer
+ *
+ * @return the length of the frame
+ */
+OSCORE_NONNULL
+size_t oscore_posix_tcp_msg_frame(struct oscore_posix_msg *msg, const uint8_t **frame);
+
+/** @} */
+
+#endif
@@ -0,0 +1,117 @@
+#ifndef OSCORE_POSIX_TCP_H
+#define OSCORE_POSIX_TCP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <oscore_posix/msg.h>
+
+/** @file */
+
+/** @ingroup oscore_posix_msg
+ *
+ * @addtogroup oscore_posix_tcp Stream transport
+ *
+ * @brief Sending and receiving CoAP messages on a connected stream socket
+ *
+ * This implements the message framing of [RFC8323](https://tools.ietf.org/html/rfc8323)
+ * on any connected stream socket (typically TCP, but also a UNIX domain socket
+ * pair or a TLS library's plaintext side). As messages are not limited to a
+ * datagram size, large payloads can be protected in a single OSCORE message
+ * rather than in many blocks.
+ *
+ * Received data is collected in a @ref oscore_posix_tcp_reader, which reads as
+ * much as the socket provides at once and then hands out the frames in it one
+ * by one, parsed in place. Outgoing messages are built with @ref
+ * oscore_posix_tcp_msg_init_outgoing and sent with @ref oscore_posix_tcp_send.
+ *
+ * Each side of a connection needs to send a Capabilities and Settings Message
+ * (CSM) first, see @ref oscore_posix_tcp_send_csm. Received signaling
+ * messages (codes 7.xx) are handed to the application like any other message.
+ *
+ * Errors are reported as negative errno values, like the other errors of this
+ * backend. Any error leaves the connection in an unknown state; it should be
+ * closed.
+ *
+ * @{
+ */
+
+/** @brief Buffer for receiving frames from a stream
+ *
+ * All fields are private.
+ */
+struct oscore_posix_tcp_reader {
+    /** @private */
+    uint8_t *buf;
+    /** @private */
+    size_t size;
+    /** @private Number of bytes received into @ref buf */
+    size_t filled;
+    /** @private Number of bytes at the start of @ref buf that were handed
+     * out as a message, and are dropped on the next read */
+    size_t consumed;
+};
+
+/** @brief Set up a reader
+ *
+ * @param[out] reader Reader to initialize
+ * @param[in] buf Buffer to receive into
+ * @param[in] size Size of @p buf; this limits the size of the messages that
+ *     can be received, and should be announced in a CSM.
+ */
+OSCORE_NONNULL
+void oscore_posix_tcp_reader_init(
+        struct oscore_posix_tcp_reader *reader,
+        uint8_t *buf,
+        size_t size
+        );
+
+/** @brief Receive the next message from a stream
+ *
+ * @param[in] fd Connected stream socket
+ * @param[inout] reader Reader used for all receptions on @p fd
+ * @param[out] msg Received message; this points into the reader's buffer and
+ *     is valid until the next call
+ *
+ * The socket is only read from if the reader holds no complete frame;
+ * whether that blocks is up to the socket.
+ *
+ * @return 1 if a message was received, 0 if the peer closed the connection
+ * in between two messages, or a negative errno value. `-EMSGSIZE` indicates
+ * a frame that does not fit the reader's buffer, and `-EBADMSG` a frame that
+ * is not a well-formed CoAP message.
+ */
+OSCORE_NONNULL
+int oscore_posix_tcp_receive(
+        int fd,
+        struct oscore_posix_tcp_reader *reader,
+        struct oscore_posix_msg *msg
+        );
+
+/** @brief Send a message on a stream
+ *
+ * @param[in] fd Connected stream socket
+ * @param[inout] msg Message to send; its header is written as by @ref
+ *     oscore_posix_tcp_msg_frame
+ *
+ * This only returns when all of the message is sent (or on error).
+ *
+ * @return 0 on success, or a negative errno value
+ */
+OSCORE_NONNULL
+int oscore_posix_tcp_send(int fd, struct oscore_posix_msg *msg);
+
+/** @brief Send a Capabilities and Settings Message
+ *
+ * @param[in] fd Connected stream socket
+ * @param[in] max_message_size Largest message this side can receive,
+ *     typically the size of its @ref oscore_posix_tcp_reader buffer
+ *
+ * @return 0 on success, or a negative errno value
+ */
+int oscore_posix_tcp_send_csm(int fd, uint32_t max_message_size);
+
+/** @} */
+
+#endif
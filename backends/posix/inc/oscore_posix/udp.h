@@ -0,0 +1,256 @@
+#ifndef OSCORE_POSIX_UDP_H
+#define OSCORE_POSIX_UDP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/socket.h>
+
+#include <oscore_posix/msg.h>
+
+/** @file */
+
+/** @ingroup oscore_posix_msg
+ *
+ * @addtogroup oscore_posix_udp Batched UDP transport
+ *
+ * @brief Sending and receiving CoAP messages on a Linux UDP socket in batches
+ *
+ * Datagrams are received into and sent from a @ref oscore_posix_udp_batch,
+ * using a single `recvmmsg` or `sendmmsg` system call for the whole batch.
+ * Received datagrams are parsed into @ref oscore_posix_msg messages in place,
+ * and outgoing ones are built right in the buffers they are sent from, so no
+ * data is copied between the socket and the OSCORE library.
+ *
+ * On top of that, @ref oscore_posix_udp_server_step implements the loop of a
+ * server: It receives a batch of requests, lets a handler build a response
+ * for each of them, and sends all responses at once.
+ *
+ * Clients use the batch functions directly: they add their requests to a
+ * batch with @ref oscore_posix_udp_batch_add, send them with @ref
+ * oscore_posix_udp_send, and collect the responses with @ref
+ * oscore_posix_udp_receive.
+ *
+ * Retransmission of confirmable messages is not implemented; servers answer
+ * them with piggybacked responses.
+ *
+ * @{
+ */
+
+/** @brief Number of datagrams handled in a single system call
+ *
+ * The value can be overridden at build time by predefining it.
+ */
+#ifndef OSCORE_POSIX_UDP_BATCH
+#define OSCORE_POSIX_UDP_BATCH 32
+#endif
+
+/** @brief Size of the buffer of each datagram
+ *
+ * Larger datagrams are truncated on reception, and then discarded. The
+ * default fits the minimal IPv6 MTU; it can be overridden at build time by
+ * predefining it.
+ */
+#ifndef OSCORE_POSIX_UDP_MTU
+#define OSCORE_POSIX_UDP_MTU 1280
+#endif
+
+/** @brief A set of datagrams along with their peers
+ *
+ * All fields are private; the messages of a batch are accessed through @ref
+ * oscore_posix_udp_batch_message and @ref oscore_posix_udp_batch_peer.
+ *
+ * A batch is large (about @ref OSCORE_POSIX_UDP_BATCH times @ref
+ * OSCORE_POSIX_UDP_MTU bytes), and is best allocated statically.
+ */
+struct oscore_posix_udp_batch {
+    /** @private */
+    size_t count;
+    /** @private Index of the first buffer that is free along with all
+     * following ones. Messages are not necessarily in the buffer of the same
+     * index, as dropping malformed or sent ones does not move any data. */
+    size_t buffers_used;
+    /** @private */
+    struct oscore_posix_msg messages[OSCORE_POSIX_UDP_BATCH];
+    /** @private */
+    struct sockaddr_storage peers[OSCORE_POSIX_UDP_BATCH];
+    /** @private */
+    socklen_t peer_lengths[OSCORE_POSIX_UDP_BATCH];
+    /** @private */
+    uint8_t buffers[OSCORE_POSIX_UDP_BATCH][OSCORE_POSIX_UDP_MTU];
+};
+
+/** @brief Remove all messages from a batch */
+OSCORE_NONNULL
+void oscore_posix_udp_batch_clear(struct oscore_posix_udp_batch *batch);
+
+/** @brief Number of messages in a batch */
+OSCORE_NONNULL
+size_t oscore_posix_udp_batch_count(const struct oscore_posix_udp_batch *batch);
+
+/** @brief Access a message of a batch
+ *
+ * @param[in] batch Batch to access
+ * @param[in] index Index of the message, less than the batch's count
+ */
+OSCORE_NONNULL
+struct oscore_posix_msg *oscore_posix_udp_batch_message(
+        struct oscore_posix_udp_batch *batch,
+        size_t index
+        );
+
+/** @brief Access the peer address of a message in a batch
+ *
+ * @param[in] batch Batch to access
+ * @param[in] index Index of the message, less than the batch's count
+ * @param[out] peer_len Length of the returned address
+ */
+OSCORE_NONNULL
+const struct sockaddr *oscore_posix_udp_batch_peer(
+        const struct oscore_posix_udp_batch *batch,
+        size_t index,
+        socklen_t *peer_len
+        );
+
+/** @brief Start an outgoing message in a batch
+ *
+ * @param[inout] batch Batch to add the message to
+ * @param[in] peer Address to send the message to
+ * @param[in] peer_len Length of @p peer
+ * @param[in] type CoAP message type
+ * @param[in] message_id CoAP message ID
+ * @param[in] token Token of the message (may be NULL if @p token_len is 0)
+ * @param[in] token_len Length of @p token
+ *
+ * The message is set up as with @ref oscore_posix_msg_init_outgoing; it
+ * needs to be completed (typically by @ref oscore_encrypt_message) before the
+ * batch is sent.
+ *
+ * @return the new message, or NULL if the batch is full or the token is
+ * invalid
+ */
+struct oscore_posix_msg *oscore_posix_udp_batch_add(
+        struct oscore_posix_udp_batch *batch,
+        const struct sockaddr *peer,
+        socklen_t peer_len,
+        uint8_t type,
+        uint16_t message_id,
+        const uint8_t *token,
+        size_t token_len
+        );
+
+/** @brief Remove the most recently added message from a batch
+ *
+ * This is useful when a message turned out not to be sendable after all.
+ */
+OSCORE_NONNULL
+void oscore_posix_udp_batch_drop_last(struct oscore_posix_udp_batch *batch);
+
+/** @brief Receive a batch of datagrams
+ *
+ * @param[in] fd Bound UDP socket
+ * @param[out] batch Batch to receive into; previous content is discarded
+ * @param[in] flags Flags to `recvmmsg`, eg. `MSG_DONTWAIT` or
+ *     `MSG_WAITFORONE`
+ *
+ * Datagrams that are not well-formed CoAP messages are dropped.
+ *
+ * @return false if `recvmmsg` failed (with errno indicating the error;
+ * `EAGAIN` just means that nothing was there to receive)
+ */
+OSCORE_NONNULL
+bool oscore_posix_udp_receive(
+        int fd,
+        struct oscore_posix_udp_batch *batch,
+        int flags
+        );
+
+/** @brief Send all messages of a batch
+ *
+ * @param[in] fd UDP socket
+ * @param[inout] batch Batch to send; it is cleared on success
+ *
+ * @return false if `sendmmsg` failed; errno indicates the error, and the
+ * messages not sent are left in the batch.
+ */
+OSCORE_NONNULL
+bool oscore_posix_udp_send(
+        int fd,
+        struct oscore_posix_udp_batch *batch
+        );
+
+/** @brief Build a response to a request
+ *
+ * @param[in] arg Argument passed to @ref oscore_posix_udp_server_init
+ * @param[inout] request Received request. It may be modified, as it is when
+ *     it is decrypted.
+ * @param[in] peer Address the request was received from
+ * @param[in] peer_len Length of @p peer
+ * @param[inout] response Response whose header and token are already set up;
+ *     the handler sets its code, options and payload
+ *
+ * @return true if @p response is to be sent
+ */
+typedef bool (*oscore_posix_udp_handler_t)(
+        void *arg,
+        struct oscore_posix_msg *request,
+        const struct sockaddr *peer,
+        socklen_t peer_len,
+        struct oscore_posix_msg *response
+        );
+
+/** @brief State of a batching server
+ *
+ * All fields are private.
+ */
+struct oscore_posix_udp_server {
+    /** @private */
+    int fd;
+    /** @private */
+    oscore_posix_udp_handler_t handler;
+    /** @private */
+    void *arg;
+    /** @private Message ID for the next non-confirmable response */
+    uint16_t next_message_id;
+    /** @private */
+    struct oscore_posix_udp_batch rx;
+    /** @private */
+    struct oscore_posix_udp_batch tx;
+};
+
+/** @brief Set up a server
+ *
+ * @param[out] server Server to initialize
+ * @param[in] fd Bound UDP socket to serve on
+ * @param[in] handler Function that builds the responses
+ * @param[in] arg Argument passed to @p handler
+ */
+void oscore_posix_udp_server_init(
+        struct oscore_posix_udp_server *server,
+        int fd,
+        oscore_posix_udp_handler_t handler,
+        void *arg
+        );
+
+/** @brief Run one iteration of a server
+ *
+ * This receives a batch of datagrams (waiting for at least one, unless
+ * @p flags contain `MSG_DONTWAIT`), passes each request to the handler, and
+ * sends the responses in one batch. Confirmable requests are answered with
+ * piggybacked responses; responses to non-confirmable requests are
+ * non-confirmable. Messages that are not requests are ignored.
+ *
+ * @param[inout] server Server to run
+ * @param[in] flags Additional flags to `recvmmsg`
+ *
+ * @return false if receiving or sending failed; errno indicates the error.
+ */
+OSCORE_NONNULL
+bool oscore_posix_udp_server_step(
+        struct oscore_posix_udp_server *server,
+        int flags
+        );
+
+/** @} */
+
+#endif
@@ -0,0 +1,125 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <oscore_posix/b1_mmapstore.h>
+
+bool oscore_posix_b1_mmapstore_open(
+        struct oscore_posix_b1_mmapstore *store,
+        const char *path,
+        size_t count
+        )
+{
+    size_t size = count * sizeof(struct oscore_context_b1_storeslot);
+
+    int fd = open(path, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        goto fail;
+    }
+    // Growing the file produces zeroed (ie. empty) slots; a longer file is
+    // left alone so that reopening with a smaller count loses nothing.
+    if ((uintmax_t)st.st_size < size && ftruncate(fd, size) != 0) {
+        goto fail;
+    }
+
+    void *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        goto fail;
+    }
+
+    store->fd = fd;
+    store->slots = map;
+    store->count = count;
+    return true;
+
+fail:
+    close(fd);
+    return false;
+}
+
+void oscore_posix_b1_mmapstore_close(
+        struct oscore_posix_b1_mmapstore *store
+        )
+{
+    munmap(store->slots, store->count * sizeof(struct oscore_context_b1_storeslot));
+    close(store->fd);
+}
+
+/** Synchronously write back the pages that contain the given byte range of
+ * the mapping */
+static bool sync_range(struct oscore_posix_b1_mmapstore *store, size_t offset, size_t len)
+{
+    size_t pagesize = sysconf(_SC_PAGESIZE);
+    size_t start = offset - offset % pagesize;
+    return msync((uint8_t*)store->slots + start, offset + len - start, MS_SYNC) == 0;
+}
+
+bool oscore_posix_b1_mmapstore_commit(
+        struct oscore_posix_b1_mmapstore *store,
+        size_t index,
+        const struct oscore_context_primitive_immutables *immutables,
+        const struct oscore_context_b1_persistrecord *record
+        )
+{
+    struct oscore_context_b1_storeslot *slot = &store->slots[index];
+    size_t offset, len;
+
+    oscore_context_b1_store_write(slot, immutables, record, &offset, &len);
+
+    return sync_range(store, (uint8_t*)slot - (uint8_t*)store->slots + offset, len);
+}
+
+bool oscore_posix_b1_mmapstore_restore(
+        struct oscore_posix_b1_mmapstore *store,
+        struct oscore_context_b1 *contexts,
+        struct oscore_context_primitive_immutables *immutables,
+        struct oscore_context_b1_persistrecord *records,
+        bool *found
+        )
+{
+    bool any_cleared = false;
+
+    for (size_t i = 0; i < store->count; ++i) {
+        found[i] = oscore_context_b1_store_read(&store->slots[i], &immutables[i], &records[i]);
+        if (!found[i] || !records[i].has_replaydata) {
+            continue;
+        }
+
+        // Replay data may be used only once, so it is removed from the file
+        // before any context is initialized with it.
+        struct oscore_context_b1_persistrecord cleared = records[i];
+        cleared.has_replaydata = false;
+        size_t offset, len;
+        oscore_context_b1_store_write(&store->slots[i], &immutables[i], &cleared, &offset, &len);
+        any_cleared = true;
+    }
+
+    // Syncing the whole file once is cheaper than one sync per cleared record
+    // when most contexts were shut down cleanly.
+    if (any_cleared && !sync_range(store, 0, store->count * sizeof(struct oscore_context_b1_storeslot))) {
+        return false;
+    }
+
+    for (size_t i = 0; i < store->count; ++i) {
+        if (!found[i]) {
+            continue;
+        }
+        oscore_context_b1_initialize(
+                &contexts[i],
+                &immutables[i],
+                records[i].seqno,
+                records[i].has_replaydata ? &records[i].replaydata : NULL
+                );
+    }
+
+    return true;
+}
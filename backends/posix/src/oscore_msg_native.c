@@ -0,0 +1,366 @@
+#include <errno.h>
+#include <string.h>
+
+// Unless they are inlined, the accessor functions defined in msg_type.h are
+// emitted here
+#define OSCORE_POSIX_MSG_DEFINE_ACCESSORS
+
+#include <oscore_posix/msg.h>
+
+/** Size of the fixed part of the CoAP header */
+#define HEADER_LEN 4
+
+/** Number of bytes of extended length in front of the code of a message
+ * framed for reliable transports (RFC8323 Section 3.2), whose options and
+ * payload occupy @p body bytes */
+static size_t tcp_extended_length(size_t body)
+{
+    if (body < 13) {
+        return 0;
+    }
+    if (body < 269) {
+        return 1;
+    }
+    if (body < 65805) {
+        return 2;
+    }
+    return 4;
+}
+
+static size_t token_len(const struct oscore_posix_msg *msg)
+{
+    return msg->options_offset - msg->token_offset;
+}
+
+/** Validate the options of a message whose buffer and positions up to the
+ * options are already set, and set up its payload
+ *
+ * @return false if the options are malformed
+ */
+static bool parse_options(struct oscore_posix_msg *msg, size_t length)
+{
+    size_t offset = msg->options_offset;
+    uint32_t number = 0;
+    while (offset < length && msg->buf[offset] != 0xff) {
+        uint32_t delta, optlen;
+        if (!oscore_posix_parse_option_header(msg->buf, &offset, length, &delta, &optlen)) {
+            return false;
+        }
+        number += delta;
+        if (number > UINT16_MAX) {
+            return false;
+        }
+        offset += optlen;
+    }
+
+    if (offset + 1 == length) {
+        // Payload marker without payload
+        return false;
+    }
+
+    msg->size = length;
+    msg->payload_offset = offset;
+    msg->payload_len = length - offset;
+    msg->payload_used = msg->payload_len;
+    msg->last_option = number;
+    return true;
+}
+
+bool oscore_posix_msg_init_outgoing(
+        struct oscore_posix_msg *msg,
+        uint8_t *buf,
+        size_t size,
+        uint8_t type,
+        uint16_t message_id,
+        const uint8_t *token,
+        size_t token_len
+        )
+{
+    if (token_len > 8 || size < HEADER_LEN + token_len) {
+        return false;
+    }
+
+    buf[0] = 0x40 | ((type & 0x3) << 4) | token_len;
+    buf[1] = 0;
+    buf[2] = message_id >> 8;
+    buf[3] = message_id & 0xff;
+    if (token_len != 0) {
+        memcpy(&buf[HEADER_LEN], token, token_len);
+    }
+
+    msg->buf = buf;
+    msg->size = size;
+    msg->code_offset = 1;
+    msg->token_offset = HEADER_LEN;
+    msg->options_offset = HEADER_LEN + token_len;
+    msg->payload_offset = msg->options_offset;
+    msg->payload_len = size - msg->payload_offset;
+    msg->payload_used = 0;
+    msg->last_option = 0;
+    return true;
+}
+
+void oscore_posix_msg_clear(struct oscore_posix_msg *msg)
+{
+    msg->buf[msg->code_offset] = 0;
+    msg->payload_offset = msg->options_offset;
+    msg->payload_len = msg->size - msg->payload_offset;
+    msg->payload_used = 0;
+    msg->last_option = 0;
+}
+
+bool oscore_posix_msg_parse(
+        struct oscore_posix_msg *msg,
+        uint8_t *buf,
+        size_t length
+        )
+{
+    if (length < HEADER_LEN || (buf[0] >> 6) != 1 || (buf[0] & 0xf) > 8 ||
+            length < HEADER_LEN + (size_t)(buf[0] & 0xf)) {
+        return false;
+    }
+
+    msg->buf = buf;
+    msg->code_offset = 1;
+    msg->token_offset = HEADER_LEN;
+    msg->options_offset = HEADER_LEN + (buf[0] & 0xf);
+    return parse_options(msg, length);
+}
+
+size_t oscore_posix_tcp_msg_frame_length(const uint8_t *buf, size_t available)
+{
+    if (available < 1) {
+        return 0;
+    }
+
+    size_t extended = (buf[0] >> 4) == 13 ? 1 :
+                      (buf[0] >> 4) == 14 ? 2 :
+                      (buf[0] >> 4) == 15 ? 4 : 0;
+    if (available < 1 + extended) {
+        return 0;
+    }
+
+    uint64_t body;
+    switch (extended) {
+    case 0:
+        body = buf[0] >> 4;
+        break;
+    case 1:
+        body = 13 + buf[1];
+        break;
+    case 2:
+        body = 269 + ((buf[1] << 8) | buf[2]);
+        break;
+    default:
+        body = 65805 + (((uint64_t)buf[1] << 24) | (buf[2] << 16) | (buf[3] << 8) | buf[4]);
+    }
+
+    uint64_t total = 1 + extended + 1 + (buf[0] & 0xf) + body;
+    return total > SIZE_MAX ? SIZE_MAX : total;
+}
+
+bool oscore_posix_tcp_msg_init_outgoing(
+        struct oscore_posix_msg *msg,
+        uint8_t *buf,
+        size_t size,
+        const uint8_t *token,
+        size_t token_len
+        )
+{
+    // Reserve room for the longest length the message can grow to; the
+    // header is placed right in front of the code when the message is framed
+    size_t header = 1 + tcp_extended_length(size);
+    if (token_len > 8 || size < header + 1 + token_len) {
+        return false;
+    }
+
+    buf[header] = 0;
+    if (token_len != 0) {
+        memcpy(&buf[header + 1], token, token_len);
+    }
+
+    msg->buf = buf;
+    msg->size = size;
+    msg->code_offset = header;
+    msg->token_offset = header + 1;
+    msg->options_offset = header + 1 + token_len;
+    msg->payload_offset = msg->options_offset;
+    msg->payload_len = size - msg->payload_offset;
+    msg->payload_used = 0;
+    msg->last_option = 0;
+    return true;
+}
+
+bool oscore_posix_tcp_msg_parse(
+        struct oscore_posix_msg *msg,
+        uint8_t *buf,
+        size_t length
+        )
+{
+    if (oscore_posix_tcp_msg_frame_length(buf, length) != length || (buf[0] & 0xf) > 8) {
+        return false;
+    }
+
+    // The frame length covers the header, code and token, so they are all
+    // in the buffer
+    size_t header;
+    switch (buf[0] >> 4) {
+    case 13: header = 2; break;
+    case 14: header = 3; break;
+    case 15: header = 5; break;
+    default: header = 1;
+    }
+
+    msg->buf = buf;
+    msg->code_offset = header;
+    msg->token_offset = header + 1;
+    msg->options_offset = header + 1 + (buf[0] & 0xf);
+    return parse_options(msg, length);
+}
+
+size_t oscore_posix_tcp_msg_frame(struct oscore_posix_msg *msg, const uint8_t **frame)
+{
+    size_t end = msg->payload_offset + msg->payload_len;
+    size_t body = end - msg->options_offset;
+    size_t extended = tcp_extended_length(body);
+    size_t start = msg->code_offset - 1 - extended;
+
+    uint8_t nibble;
+    switch (extended) {
+    case 0:
+        nibble = body;
+        break;
+    case 1:
+        nibble = 13;
+        msg->buf[start + 1] = body - 13;
+        break;
+    case 2:
+        nibble = 14;
+        msg->buf[start + 1] = (body - 269) >> 8;
+        msg->buf[start + 2] = (body - 269) & 0xff;
+        break;
+    default:
+        nibble = 15;
+        msg->buf[start + 1] = ((body - 65805) >> 24) & 0xff;
+        msg->buf[start + 2] = ((body - 65805) >> 16) & 0xff;
+        msg->buf[start + 3] = ((body - 65805) >> 8) & 0xff;
+        msg->buf[start + 4] = (body - 65805) & 0xff;
+    }
+    msg->buf[start] = (nibble << 4) | token_len(msg);
+
+    *frame = &msg->buf[start];
+    return end - start;
+}
+
+size_t oscore_posix_msg_length(const struct oscore_posix_msg *msg)
+{
+    return msg->payload_offset + msg->payload_len;
+}
+
+uint8_t oscore_posix_msg_get_type(const struct oscore_posix_msg *msg)
+{
+    return (msg->buf[0] >> 4) & 0x3;
+}
+
+uint16_t oscore_posix_msg_get_message_id(const struct oscore_posix_msg *msg)
+{
+    return (msg->buf[2] << 8) | msg->buf[3];
+}
+
+size_t oscore_posix_msg_get_token(const struct oscore_posix_msg *msg, const uint8_t **token)
+{
+    *token = &msg->buf[msg->token_offset];
+    return token_len(msg);
+}
+
+oscore_msgerr_native_t oscore_msg_native_append_option(
+        oscore_msg_native_t msg,
+        uint16_t option_number,
+        const uint8_t *value,
+        size_t value_len
+        )
+{
+    if (option_number < msg->last_option) {
+        return -EINVAL;
+    }
+
+    uint16_t delta = option_number - msg->last_option;
+    if (value_len > UINT16_MAX) {
+        return -ENOSPC;
+    }
+    size_t optionlength = value_len + oscore_coapoption_header_length(delta, value_len);
+    if (optionlength > msg->payload_len) {
+        return -ENOSPC;
+    }
+
+    // Move what was written to the payload behind the new option. If the
+    // payload area was used to its end, its tail falls off, as the native
+    // message API allows.
+    size_t moved = msg->payload_used;
+    if (moved > msg->payload_len - optionlength) {
+        moved = msg->payload_len - optionlength;
+    }
+    uint8_t *payload = &msg->buf[msg->payload_offset];
+    memmove(payload + optionlength, payload, moved);
+
+    size_t offset = msg->payload_offset;
+    offset += oscore_coapoption_encode_header(&msg->buf[offset], delta, value_len);
+    if (value_len != 0) {
+        memcpy(&msg->buf[offset], value, value_len);
+    }
+
+    msg->payload_offset += optionlength;
+    msg->payload_len -= optionlength;
+    msg->payload_used = moved;
+    msg->last_option = option_number;
+    return 0;
+}
+
+void oscore_msg_native_set_payload_used(
+        oscore_msg_native_t msg,
+        size_t used_len
+        )
+{
+    // Counting the payload marker, which is in front of what map_payload
+    // hands out
+    size_t used = used_len == 0 ? 0 : used_len + 1;
+    if (msg->payload_used > used) {
+        msg->payload_used = used;
+    }
+}
+
+oscore_msgerr_native_t oscore_msg_native_update_option(
+        oscore_msg_native_t msg,
+        uint16_t option_number,
+        size_t option_occurrence,
+        const uint8_t *value,
+        size_t value_len
+        )
+{
+    oscore_msg_native_optiter_t iter;
+    oscore_msg_native_optiter_init(msg, &iter);
+
+    uint16_t number;
+    const uint8_t *found;
+    size_t found_len;
+    while (oscore_msg_native_optiter_next(msg, &iter, &number, &found, &found_len)) {
+        if (number != option_number) {
+            continue;
+        }
+        if (option_occurrence > 0) {
+            option_occurrence -= 1;
+            continue;
+        }
+
+        if (value_len != found_len) {
+            return -EBADMSG;
+        }
+        // Be liberal and accept user provided NULL values for zero-length references
+        if (value_len != 0) {
+            memcpy((uint8_t *)found, value, value_len);
+        }
+        return 0;
+    }
+
+    return -ENOENT;
+}
@@ -0,0 +1,39 @@
+#include <stdlib.h>
+
+#include <oscore_native/test.h>
+#include <oscore_posix/msg.h>
+
+#define MESSAGE_DEFAULT_SIZE 1024
+#define MESSAGE_POOL_SIZE 8
+
+static bool is_allocated[MESSAGE_POOL_SIZE];
+static struct oscore_posix_msg messages[MESSAGE_POOL_SIZE];
+static uint8_t buffers[MESSAGE_POOL_SIZE][MESSAGE_DEFAULT_SIZE];
+
+oscore_msg_native_t oscore_test_msg_create(void)
+{
+    for (size_t i = 0; i < MESSAGE_POOL_SIZE; ++i) {
+        if (is_allocated[i]) {
+            continue;
+        }
+        if (!oscore_posix_msg_init_outgoing(&messages[i], buffers[i], MESSAGE_DEFAULT_SIZE, 1, 0, NULL, 0)) {
+            abort();
+        }
+        is_allocated[i] = true;
+        return &messages[i];
+    }
+    return NULL;
+}
+
+void oscore_test_msg_destroy(oscore_msg_native_t message)
+{
+    if (message == NULL) {
+        return;
+    }
+
+    size_t index = message - messages;
+    if (index >= MESSAGE_POOL_SIZE || !is_allocated[index]) {
+        abort();
+    }
+    is_allocated[index] = false;
+}
@@ -0,0 +1,110 @@
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#include <oscore_posix/tcp.h>
+
+/** Code of a Capabilities and Settings Message (7.01) */
+#define CODE_CSM 0xe1
+/** Max-Message-Size option of a CSM */
+#define OPTION_MAX_MESSAGE_SIZE 2
+
+void oscore_posix_tcp_reader_init(
+        struct oscore_posix_tcp_reader *reader,
+        uint8_t *buf,
+        size_t size
+        )
+{
+    reader->buf = buf;
+    reader->size = size;
+    reader->filled = 0;
+    reader->consumed = 0;
+}
+
+int oscore_posix_tcp_receive(
+        int fd,
+        struct oscore_posix_tcp_reader *reader,
+        struct oscore_posix_msg *msg
+        )
+{
+    if (reader->consumed != 0) {
+        memmove(reader->buf, &reader->buf[reader->consumed], reader->filled - reader->consumed);
+        reader->filled -= reader->consumed;
+        reader->consumed = 0;
+    }
+
+    while (true) {
+        size_t length = oscore_posix_tcp_msg_frame_length(reader->buf, reader->filled);
+        if (length > reader->size) {
+            return -EMSGSIZE;
+        }
+        if (length != 0 && length <= reader->filled) {
+            if (!oscore_posix_tcp_msg_parse(msg, reader->buf, length)) {
+                return -EBADMSG;
+            }
+            reader->consumed = length;
+            return 1;
+        }
+        if (reader->filled == reader->size) {
+            // Not even the length could be read
+            return -EMSGSIZE;
+        }
+
+        ssize_t received = recv(fd, &reader->buf[reader->filled], reader->size - reader->filled, 0);
+        if (received < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -errno;
+        }
+        if (received == 0) {
+            // A connection closed in the middle of a message is broken
+            return reader->filled == 0 ? 0 : -ECONNRESET;
+        }
+        reader->filled += received;
+    }
+}
+
+int oscore_posix_tcp_send(int fd, struct oscore_posix_msg *msg)
+{
+    const uint8_t *frame;
+    size_t length = oscore_posix_tcp_msg_frame(msg, &frame);
+
+    while (length > 0) {
+        // Broken connections are reported as errors rather than by signal
+        ssize_t sent = send(fd, frame, length, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -errno;
+        }
+        frame += sent;
+        length -= sent;
+    }
+    return 0;
+}
+
+int oscore_posix_tcp_send_csm(int fd, uint32_t max_message_size)
+{
+    // Header, code and the longest possible option
+    uint8_t buf[1 + 1 + 1 + 4];
+    struct oscore_posix_msg msg;
+    oscore_posix_tcp_msg_init_outgoing(&msg, buf, sizeof(buf), NULL, 0);
+    oscore_msg_native_set_code(&msg, CODE_CSM);
+
+    // Option values are unsigned integers without leading zeros
+    uint8_t value[4] = {max_message_size >> 24, max_message_size >> 16, max_message_size >> 8, max_message_size};
+    size_t skip = 0;
+    while (skip < sizeof(value) && value[skip] == 0) {
+        skip += 1;
+    }
+    oscore_msgerr_native_t err = oscore_msg_native_append_option(&msg, OPTION_MAX_MESSAGE_SIZE,
+            &value[skip], sizeof(value) - skip);
+    if (oscore_msgerr_native_is_error(err)) {
+        return err;
+    }
+    oscore_msg_native_trim_payload(&msg, 0);
+
+    return oscore_posix_tcp_send(fd, &msg);
+}
@@ -0,0 +1,223 @@
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#include <oscore_posix/udp.h>
+
+/** CoAP message types used by the server */
+#define TYPE_CON 0
+#define TYPE_NON 1
+#define TYPE_ACK 2
+
+void oscore_posix_udp_batch_clear(struct oscore_posix_udp_batch *batch)
+{
+    batch->count = 0;
+    batch->buffers_used = 0;
+}
+
+size_t oscore_posix_udp_batch_count(const struct oscore_posix_udp_batch *batch)
+{
+    return batch->count;
+}
+
+struct oscore_posix_msg *oscore_posix_udp_batch_message(
+        struct oscore_posix_udp_batch *batch,
+        size_t index
+        )
+{
+    assert(index < batch->count);
+    return &batch->messages[index];
+}
+
+const struct sockaddr *oscore_posix_udp_batch_peer(
+        const struct oscore_posix_udp_batch *batch,
+        size_t index,
+        socklen_t *peer_len
+        )
+{
+    assert(index < batch->count);
+    *peer_len = batch->peer_lengths[index];
+    return (const struct sockaddr *)&batch->peers[index];
+}
+
+struct oscore_posix_msg *oscore_posix_udp_batch_add(
+        struct oscore_posix_udp_batch *batch,
+        const struct sockaddr *peer,
+        socklen_t peer_len,
+        uint8_t type,
+        uint16_t message_id,
+        const uint8_t *token,
+        size_t token_len
+        )
+{
+    if (batch->buffers_used == OSCORE_POSIX_UDP_BATCH || peer_len > sizeof(batch->peers[0])) {
+        return NULL;
+    }
+
+    size_t index = batch->count;
+    struct oscore_posix_msg *msg = &batch->messages[index];
+    if (!oscore_posix_msg_init_outgoing(msg, batch->buffers[batch->buffers_used], OSCORE_POSIX_UDP_MTU,
+                type, message_id, token, token_len)) {
+        return NULL;
+    }
+    memcpy(&batch->peers[index], peer, peer_len);
+    batch->peer_lengths[index] = peer_len;
+    batch->count += 1;
+    batch->buffers_used += 1;
+    return msg;
+}
+
+void oscore_posix_udp_batch_drop_last(struct oscore_posix_udp_batch *batch)
+{
+    assert(batch->count > 0);
+    batch->count -= 1;
+    // The message that was just added is in the last used buffer
+    batch->buffers_used -= 1;
+}
+
+bool oscore_posix_udp_receive(
+        int fd,
+        struct oscore_posix_udp_batch *batch,
+        int flags
+        )
+{
+    struct mmsghdr headers[OSCORE_POSIX_UDP_BATCH];
+    struct iovec iov[OSCORE_POSIX_UDP_BATCH];
+
+    for (size_t i = 0; i < OSCORE_POSIX_UDP_BATCH; ++i) {
+        iov[i].iov_base = batch->buffers[i];
+        iov[i].iov_len = OSCORE_POSIX_UDP_MTU;
+        memset(&headers[i].msg_hdr, 0, sizeof(headers[i].msg_hdr));
+        headers[i].msg_hdr.msg_name = &batch->peers[i];
+        headers[i].msg_hdr.msg_namelen = sizeof(batch->peers[i]);
+        headers[i].msg_hdr.msg_iov = &iov[i];
+        headers[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    oscore_posix_udp_batch_clear(batch);
+    int received = recvmmsg(fd, headers, OSCORE_POSIX_UDP_BATCH, flags, NULL);
+    if (received < 0) {
+        return false;
+    }
+
+    // Parse in place, moving only the well-formed messages' metadata to the
+    // front
+    batch->buffers_used = received;
+    for (int i = 0; i < received; ++i) {
+        if (headers[i].msg_hdr.msg_flags & MSG_TRUNC) {
+            continue;
+        }
+        if (!oscore_posix_msg_parse(&batch->messages[batch->count], batch->buffers[i], headers[i].msg_len)) {
+            continue;
+        }
+        if ((size_t)i != batch->count) {
+            memcpy(&batch->peers[batch->count], &batch->peers[i], headers[i].msg_hdr.msg_namelen);
+        }
+        batch->peer_lengths[batch->count] = headers[i].msg_hdr.msg_namelen;
+        batch->count += 1;
+    }
+
+    return true;
+}
+
+bool oscore_posix_udp_send(
+        int fd,
+        struct oscore_posix_udp_batch *batch
+        )
+{
+    struct mmsghdr headers[OSCORE_POSIX_UDP_BATCH];
+    struct iovec iov[OSCORE_POSIX_UDP_BATCH];
+
+    for (size_t i = 0; i < batch->count; ++i) {
+        iov[i].iov_base = batch->messages[i].buf;
+        iov[i].iov_len = oscore_posix_msg_length(&batch->messages[i]);
+        memset(&headers[i].msg_hdr, 0, sizeof(headers[i].msg_hdr));
+        headers[i].msg_hdr.msg_name = &batch->peers[i];
+        headers[i].msg_hdr.msg_namelen = batch->peer_lengths[i];
+        headers[i].msg_hdr.msg_iov = &iov[i];
+        headers[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    size_t sent = 0;
+    while (sent < batch->count) {
+        int result = sendmmsg(fd, &headers[sent], batch->count - sent, 0);
+        if (result < 0) {
+            // Leave only what was not sent; their buffers stay in use
+            memmove(&batch->messages[0], &batch->messages[sent], (batch->count - sent) * sizeof(batch->messages[0]));
+            memmove(&batch->peers[0], &batch->peers[sent], (batch->count - sent) * sizeof(batch->peers[0]));
+            memmove(&batch->peer_lengths[0], &batch->peer_lengths[sent], (batch->count - sent) * sizeof(batch->peer_lengths[0]));
+            batch->count -= sent;
+            return false;
+        }
+        sent += result;
+    }
+
+    oscore_posix_udp_batch_clear(batch);
+    return true;
+}
+
+void oscore_posix_udp_server_init(
+        struct oscore_posix_udp_server *server,
+        int fd,
+        oscore_posix_udp_handler_t handler,
+        void *arg
+        )
+{
+    server->fd = fd;
+    server->handler = handler;
+    server->arg = arg;
+    server->next_message_id = 0;
+    oscore_posix_udp_batch_clear(&server->rx);
+    oscore_posix_udp_batch_clear(&server->tx);
+}
+
+bool oscore_posix_udp_server_step(
+        struct oscore_posix_udp_server *server,
+        int flags
+        )
+{
+    if (!oscore_posix_udp_receive(server->fd, &server->rx, flags | MSG_WAITFORONE)) {
+        return false;
+    }
+
+    oscore_posix_udp_batch_clear(&server->tx);
+
+    for (size_t i = 0; i < server->rx.count; ++i) {
+        struct oscore_posix_msg *request = &server->rx.messages[i];
+        uint8_t code = oscore_msg_native_get_code(request);
+        uint8_t type = oscore_posix_msg_get_type(request);
+        if (code == 0 || code >= 32 || (type != TYPE_CON && type != TYPE_NON)) {
+            continue;
+        }
+
+        uint16_t message_id;
+        if (type == TYPE_CON) {
+            type = TYPE_ACK;
+            message_id = oscore_posix_msg_get_message_id(request);
+        } else {
+            message_id = server->next_message_id++;
+        }
+
+        const uint8_t *token;
+        size_t token_len = oscore_posix_msg_get_token(request, &token);
+        socklen_t peer_len;
+        const struct sockaddr *peer = oscore_posix_udp_batch_peer(&server->rx, i, &peer_len);
+
+        struct oscore_posix_msg *response = oscore_posix_udp_batch_add(
+                &server->tx, peer, peer_len, type, message_id, token, token_len);
+        // The transmit batch has as many slots as the receive batch, and the
+        // token was already validated
+        assert(response != NULL);
+
+        if (!server->handler(server->arg, request, peer, peer_len, response)) {
+            oscore_posix_udp_batch_drop_last(&server->tx);
+        }
+    }
+
+    if (server->tx.count == 0) {
+        return true;
+    }
+    return oscore_posix_udp_send(server->fd, &server->tx);
+}
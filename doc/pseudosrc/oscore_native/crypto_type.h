@@ -82,4 +82,19 @@ typedef int32_t oscore_crypto_hkdfalg_t;
  */
 typedef bool oscore_cryptoerr_t;
 
+/** @brief Build switch for a single AEAD algorithm
+ *
+ * This is not defined by default. It can be defined at build time (for the
+ * library, the backend and the application alike) to the COSE number of the
+ * only AEAD algorithm that is to be used.
+ *
+ * The library then writes the algorithm into the AAD as a precomputed
+ * constant. Backends that support this only accept that algorithm in @ref
+ * oscore_crypto_aead_from_number. They size @ref OSCORE_CRYPTO_AEAD_IV_MAXLEN
+ * and @ref OSCORE_CRYPTO_AEAD_KEY_MAXLEN for it, and provide @ref
+ * oscore_crypto_aead_get_number and the length functions as `static inline`
+ * definitions of constants in their ``oscore_native/crypto_type.h``.
+ */
+#define OSCORE_FIXED_AEADALG 10
+
 /** @} */
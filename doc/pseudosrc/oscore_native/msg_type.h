@@ -31,4 +31,14 @@ typedef struct example_optiter oscore_msg_native_optiter_t;
  */
 typedef int32_ oscore_msgerr_native_t;
 
+/** @brief Build switch for inline definitions of message functions
+ *
+ * This is not defined by default. When it is defined at build time (for the
+ * library, the backend and the application alike), backends that support it
+ * provide some of the @ref oscore_native_msg functions as `static inline`
+ * definitions in their ``oscore_native/msg_type.h`` file. Backends without
+ * such definitions ignore it.
+ */
+#define OSCORE_MSG_NATIVE_STATIC
+
 /** @} */
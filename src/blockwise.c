@@ -0,0 +1,134 @@
+#include <string.h>
+#include <oscore/blockwise.h>
+
+/** Largest block number expressible in a Block2 option */
+#define BLOCKNUM_MAX ((1 << 20) - 1)
+
+/** Upper bound on the size of the Block2 (2 bytes of header and 3 of value)
+ * and Size2 (2 and 4) options, which are added after the payload is mapped
+ * and thus shrink it */
+#define OPTIONS_RESERVE 11
+
+/** Encode @p value as a CoAP uint option value into @p buffer, and return its
+ * length */
+static size_t encode_uint(uint8_t buffer[4], uint32_t value)
+{
+    size_t len = value > 0xffffff ? 4 : value > 0xffff ? 3 : value > 0xff ? 2 : value > 0 ? 1 : 0;
+    for (size_t i = 0; i < len; ++i) {
+        buffer[i] = value >> (8 * (len - 1 - i));
+    }
+    return len;
+}
+
+bool oscore_blockwise_parse_block2(
+        oscore_msg_protected_t *request,
+        struct oscore_blockwise_block2 *block
+        )
+{
+    block->num = 0;
+    block->szx = OSCORE_BLOCKWISE_DEFAULT_SZX;
+
+    const uint8_t *value;
+    size_t value_len;
+    oscore_msgerr_protected_t err = oscore_msg_protected_get_inner_option(request, 23 /* Block2 */, 0, &value, &value_len);
+    if (err == INVALID_ARG_ERROR) {
+        // Absent
+        return true;
+    }
+    if (err != OK || value_len > 3) {
+        return false;
+    }
+
+    uint32_t numeric = 0;
+    for (size_t i = 0; i < value_len; ++i) {
+        numeric = (numeric << 8) | value[i];
+    }
+    // ignoring the "M" bit, which has no meaning in requests
+    if ((numeric & 0x7) == 7) {
+        return false;
+    }
+    block->num = numeric >> 4;
+    block->szx = numeric & 0x7;
+    return true;
+}
+
+enum oscore_blockwise_result oscore_blockwise_write_block2(
+        oscore_msg_protected_t *response,
+        struct oscore_blockwise_block2 *block,
+        size_t total_length,
+        oscore_blockwise_read_t read,
+        void *source
+        )
+{
+    uint8_t *payload;
+    size_t available;
+    oscore_msgerr_protected_t err = oscore_msg_protected_map_payload(response, &payload, &available);
+    if (err != OK) {
+        return OSCORE_BLOCKWISE_MESSAGE_ERROR;
+    }
+
+    size_t blocksize;
+    while (true) {
+        blocksize = (size_t)1 << (block->szx + 4);
+        if (blocksize + OPTIONS_RESERVE <= available) {
+            break;
+        }
+        if (block->szx == 0) {
+            return OSCORE_BLOCKWISE_MESSAGE_ERROR;
+        }
+        block->szx --;
+        block->num <<= 1;
+    }
+
+    uint64_t start = (uint64_t)block->num * blocksize;
+    if (block->num > BLOCKNUM_MAX || (start >= total_length && start != 0)) {
+        err = oscore_msg_protected_trim_payload(response, 0);
+        return err == OK ? OSCORE_BLOCKWISE_OUT_OF_RANGE : OSCORE_BLOCKWISE_MESSAGE_ERROR;
+    }
+    size_t len = total_length - start;
+    if (len > blocksize) {
+        len = blocksize;
+    }
+    bool m = start + len < total_length;
+
+    uint8_t optionbuffer[4];
+    size_t optionlength;
+
+    optionlength = encode_uint(optionbuffer, (block->num << 4) | (m << 3) | block->szx);
+    err = oscore_msg_protected_append_option(response, 23 /* Block2 */, optionbuffer, optionlength);
+    if (err != OK) {
+        return OSCORE_BLOCKWISE_MESSAGE_ERROR;
+    }
+
+    if (block->num == 0 && total_length <= UINT32_MAX) {
+        optionlength = encode_uint(optionbuffer, total_length);
+        err = oscore_msg_protected_append_option(response, 28 /* Size2 */, optionbuffer, optionlength);
+        if (err != OK) {
+            return OSCORE_BLOCKWISE_MESSAGE_ERROR;
+        }
+    }
+
+    // Options moved the payload
+    err = oscore_msg_protected_map_payload(response, &payload, &available);
+    if (err != OK || available < len) {
+        return OSCORE_BLOCKWISE_MESSAGE_ERROR;
+    }
+
+    if (len != 0 && !read(source, start, payload, len)) {
+        return OSCORE_BLOCKWISE_READ_ERROR;
+    }
+
+    err = oscore_msg_protected_trim_payload(response, len);
+    return err == OK ? OSCORE_BLOCKWISE_OK : OSCORE_BLOCKWISE_MESSAGE_ERROR;
+}
+
+bool oscore_blockwise_read_memory(
+        void *source,
+        size_t offset,
+        uint8_t *dest,
+        size_t len
+        )
+{
+    memcpy(dest, (const uint8_t *)source + offset, len);
+    return true;
+}
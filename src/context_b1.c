@@ -17,6 +17,7 @@ void oscore_context_b1_initialize(
     secctx->high_sequence_number = seqno;
 
     secctx->echo_value_populated = 0;
+    secctx->echo = NULL;
 
     if (replaydata == NULL) {
         secctx->primitive.replay_window_left_edge = OSCORE_SEQNO_MAX;
@@ -45,6 +46,14 @@ uint64_t oscore_context_b1_get_wanted(
     return secctx->high_sequence_number;
 }
 
+void oscore_context_b1_set_stateless_echo(
+        struct oscore_context_b1 *secctx,
+        const struct oscore_echo *echo
+        )
+{
+    secctx->echo = echo;
+}
+
 void oscore_context_b1_replay_extract(
     struct oscore_context_b1 *secctx,
     struct oscore_context_b1_replaydata *replaydata
@@ -75,6 +84,19 @@ void oscore_context_b1_get_echo(
     struct oscore_context_b1 *b1 = secctx->data;
 
     *value = b1->echo_value;
+
+    if (b1->echo != NULL) {
+        // Regenerated every time as the timestamp in it moves on; this costs
+        // a MAC but no sequence number.
+        if (b1->primitive.replay_window_left_edge == OSCORE_SEQNO_MAX &&
+                oscore_echo_generate(b1->echo, secctx, b1->echo_value)) {
+            *value_length = OSCORE_ECHO_VALUE_LEN;
+        } else {
+            *value_length = 0;
+        }
+        return;
+    }
+
     if (b1->echo_value_populated != 0) {
         *value_length = b1->echo_value_populated;
         return;
@@ -93,6 +115,25 @@ void oscore_context_b1_get_echo(
     }
 }
 
+/** Start the replay window at the request's sequence number, and mark the
+ * request as fresh */
+static void init_replay_window(
+        struct oscore_context_b1 *b1,
+        oscore_requestid_t *request_id,
+        enum oscore_unprotect_request_result *unprotectresult
+        )
+{
+    b1->primitive.replay_window_left_edge = \
+                      request_id->bytes[4] + \
+                      request_id->bytes[3] * ((int64_t)1 << 8) + \
+                      request_id->bytes[2] * ((int64_t)1 << 16) + \
+                      request_id->bytes[1] * ((int64_t)1 << 24) + \
+                      request_id->bytes[0] * ((int64_t)1 << 32);
+    b1->primitive.replay_window = 0;
+    request_id->is_first_use = true;
+    *unprotectresult = OSCORE_UNPROTECT_REQUEST_OK;
+}
+
 bool oscore_context_b1_process_request(
         oscore_context_t *secctx,
         oscore_msg_protected_t *request,
@@ -110,6 +151,14 @@ bool oscore_context_b1_process_request(
             b1->primitive.replay_window_left_edge != OSCORE_SEQNO_MAX)
         return false;
 
+    if (b1->echo != NULL) {
+        if (!oscore_echo_verify_request(b1->echo, secctx, request)) {
+            return true;
+        }
+        init_replay_window(b1, request_id, unprotectresult);
+        return false;
+    }
+
     size_t echo_length;
     uint8_t *echo_value;
     oscore_context_b1_get_echo(secctx, &echo_length, &echo_value);
@@ -130,15 +179,7 @@ bool oscore_context_b1_process_request(
                 opt_len == echo_length &&
                 memcmp(opt_val, echo_value, echo_length) == 0) {
             // Matches, and replay window was previously checked to be uninitialized
-            b1->primitive.replay_window_left_edge = \
-                              request_id->bytes[4] + \
-                              request_id->bytes[3] * ((int64_t)1 << 8) + \
-                              request_id->bytes[2] * ((int64_t)1 << 16) + \
-                              request_id->bytes[1] * ((int64_t)1 << 24) + \
-                              request_id->bytes[0] * ((int64_t)1 << 32);
-            b1->primitive.replay_window = 0;
-            request_id->is_first_use = true;
-            *unprotectresult = OSCORE_UNPROTECT_REQUEST_OK;
+            init_replay_window(b1, request_id, unprotectresult);
             result = false;
             break;
         }
@@ -0,0 +1,112 @@
+#include <assert.h>
+#include <oscore/contextpair.h>
+#include <oscore/context_impl/b1_persist.h>
+
+void oscore_context_b1_persist_init(
+        struct oscore_context_b1_persist *persist,
+        struct oscore_context_b1 *secctx,
+        uint64_t lease
+        )
+{
+    assert(lease >= 2);
+
+    persist->secctx = secctx;
+    persist->lease = lease;
+    // Whatever the context was initialized with is what was persisted before
+    persist->requested = secctx->high_sequence_number;
+    persist->durable = secctx->high_sequence_number;
+    persist->staged_pending = false;
+    persist->in_flight = false;
+    persist->shut_down = false;
+}
+
+bool oscore_context_b1_persist_poll(
+        struct oscore_context_b1_persist *persist
+        )
+{
+    struct oscore_context_b1 *b1 = persist->secctx;
+
+    assert(!persist->shut_down);
+
+    if (persist->durable > b1->high_sequence_number) {
+        oscore_context_b1_allow_high(b1, persist->durable);
+    }
+
+    // The context never deals out numbers at or above its high sequence
+    // number, and that is never above what was requested, so this can't
+    // underflow.
+    uint64_t next = b1->primitive.sender_sequence_number;
+    assert(persist->requested >= next);
+    if (persist->requested - next >= persist->lease / 2) {
+        return false;
+    }
+
+    uint64_t wanted = next + persist->lease;
+    if (wanted > OSCORE_SEQNO_MAX) {
+        wanted = OSCORE_SEQNO_MAX;
+    }
+    if (wanted <= persist->requested) {
+        // Sequence number space exhausted; nothing more to request
+        return false;
+    }
+
+    persist->requested = wanted;
+    persist->staged.seqno = wanted;
+    persist->staged.has_replaydata = false;
+
+    // If a record was already pending, it is just replaced, and the
+    // background task does not need another wake-up.
+    bool was_pending = persist->staged_pending;
+    persist->staged_pending = true;
+    return !was_pending;
+}
+
+bool oscore_context_b1_persist_take(
+        struct oscore_context_b1_persist *persist,
+        struct oscore_context_b1_persistrecord *record
+        )
+{
+    if (!persist->staged_pending || persist->in_flight) {
+        return false;
+    }
+
+    *record = persist->staged;
+    persist->staged_pending = false;
+    persist->in_flight = true;
+    return true;
+}
+
+void oscore_context_b1_persist_complete(
+        struct oscore_context_b1_persist *persist,
+        const struct oscore_context_b1_persistrecord *record
+        )
+{
+    assert(persist->in_flight);
+
+    persist->in_flight = false;
+    if (record->seqno > persist->durable) {
+        persist->durable = record->seqno;
+    }
+}
+
+void oscore_context_b1_persist_shutdown(
+        struct oscore_context_b1_persist *persist
+        )
+{
+    assert(!persist->shut_down);
+    persist->shut_down = true;
+
+    // Any limit requested may have been passed to allow_high by the time the
+    // final record is read back, so the highest one is the only safe choice.
+    persist->staged.seqno = persist->requested;
+    persist->staged.has_replaydata = true;
+    oscore_context_b1_replay_extract(persist->secctx, &persist->staged.replaydata);
+    persist->staged_pending = true;
+}
+
+bool oscore_context_b1_persist_is_idle(
+        const struct oscore_context_b1_persist *persist
+        )
+{
+    return !persist->staged_pending && !persist->in_flight;
+}
@@ -0,0 +1,184 @@
+#include <string.h>
+#include <oscore/context_impl/b1_store.h>
+
+#define FLAG_HAS_REPLAYDATA 0x01
+
+_Static_assert(OSCORE_CRYPTO_AEAD_IV_MAXLEN <= OSCORE_CONTEXT_B1_STORE_IV_SIZE,
+        "Common IV does not fit the record format");
+_Static_assert(OSCORE_KEYID_MAXLEN <= OSCORE_CONTEXT_B1_STORE_KEYID_SIZE,
+        "Key IDs do not fit the record format");
+_Static_assert(OSCORE_CRYPTO_AEAD_KEY_MAXLEN <= OSCORE_CONTEXT_B1_STORE_KEY_SIZE,
+        "Keys do not fit the record format");
+
+static uint32_t crc32(const uint8_t *data, size_t len)
+{
+    uint32_t crc = 0xffffffff;
+    for (size_t i = 0; i < len; ++i) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
+
+static void put_u32(uint8_t **cursor, uint32_t value)
+{
+    for (int i = 3; i >= 0; --i) {
+        *((*cursor)++) = value >> (8 * i);
+    }
+}
+
+static void put_u64(uint8_t **cursor, uint64_t value)
+{
+    put_u32(cursor, value >> 32);
+    put_u32(cursor, value);
+}
+
+/** Write @p len bytes of @p data into a field of @p size bytes, zero padded */
+static void put_bytes(uint8_t **cursor, const uint8_t *data, size_t len, size_t size)
+{
+    memcpy(*cursor, data, len);
+    memset(*cursor + len, 0, size - len);
+    *cursor += size;
+}
+
+static uint32_t get_u32(const uint8_t **cursor)
+{
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i) {
+        value = (value << 8) | *((*cursor)++);
+    }
+    return value;
+}
+
+static uint64_t get_u64(const uint8_t **cursor)
+{
+    uint64_t high = get_u32(cursor);
+    return (high << 32) | get_u32(cursor);
+}
+
+/** Read the first @p len bytes of a field of @p size bytes into @p data */
+static void get_bytes(const uint8_t **cursor, uint8_t *data, size_t len, size_t size)
+{
+    memcpy(data, *cursor, len);
+    *cursor += size;
+}
+
+/** Check whether a serialized version is intact and of the current format,
+ * and if so, populate its generation */
+static bool version_intact(const uint8_t *version, uint32_t *generation)
+{
+    const uint8_t *cursor = &version[OSCORE_CONTEXT_B1_STORE_RECORD_SIZE - 4];
+    uint32_t checksum = get_u32(&cursor);
+
+    if (version[0] != OSCORE_CONTEXT_B1_STORE_FORMAT ||
+            checksum != crc32(version, OSCORE_CONTEXT_B1_STORE_RECORD_SIZE - 4)) {
+        return false;
+    }
+
+    cursor = &version[1];
+    *generation = get_u32(&cursor);
+    return true;
+}
+
+/** Find the index of the latest intact version in a slot, or -1 if there is
+ * none. The generation counter is compared in serial number arithmetic, so it
+ * may wrap. */
+static int find_current(const struct oscore_context_b1_storeslot *slot, uint32_t *generation)
+{
+    uint32_t generations[2];
+    bool intact[2];
+    for (int i = 0; i < 2; ++i) {
+        intact[i] = version_intact(slot->versions[i], &generations[i]);
+    }
+
+    int current;
+    if (intact[0] && intact[1]) {
+        current = (int32_t)(generations[1] - generations[0]) > 0 ? 1 : 0;
+    } else if (intact[0]) {
+        current = 0;
+    } else if (intact[1]) {
+        current = 1;
+    } else {
+        return -1;
+    }
+    *generation = generations[current];
+    return current;
+}
+
+bool oscore_context_b1_store_read(
+        const struct oscore_context_b1_storeslot *slot,
+        struct oscore_context_primitive_immutables *immutables,
+        struct oscore_context_b1_persistrecord *record
+        )
+{
+    uint32_t generation;
+    int current = find_current(slot, &generation);
+    if (current == -1) {
+        return false;
+    }
+
+    // Skipping format and generation
+    const uint8_t *cursor = &slot->versions[current][5];
+
+    record->seqno = get_u64(&cursor);
+    uint8_t flags = *(cursor++);
+    record->has_replaydata = (flags & FLAG_HAS_REPLAYDATA) != 0;
+    record->replaydata.left_edge = get_u64(&cursor);
+    record->replaydata.window = get_u32(&cursor);
+
+    int32_t alg = (int32_t)get_u32(&cursor);
+    if (oscore_cryptoerr_is_error(oscore_crypto_aead_from_number(&immutables->aeadalg, alg))) {
+        return false;
+    }
+
+    get_bytes(&cursor, immutables->common_iv, OSCORE_CRYPTO_AEAD_IV_MAXLEN, OSCORE_CONTEXT_B1_STORE_IV_SIZE);
+    immutables->sender_id_len = *(cursor++);
+    get_bytes(&cursor, immutables->sender_id, OSCORE_KEYID_MAXLEN, OSCORE_CONTEXT_B1_STORE_KEYID_SIZE);
+    get_bytes(&cursor, immutables->sender_key, OSCORE_CRYPTO_AEAD_KEY_MAXLEN, OSCORE_CONTEXT_B1_STORE_KEY_SIZE);
+    immutables->recipient_id_len = *(cursor++);
+    get_bytes(&cursor, immutables->recipient_id, OSCORE_KEYID_MAXLEN, OSCORE_CONTEXT_B1_STORE_KEYID_SIZE);
+    get_bytes(&cursor, immutables->recipient_key, OSCORE_CRYPTO_AEAD_KEY_MAXLEN, OSCORE_CONTEXT_B1_STORE_KEY_SIZE);
+
+    return immutables->sender_id_len <= OSCORE_KEYID_MAXLEN &&
+        immutables->recipient_id_len <= OSCORE_KEYID_MAXLEN;
+}
+
+void oscore_context_b1_store_write(
+        struct oscore_context_b1_storeslot *slot,
+        const struct oscore_context_primitive_immutables *immutables,
+        const struct oscore_context_b1_persistrecord *record,
+        size_t *changed_offset,
+        size_t *changed_len
+        )
+{
+    uint32_t generation = 0;
+    int current = find_current(slot, &generation);
+    int target = current == 0 ? 1 : 0;
+
+    int32_t alg = 0;
+    oscore_crypto_aead_get_number(immutables->aeadalg, &alg);
+
+    uint8_t *version = slot->versions[target];
+    uint8_t *cursor = version;
+
+    *(cursor++) = OSCORE_CONTEXT_B1_STORE_FORMAT;
+    put_u32(&cursor, generation + 1);
+    put_u64(&cursor, record->seqno);
+    *(cursor++) = record->has_replaydata ? FLAG_HAS_REPLAYDATA : 0;
+    put_u64(&cursor, record->has_replaydata ? record->replaydata.left_edge : 0);
+    put_u32(&cursor, record->has_replaydata ? record->replaydata.window : 0);
+    put_u32(&cursor, (uint32_t)alg);
+    put_bytes(&cursor, immutables->common_iv, OSCORE_CRYPTO_AEAD_IV_MAXLEN, OSCORE_CONTEXT_B1_STORE_IV_SIZE);
+    *(cursor++) = immutables->sender_id_len;
+    put_bytes(&cursor, immutables->sender_id, OSCORE_KEYID_MAXLEN, OSCORE_CONTEXT_B1_STORE_KEYID_SIZE);
+    put_bytes(&cursor, immutables->sender_key, OSCORE_CRYPTO_AEAD_KEY_MAXLEN, OSCORE_CONTEXT_B1_STORE_KEY_SIZE);
+    *(cursor++) = immutables->recipient_id_len;
+    put_bytes(&cursor, immutables->recipient_id, OSCORE_KEYID_MAXLEN, OSCORE_CONTEXT_B1_STORE_KEYID_SIZE);
+    put_bytes(&cursor, immutables->recipient_key, OSCORE_CRYPTO_AEAD_KEY_MAXLEN, OSCORE_CONTEXT_B1_STORE_KEY_SIZE);
+    put_u32(&cursor, crc32(version, cursor - version));
+
+    *changed_offset = version - (uint8_t*)slot;
+    *changed_len = cursor - version;
+}
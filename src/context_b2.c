@@ -0,0 +1,317 @@
+#include <string.h>
+#include <oscore/contextpair.h>
+#include <oscore/context_impl/b2.h>
+
+bool oscore_context_b2_derive(
+        const struct oscore_context_b2 *secctx,
+        const uint8_t *id_context,
+        size_t id_context_len,
+        struct oscore_context_b2_derived *derived
+        )
+{
+    if (id_context_len > OSCORE_KEYIDCONTEXT_MAXLEN) {
+        return false;
+    }
+
+    // Takes algorithm and IDs from the current context; keys and IV are
+    // overwritten by the derivation
+    derived->immutables = *secctx->primitive.immutables;
+    oscore_cryptoerr_t err = oscore_context_primitive_derive(
+            &derived->immutables,
+            secctx->hkdfalg,
+            secctx->master_salt, secctx->master_salt_len,
+            secctx->master_secret, secctx->master_secret_len,
+            id_context_len == 0 ? NULL : id_context, id_context_len
+            );
+    if (oscore_cryptoerr_is_error(err)) {
+        return false;
+    }
+
+    derived->secctx = secctx;
+    if (id_context_len != 0) {
+        memcpy(derived->id_context, id_context, id_context_len);
+    }
+    derived->id_context_len = id_context_len;
+    return true;
+}
+
+/** Place key material for the given ID Context into the immutables slot that
+ * is not in use, taking it from @p prepared if that was derived for it, and
+ * deriving it otherwise.
+ *
+ * The slot is only written to on success, so a context kept around for
+ * reverting (which may live in that slot) stays intact on failure. */
+static bool derive_into_spare(
+        struct oscore_context_b2 *b2,
+        const uint8_t *id_context,
+        size_t id_context_len,
+        const struct oscore_context_b2_derived *prepared,
+        struct oscore_context_primitive_immutables **spare
+        )
+{
+    struct oscore_context_b2_derived derived;
+    if (prepared == NULL || prepared->secctx != b2 ||
+            prepared->id_context_len != id_context_len ||
+            memcmp(prepared->id_context, id_context, id_context_len) != 0) {
+        if (!oscore_context_b2_derive(b2, id_context, id_context_len, &derived)) {
+            return false;
+        }
+        prepared = &derived;
+    }
+
+    *spare = b2->primitive.immutables == &b2->immutables[0] ?
+        &b2->immutables[1] : &b2->immutables[0];
+    **spare = prepared->immutables;
+    return true;
+}
+
+/** Start using freshly derived key material, optionally keeping the current
+ * state for @ref revert */
+static void switch_to(
+        struct oscore_context_b2 *b2,
+        struct oscore_context_primitive_immutables *immutables,
+        const uint8_t *id_context,
+        size_t id_context_len,
+        bool tentative
+        )
+{
+    if (tentative) {
+        b2->previous = b2->primitive;
+        memcpy(b2->previous_id_context, b2->id_context, b2->id_context_len);
+        b2->previous_id_context_len = b2->id_context_len;
+        b2->previous_state = b2->state;
+    }
+
+    if (id_context_len != 0) {
+        // id_context may overlap with b2->id_context (when extending it)
+        memmove(b2->id_context, id_context, id_context_len);
+    }
+    b2->id_context_len = id_context_len;
+
+    b2->primitive.immutables = immutables;
+    b2->primitive.sender_sequence_number = 0;
+    // A new context has never seen any request
+    b2->primitive.replay_window_left_edge = 0;
+    b2->primitive.replay_window = 0;
+}
+
+static void revert(struct oscore_context_b2 *b2)
+{
+    b2->primitive = b2->previous;
+    memcpy(b2->id_context, b2->previous_id_context, b2->previous_id_context_len);
+    b2->id_context_len = b2->previous_id_context_len;
+    b2->state = b2->previous_state;
+}
+
+bool oscore_context_b2_initialize(
+        struct oscore_context_b2 *secctx,
+        const struct oscore_context_primitive_immutables *template,
+        oscore_crypto_hkdfalg_t hkdfalg,
+        const uint8_t *master_secret,
+        size_t master_secret_len,
+        const uint8_t *master_salt,
+        size_t master_salt_len,
+        const uint8_t *id_context,
+        size_t id_context_len
+        )
+{
+    if (master_secret_len > OSCORE_CONTEXT_B2_SECRET_MAXLEN ||
+            master_salt_len > OSCORE_CONTEXT_B2_SALT_MAXLEN ||
+            id_context_len > OSCORE_KEYIDCONTEXT_MAXLEN) {
+        return false;
+    }
+
+    secctx->hkdfalg = hkdfalg;
+    memcpy(secctx->master_secret, master_secret, master_secret_len);
+    secctx->master_secret_len = master_secret_len;
+    if (master_salt_len != 0) {
+        memcpy(secctx->master_salt, master_salt, master_salt_len);
+    }
+    secctx->master_salt_len = master_salt_len;
+
+    secctx->immutables[0] = *template;
+    oscore_cryptoerr_t err = oscore_context_primitive_derive(
+            &secctx->immutables[0],
+            hkdfalg,
+            secctx->master_salt, master_salt_len,
+            secctx->master_secret, master_secret_len,
+            id_context, id_context_len
+            );
+    if (oscore_cryptoerr_is_error(err)) {
+        return false;
+    }
+
+    secctx->state = OSCORE_CONTEXT_B2_IDLE;
+    switch_to(secctx, &secctx->immutables[0], id_context, id_context_len, false);
+    return true;
+}
+
+bool oscore_context_b2_wants_rekey(
+        const struct oscore_context_b2 *secctx
+        )
+{
+    return secctx->state == OSCORE_CONTEXT_B2_IDLE &&
+        OSCORE_SEQNO_MAX - secctx->primitive.sender_sequence_number < OSCORE_CONTEXT_B2_REKEY_MARGIN;
+}
+
+bool oscore_context_b2_initiate(
+        struct oscore_context_b2 *secctx,
+        const uint8_t *r1,
+        size_t r1_len,
+        const struct oscore_context_b2_derived *derived
+        )
+{
+    if (r1_len == 0 || r1_len > OSCORE_KEYIDCONTEXT_MAXLEN / 2) {
+        return false;
+    }
+
+    struct oscore_context_primitive_immutables *spare;
+    if (!derive_into_spare(secctx, r1, r1_len, derived, &spare)) {
+        return false;
+    }
+
+    // The old context is not reverted to: it is either exhausted, or was
+    // given up on by the application.
+    switch_to(secctx, spare, r1, r1_len, false);
+    secctx->state = OSCORE_CONTEXT_B2_INITIATED;
+    return true;
+}
+
+bool oscore_context_b2_process_kidcontext(
+        struct oscore_context_b2 *secctx,
+        const uint8_t *kidcontext,
+        size_t kidcontext_len,
+        bool is_request,
+        const struct oscore_context_b2_derived *derived
+        )
+{
+    struct oscore_context_primitive_immutables *spare;
+
+    if (is_request) {
+        if (kidcontext == NULL || (kidcontext_len == secctx->id_context_len &&
+                    memcmp(kidcontext, secctx->id_context, kidcontext_len) == 0)) {
+            // A request in the current context (which, after responding,
+            // means that the client has switched over as well)
+            if (secctx->state == OSCORE_CONTEXT_B2_RESPONDED) {
+                secctx->state = OSCORE_CONTEXT_B2_IDLE;
+            }
+            return false;
+        }
+
+        if (kidcontext_len == 0 || kidcontext_len > OSCORE_KEYIDCONTEXT_MAXLEN / 2) {
+            return false;
+        }
+        if (!derive_into_spare(secctx, kidcontext, kidcontext_len, derived, &spare)) {
+            return false;
+        }
+        switch_to(secctx, spare, kidcontext, kidcontext_len, true);
+        secctx->state = OSCORE_CONTEXT_B2_REQUEST_TENTATIVE;
+        return true;
+    } else {
+        // Only R1|R2 is expected, and only while waiting for it
+        if (secctx->state != OSCORE_CONTEXT_B2_INITIATED ||
+                kidcontext == NULL ||
+                kidcontext_len <= secctx->id_context_len ||
+                kidcontext_len > OSCORE_KEYIDCONTEXT_MAXLEN ||
+                memcmp(kidcontext, secctx->id_context, secctx->id_context_len) != 0) {
+            return false;
+        }
+        if (!derive_into_spare(secctx, kidcontext, kidcontext_len, derived, &spare)) {
+            return false;
+        }
+        switch_to(secctx, spare, kidcontext, kidcontext_len, true);
+        secctx->state = OSCORE_CONTEXT_B2_RESPONSE_TENTATIVE;
+        return true;
+    }
+}
+
+bool oscore_context_b2_process_request(
+        oscore_context_t *secctx,
+        enum oscore_unprotect_request_result *unprotectresult,
+        oscore_requestid_t *request_id
+        )
+{
+    if (secctx->type != OSCORE_CONTEXT_B2) {
+        // This is a usage error.
+        // FIXME introduce optional usage error callback
+        return false;
+    }
+    struct oscore_context_b2 *b2 = secctx->data;
+
+    if (b2->state != OSCORE_CONTEXT_B2_REQUEST_TENTATIVE) {
+        return false;
+    }
+
+    if (*unprotectresult == OSCORE_UNPROTECT_REQUEST_INVALID) {
+        revert(b2);
+        return false;
+    }
+
+    // The request may be a replay of an earlier procedure's first request;
+    // the application must not act on it.
+    request_id->is_first_use = false;
+    *unprotectresult = OSCORE_UNPROTECT_REQUEST_DUPLICATE;
+    b2->state = OSCORE_CONTEXT_B2_REQUEST_VERIFIED;
+    return true;
+}
+
+bool oscore_context_b2_respond(
+        oscore_context_t *secctx,
+        const uint8_t *r2,
+        size_t r2_len,
+        const struct oscore_context_b2_derived *derived
+        )
+{
+    if (secctx->type != OSCORE_CONTEXT_B2) {
+        // This is a usage error.
+        // FIXME introduce optional usage error callback
+        return false;
+    }
+    struct oscore_context_b2 *b2 = secctx->data;
+
+    if (b2->state != OSCORE_CONTEXT_B2_REQUEST_VERIFIED) {
+        return false;
+    }
+
+    uint8_t id_context[OSCORE_KEYIDCONTEXT_MAXLEN];
+    struct oscore_context_primitive_immutables *spare;
+    if (r2_len == 0 || b2->id_context_len + r2_len > OSCORE_KEYIDCONTEXT_MAXLEN) {
+        revert(b2);
+        return false;
+    }
+    memcpy(id_context, b2->id_context, b2->id_context_len);
+    memcpy(&id_context[b2->id_context_len], r2, r2_len);
+
+    if (!derive_into_spare(b2, id_context, b2->id_context_len + r2_len, derived, &spare)) {
+        revert(b2);
+        return false;
+    }
+    // The spare slot held the context from before the request, which can not
+    // be reverted to any more
+    switch_to(b2, spare, id_context, b2->id_context_len + r2_len, false);
+    b2->state = OSCORE_CONTEXT_B2_RESPONDED;
+    return true;
+}
+
+void oscore_context_b2_process_response(
+        oscore_context_t *secctx,
+        enum oscore_unprotect_response_result unprotectresult
+        )
+{
+    if (secctx->type != OSCORE_CONTEXT_B2) {
+        // This is a usage error.
+        // FIXME introduce optional usage error callback
+        return;
+    }
+    struct oscore_context_b2 *b2 = secctx->data;
+
+    if (b2->state != OSCORE_CONTEXT_B2_RESPONSE_TENTATIVE) {
+        return;
+    }
+
+    if (unprotectresult == OSCORE_UNPROTECT_RESPONSE_OK) {
+        b2->state = OSCORE_CONTEXT_B2_IDLE;
+    } else {
+        revert(b2);
+    }
+}
@@ -1,6 +1,8 @@
 #include <assert.h>
 #include <oscore/context_impl/primitive.h>
 
+#include "internal.h"
+
 const size_t info_maxlen = 1 + \
     /* Assuming OSCORE_KEYID_MAXLEN is not >255 */ \
     2 + \
@@ -14,10 +16,6 @@ const size_t info_maxlen = 1 + \
     /* Assuming derived lengths all fit in a u16 */ \
     3;
 
-extern size_t cbor_intencode(size_t input, uint8_t buf[5], uint8_t type);
-extern size_t cbor_intsize(size_t input);
-extern size_t cbor_signedintencode(int32_t input, uint8_t buf[5]);
-extern size_t cbor_signedintsize(int32_t input);
 
 /** Build an `info` and derive a single output parameter.
  *
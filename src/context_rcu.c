@@ -0,0 +1,67 @@
+#include <assert.h>
+#include <oscore/context_impl/rcu.h>
+
+void oscore_context_rcu_init(
+        struct oscore_context_rcu *rcu,
+        const oscore_context_t *initial
+        )
+{
+    rcu->slots[0] = *initial;
+    atomic_init(&rcu->current, 0);
+    atomic_init(&rcu->readers[0], 0);
+    atomic_init(&rcu->readers[1], 0);
+}
+
+oscore_context_t *oscore_context_rcu_acquire(
+        struct oscore_context_rcu *rcu
+        )
+{
+    while (true) {
+        unsigned int index = atomic_load(&rcu->current);
+        atomic_fetch_add(&rcu->readers[index], 1);
+        // If a publication happened in between, the slot may be in the
+        // process of being overwritten; the publisher only checks for readers
+        // before it writes, so we can't rely on that and need to go again.
+        if (atomic_load(&rcu->current) == index) {
+            return &rcu->slots[index];
+        }
+        atomic_fetch_sub(&rcu->readers[index], 1);
+    }
+}
+
+void oscore_context_rcu_release(
+        struct oscore_context_rcu *rcu,
+        oscore_context_t *secctx
+        )
+{
+    unsigned int index = secctx == &rcu->slots[0] ? 0 : 1;
+    assert(secctx == &rcu->slots[index]);
+
+    unsigned int previous = atomic_fetch_sub(&rcu->readers[index], 1);
+    assert(previous != 0);
+    (void)previous;
+}
+
+bool oscore_context_rcu_publish(
+        struct oscore_context_rcu *rcu,
+        const oscore_context_t *secctx
+        )
+{
+    unsigned int spare = 1 - atomic_load(&rcu->current);
+
+    if (atomic_load(&rcu->readers[spare]) != 0) {
+        return false;
+    }
+
+    rcu->slots[spare] = *secctx;
+    atomic_store(&rcu->current, spare);
+    return true;
+}
+
+bool oscore_context_rcu_retired_is_idle(
+        struct oscore_context_rcu *rcu
+        )
+{
+    unsigned int spare = 1 - atomic_load(&rcu->current);
+    return atomic_load(&rcu->readers[spare]) == 0;
+}
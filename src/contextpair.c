@@ -1,14 +1,15 @@
 #include <oscore/contextpair.h>
 #include <oscore/context_impl/primitive.h>
 #include <oscore/context_impl/b1.h>
+#include <oscore/context_impl/b2.h>
 
 #include <stdlib.h>
 
-/* Given a PRIMITIVE or B1 context, return a pointer to its actual primitive
- * payload.
+/* Given a PRIMITIVE, B1 or B2 context, return a pointer to its actual
+ * primitive payload.
  *
- * From the construction of the B1 struct, this function has identical results
- * for either case, but it lets the compiler prove that rather than relying on
+ * From the construction of the B1 and B2 structs, this function has identical
+ * results for any case, but it lets the compiler prove that rather than relying on
  * a developer to enforce it.
  * */
 static struct oscore_context_primitive *find_primitive(const oscore_context_t *secctx) {
@@ -23,6 +24,11 @@ static struct oscore_context_primitive *find_primitive(const oscore_context_t *s
             struct oscore_context_b1 *b1 = secctx->data;
             return &b1->primitive;
         }
+    case OSCORE_CONTEXT_B2:
+        {
+            struct oscore_context_b2 *b2 = secctx->data;
+            return &b2->primitive;
+        }
     default:
         abort();
     }
@@ -33,6 +39,7 @@ oscore_crypto_aeadalg_t oscore_context_get_aeadalg(const oscore_context_t *secct
     switch (secctx->type) {
     case OSCORE_CONTEXT_PRIMITIVE:
     case OSCORE_CONTEXT_B1:
+    case OSCORE_CONTEXT_B2:
         {
             struct oscore_context_primitive *primitive = find_primitive(secctx);
             return primitive->immutables->aeadalg;
@@ -52,6 +59,7 @@ void oscore_context_get_kid(
     switch (secctx->type) {
     case OSCORE_CONTEXT_PRIMITIVE:
     case OSCORE_CONTEXT_B1:
+    case OSCORE_CONTEXT_B2:
         {
             struct oscore_context_primitive *primitive = find_primitive(secctx);
             if (role == OSCORE_ROLE_RECIPIENT) {
@@ -73,6 +81,7 @@ const uint8_t *oscore_context_get_commoniv(const oscore_context_t *secctx)
     switch (secctx->type) {
     case OSCORE_CONTEXT_PRIMITIVE:
     case OSCORE_CONTEXT_B1:
+    case OSCORE_CONTEXT_B2:
         {
             struct oscore_context_primitive *primitive = find_primitive(secctx);
             return primitive->immutables->common_iv;
@@ -89,6 +98,7 @@ const uint8_t *oscore_context_get_key(
     switch (secctx->type) {
     case OSCORE_CONTEXT_PRIMITIVE:
     case OSCORE_CONTEXT_B1:
+    case OSCORE_CONTEXT_B2:
         {
             struct oscore_context_primitive *primitive = find_primitive(secctx);
             if (role == OSCORE_ROLE_RECIPIENT)
@@ -101,14 +111,15 @@ const uint8_t *oscore_context_get_key(
     }
 }
 
-bool oscore_context_take_seqno(
-        oscore_context_t *secctx,
+bool oscore_context_peek_seqno(
+        const oscore_context_t *secctx,
         oscore_requestid_t *request_id
         )
 {
     switch (secctx->type) {
     case OSCORE_CONTEXT_PRIMITIVE:
     case OSCORE_CONTEXT_B1:
+    case OSCORE_CONTEXT_B2:
         {
             struct oscore_context_primitive *primitive = find_primitive(secctx);
             uint64_t seqno = primitive->sender_sequence_number;
@@ -121,7 +132,6 @@ bool oscore_context_take_seqno(
                     return false;
                 }
             }
-            primitive->sender_sequence_number = seqno + 1;
             request_id->is_first_use = true;
             request_id->bytes[0] = (seqno >> 32) & 0xff;
             request_id->bytes[1] = (seqno >> 24) & 0xff;
@@ -140,6 +150,18 @@ bool oscore_context_take_seqno(
     }
 }
 
+bool oscore_context_take_seqno(
+        oscore_context_t *secctx,
+        oscore_requestid_t *request_id
+        )
+{
+    if (!oscore_context_peek_seqno(secctx, request_id)) {
+        return false;
+    }
+    find_primitive(secctx)->sender_sequence_number += 1;
+    return true;
+}
+
 /** @brief Strike out the left edge number from the replay window */
 // Like all context_primitive specifics, this is on the path to refactoring
 // once we know what's actually needed where
@@ -185,6 +207,7 @@ void oscore_context_strikeout_requestid(
     // Needs no special-casing as strike-out of an uninitialized context will
     // always fail the first test.
     case OSCORE_CONTEXT_B1:
+    case OSCORE_CONTEXT_B2:
         {
             struct oscore_context_primitive *primitive = find_primitive(secctx);
             // request_id->partial_iv is documented to always be zero-padded
@@ -228,20 +251,32 @@ void oscore_context_get_kidcontext(
         size_t *kidcontext_len
         )
 {
-    (void)secctx;
-    (void)kidcontext;
     switch (secctx->type) {
+    case OSCORE_CONTEXT_B2:
+        {
+            struct oscore_context_b2 *b2 = secctx->data;
+            *kidcontext = b2->id_context;
+            *kidcontext_len = b2->id_context_len;
+            return;
+        }
     default:
         /* For those it is not relevant ever, returning empty as they don't keep it */
+        *kidcontext = NULL;
         *kidcontext_len = 0;
     }
 }
 
 bool oscore_context_emit_kidcontext(const oscore_context_t *secctx, bool is_request)
 {
-    (void)secctx;
-    (void)is_request;
     switch (secctx->type) {
+    case OSCORE_CONTEXT_B2:
+        {
+            // Only while the peer needs it to find the new key material
+            struct oscore_context_b2 *b2 = secctx->data;
+            return is_request ?
+                b2->state == OSCORE_CONTEXT_B2_INITIATED :
+                b2->state == OSCORE_CONTEXT_B2_RESPONDED;
+        }
     default:
         return false;
     }
@@ -0,0 +1,149 @@
+#include <string.h>
+#include <oscore/echo.h>
+
+/** Maximum length of the input to the MAC: timestamp, three length-prefixed
+ * identifiers and the common IV */
+static const size_t ikm_maxlen = 4 + \
+    1 + OSCORE_KEYID_MAXLEN + \
+    1 + OSCORE_KEYID_MAXLEN + \
+    1 + OSCORE_KEYIDCONTEXT_MAXLEN + \
+    OSCORE_CRYPTO_AEAD_IV_MAXLEN;
+
+static void append_item(uint8_t **cursor, const uint8_t *data, size_t len)
+{
+    *((*cursor)++) = len;
+    if (len != 0) {
+        // Empty items may come with a NULL pointer
+        memcpy(*cursor, data, len);
+        *cursor += len;
+    }
+}
+
+/** Compute the MAC for a given timestamp into @p mac */
+static bool compute_mac(
+        const struct oscore_echo *echo,
+        const oscore_context_t *secctx,
+        const uint8_t timestamp[4],
+        uint8_t mac[OSCORE_ECHO_MAC_LEN]
+        )
+{
+    const uint8_t *sender_id, *recipient_id, *kidcontext;
+    size_t sender_id_len, recipient_id_len, kidcontext_len;
+    oscore_context_get_kid(secctx, OSCORE_ROLE_SENDER, &sender_id, &sender_id_len);
+    oscore_context_get_kid(secctx, OSCORE_ROLE_RECIPIENT, &recipient_id, &recipient_id_len);
+    oscore_context_get_kidcontext(secctx, &kidcontext, &kidcontext_len);
+
+    // Allocating on the careful side, see @ref stack_allocation_sizes for
+    // rationale.
+    uint8_t ikm[ikm_maxlen];
+    uint8_t *cursor = ikm;
+    memcpy(cursor, timestamp, 4);
+    cursor += 4;
+    append_item(&cursor, sender_id, sender_id_len);
+    append_item(&cursor, recipient_id, recipient_id_len);
+    append_item(&cursor, kidcontext, kidcontext_len);
+    size_t iv_len = oscore_crypto_aead_get_ivlength(oscore_context_get_aeadalg(secctx));
+    memcpy(cursor, oscore_context_get_commoniv(secctx), iv_len);
+    cursor += iv_len;
+
+    oscore_cryptoerr_t err = oscore_crypto_hkdf_derive(
+            echo->alg,
+            echo->key, OSCORE_ECHO_KEY_LEN,
+            ikm, cursor - ikm,
+            (const uint8_t*)"Echo", 4,
+            mac, OSCORE_ECHO_MAC_LEN
+            );
+    return !oscore_cryptoerr_is_error(err);
+}
+
+void oscore_echo_init(
+        struct oscore_echo *echo,
+        oscore_crypto_hkdfalg_t alg,
+        const uint8_t key[OSCORE_ECHO_KEY_LEN],
+        uint32_t max_age
+        )
+{
+    echo->alg = alg;
+    memcpy(echo->key, key, OSCORE_ECHO_KEY_LEN);
+    echo->now = 0;
+    echo->max_age = max_age;
+}
+
+void oscore_echo_set_time(
+        struct oscore_echo *echo,
+        uint32_t now
+        )
+{
+    echo->now = now;
+}
+
+bool oscore_echo_generate(
+        const struct oscore_echo *echo,
+        const oscore_context_t *secctx,
+        uint8_t value[OSCORE_ECHO_VALUE_LEN]
+        )
+{
+    value[0] = echo->now >> 24;
+    value[1] = echo->now >> 16;
+    value[2] = echo->now >> 8;
+    value[3] = echo->now;
+
+    return compute_mac(echo, secctx, value, &value[4]);
+}
+
+bool oscore_echo_verify(
+        const struct oscore_echo *echo,
+        const oscore_context_t *secctx,
+        const uint8_t *value,
+        size_t value_len
+        )
+{
+    if (value_len != OSCORE_ECHO_VALUE_LEN) {
+        return false;
+    }
+
+    uint32_t timestamp = ((uint32_t)value[0] << 24) | ((uint32_t)value[1] << 16) |
+        ((uint32_t)value[2] << 8) | value[3];
+    // Wrapping arithmetic: timestamps from the future show up as very old
+    if ((uint32_t)(echo->now - timestamp) > echo->max_age) {
+        return false;
+    }
+
+    uint8_t mac[OSCORE_ECHO_MAC_LEN];
+    if (!compute_mac(echo, secctx, value, mac)) {
+        return false;
+    }
+
+    // Not leaking through timing how many bytes of a forgery were right
+    uint8_t diff = 0;
+    for (size_t i = 0; i < OSCORE_ECHO_MAC_LEN; ++i) {
+        diff |= mac[i] ^ value[4 + i];
+    }
+    return diff == 0;
+}
+
+bool oscore_echo_verify_request(
+        const struct oscore_echo *echo,
+        const oscore_context_t *secctx,
+        oscore_msg_protected_t *request
+        )
+{
+    bool result = false;
+    oscore_msg_protected_optiter_t iter;
+    uint16_t opt_num;
+    const uint8_t *opt_val;
+    size_t opt_len;
+    oscore_msg_protected_optiter_init(request, &iter);
+    while (oscore_msg_protected_optiter_next(request, &iter, &opt_num, &opt_val, &opt_len)) {
+        if (opt_num == 252 /* Echo */) {
+            result = oscore_echo_verify(echo, secctx, opt_val, opt_len);
+            break;
+        }
+    }
+    // Ignoring the result -- if the Echo option was good, it's fine for here
+    // and whoever parses the rest of the message will deal with its garbled
+    // contents.
+    (void)oscore_msg_protected_optiter_finish(request, &iter);
+
+    return result;
+}
@@ -0,0 +1,60 @@
+#include <oscore/fanout.h>
+
+/** Build and protect a notification into a single target's message */
+static enum oscore_fanout_result notify_one(
+        const oscore_fanout_notification_t *notification,
+        struct oscore_fanout_target *target
+        )
+{
+    oscore_msg_protected_t plaintext;
+    enum oscore_prepare_result prepared = oscore_prepare_response(
+            target->message,
+            &plaintext,
+            target->secctx,
+            target->request_id
+            );
+    if (prepared != OSCORE_PREPARE_OK) {
+        return OSCORE_FANOUT_SECCTX_UNAVAILABLE;
+    }
+
+    if (target->aadcache != NULL) {
+        oscore_msg_protected_set_aadcache(&plaintext, target->aadcache);
+    }
+    oscore_msg_protected_set_code(&plaintext, notification->code);
+
+    bool ok = oscore_msg_protected_append_option(&plaintext, 6 /* Observe */, notification->observe, notification->observe_len) == OK;
+    if (ok && notification->inner_options != NULL) {
+        ok = oscore_msg_protected_append_template(&plaintext, notification->inner_options) == OK;
+    }
+    if (ok) {
+        const oscore_msg_protected_payloadpart_t payload = {
+            notification->payload,
+            notification->payload_len,
+        };
+        ok = oscore_msg_protected_write_payload(&plaintext, &payload, 1) == OK;
+    }
+
+    if (!ok) {
+        return OSCORE_FANOUT_MESSAGE_ERROR;
+    }
+
+    oscore_msg_native_t protected;
+    enum oscore_finish_result finished = oscore_encrypt_message(&plaintext, &protected);
+    return finished == OSCORE_FINISH_OK ? OSCORE_FANOUT_OK : OSCORE_FANOUT_CRYPTO_ERROR;
+}
+
+size_t oscore_fanout_notify(
+        const oscore_fanout_notification_t *notification,
+        struct oscore_fanout_target *targets,
+        size_t targets_count
+        )
+{
+    size_t successful = 0;
+    for (size_t i = 0; i < targets_count; ++i) {
+        targets[i].result = notify_one(notification, &targets[i]);
+        if (targets[i].result == OSCORE_FANOUT_OK) {
+            successful += 1;
+        }
+    }
+    return successful;
+}
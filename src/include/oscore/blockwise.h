@@ -0,0 +1,144 @@
+#ifndef OSCORE_BLOCKWISE_H
+#define OSCORE_BLOCKWISE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include <oscore/message.h>
+#include <oscore/helpers.h>
+
+/** @file */
+
+/** @ingroup oscore_api
+ *
+ * @addtogroup oscore_blockwise Inner Block2 responses
+ *
+ * @brief Serving large resources in blocks inside OSCORE
+ *
+ * Representations that exceed a single message are transferred in blocks as
+ * described in [RFC7959](https://tools.ietf.org/html/rfc7959). With OSCORE,
+ * the Block2 option can be used as an inner option, so that each block is
+ * protected individually (see [Section 4.1.3.4.1 of
+ * RFC8613](https://tools.ietf.org/html/rfc8613#section-4.1.3.4.1)).
+ *
+ * These helpers implement the server side of that: @ref
+ * oscore_blockwise_parse_block2 extracts the block the client asks for from a
+ * request, and @ref oscore_blockwise_write_block2 places that block into a
+ * response. The block size is reduced if the requested one does not fit the
+ * response message, and the data is read through a callback right into the
+ * plaintext (from where it is encrypted in place), so the resource never
+ * needs to be held in memory as a whole.
+ *
+ * Block1 (ie. large request payloads) is not covered.
+ *
+ * @{
+ */
+
+/** @brief Block size exponent used when a request carries no Block2 option
+ *
+ * The default of 6 means 1024 byte blocks, which are reduced to what fits the
+ * response message. The value can be overridden at build time by predefining
+ * it.
+ */
+#ifndef OSCORE_BLOCKWISE_DEFAULT_SZX
+#define OSCORE_BLOCKWISE_DEFAULT_SZX 6
+#endif
+
+/** @brief Block requested by a client, or sent by a server */
+struct oscore_blockwise_block2 {
+    /** Block number, counted in blocks of the size given by @ref szx */
+    uint32_t num;
+    /** Block size exponent; the block size is `1 << (szx + 4)` */
+    uint8_t szx;
+};
+
+/** @brief Read part of a resource
+ *
+ * @param[in] source Pointer passed to @ref oscore_blockwise_write_block2
+ * @param[in] offset Position in the resource to start reading at
+ * @param[out] dest Memory to read into
+ * @param[in] len Number of bytes to read; the requested range always lies
+ *     within the resource
+ *
+ * @return true if all requested bytes were read
+ */
+typedef bool (*oscore_blockwise_read_t)(
+        void *source,
+        size_t offset,
+        uint8_t *dest,
+        size_t len
+        );
+
+/** @brief Outcome of @ref oscore_blockwise_write_block2 */
+enum oscore_blockwise_result {
+    /** The block was written, and the response can be encrypted */
+    OSCORE_BLOCKWISE_OK,
+    /** The requested block starts behind the end of the resource. The
+     * response is left without payload, and is best sent with a 4.02 Bad
+     * Option code. */
+    OSCORE_BLOCKWISE_OUT_OF_RANGE,
+    /** The read callback failed */
+    OSCORE_BLOCKWISE_READ_ERROR,
+    /** Options or payload could not be written; typically, the message is too
+     * small for even a 16 byte block */
+    OSCORE_BLOCKWISE_MESSAGE_ERROR,
+};
+
+/** @brief Determine which block a request asks for
+ *
+ * @param[in] request Received request
+ * @param[out] block Requested block (block 0 of size @ref
+ *     OSCORE_BLOCKWISE_DEFAULT_SZX if the request carries no Block2 option)
+ *
+ * @return false if the request's Block2 option is malformed or its inner
+ * options can not be parsed; the request should then be answered with a 4.02
+ * Bad Option response.
+ */
+OSCORE_NONNULL
+bool oscore_blockwise_parse_block2(
+        oscore_msg_protected_t *request,
+        struct oscore_blockwise_block2 *block
+        );
+
+/** @brief Write a block of a resource into a response
+ *
+ * @param[inout] response Response whose code is set, and which may already
+ *     carry inner options with numbers less than Block2's (23)
+ * @param[inout] block Block requested by the client. If its size does not fit
+ *     into the response, it is reduced (and its number increased
+ *     accordingly), so on return this reflects the block that was sent.
+ * @param[in] total_length Length of the resource
+ * @param[in] read Callback that reads from the resource
+ * @param[in] source Argument passed to @p read (eg. a file handle, or a
+ *     pointer to the resource for @ref oscore_blockwise_read_memory)
+ *
+ * This adds the Block2 option, and on the first block the Size2 option, to
+ * the response. It reads the block's data directly into the payload and trims
+ * the payload to its length. Apart from the outer options, nothing may be
+ * added to the response after this.
+ */
+enum oscore_blockwise_result oscore_blockwise_write_block2(
+        oscore_msg_protected_t *response,
+        struct oscore_blockwise_block2 *block,
+        size_t total_length,
+        oscore_blockwise_read_t read,
+        void *source
+        );
+
+/** @brief Read callback for resources that are fully in memory
+ *
+ * This can be used as @ref oscore_blockwise_read_t when the resource is in
+ * memory (including memory mapped files); the source is a pointer to the
+ * resource's first byte.
+ */
+bool oscore_blockwise_read_memory(
+        void *source,
+        size_t offset,
+        uint8_t *dest,
+        size_t len
+        );
+
+/** @} */
+
+#endif
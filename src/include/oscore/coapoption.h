@@ -0,0 +1,127 @@
+#ifndef OSCORE_COAPOPTION_H
+#define OSCORE_COAPOPTION_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** @file */
+
+/** @ingroup oscore_helpers
+ *
+ * @addtogroup oscore_coapoption CoAP option header encoding
+ *
+ * @brief Encoding of the option delta and length of CoAP options
+ *
+ * These implement the option header format of RFC7252 Section 3.1. They are
+ * used by the library wherever it composes or parses options itself, and are
+ * available to backends that serialize messages.
+ *
+ * @{
+ */
+
+/** @brief Maximum length of an option header (without the value) */
+#define OSCORE_COAPOPTION_HEADER_MAXLEN 5
+
+/** @brief Number of extended bytes that encode an option delta or length of
+ * @p value */
+static inline size_t oscore_coapoption_extension_length(uint16_t value)
+{
+    return (value >= 13) + (value >= 269);
+}
+
+/** @brief Number of bytes in an option header for @p delta and @p length */
+static inline size_t oscore_coapoption_header_length(uint16_t delta, uint16_t length)
+{
+    return 1 + oscore_coapoption_extension_length(delta) + oscore_coapoption_extension_length(length);
+}
+
+/** @private Place the extended bytes of @p value at @p buffer and return the
+ * nibble that goes into the option header */
+static inline uint8_t _oscore_coapoption_encode_part(uint16_t value, uint8_t **buffer)
+{
+    if (value < 13) {
+        return value;
+    }
+    if (value < 269) {
+        *(*buffer)++ = value - 13;
+        return 13;
+    }
+    value -= 269;
+    *(*buffer)++ = value >> 8;
+    *(*buffer)++ = value;
+    return 14;
+}
+
+/** @brief Encode the header of an option
+ *
+ * @param[out] buffer Space for at least @ref oscore_coapoption_header_length
+ *                    bytes
+ * @param[in] delta Option delta against the previous option number
+ * @param[in] length Length of the option value
+ *
+ * @return the number of bytes written
+ */
+static inline size_t oscore_coapoption_encode_header(uint8_t *buffer, uint16_t delta, uint16_t length)
+{
+    uint8_t *cursor = &buffer[1];
+    uint8_t delta_nibble = _oscore_coapoption_encode_part(delta, &cursor);
+    uint8_t length_nibble = _oscore_coapoption_encode_part(length, &cursor);
+    buffer[0] = (delta_nibble << 4) | length_nibble;
+    return cursor - buffer;
+}
+
+/** @private Read the value for @p nibble from the extended bytes at @p
+ * buffer[*offset], advancing @p offset; return false if the nibble is
+ * reserved or the bytes exceed @p available */
+static inline bool _oscore_coapoption_decode_part(uint8_t nibble, const uint8_t *buffer, size_t *offset, size_t available, uint32_t *value)
+{
+    switch (nibble) {
+    case 13:
+        if (available - *offset < 1) {
+            return false;
+        }
+        *value = 13 + buffer[*offset];
+        *offset += 1;
+        return true;
+    case 14:
+        if (available - *offset < 2) {
+            return false;
+        }
+        *value = 269 + ((buffer[*offset] << 8) | buffer[*offset + 1]);
+        *offset += 2;
+        return true;
+    case 15:
+        return false;
+    default:
+        *value = nibble;
+        return true;
+    }
+}
+
+/** @brief Decode the header of an option
+ *
+ * @param[in] buffer Start of the option
+ * @param[in] available Number of bytes (at least 1) from @p buffer that belong
+ *                      to the option area
+ * @param[out] delta Option delta against the previous option number
+ * @param[out] length Length of the option value
+ *
+ * @return the length of the header, after which the value starts, or 0 if the
+ * header is malformed (which includes it being a payload marker) or the header
+ * and value exceed @p available
+ */
+static inline size_t oscore_coapoption_decode_header(const uint8_t *buffer, size_t available, uint32_t *delta, uint32_t *length)
+{
+    size_t offset = 1;
+    if (!_oscore_coapoption_decode_part(buffer[0] >> 4, buffer, &offset, available, delta) ||
+            !_oscore_coapoption_decode_part(buffer[0] & 0xf, buffer, &offset, available, length) ||
+            *length > available - offset) {
+        return 0;
+    }
+    return offset;
+}
+
+/** @} */
+
+#endif
@@ -4,6 +4,7 @@
 #include <oscore/context_impl/primitive.h>
 #include <oscore_native/message.h>
 #include <oscore/protection.h>
+#include <oscore/echo.h>
 
 /** @file */
 
@@ -100,6 +101,10 @@
  *     recognize any incoming Echo options and thus initialize the replay
  *     state.
  *
+ *     Servers with many contexts can use @ref
+ *     oscore_context_b1_set_stateless_echo so that Echo values neither take
+ *     sequence numbers nor need to be remembered per context.
+ *
  *   * A client that receives a 4.01 response with an Echo option needs to
  *     resubmit the request, and use any Echo value found in the response in
  *     its next request.
@@ -145,7 +150,7 @@ struct oscore_context_b1 {
      * it needs to be used then that response already pulled out a sequence
      * number.
      */
-    uint8_t echo_value[PIV_BYTES];
+    uint8_t echo_value[OSCORE_ECHO_VALUE_LEN > PIV_BYTES ? OSCORE_ECHO_VALUE_LEN : PIV_BYTES];
     /** @private
      *
      * @brief Indicator of how many bytes of Echo value are populated
@@ -154,6 +159,14 @@ struct oscore_context_b1 {
      * value is a Partial IV, it never has zero length).
      */
     uint8_t echo_value_populated;
+    /** @private
+     *
+     * @brief Stateless Echo generator to use instead of @p echo_value
+     *
+     * If this is set, @p echo_value is only used as a buffer for the value
+     * produced by it.
+     */
+    const struct oscore_echo *echo;
 };
 
 /** @brief Persistable replay data of a B.1 context
@@ -237,6 +250,28 @@ uint64_t oscore_context_b1_get_wanted(
         struct oscore_context_b1 *secctx
         );
 
+/** @brief Use stateless Echo values for replay window recovery
+ *
+ * By default, a B.1 context uses one of its own sequence numbers as the Echo
+ * value with which it recovers its replay window. After this call, it instead
+ * uses values produced by @p echo (see @ref oscore_echo), which takes no
+ * sequence number and verifies without comparing to a stored value.
+ *
+ * This is only secure if the key of @p echo was created at this startup (ie.
+ * it is random and not persisted), as otherwise, a request carrying an Echo
+ * value produced before a restart could be used to initialize the replay
+ * window with stale values.
+ *
+ * @param[inout] secctx B.1 security context that was just initialized
+ * @param[in] echo Echo state that outlives @p secctx, and is commonly shared
+ *     by all B.1 contexts of the server
+ */
+OSCORE_NONNULL
+void oscore_context_b1_set_stateless_echo(
+        struct oscore_context_b1 *secctx,
+        const struct oscore_echo *echo
+        );
+
 /** @brief Take the replay data of a security context for persistence
  *
  * @param[inout] secctx B.1 security context to shut down. This is marked inout
@@ -0,0 +1,259 @@
+#ifndef OSCORE_CONTEXT_B1_PERSIST_H
+#define OSCORE_CONTEXT_B1_PERSIST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <oscore/context_impl/b1.h>
+
+/** @file */
+
+/** @ingroup oscore_context_b1
+ *
+ * @addtogroup oscore_context_b1_persist Write-behind persistence of B.1 contexts
+ *
+ * @brief Helper for persisting B.1 state outside the request processing path
+ *
+ * The persistence steps described in @ref oscore_context_b1 can be performed
+ * by the application right where a sequence number is needed, but then the
+ * latency of the storage medium (eg. an `fsync` or a flash page write) is
+ * added to the handling of the request that happened to exhaust the current
+ * allocation.
+ *
+ * This component decouples the two: The request path only ever *stages* a
+ * @ref oscore_context_b1_persistrecord (a cheap copy into a buffer held here),
+ * and a background task (a thread, an idle task or a main loop iteration)
+ * *takes* that record into a buffer of its own, writes it to persistent
+ * storage at its own pace, and reports its *completion*. Only then is the new
+ * limit made available to the security context. The staging buffer and the
+ * background task's buffer form a double buffer: Further stagings that happen
+ * while a record is being written only replace the staged record, and are
+ * picked up by the next take.
+ *
+ * To keep the request path from ever waiting for the storage, a lease of
+ * sequence numbers is requested well ahead: Whenever less than half of the
+ * configured lease is left between the next sequence number and the highest
+ * limit ever requested, a new limit a full lease ahead is staged. As long as
+ * the background task completes a write before the other half is used up,
+ * sequence numbers are always available.
+ *
+ * In line with @ref design_thread, this component does not synchronize on its
+ * own. All functions operating on a @ref oscore_context_b1_persist need to be
+ * called under a common lock (eg. the one that serializes the use of the
+ * security context). None of them performs any I/O or waits, so the lock is
+ * only held for a few copy operations; the actual write to persistent storage
+ * happens outside of it on the taken copy.
+ *
+ * A typical setup looks like this:
+ *
+ * * At startup, the application reads the last persisted record. If it
+ *   contains replay data, the application writes back the record with @ref
+ *   oscore_context_b1_persistrecord::has_replaydata cleared *before*
+ *   initializing the context with it (see @ref oscore_context_b1_initialize
+ *   for why that is crucial). It then calls @ref oscore_context_b1_initialize
+ *   and @ref oscore_context_b1_persist_init.
+ *
+ * * Before any operation that takes a sequence number (ie. before unprotecting
+ *   a request or preparing a message), it calls @ref
+ *   oscore_context_b1_persist_poll. When that returns true, it wakes up the
+ *   background task.
+ *
+ * * The background task repeatedly calls @ref oscore_context_b1_persist_take,
+ *   stores the record, and calls @ref oscore_context_b1_persist_complete.
+ *
+ * * At a controlled shutdown, the application calls @ref
+ *   oscore_context_b1_persist_shutdown (after which the security context is
+ *   not used any more), and waits for @ref oscore_context_b1_persist_is_idle
+ *   before powering down.
+ *
+ * @{
+ */
+
+/** @brief Default number of sequence numbers requested ahead of use
+ *
+ * This is the lease used by the demo applications; it can be overridden at
+ * build time by predefining it. Actual applications pick a lease in @ref
+ * oscore_context_b1_persist_init based on their traffic and storage latency.
+ */
+#ifndef OSCORE_CONTEXT_B1_PERSIST_DEFAULT_LEASE
+#define OSCORE_CONTEXT_B1_PERSIST_DEFAULT_LEASE 1000
+#endif
+
+/** @brief Data to be persisted for a B.1 security context
+ *
+ * This is the unit of data handed from the request path to the background
+ * task. Its fields are public as the application decides how to serialize
+ * them.
+ */
+struct oscore_context_b1_persistrecord {
+    /** Sequence number to pass to @ref oscore_context_b1_initialize at the
+     * next startup */
+    uint64_t seqno;
+    /** Whether @p replaydata is populated. This is only ever set in the
+     * record staged by @ref oscore_context_b1_persist_shutdown. */
+    bool has_replaydata;
+    /** Replay window state for use at the next startup, valid if @p
+     * has_replaydata is set */
+    struct oscore_context_b1_replaydata replaydata;
+};
+
+/** @brief State of write-behind persistence for a single B.1 context
+ *
+ * All fields are private; this must be initialized using @ref
+ * oscore_context_b1_persist_init.
+ */
+struct oscore_context_b1_persist {
+    /** @private
+     *
+     * @brief The security context whose state is persisted
+     */
+    struct oscore_context_b1 *secctx;
+    /** @private
+     *
+     * @brief Number of sequence numbers to request ahead
+     */
+    uint64_t lease;
+    /** @private
+     *
+     * @brief Highest sequence number limit ever staged
+     *
+     * This is never lower than any limit that has been completed, and thus
+     * always safe to persist.
+     */
+    uint64_t requested;
+    /** @private
+     *
+     * @brief Highest sequence number limit known to be persisted
+     */
+    uint64_t durable;
+    /** @private
+     *
+     * @brief Record waiting to be taken by the background task
+     */
+    struct oscore_context_b1_persistrecord staged;
+    /** @private
+     *
+     * @brief Whether @p staged contains a record not taken yet
+     */
+    bool staged_pending;
+    /** @private
+     *
+     * @brief Whether a record was taken and its completion is outstanding
+     */
+    bool in_flight;
+    /** @private
+     *
+     * @brief Whether @ref oscore_context_b1_persist_shutdown was called
+     */
+    bool shut_down;
+};
+
+/** @brief Set up write-behind persistence for a B.1 context
+ *
+ * @param[out] persist Uninitialized persistence state
+ * @param[in] secctx B.1 security context that was just initialized using
+ *     @ref oscore_context_b1_initialize, and on which @ref
+ *     oscore_context_b1_allow_high has not been called yet.
+ * @param[in] lease Number of sequence numbers to keep persisted ahead of the
+ *     currently used one. It must be at least 2; larger values save writes
+ *     at the expense of sequence numbers lost at every unclean restart.
+ *
+ * This does not stage any record yet; the first @ref
+ * oscore_context_b1_persist_poll does.
+ */
+OSCORE_NONNULL
+void oscore_context_b1_persist_init(
+        struct oscore_context_b1_persist *persist,
+        struct oscore_context_b1 *secctx,
+        uint64_t lease
+        );
+
+/** @brief Update the security context and stage a record if necessary
+ *
+ * This is the function called in the request path. It makes any sequence
+ * number limit that completed persisting since the last call available to the
+ * security context, and stages a new record if the remaining lease has fallen
+ * below half of its configured size.
+ *
+ * @param[inout] persist Persistence state
+ *
+ * @return true if a record was staged that was not staged before, in which
+ * case the background task should be woken up.
+ */
+OSCORE_NONNULL
+bool oscore_context_b1_persist_poll(
+        struct oscore_context_b1_persist *persist
+        );
+
+/** @brief Obtain the record that is to be written to persistent storage
+ *
+ * This is called by the background task, which then owns the copy in @p
+ * record and writes it to persistent storage after releasing the lock.
+ *
+ * At most one record can be taken at a time; after a successful take, @ref
+ * oscore_context_b1_persist_complete needs to be called before the next take
+ * is successful.
+ *
+ * @param[inout] persist Persistence state
+ * @param[out] record Buffer to copy the staged record into
+ *
+ * @return true if a record was copied into @p record, false if there is
+ * nothing to be written (or a write is still in flight).
+ */
+OSCORE_NONNULL
+bool oscore_context_b1_persist_take(
+        struct oscore_context_b1_persist *persist,
+        struct oscore_context_b1_persistrecord *record
+        );
+
+/** @brief Report that a taken record has been written to persistent storage
+ *
+ * This must only be called after the data of @p record is guaranteed to be
+ * found by the next startup (ie. after any `fsync` or flash write verification
+ * completed).
+ *
+ * The new limit is made available to the security context at the next @ref
+ * oscore_context_b1_persist_poll call.
+ *
+ * @param[inout] persist Persistence state
+ * @param[in] record The record previously obtained through @ref
+ *     oscore_context_b1_persist_take
+ */
+OSCORE_NONNULL
+void oscore_context_b1_persist_complete(
+        struct oscore_context_b1_persist *persist,
+        const struct oscore_context_b1_persistrecord *record
+        );
+
+/** @brief Stage the final record of a security context that is being shut down
+ *
+ * This extracts the replay window using @ref oscore_context_b1_replay_extract
+ * and stages it along with the highest requested sequence number limit. The
+ * security context must not be used any more after this call, and @ref
+ * oscore_context_b1_persist_poll must not be called on @p persist again.
+ *
+ * The application should wait for @ref oscore_context_b1_persist_is_idle to
+ * become true before it ends operation; if it does not, the next startup will
+ * only find an earlier record without replay data, which is safe.
+ *
+ * @param[inout] persist Persistence state
+ */
+OSCORE_NONNULL
+void oscore_context_b1_persist_shutdown(
+        struct oscore_context_b1_persist *persist
+        );
+
+/** @brief Determine whether all staged data has been persisted
+ *
+ * @param[in] persist Persistence state
+ *
+ * @return true if no record is staged or in flight.
+ */
+OSCORE_NONNULL
+bool oscore_context_b1_persist_is_idle(
+        const struct oscore_context_b1_persist *persist
+        );
+
+/** @} */
+
+#endif
@@ -0,0 +1,132 @@
+#ifndef OSCORE_CONTEXT_B1_STORE_H
+#define OSCORE_CONTEXT_B1_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <oscore/context_impl/b1_persist.h>
+
+/** @file */
+
+/** @ingroup oscore_context_b1
+ *
+ * @addtogroup oscore_context_b1_store Fixed-size record format for B.1 contexts
+ *
+ * @brief Crash-consistent serialization of many B.1 contexts into a flat memory region
+ *
+ * This component defines a fixed-size @ref oscore_context_b1_storeslot that
+ * holds everything needed to restore a B.1 context: its key material (@ref
+ * oscore_context_primitive_immutables) and a @ref
+ * oscore_context_b1_persistrecord. Slots are meant to be laid out as a plain
+ * array in a memory mapped file or a flash area, one slot per context, so
+ * that committing one context touches only the bytes of that slot.
+ *
+ * Each slot contains two versions of its record. A write always goes to the
+ * version that is not the current one, and carries a generation counter one
+ * higher than it; each version is protected by a CRC-32. If a write is torn
+ * (eg. by power loss during the write-back of a page), the partially written
+ * version fails its checksum and the previous version is used when reading.
+ *
+ * The serialization is byte oriented and independent of the platform's struct
+ * layout, endianness or padding. Key material is stored in fields of fixed
+ * size that fit every supported algorithm (zero padded as needed), so the
+ * layout also stays the same when the library is rebuilt with a different set
+ * of algorithms (eg. using `OSCORE_FIXED_AEADALG`).
+ *
+ * No I/O is performed here; after a @ref oscore_context_b1_store_write, the
+ * application needs to make the reported byte range durable (eg. using
+ * `msync`) before it uses the sequence number in there with @ref
+ * oscore_context_b1_allow_high. Likewise, when a record read with @ref
+ * oscore_context_b1_store_read contains replay data, the application must
+ * write (and make durable) the record with replay data cleared before passing
+ * it to @ref oscore_context_b1_initialize.
+ *
+ * @{
+ */
+
+/** @brief Version of the record format
+ *
+ * Records of other format versions are treated as absent.
+ */
+#define OSCORE_CONTEXT_B1_STORE_FORMAT 2
+
+/** @brief Size of the field that holds the common IV */
+#define OSCORE_CONTEXT_B1_STORE_IV_SIZE 16
+/** @brief Size of each of the fields that hold a sender or recipient ID */
+#define OSCORE_CONTEXT_B1_STORE_KEYID_SIZE 16
+/** @brief Size of each of the fields that hold a sender or recipient key */
+#define OSCORE_CONTEXT_B1_STORE_KEY_SIZE 32
+
+/** @brief Number of bytes in a single version of a serialized record
+ *
+ * This does not depend on the build configuration.
+ */
+#define OSCORE_CONTEXT_B1_STORE_RECORD_SIZE ( \
+        1 /* format */ + \
+        4 /* generation */ + \
+        8 /* sequence number */ + \
+        1 /* flags */ + \
+        8 + 4 /* replay data */ + \
+        4 /* algorithm */ + \
+        OSCORE_CONTEXT_B1_STORE_IV_SIZE + \
+        2 * (1 + OSCORE_CONTEXT_B1_STORE_KEYID_SIZE + OSCORE_CONTEXT_B1_STORE_KEY_SIZE) + \
+        4 /* checksum */ \
+        )
+
+/** @brief Storage for the persisted state of a single B.1 context
+ *
+ * The content is private; an all-zero slot (eg. in a freshly created file) is
+ * valid and contains no record.
+ */
+struct oscore_context_b1_storeslot {
+    /** @private
+     *
+     * @brief Two serialized versions of the record
+     */
+    uint8_t versions[2][OSCORE_CONTEXT_B1_STORE_RECORD_SIZE];
+};
+
+/** @brief Read the latest intact record from a slot
+ *
+ * @param[in] slot Slot to read
+ * @param[out] immutables Key material found in the slot
+ * @param[out] record Sequence number and replay data found in the slot
+ *
+ * @return true if a record was found, false if the slot contains no record
+ * that is intact and uses an algorithm supported by the crypto backend. The
+ * output arguments are left in an unspecified state in the latter case.
+ */
+OSCORE_NONNULL
+bool oscore_context_b1_store_read(
+        const struct oscore_context_b1_storeslot *slot,
+        struct oscore_context_primitive_immutables *immutables,
+        struct oscore_context_b1_persistrecord *record
+        );
+
+/** @brief Write a record into a slot
+ *
+ * The new record replaces the older of the two versions in the slot, leaving
+ * the latest one intact until the new one is complete.
+ *
+ * @param[inout] slot Slot to write to
+ * @param[in] immutables Key material to store
+ * @param[in] record Sequence number and replay data to store
+ * @param[out] changed_offset Offset of the first modified byte, relative to @p slot
+ * @param[out] changed_len Number of modified bytes
+ *
+ * Only bytes in the reported range are modified; only those need to be made
+ * durable before the record can be considered stored.
+ */
+OSCORE_NONNULL
+void oscore_context_b1_store_write(
+        struct oscore_context_b1_storeslot *slot,
+        const struct oscore_context_primitive_immutables *immutables,
+        const struct oscore_context_b1_persistrecord *record,
+        size_t *changed_offset,
+        size_t *changed_len
+        );
+
+/** @} */
+
+#endif
@@ -0,0 +1,371 @@
+#ifndef OSCORE_CONTEXT_B2_H
+#define OSCORE_CONTEXT_B2_H
+
+#include <oscore/context_impl/primitive.h>
+#include <oscore/protection.h>
+
+/** @file */
+
+/** @ingroup oscore_contextpair
+ *
+ * @addtogroup oscore_context_b2 Security context with Appendix B.2 re-keying
+ *
+ * @brief A context that can derive fresh key material with its peer
+ *
+ * This security context behaves like a @ref oscore_context_primitive, but
+ * keeps the Master Secret and Master Salt it was derived from. Using the
+ * procedure described in [Appendix B.2 of
+ * RFC8613](https://tools.ietf.org/html/rfc8613#appendix-B.2), the peers can
+ * derive a new security context with a fresh ID Context without any further
+ * key exchange. This makes the context usable beyond the exhaustion of its
+ * sequence numbers.
+ *
+ * The procedure is client initiated:
+ *
+ * * The client picks a random nonce R1, and calls @ref
+ *   oscore_context_b2_initiate. This derives a context CTX_1 with ID Context
+ *   R1, switches to it (resetting the sequence number), and makes requests
+ *   carry R1 in their KID Context. The client then sends a request as usual.
+ *
+ * * The server looks up the security context by the KID of that request, and
+ *   passes the request's KID Context to @ref oscore_context_b2_process_kidcontext
+ *   before unprotecting. This derives CTX_1 as well and switches to it
+ *   tentatively. After unprotecting, the server calls @ref
+ *   oscore_context_b2_process_request. If unprotection failed, the server
+ *   reverts to its previous context; otherwise, it marks the request as
+ *   possibly replayed (as it can not be known to be fresh), and the
+ *   application calls @ref oscore_context_b2_respond with a random nonce R2.
+ *   This derives the final context CTX_NEW with ID Context R1|R2, and switches
+ *   to it. The next response (typically a 4.01 Unauthorized, or any response
+ *   acceptable for a possibly replayed request) is protected with CTX_NEW and
+ *   carries R1|R2 in its KID Context.
+ *
+ * * The client passes the response's KID Context to @ref
+ *   oscore_context_b2_process_kidcontext before unprotecting it, which
+ *   derives CTX_NEW and switches to it tentatively. After unprotecting, it
+ *   calls @ref oscore_context_b2_process_response, which either keeps CTX_NEW
+ *   (ending the procedure) or reverts to CTX_1.
+ *
+ * New key material is put into place outside of the context that is in use:
+ * Each context keeps two sets of @ref oscore_context_primitive_immutables, and
+ * switching between them is a single pointer update. As with all context
+ * operations, it is up to the application to serialize them (see @ref
+ * design_thread).
+ *
+ * Each of those calls needs a key derivation (several HKDF runs). By default,
+ * it is performed synchronously inside the call, and thus on the path of the
+ * message being processed. Applications that can not afford that run @ref
+ * oscore_context_b2_derive ahead of the call (for example, in a lower priority
+ * thread while the request waits), and pass its result in; the call then only
+ * switches. The ID Contexts to derive for are R1 for @ref
+ * oscore_context_b2_initiate, the message's KID Context for @ref
+ * oscore_context_b2_process_kidcontext, and the current ID Context (see @ref
+ * oscore_context_get_kidcontext) followed by R2 for @ref
+ * oscore_context_b2_respond.
+ *
+ * Applications should initiate the procedure ahead of sequence number
+ * exhaustion, as indicated by @ref oscore_context_b2_wants_rekey, so that
+ * requests never fail for lack of sequence numbers.
+ *
+ * As the library has no source of randomness, the nonces are provided by the
+ * application. Their lengths are limited to half of @ref
+ * OSCORE_KEYIDCONTEXT_MAXLEN each; 8 bytes are recommended.
+ *
+ * A server can not tell whether the first request of the procedure is fresh.
+ * If it is replayed later, the server moves on to a context the client does
+ * not know; the client then fails to unprotect responses, and recovers by
+ * starting the procedure again.
+ *
+ * This context is not persisted; after a restart, the application needs to
+ * set it up again with a new ID Context (which is what this procedure is
+ * suitable for, with the restarted party initiating).
+ *
+ * @{
+ */
+
+/** @brief Maximum length of a Master Secret stored in a B.2 context
+ *
+ * The value can be overridden at build time by predefining it.
+ */
+#ifndef OSCORE_CONTEXT_B2_SECRET_MAXLEN
+#define OSCORE_CONTEXT_B2_SECRET_MAXLEN 32
+#endif
+
+/** @brief Maximum length of a Master Salt stored in a B.2 context
+ *
+ * The value can be overridden at build time by predefining it.
+ */
+#ifndef OSCORE_CONTEXT_B2_SALT_MAXLEN
+#define OSCORE_CONTEXT_B2_SALT_MAXLEN 32
+#endif
+
+/** @brief Number of sequence numbers left at which @ref
+ * oscore_context_b2_wants_rekey starts reporting true
+ *
+ * The value can be overridden at build time by predefining it.
+ */
+#ifndef OSCORE_CONTEXT_B2_REKEY_MARGIN
+#define OSCORE_CONTEXT_B2_REKEY_MARGIN 0x10000
+#endif
+
+/** @brief Progress of the B.2 procedure in a context */
+enum oscore_context_b2_state {
+    /** No procedure is ongoing */
+    OSCORE_CONTEXT_B2_IDLE,
+    /** Client: CTX_1 is in use, and requests carry its ID Context */
+    OSCORE_CONTEXT_B2_INITIATED,
+    /** Client: CTX_NEW is tentatively in use for unprotecting a response */
+    OSCORE_CONTEXT_B2_RESPONSE_TENTATIVE,
+    /** Server: CTX_1 is tentatively in use for unprotecting a request */
+    OSCORE_CONTEXT_B2_REQUEST_TENTATIVE,
+    /** Server: a request was unprotected with CTX_1 and is waiting for @ref
+     * oscore_context_b2_respond */
+    OSCORE_CONTEXT_B2_REQUEST_VERIFIED,
+    /** Server: CTX_NEW is in use, and responses carry its ID Context */
+    OSCORE_CONTEXT_B2_RESPONDED,
+};
+
+/** @brief Key material derived ahead of a step of the B.2 procedure
+ *
+ * This is populated by @ref oscore_context_b2_derive. All fields are private.
+ */
+struct oscore_context_b2_derived {
+    /** @private
+     *
+     * @brief Context the material was derived from */
+    const struct oscore_context_b2 *secctx;
+    /** @private */
+    struct oscore_context_primitive_immutables immutables;
+    /** @private */
+    uint8_t id_context[OSCORE_KEYIDCONTEXT_MAXLEN];
+    /** @private */
+    size_t id_context_len;
+};
+
+/** @brief Data for a security context that can perform B.2 re-keying
+ *
+ * This must always be initialized using @ref oscore_context_b2_initialize.
+ * All fields are private.
+ */
+struct oscore_context_b2 {
+    /** @private
+     *
+     * @brief The context currently in use
+     *
+     * Having this as the first member allows contextpair.h functions to treat
+     * B.2 contexts like primitive ones.
+     */
+    struct oscore_context_primitive primitive;
+    /** @private
+     *
+     * @brief Storage for the key material of the context in use, and for the
+     * one being derived or kept for reverting
+     */
+    struct oscore_context_primitive_immutables immutables[2];
+    /** @private
+     *
+     * @brief The context that was in use before a tentative switch
+     */
+    struct oscore_context_primitive previous;
+
+    /** @private */
+    oscore_crypto_hkdfalg_t hkdfalg;
+    /** @private */
+    uint8_t master_secret[OSCORE_CONTEXT_B2_SECRET_MAXLEN];
+    /** @private */
+    size_t master_secret_len;
+    /** @private */
+    uint8_t master_salt[OSCORE_CONTEXT_B2_SALT_MAXLEN];
+    /** @private */
+    size_t master_salt_len;
+
+    /** @private
+     *
+     * @brief ID Context of the context in use
+     */
+    uint8_t id_context[OSCORE_KEYIDCONTEXT_MAXLEN];
+    /** @private */
+    size_t id_context_len;
+    /** @private
+     *
+     * @brief ID Context of the context that was in use before a tentative
+     * switch
+     */
+    uint8_t previous_id_context[OSCORE_KEYIDCONTEXT_MAXLEN];
+    /** @private */
+    size_t previous_id_context_len;
+
+    /** @private */
+    enum oscore_context_b2_state state;
+    /** @private
+     *
+     * @brief State before the tentative switch
+     */
+    enum oscore_context_b2_state previous_state;
+};
+
+/** @brief Initialize a B.2 context
+ *
+ * @param[out] secctx B.2 context to initialize
+ * @param[in] template Key material template in which the algorithm and the
+ *     sender and recipient IDs are set; keys and IV are ignored
+ * @param[in] hkdfalg HKDF algorithm used to derive the keys
+ * @param[in] master_secret The Master Secret
+ * @param[in] master_secret_len Length of @p master_secret
+ * @param[in] master_salt The Master Salt (may be NULL if its length is 0)
+ * @param[in] master_salt_len Length of @p master_salt
+ * @param[in] id_context The initial ID Context (may be NULL for none)
+ * @param[in] id_context_len Length of @p id_context (must be 0 if it is NULL)
+ *
+ * @return true on success, false if any length exceeds the compile time
+ * limits or key derivation failed.
+ */
+bool oscore_context_b2_initialize(
+        struct oscore_context_b2 *secctx,
+        const struct oscore_context_primitive_immutables *template,
+        oscore_crypto_hkdfalg_t hkdfalg,
+        const uint8_t *master_secret,
+        size_t master_secret_len,
+        const uint8_t *master_salt,
+        size_t master_salt_len,
+        const uint8_t *id_context,
+        size_t id_context_len
+        );
+
+/** @brief Determine whether the sequence numbers of the context are running
+ * out
+ *
+ * @param[in] secctx B.2 context
+ *
+ * @return true if fewer than @ref OSCORE_CONTEXT_B2_REKEY_MARGIN sequence
+ * numbers are left and no procedure is ongoing
+ */
+OSCORE_NONNULL
+bool oscore_context_b2_wants_rekey(
+        const struct oscore_context_b2 *secctx
+        );
+
+/** @brief Derive the key material for an ID Context without using it yet
+ *
+ * The result can be passed to the next step of the procedure, which then
+ * needs no derivation of its own.
+ *
+ * This does not modify @p secctx. It may run while the context is used to
+ * protect and unprotect messages, but not concurrently with any other
+ * function of this group on the same context.
+ *
+ * @param[in] secctx B.2 context
+ * @param[in] id_context ID Context to derive for
+ * @param[in] id_context_len Length of @p id_context
+ * @param[out] derived Key material for the step
+ *
+ * @return true on success, false if the ID Context is too long or key
+ * derivation failed
+ */
+OSCORE_NONNULL
+bool oscore_context_b2_derive(
+        const struct oscore_context_b2 *secctx,
+        const uint8_t *id_context,
+        size_t id_context_len,
+        struct oscore_context_b2_derived *derived
+        );
+
+/** @brief Start the B.2 procedure as a client
+ *
+ * @param[inout] secctx B.2 context
+ * @param[in] r1 Random nonce R1
+ * @param[in] r1_len Length of @p r1
+ * @param[in] derived Result of @ref oscore_context_b2_derive for R1, or NULL
+ *     to derive here
+ *
+ * @return true on success, false if the nonce is too long or key derivation
+ * failed (in which case the context is left unmodified)
+ */
+bool oscore_context_b2_initiate(
+        struct oscore_context_b2 *secctx,
+        const uint8_t *r1,
+        size_t r1_len,
+        const struct oscore_context_b2_derived *derived
+        );
+
+/** @brief Prepare for unprotecting an incoming message with a KID Context
+ *
+ * This is called with the KID Context of the OSCORE option (if any) before
+ * unprotecting an incoming request (on the server) or response (on the
+ * client). If it indicates a step of the B.2 procedure, the context switches
+ * tentatively to the appropriate new key material.
+ *
+ * After any call to this, @ref oscore_context_b2_process_request or @ref
+ * oscore_context_b2_process_response needs to be called after unprotecting.
+ *
+ * @param[inout] secctx B.2 context
+ * @param[in] kidcontext KID Context from the incoming message's OSCORE
+ *     option, may be NULL if absent
+ * @param[in] kidcontext_len Length of @p kidcontext
+ * @param[in] is_request true if the message is a request
+ * @param[in] derived Result of @ref oscore_context_b2_derive for @p
+ *     kidcontext, or NULL to derive here if needed
+ *
+ * @return true if the context was switched tentatively
+ */
+bool oscore_context_b2_process_kidcontext(
+        struct oscore_context_b2 *secctx,
+        const uint8_t *kidcontext,
+        size_t kidcontext_len,
+        bool is_request,
+        const struct oscore_context_b2_derived *derived
+        );
+
+/** @brief Complete the server side processing of a possibly B.2 related request
+ *
+ * This is called after unprotecting a request. If the context was switched
+ * tentatively, it is reverted if unprotection failed. If unprotection
+ * succeeded, the request is downgraded to a duplicate (as it may be a replay),
+ * and the application needs to call @ref oscore_context_b2_respond before
+ * responding.
+ *
+ * @param[inout] secctx Security context backed by a B.2 context
+ * @param[inout] unprotectresult Result of unprotecting the request
+ * @param[inout] request_id Request ID of the request
+ *
+ * @return true if @ref oscore_context_b2_respond needs to be called
+ */
+OSCORE_NONNULL
+bool oscore_context_b2_process_request(
+        oscore_context_t *secctx,
+        enum oscore_unprotect_request_result *unprotectresult,
+        oscore_requestid_t *request_id
+        );
+
+/** @brief Derive the final context on the server
+ *
+ * @param[inout] secctx Security context backed by a B.2 context
+ * @param[in] r2 Random nonce R2
+ * @param[in] r2_len Length of @p r2
+ * @param[in] derived Result of @ref oscore_context_b2_derive for the current
+ *     ID Context followed by @p r2, or NULL to derive here
+ *
+ * @return true on success. On failure, the context is reverted to the state
+ * before the request, and the application should respond with an error.
+ */
+bool oscore_context_b2_respond(
+        oscore_context_t *secctx,
+        const uint8_t *r2,
+        size_t r2_len,
+        const struct oscore_context_b2_derived *derived
+        );
+
+/** @brief Complete the client side processing of a possibly B.2 related response
+ *
+ * @param[inout] secctx Security context backed by a B.2 context
+ * @param[in] unprotectresult Result of unprotecting the response
+ */
+OSCORE_NONNULL
+void oscore_context_b2_process_response(
+        oscore_context_t *secctx,
+        enum oscore_unprotect_response_result unprotectresult
+        );
+
+/** @} */
+
+#endif
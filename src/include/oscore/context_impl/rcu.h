@@ -0,0 +1,144 @@
+#ifndef OSCORE_CONTEXT_RCU_H
+#define OSCORE_CONTEXT_RCU_H
+
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#include <oscore/contextpair.h>
+
+/** @file */
+
+/** @ingroup oscore_contextpair
+ *
+ * @addtogroup oscore_context_rcu Read-copy-update publication of security contexts
+ *
+ * @brief Replacing a security context while exchanges with the old one are in flight
+ *
+ * A security context must not be modified or freed while any message or
+ * request ID that uses it is still around (see @ref design_thread). An
+ * application that replaces key material (eg. after commissioning, or to
+ * rotate keys) would therefore need to wait for all exchanges to complete, or
+ * refuse new ones while it waits.
+ *
+ * This component instead keeps two context slots, one of which is published.
+ * Exchanges @ref oscore_context_rcu_acquire the published context when they
+ * start, and use the returned context throughout (from unprotecting a request
+ * to encrypting the response, or from preparing a request to unprotecting the
+ * response), after which they @ref oscore_context_rcu_release it. A new
+ * context is written into the other slot and published with @ref
+ * oscore_context_rcu_publish; exchanges that started before keep using the
+ * previous context until they complete, while new exchanges pick up the new
+ * one.
+ *
+ * Acquisition and release only use atomic operations on the slot's reader
+ * count and never block or fail. Publication fails (rather than blocking) if
+ * the slot it would overwrite still has readers from two publications ago;
+ * @ref oscore_context_rcu_retired_is_idle tells when the previous context is
+ * not used any more (eg. to persist its final state, or to free its key
+ * material).
+ *
+ * This is the only component of the library that synchronizes on its own.
+ * Note that it only synchronizes the *publication* of contexts: Operations
+ * that modify the acquired context (which are practically all, as they take
+ * sequence numbers or update the replay window) still need to be serialized
+ * by the application, eg. with a mutex per context that is only held for the
+ * duration of the individual library call.
+ *
+ * @{
+ */
+
+/** @brief A pair of context slots, one of which is published
+ *
+ * All fields are private; this must be initialized using @ref
+ * oscore_context_rcu_init.
+ */
+struct oscore_context_rcu {
+    /** @private */
+    oscore_context_t slots[2];
+    /** @private
+     *
+     * @brief Index of the published slot
+     */
+    atomic_uint current;
+    /** @private
+     *
+     * @brief Number of exchanges that acquired the respective slot
+     */
+    atomic_uint readers[2];
+};
+
+/** @brief Set up context publication with an initial context
+ *
+ * @param[out] rcu Publication state to initialize
+ * @param[in] initial Context to publish initially
+ */
+OSCORE_NONNULL
+void oscore_context_rcu_init(
+        struct oscore_context_rcu *rcu,
+        const oscore_context_t *initial
+        );
+
+/** @brief Obtain the currently published context for an exchange
+ *
+ * @param[inout] rcu Publication state
+ *
+ * @return the context to use for the exchange. It stays valid until passed
+ * to @ref oscore_context_rcu_release.
+ */
+OSCORE_NONNULL
+oscore_context_t *oscore_context_rcu_acquire(
+        struct oscore_context_rcu *rcu
+        );
+
+/** @brief Indicate that an exchange is complete
+ *
+ * @param[inout] rcu Publication state
+ * @param[in] secctx Context previously returned by @ref
+ *     oscore_context_rcu_acquire. Neither it nor any request ID or message
+ *     created with it may be used after this call.
+ */
+OSCORE_NONNULL
+void oscore_context_rcu_release(
+        struct oscore_context_rcu *rcu,
+        oscore_context_t *secctx
+        );
+
+/** @brief Publish a new context
+ *
+ * The new context replaces the published one for all subsequent acquisitions.
+ * The previously published context stays valid for exchanges that acquired
+ * it.
+ *
+ * Calls to this need to be serialized by the application (there is usually
+ * only one party that changes key material anyway).
+ *
+ * @param[inout] rcu Publication state
+ * @param[in] secctx New context. Its data needs to be fully initialized, and
+ *     must not be shared with either of the currently used contexts.
+ *
+ * @return true if the context was published, false if the context published
+ * before the current one is still in use (see @ref
+ * oscore_context_rcu_retired_is_idle).
+ */
+OSCORE_NONNULL
+bool oscore_context_rcu_publish(
+        struct oscore_context_rcu *rcu,
+        const oscore_context_t *secctx
+        );
+
+/** @brief Determine whether the previously published context is unused
+ *
+ * @param[in] rcu Publication state
+ *
+ * @return true if no exchange uses the context that was replaced by the last
+ * publication, and the next publication will succeed. After the return of
+ * true, the application may reclaim that context's data.
+ */
+OSCORE_NONNULL
+bool oscore_context_rcu_retired_is_idle(
+        struct oscore_context_rcu *rcu
+        );
+
+/** @} */
+
+#endif
@@ -53,6 +53,8 @@ enum oscore_context_type {
     OSCORE_CONTEXT_PRIMITIVE,
     /** A security context that can be persisted, see @ref oscore_context_b1 */
     OSCORE_CONTEXT_B1,
+    /** A security context that can be re-keyed, see @ref oscore_context_b2 */
+    OSCORE_CONTEXT_B2,
 };
 
 // FIXME
@@ -124,6 +126,22 @@ bool oscore_context_take_seqno(
         oscore_requestid_t *request_id
         );
 
+/** @brief Show the request ID a security context would give out next
+ *
+ * This behaves like @ref oscore_context_take_seqno, but does not increment
+ * the sender sequence number.
+ *
+ * @param[in] secctx Security context pair whose sender role to look at
+ * @param[out] request_id Uninitialized request ID to populate with the sequence number
+ *
+ * @return ``true`` if a sequence number is available, otherwise ``false``
+ */
+OSCORE_NONNULL
+bool oscore_context_peek_seqno(
+        const oscore_context_t *secctx,
+        oscore_requestid_t *request_id
+        );
+
 /** @} */
 
 /** @brief Ask the context whether to encode the KID Context in the OSCORE option
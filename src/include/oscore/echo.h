@@ -0,0 +1,178 @@
+#ifndef OSCORE_ECHO_H
+#define OSCORE_ECHO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include <oscore_native/crypto.h>
+#include <oscore/contextpair.h>
+#include <oscore/message.h>
+#include <oscore/helpers.h>
+
+/** @file */
+
+/** @ingroup oscore_api
+ *
+ * @addtogroup oscore_echo Stateless Echo values
+ *
+ * @brief Generation and verification of Echo values without per-peer state
+ *
+ * An Echo option ([RFC9175](https://tools.ietf.org/html/rfc9175)) lets a
+ * server establish that a request was sent after the server produced the Echo
+ * value. Keeping a random value per peer for that purpose costs memory and
+ * bookkeeping on servers with many peers.
+ *
+ * The values produced here instead consist of a coarse timestamp and a
+ * truncated MAC over that timestamp and the identity of the security context
+ * (its sender ID, recipient ID and ID context). The MAC is computed with the
+ * backend's HKDF under a key known only to the server. A request that
+ * carries a value that verifies under the same security context was thus sent
+ * after the timestamp in it, without the server having stored anything about
+ * that peer.
+ *
+ * The library has no notion of time; the application provides a monotonic
+ * coarse time value using @ref oscore_echo_set_time (eg. seconds since
+ * startup, updated once per second). Values are accepted for a configurable
+ * number of those time units.
+ *
+ * If the server key is created randomly at startup and never persisted, a
+ * valid Echo value additionally proves that the request was sent after that
+ * startup; this is what allows using these values for recovering the replay
+ * window of @ref oscore_context_b1 contexts (see @ref
+ * oscore_context_b1_set_stateless_echo).
+ *
+ * In line with @ref design_thread, a @ref oscore_echo is only read by the
+ * generation and verification functions, and may be shared between any
+ * number of security contexts; updates to it (ie. @ref oscore_echo_set_time)
+ * need to be synchronized by the application.
+ *
+ * @{
+ */
+
+/** @brief Length of the server key used to generate Echo values */
+#define OSCORE_ECHO_KEY_LEN 32
+
+/** @brief Number of MAC bytes in an Echo value
+ *
+ * 8 bytes are ample given that Echo values are only valid for a short time
+ * and a forgery attempt needs a full request round trip. The value can be
+ * overridden at build time by predefining it.
+ */
+#ifndef OSCORE_ECHO_MAC_LEN
+#define OSCORE_ECHO_MAC_LEN 8
+#endif
+
+/** @brief Length of an Echo value produced by @ref oscore_echo_generate */
+#define OSCORE_ECHO_VALUE_LEN (4 + OSCORE_ECHO_MAC_LEN)
+
+/** @brief Server state for generating stateless Echo values
+ *
+ * All fields are private; this must be initialized using @ref
+ * oscore_echo_init.
+ */
+struct oscore_echo {
+    /** @private */
+    oscore_crypto_hkdfalg_t alg;
+    /** @private */
+    uint8_t key[OSCORE_ECHO_KEY_LEN];
+    /** @private
+     *
+     * @brief Current time, in application defined units
+     */
+    uint32_t now;
+    /** @private
+     *
+     * @brief Number of time units during which a value is accepted
+     */
+    uint32_t max_age;
+};
+
+/** @brief Set up stateless Echo value generation
+ *
+ * @param[out] echo Echo state to initialize
+ * @param[in] alg HKDF algorithm used for computing the MAC
+ * @param[in] key Server key, which should be generated from a good random
+ *     source and not be shared with anyone
+ * @param[in] max_age Number of time units (see @ref oscore_echo_set_time)
+ *     after which a generated value is not accepted any more
+ *
+ * The time is initialized to 0.
+ */
+OSCORE_NONNULL
+void oscore_echo_init(
+        struct oscore_echo *echo,
+        oscore_crypto_hkdfalg_t alg,
+        const uint8_t key[OSCORE_ECHO_KEY_LEN],
+        uint32_t max_age
+        );
+
+/** @brief Update the current time of the Echo state
+ *
+ * @param[inout] echo Echo state
+ * @param[in] now Current time. It must not decrease between calls, and may
+ *     wrap around only after much more than the configured maximum age.
+ */
+OSCORE_NONNULL
+void oscore_echo_set_time(
+        struct oscore_echo *echo,
+        uint32_t now
+        );
+
+/** @brief Produce an Echo value to be sent to the peer of a security context
+ *
+ * @param[in] echo Echo state
+ * @param[in] secctx Security context that will protect the message containing
+ *     the value, and that will be used to unprotect the request returning it
+ * @param[out] value Buffer to write the value to
+ *
+ * @return true on success, false if the crypto backend failed to produce a MAC
+ */
+OSCORE_NONNULL
+bool oscore_echo_generate(
+        const struct oscore_echo *echo,
+        const oscore_context_t *secctx,
+        uint8_t value[OSCORE_ECHO_VALUE_LEN]
+        );
+
+/** @brief Check whether an Echo value was produced for a security context and
+ * is still current
+ *
+ * @param[in] echo Echo state
+ * @param[in] secctx Security context with which the request carrying the
+ *     value was unprotected
+ * @param[in] value Echo value found in the request
+ * @param[in] value_len Length of @p value
+ *
+ * @return true if the value was generated using @p echo for @p secctx within
+ * the configured maximum age
+ */
+OSCORE_NONNULL
+bool oscore_echo_verify(
+        const struct oscore_echo *echo,
+        const oscore_context_t *secctx,
+        const uint8_t *value,
+        size_t value_len
+        );
+
+/** @brief Check whether an unprotected request carries a current Echo value
+ *
+ * This looks for an (inner) Echo option in @p request and verifies it using
+ * @ref oscore_echo_verify.
+ *
+ * @param[in] echo Echo state
+ * @param[in] secctx Security context with which the request was unprotected
+ * @param[in] request Unprotected request
+ *
+ * @return true if an Echo option was found and verified
+ */
+OSCORE_NONNULL
+bool oscore_echo_verify_request(
+        const struct oscore_echo *echo,
+        const oscore_context_t *secctx,
+        oscore_msg_protected_t *request
+        );
+
+/** @} */
+
+#endif
@@ -0,0 +1,109 @@
+#ifndef OSCORE_FANOUT_H
+#define OSCORE_FANOUT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include <oscore/message.h>
+#include <oscore/protection.h>
+#include <oscore/helpers.h>
+
+/** @file */
+
+/** @ingroup oscore_api
+ *
+ * @addtogroup oscore_fanout Observe notification fan-out
+ *
+ * @brief Protecting one notification for many observers
+ *
+ * When a resource changes, every observer gets a notification with the same
+ * plaintext, but protected in the observer's security context and bound to
+ * the observation's request. Rather than building the plaintext once per
+ * observer, it is described once in an @ref oscore_fanout_notification_t
+ * (with the inner options pre-encoded in a @ref
+ * oscore_msg_protected_template_t), and @ref oscore_fanout_notify copies it
+ * into one native message per observer and encrypts that.
+ *
+ * @{
+ */
+
+/** @brief Content of a notification that is sent to many observers
+ *
+ * All pointed-to data needs to stay valid for the duration of the @ref
+ * oscore_fanout_notify call.
+ */
+typedef struct {
+    /** Inner code (eg. 0x45 for 2.05 Content) */
+    uint8_t code;
+    /** Value of the outer Observe option (the notification's sequence
+     * number). The inner Observe option is added automatically. */
+    const uint8_t *observe;
+    /** Length of @ref observe */
+    size_t observe_len;
+    /** Inner options, or NULL if there are none besides Observe */
+    const oscore_msg_protected_template_t *inner_options;
+    /** Inner payload */
+    const uint8_t *payload;
+    /** Length of @ref payload */
+    size_t payload_len;
+} oscore_fanout_notification_t;
+
+/** @brief Outcome of protecting a notification for a single observer */
+enum oscore_fanout_result {
+    /** The target's message was protected and can be sent */
+    OSCORE_FANOUT_OK,
+    /** The security context can not provide protection for the message (see
+     * @ref OSCORE_PREPARE_SECCTX_UNAVAILABLE) */
+    OSCORE_FANOUT_SECCTX_UNAVAILABLE,
+    /** The notification does not fit the target's message */
+    OSCORE_FANOUT_MESSAGE_ERROR,
+    /** Encryption failed */
+    OSCORE_FANOUT_CRYPTO_ERROR,
+};
+
+/** @brief One observer of a notification */
+struct oscore_fanout_target {
+    /** Security context of the observer */
+    oscore_context_t *secctx;
+    /** Request ID of the observation's registration request */
+    oscore_requestid_t *request_id;
+    /** Allocated native message the notification is written into. Its outer
+     * header (type, token, and outer options with numbers up to Observe's) is
+     * set up by the application. */
+    oscore_msg_native_t message;
+    /** AAD computed for the observation by @ref oscore_aadcache_init, or NULL
+     * to compute it for every notification */
+    const struct oscore_aadcache *aadcache;
+    /** Outcome of protecting @ref message, set by @ref oscore_fanout_notify */
+    enum oscore_fanout_result result;
+};
+
+/** @brief Protect a notification for any number of observers
+ *
+ * @param[in] notification Content of the notification
+ * @param[inout] targets Observers to send the notification to
+ * @param[in] targets_count Number of entries in @p targets
+ *
+ * For each target, this prepares a response in the target's context (taking
+ * a fresh sequence number), writes the outer Observe option, the inner
+ * options, and the payload, and encrypts the message. The outcome is stored in
+ * each target's @ref oscore_fanout_target::result; targets that failed are
+ * skipped, and their messages should be freed rather than sent.
+ *
+ * The same restrictions on the use of the targets' security contexts as for
+ * @ref oscore_prepare_response apply; the same context may occur in several
+ * targets.
+ *
+ * @return the number of targets whose messages were protected successfully
+ */
+OSCORE_NONNULL
+size_t oscore_fanout_notify(
+        const oscore_fanout_notification_t *notification,
+        struct oscore_fanout_target *targets,
+        size_t targets_count
+        );
+
+/** @} */
+
+#endif
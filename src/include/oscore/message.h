@@ -46,6 +46,59 @@ struct oscore_opttrack {
     uint16_t option_number;
 };
 
+/** @brief Number of inner options indexed in received messages
+ *
+ * If this is nonzero, the inner options of a message are parsed once right
+ * after it is decrypted, and the number and position of each option is kept
+ * in the @ref oscore_msg_protected_t. Iteration over the options, @ref
+ * oscore_msg_protected_get_inner_option, @ref
+ * oscore_msg_protected_update_option and @ref oscore_msg_protected_map_payload
+ * then do not need to parse them again.
+ *
+ * Each index entry takes 6 bytes in every @ref oscore_msg_protected_t. Messages
+ * with more inner options than fit the index (or with inner options that can
+ * not be parsed) are processed as if no index were present.
+ *
+ * This defaults to 0 (no index). The value can be overridden at build time by
+ * predefining it to a numeric value in the compiler invocation.
+ */
+#ifndef OSCORE_MSG_PROTECTED_INDEX_SIZE
+#define OSCORE_MSG_PROTECTED_INDEX_SIZE 0
+#endif
+
+#if OSCORE_MSG_PROTECTED_INDEX_SIZE > 255
+#error "OSCORE_MSG_PROTECTED_INDEX_SIZE can be at most 255"
+#endif
+
+#if OSCORE_MSG_PROTECTED_INDEX_SIZE > 0
+/** @brief Position of an inner option inside a received message's plaintext
+ *
+ * @private
+ */
+struct oscore_msg_protected_indexentry {
+    uint16_t option_number;
+    /** Offset of the option value from the start of the plaintext */
+    uint16_t offset;
+    uint16_t length;
+};
+
+/** @brief Index of the inner options of a received message
+ *
+ * @private
+ */
+struct oscore_msg_protected_index {
+    /** Plaintext the offsets are relative to; this is the backend's payload
+     * (which is not mapped again while the index is usable) */
+    uint8_t *plaintext;
+    /** Number of populated entries */
+    uint8_t count;
+    /** False if the options did not fit into the index, or were not parsed
+     * successfully */
+    bool usable;
+    struct oscore_msg_protected_indexentry entries[OSCORE_MSG_PROTECTED_INDEX_SIZE];
+};
+#endif
+
 /** @brief Flags used inside OSCORE messages
  *
  * These flags keep some state about a message, especially about which fields
@@ -82,8 +135,16 @@ enum oscore_msg_protected_flags {
      * This is set at message creation time, and cleared when the OSCORE option
      * is written as an autooption. */
     OSCORE_MSG_PROTECTED_FLAG_PENDING_OSCORE = 1 << 4,
+
+    /** The payload has been trimmed, so there is no room for further inner
+     * options any more
+     *
+     * This is set by @ref oscore_msg_protected_trim_payload. */
+    OSCORE_MSG_PROTECTED_FLAG_TRIMMED = 1 << 5,
 };
 
+struct oscore_aadcache;
+
 /** @brief OSCORE protected CoAP message
  *
  * @todo This struct may need splitting up according to read/write state
@@ -135,6 +196,18 @@ typedef struct {
      * */
     size_t payload_offset;
 
+#if OSCORE_MSG_PROTECTED_INDEX_SIZE > 0
+    //
+    // only used in readable messages
+    //
+
+    /** @brief Inner options parsed at decryption time
+     *
+     * @private
+     */
+    struct oscore_msg_protected_index index;
+#endif
+
     //
     // only used in writable messages
     //
@@ -170,6 +243,14 @@ typedef struct {
     oscore_requestid_t request_id;
 
     struct oscore_opttrack class_e;
+
+    /** @brief Precomputed AAD used when encrypting, or NULL
+     *
+     * See @ref oscore_msg_protected_set_aadcache.
+     *
+     * @private
+     */
+    const struct oscore_aadcache *aadcache;
 } oscore_msg_protected_t;
 
 /** @brief OSCORE message operation error type
@@ -197,6 +278,44 @@ typedef enum {
     MESSAGESIZE,
 } oscore_msgerr_protected_t;
 
+/** @brief Pre-encoded sequence of inner options
+ *
+ * A template is populated once using @ref oscore_msg_protected_template_init
+ * and @ref oscore_msg_protected_template_add, and can then be added to any
+ * number of messages using @ref oscore_msg_protected_append_template.
+ *
+ * The encoded options are stored in a buffer provided by the application,
+ * which needs to stay unmodified while the template is in use.
+ *
+ * All fields are private.
+ */
+typedef struct {
+    /** @private
+     *
+     * @brief Encoded options, the first of them with its delta relative to 0
+     */
+    uint8_t *buffer;
+    /** @private */
+    size_t buffer_size;
+    /** @private
+     *
+     * @brief Number of bytes populated in @ref buffer
+     */
+    size_t length;
+    /** @private
+     *
+     * @brief Length of the first option's header (the part re-encoded when
+     * appending)
+     */
+    size_t first_header_length;
+    /** @private */
+    uint16_t first_option_number;
+    /** @private */
+    uint16_t first_value_length;
+    /** @private */
+    uint16_t last_option_number;
+} oscore_msg_protected_template_t;
+
 /** @brief Iterator (cursor) over a protected CoAP message
  */
 typedef struct {
@@ -238,6 +357,14 @@ typedef struct {
     uint16_t backend_peeked_optionnumber;
     const uint8_t *backend_peeked_value;
     size_t backend_peeked_value_len;
+
+#if OSCORE_MSG_PROTECTED_INDEX_SIZE > 0
+    /** @private
+     *
+     * @brief Index entry to be peeked at next, if the message's index is usable
+     */
+    uint8_t inner_index_position;
+#endif
 } oscore_msg_protected_optiter_t;
 
 /** Retrieve the inner CoAP code (request method or response code) from a protected message */
@@ -257,9 +384,14 @@ void oscore_msg_protected_set_code(oscore_msg_protected_t *msg, uint8_t code);
  * Depending on the option's protection class (U, I or E), the option is
  * included in the appropriate section of the message.
  *
+ * Options that go into the ciphertext (Class E) can be appended in any order;
+ * an option with a lower number than a previous one is inserted at its place
+ * in sequence. If the payload was already mapped, it is moved behind the new
+ * option, and needs to be mapped again.
+ *
  * Valid reasons for this to return an unsuccessful response include space
- * inside the message, options being written in the wrong order or payload
- * having been written to the message.
+ * inside the message, outer options being written in an order the backend
+ * does not support, or the payload having been trimmed.
  */
 oscore_msgerr_protected_t oscore_msg_protected_append_option(
         oscore_msg_protected_t *msg,
@@ -268,6 +400,119 @@ oscore_msgerr_protected_t oscore_msg_protected_append_option(
         size_t value_len
         );
 
+/** @brief Set up an empty option template
+ *
+ * @param[out] template Template to initialize
+ * @param[in] buffer Memory the encoded options are stored in
+ * @param[in] buffer_size Number of bytes available in @p buffer
+ */
+OSCORE_NONNULL
+void oscore_msg_protected_template_init(
+        oscore_msg_protected_template_t *template,
+        uint8_t *buffer,
+        size_t buffer_size
+        );
+
+/** @brief Encode an option into a template
+ *
+ * @param[inout] template Template to append to
+ * @param[in] option_number Option number of the new option
+ * @param[in] value Bytes to be added in the new option
+ * @param[in] value_len Number of bytes in the new option
+ *
+ * Only options that are always placed in the ciphertext (eg. Content-Format,
+ * Max-Age, ETag or Location-Path) can be added to templates; others make this
+ * return INVALID_ARG_ERROR. Options need to be added in ascending order, or
+ * OPTION_SEQUENCE is returned. OPTION_SIZE is returned when the template's
+ * buffer is exhausted.
+ */
+oscore_msgerr_protected_t oscore_msg_protected_template_add(
+        oscore_msg_protected_template_t *template,
+        uint16_t option_number,
+        const uint8_t *value,
+        size_t value_len
+        );
+
+/** @brief Copy the inner options written to a message into a template
+ *
+ * @param[out] template Template to initialize
+ * @param[in] buffer Memory the encoded options are stored in
+ * @param[in] buffer_size Number of bytes available in @p buffer
+ * @param[in] msg Message prepared for encryption, but not encrypted yet
+ *
+ * This allows reproducing the inner options of a message that was built once
+ * (eg. by an application handler) in later messages.
+ *
+ * @return OPTION_SIZE if the options do not fit into @p buffer, INVALID_ARG_ERROR
+ * if @p msg is not being written, and OK otherwise
+ */
+OSCORE_NONNULL
+oscore_msgerr_protected_t oscore_msg_protected_template_capture(
+        oscore_msg_protected_template_t *template,
+        uint8_t *buffer,
+        size_t buffer_size,
+        oscore_msg_protected_t *msg
+        );
+
+/** @brief Append all options of a template to a protected CoAP message
+ *
+ * @param[inout] msg Message to append to
+ * @param[in] template Template populated before
+ *
+ * This has the same effect as calling @ref oscore_msg_protected_append_option
+ * for each option of the template. When the template's options all come after
+ * the message's previous inner options and no payload was mapped yet (which is
+ * the typical case), the only work done is re-encoding the first option's
+ * header and copying the rest of the template.
+ */
+OSCORE_NONNULL
+oscore_msgerr_protected_t oscore_msg_protected_append_template(
+        oscore_msg_protected_t *msg,
+        const oscore_msg_protected_template_t *template
+        );
+
+/** @brief Sizes of a protected message as predicted by @ref
+ * oscore_msg_protected_predict_size */
+struct oscore_msg_protected_size {
+    /** Length of the OSCORE option's value */
+    size_t oscore_option_length;
+    /** Length of the native message's payload (code, inner options, inner
+     * payload and tag) */
+    size_t payload_length;
+};
+
+/** @brief Predict the sizes of a message before it is built
+ *
+ * @param[in] secctx Security context the message will be prepared with
+ * @param[in] is_request true if the message will be a request
+ * @param[in] request_id For responses, the request ID that will be passed to
+ *     @ref oscore_prepare_response; ignored (and may be NULL) for requests
+ * @param[in] inner_options Template containing the inner options the message
+ *     will carry, or NULL if there are none
+ * @param[in] payload_len Length of the inner payload
+ * @param[out] size Predicted sizes
+ *
+ * The sizes are exact as long as the context is not used for any other
+ * message before the prediction's message is prepared, and the message's
+ * inner options are encoded as in the template. An inner Observe option,
+ * which is added automatically along with an outer Observe option, is not
+ * accounted for; it adds at most one byte.
+ *
+ * Together with the size of the outer options (which depends on the backend's
+ * encoding), this allows picking the largest payload that fits a message.
+ *
+ * @return true on success, false if the context has no sequence numbers left
+ * for the message (in which case preparing the message would fail as well).
+ */
+bool oscore_msg_protected_predict_size(
+        const oscore_context_t *secctx,
+        bool is_request,
+        const oscore_requestid_t *request_id,
+        const oscore_msg_protected_template_t *inner_options,
+        size_t payload_len,
+        struct oscore_msg_protected_size *size
+        );
+
 /** @brief Update an single occurrence of an option in a protected CoAP message
  *
  * @param[inout] msg Message to update
@@ -289,6 +534,32 @@ oscore_msgerr_protected_t oscore_msg_protected_update_option(
         size_t value_len
         );
 
+/** @brief Look up a single occurrence of an inner option in a protected CoAP message
+ *
+ * @param[in] msg Message to search
+ * @param[in] option_number Option number of the requested option
+ * @param[in] option_occurrence Index inside the list of inner options of the same option number (starting at zero)
+ * @param[out] value Data inside the option
+ * @param[out] value_len Number of bytes inside the option
+ *
+ * Only the inner (Class E) options are considered; for options that may be
+ * transported outside the ciphertext, iterate over the message instead.
+ *
+ * This returns INVALID_ARG_ERROR if there is no such option, and
+ * INVALID_INNER_OPTION if the inner options could not be parsed before it was
+ * found. In received messages with an index (see @ref
+ * OSCORE_MSG_PROTECTED_INDEX_SIZE), this takes logarithmic time in the number
+ * of inner options, and does not access the backend.
+ */
+OSCORE_NONNULL
+oscore_msgerr_protected_t oscore_msg_protected_get_inner_option(
+        oscore_msg_protected_t *msg,
+        uint16_t option_number,
+        size_t option_occurrence,
+        const uint8_t **value,
+        size_t *value_len
+        );
+
 /** @brief Set up an iterator over a protected CoAP message
  *
  * Set up the previously uninitialized @p iter on which
@@ -399,6 +670,36 @@ oscore_msgerr_protected_t oscore_msg_protected_trim_payload(
         size_t payload_len
         );
 
+/** @brief Piece of payload for @ref oscore_msg_protected_write_payload */
+typedef struct {
+    /** Bytes to be written (may be NULL if @ref len is 0) */
+    const uint8_t *data;
+    /** Number of bytes at @ref data */
+    size_t len;
+} oscore_msg_protected_payloadpart_t;
+
+/** @brief Set the payload from several pieces of memory
+ *
+ * @param[inout] msg Message whose payload is written
+ * @param[in] parts Pieces to be concatenated into the payload
+ * @param[in] parts_count Number of items in @p parts
+ *
+ * This maps the payload, copies the parts one after the other directly into
+ * the plaintext, and trims the payload to their total length. It is a
+ * shorthand for @ref oscore_msg_protected_map_payload and @ref
+ * oscore_msg_protected_trim_payload that saves applications assembling their
+ * payload from different sources a copy into a staging buffer.
+ *
+ * If the parts do not fit into the message, MESSAGESIZE is returned, and the
+ * message is left in the state after mapping the payload.
+ */
+OSCORE_NONNULL
+oscore_msgerr_protected_t oscore_msg_protected_write_payload(
+        oscore_msg_protected_t *msg,
+        const oscore_msg_protected_payloadpart_t *parts,
+        size_t parts_count
+        );
+
 /** Return true if an error type indicates an unsuccessful operation */
 bool oscore_msgerr_protected_is_error(oscore_msgerr_protected_t);
 
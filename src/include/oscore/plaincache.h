@@ -0,0 +1,280 @@
+#ifndef OSCORE_PLAINCACHE_H
+#define OSCORE_PLAINCACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include <oscore/message.h>
+#include <oscore/helpers.h>
+
+/** @file */
+
+/** @ingroup oscore_api
+ *
+ * @addtogroup oscore_plaincache Plaintext response cache
+ *
+ * @brief Answering GET requests without running the resource handler
+ *
+ * Resources whose representation changes rarely can have their responses'
+ * plaintext (code, inner options and payload) cached on the server. On a
+ * cache hit, the cached plaintext is copied into the response, which still
+ * needs to be encrypted for the requesting client (as every response is
+ * protected individually), but the resource handler does not need to run.
+ *
+ * A typical server flow is:
+ *
+ * * After unprotecting a request, @ref oscore_plaincache_key_from_request
+ *   determines whether the request can be served from the cache.
+ * * If so, @ref oscore_plaincache_find looks for a fresh entry; on a hit, the
+ *   response is prepared, written with @ref oscore_plaincache_write, and
+ *   encrypted.
+ * * Otherwise, the handler builds the response, and @ref
+ *   oscore_plaincache_store keeps a copy before it is encrypted.
+ * * When a resource changes, @ref oscore_plaincache_invalidate drops its
+ *   entries.
+ *
+ * Every key carries a scope, which is typically the security context the
+ * request was unprotected with: a response rendered for one client is then
+ * only served to that client, and whatever authorization the handler
+ * performs per context is not bypassed. Applications whose handlers behave
+ * the same for a group of contexts can pass a value that identifies the group
+ * instead, and share entries between its members.
+ *
+ * Entries expire after the Max-Age given when storing them; the library has no
+ * clock, so the application passes in the current time as seconds of any
+ * monotonic clock. The cache does not allocate memory; its entries are
+ * provided by the application.
+ *
+ * @{
+ */
+
+/** @brief Space for the encoded cache key (Uri-Path, Uri-Query and Accept)
+ *
+ * Each option takes 2 bytes in addition to its value. Requests with longer
+ * keys are not cached.
+ *
+ * The value can be overridden at build time by predefining it.
+ */
+#ifndef OSCORE_PLAINCACHE_KEY_MAXLEN
+#define OSCORE_PLAINCACHE_KEY_MAXLEN 48
+#endif
+
+/** @brief Space for the inner options and payload of a cached response
+ *
+ * Responses that do not fit are not cached.
+ *
+ * The value can be overridden at build time by predefining it.
+ */
+#ifndef OSCORE_PLAINCACHE_MAXLEN
+#define OSCORE_PLAINCACHE_MAXLEN 128
+#endif
+
+/** @brief Key of a cache entry
+ *
+ * Keys are built from the request using @ref
+ * oscore_plaincache_key_from_request, or (to describe resources for @ref
+ * oscore_plaincache_invalidate) with @ref oscore_plaincache_key_init and @ref
+ * oscore_plaincache_key_add.
+ *
+ * All fields are private.
+ */
+struct oscore_plaincache_key {
+    /** @private
+     *
+     * @brief Scope the key is valid in, compared by identity */
+    const void *scope;
+    /** @private
+     *
+     * @brief Options, each as 1 byte option number, 1 byte length and the
+     * value */
+    uint8_t data[OSCORE_PLAINCACHE_KEY_MAXLEN];
+    /** @private */
+    uint8_t length;
+};
+
+/** @brief A cached response
+ *
+ * All fields are private.
+ */
+struct oscore_plaincache_entry {
+    /** @private */
+    struct oscore_plaincache_key key;
+    /** @private */
+    bool used;
+    /** @private
+     *
+     * @brief Time (in the application's clock) at which the entry expires */
+    uint32_t expires;
+    /** @private */
+    uint8_t code;
+    /** @private
+     *
+     * @brief Inner options, stored at the start of @ref data */
+    oscore_msg_protected_template_t options;
+    /** @private
+     *
+     * @brief Length of the payload, stored in @ref data after the options */
+    uint16_t payload_length;
+    /** @private */
+    uint8_t data[OSCORE_PLAINCACHE_MAXLEN];
+};
+
+/** @brief Cache of response plaintexts
+ *
+ * All fields are private.
+ */
+struct oscore_plaincache {
+    /** @private */
+    struct oscore_plaincache_entry *entries;
+    /** @private */
+    size_t entries_count;
+    /** @private
+     *
+     * @brief Index of the entry replaced next if none is free */
+    size_t next;
+};
+
+/** @brief Set up a cache
+ *
+ * @param[out] cache Cache to initialize
+ * @param[in] entries Memory for the cached responses. The entries must not be
+ *     moved while the cache is in use.
+ * @param[in] entries_count Number of elements in @p entries
+ */
+OSCORE_NONNULL
+void oscore_plaincache_init(
+        struct oscore_plaincache *cache,
+        struct oscore_plaincache_entry *entries,
+        size_t entries_count
+        );
+
+/** @brief Start an empty key
+ *
+ * @param[out] key Key to initialize
+ * @param[in] scope Scope of the key, see @ref
+ *     oscore_plaincache_key_from_request. Keys that only describe resources
+ *     for @ref oscore_plaincache_invalidate can use NULL.
+ */
+void oscore_plaincache_key_init(struct oscore_plaincache_key *key, const void *scope);
+
+/** @brief Add an option to a key
+ *
+ * @param[inout] key Key to extend
+ * @param[in] option_number Number of the option (Uri-Path, Uri-Query or
+ *     Accept)
+ * @param[in] value Option value
+ * @param[in] value_len Length of @p value
+ *
+ * Options need to be added in the sequence in which they occur in requests.
+ *
+ * @return false if the key is full
+ */
+bool oscore_plaincache_key_add(
+        struct oscore_plaincache_key *key,
+        uint16_t option_number,
+        const uint8_t *value,
+        size_t value_len
+        );
+
+/** @brief Build the cache key of a request
+ *
+ * @param[out] key Key built from the request's inner Uri-Path, Uri-Query and
+ *     Accept options
+ * @param[in] request Unprotected request
+ * @param[in] scope Value that responses are only shared within. This is
+ *     typically the @ref oscore_context_t the request was unprotected with;
+ *     only if the resource's handler would send the same response to a
+ *     group of security contexts can a value that identifies that group be
+ *     used instead. It is only compared, never dereferenced.
+ *
+ * Only GET requests that are not Observe registrations are cacheable. Requests
+ * that carry an ETag, Block1, Block2 or Size2 option are not cacheable either,
+ * as their responses depend on those. Other inner options of the request do
+ * not take part in the key, so resources whose representation depends on
+ * them must not be cached.
+ *
+ * @return true if the request can be served from the cache
+ */
+OSCORE_NONNULL
+bool oscore_plaincache_key_from_request(
+        struct oscore_plaincache_key *key,
+        oscore_msg_protected_t *request,
+        const void *scope
+        );
+
+/** @brief Look up a fresh response
+ *
+ * @param[inout] cache Cache to search (expired entries are dropped)
+ * @param[in] key Key of the request
+ * @param[in] now Current time in seconds
+ *
+ * @return the cached response, or NULL if there is none. The entry is valid
+ * until the cache is modified next.
+ */
+OSCORE_NONNULL
+const struct oscore_plaincache_entry *oscore_plaincache_find(
+        struct oscore_plaincache *cache,
+        const struct oscore_plaincache_key *key,
+        uint32_t now
+        );
+
+/** @brief Write a cached response
+ *
+ * @param[in] entry Response found by @ref oscore_plaincache_find
+ * @param[inout] response Response freshly prepared with @ref
+ *     oscore_prepare_response
+ * @param[in] now Current time in seconds
+ *
+ * This sets the code, the inner options, a Max-Age option with the entry's
+ * remaining lifetime, and the payload. The response can be encrypted right
+ * away.
+ */
+OSCORE_NONNULL
+oscore_msgerr_protected_t oscore_plaincache_write(
+        const struct oscore_plaincache_entry *entry,
+        oscore_msg_protected_t *response,
+        uint32_t now
+        );
+
+/** @brief Keep a copy of a response's plaintext
+ *
+ * @param[inout] cache Cache to store the response in
+ * @param[in] key Key of the request the response answers
+ * @param[in] response Response whose payload is written and trimmed, but which
+ *     is not encrypted yet. It must not carry a Max-Age option; that is
+ *     added from @p max_age when the cached response is written.
+ * @param[in] max_age Number of seconds the response is fresh
+ * @param[in] now Current time in seconds
+ *
+ * An older response cached with the same key is replaced.
+ *
+ * @return true if the response was cached, false if it is too large
+ */
+OSCORE_NONNULL
+bool oscore_plaincache_store(
+        struct oscore_plaincache *cache,
+        const struct oscore_plaincache_key *key,
+        oscore_msg_protected_t *response,
+        uint32_t max_age,
+        uint32_t now
+        );
+
+/** @brief Drop responses of a resource
+ *
+ * @param[inout] cache Cache to remove entries from
+ * @param[in] prefix Key whose responses to drop. All entries whose key starts
+ *     with this are dropped; a key containing only Uri-Path options thus drops
+ *     all representations of the resource and of any resource below it. An
+ *     empty key drops all entries. The scope of @p prefix is ignored, and
+ *     entries of all scopes are dropped.
+ */
+OSCORE_NONNULL
+void oscore_plaincache_invalidate(
+        struct oscore_plaincache *cache,
+        const struct oscore_plaincache_key *prefix
+        );
+
+/** @} */
+
+#endif
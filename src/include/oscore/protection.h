@@ -251,6 +251,57 @@ oscore_msg_native_t oscore_release_unprotected(
         oscore_msg_protected_t *unprotected
         );
 
+/** @brief Upper bound on the length of a message's AAD
+ *
+ * This holds as long as no Class I options are used.
+ */
+#define OSCORE_AADCACHE_MAXLEN ( \
+        11 /* array head, "Encrypt0" and empty protected header */ + \
+        2 /* external AAD length */ + \
+        3 /* external AAD array head, version, algorithms array head */ + \
+        5 /* algorithm */ + \
+        1 + OSCORE_KEYID_MAXLEN /* request KID */ + \
+        1 + PIV_BYTES /* request PIV */ + \
+        1 /* Class I options */ \
+        )
+
+/** @brief Precomputed AAD of the responses to a request
+ *
+ * All responses to a request share the same AAD, as it is built from the
+ * request's KID and Partial IV (and the context's algorithm). A server sending
+ * many notifications on an observation can compute it once with @ref
+ * oscore_aadcache_init, keep it next to the observation's @ref
+ * oscore_requestid_t, and pass it to every notification with @ref
+ * oscore_msg_protected_set_aadcache.
+ *
+ * All fields are private.
+ */
+struct oscore_aadcache {
+    /** @private */
+    uint8_t aad[OSCORE_AADCACHE_MAXLEN];
+    /** @private */
+    uint8_t length;
+};
+
+/** @brief Compute the AAD shared by all responses to a request
+ *
+ * @param[out] cache Cache to populate
+ * @param[in] secctx Security context the request was received in
+ * @param[in] request_id Request ID of the request
+ *
+ * The cache stays valid as long as the security context's recipient ID and
+ * algorithm do not change.
+ *
+ * @return false if the AAD could not be built (eg. because the algorithm has
+ * no numeric identifier)
+ */
+OSCORE_NONNULL
+bool oscore_aadcache_init(
+        struct oscore_aadcache *cache,
+        const oscore_context_t *secctx,
+        const oscore_requestid_t *request_id
+        );
+
 /** @brief Results of message encryption preparation
  *
  * Users of the library should never check for identity to unsuccessful values,
@@ -263,6 +314,9 @@ enum oscore_prepare_result {
     // There may be a future distinction between temporary ("Can't send yet,
     // flash write not completed yet") and permanent failures
     OSCORE_PREPARE_SECCTX_UNAVAILABLE,
+    /** The buffer given to a @ref oscore_raw function can not even hold the
+     * outer options, a plaintext code and the tag */
+    OSCORE_PREPARE_ERROR_SIZE,
 };
 
 /** @brief Response message preparation
@@ -316,6 +370,21 @@ enum oscore_prepare_result oscore_prepare_request(
         oscore_requestid_t *request_id
         );
 
+/** @brief Use a precomputed AAD when encrypting a response
+ *
+ * @param[inout] unprotected Response prepared with @ref oscore_prepare_response
+ * @param[in] cache AAD computed by @ref oscore_aadcache_init for the same
+ *     context and request ID as were passed to @ref oscore_prepare_response
+ *
+ * @ref oscore_encrypt_message then feeds the cached AAD to the AEAD in a single
+ * call rather than assembling it. The cache needs to stay valid until then.
+ */
+OSCORE_NONNULL
+void oscore_msg_protected_set_aadcache(
+        oscore_msg_protected_t *unprotected,
+        const struct oscore_aadcache *cache
+        );
+
 /** @brief Results of message encryption
  *
  * Users of the library should never check for identity to unsuccessful values,
@@ -0,0 +1,226 @@
+#ifndef OSCORE_RAW_H
+#define OSCORE_RAW_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include <oscore/protection.h>
+#include <oscore/helpers.h>
+
+/** @file */
+
+/** @ingroup oscore_api
+ *
+ * @addtogroup oscore_raw Protection of raw datagrams
+ *
+ * @brief Unprotecting and protecting CoAP messages held in byte buffers
+ *
+ * Services that hold CoAP messages in UDP wire format anyway (eg. forwarding
+ * or terminating OSCORE at high rates) can use these functions instead of
+ * wrapping the buffer in a native message for the @ref oscore_protection.
+ *
+ * On reception, @ref oscore_raw_parse finds the OSCORE option and the
+ * ciphertext in a single pass over the message, so that the security context
+ * can be selected by the KID, and @ref oscore_unprotect_request_raw (or @ref
+ * oscore_unprotect_response_raw) decrypts the ciphertext in place. The
+ * plaintext is then described by a @ref oscore_raw_plaintext, whose inner
+ * options are in CoAP encoding.
+ *
+ * On transmission, the application writes the CoAP header and token (and any
+ * outer options that precede the OSCORE option) into a buffer. @ref
+ * oscore_prepare_request_raw (or @ref oscore_prepare_response_raw) appends the
+ * OSCORE option and the payload marker, and indicates where to write the
+ * plaintext (the inner code, the inner options in CoAP encoding, and
+ * optionally a payload marker and payload). @ref oscore_encrypt_message_raw
+ * then encrypts that in place and appends the tag.
+ *
+ * Class I options are not supported, just as with the rest of the library.
+ * No inner options are generated automatically; in particular, an inner
+ * Observe option needs to be written by the application.
+ *
+ * @{
+ */
+
+/** @brief Results of @ref oscore_raw_parse */
+enum oscore_raw_parse_result {
+    /** The message is an OSCORE message */
+    OSCORE_RAW_PARSE_OK,
+    /** The message is a well-formed CoAP message, but has no OSCORE option */
+    OSCORE_RAW_PARSE_NO_OSCORE,
+    /** The message is not a well-formed CoAP message, or its OSCORE option
+     * can not be parsed */
+    OSCORE_RAW_PARSE_INVALID,
+};
+
+/** @brief A received OSCORE message located in a buffer
+ *
+ * All fields are private, except for @ref header.
+ */
+struct oscore_raw_message {
+    /** @brief The message's OSCORE option
+     *
+     * This points into the message buffer. */
+    oscore_oscoreoption_t header;
+    /** @private */
+    uint8_t *ciphertext;
+    /** @private */
+    size_t ciphertext_length;
+};
+
+/** @brief Plaintext of an unprotected message
+ *
+ * All pointers point into the message buffer, where the plaintext was
+ * decrypted.
+ */
+struct oscore_raw_plaintext {
+    /** Inner code */
+    uint8_t code;
+    /** Inner (Class E) options in CoAP encoding; the first option's delta is
+     * its number */
+    const uint8_t *options;
+    /** Length of @ref options */
+    size_t options_length;
+    /** Payload, or NULL if there is none */
+    uint8_t *payload;
+    /** Length of @ref payload */
+    size_t payload_length;
+};
+
+/** @brief Locate the OSCORE option and ciphertext of a received message
+ *
+ * @param[in] buffer Message in CoAP over UDP wire format
+ * @param[in] length Length of the message
+ * @param[out] message Parsed message. This references @p buffer.
+ */
+OSCORE_NONNULL
+enum oscore_raw_parse_result oscore_raw_parse(
+        uint8_t *buffer,
+        size_t length,
+        struct oscore_raw_message *message
+        );
+
+/** @brief Decrypt a request in place
+ *
+ * This behaves like @ref oscore_unprotect_request (including the replay
+ * protection), but works on a message parsed by @ref oscore_raw_parse.
+ *
+ * @param[inout] message Parsed message; its ciphertext is decrypted in place
+ * @param[out] plaintext Description of the decrypted plaintext
+ * @param[inout] secctx Security context to decrypt with (typically chosen by
+ *     the KID in the message's header)
+ * @param[out] request_id Request ID for building responses
+ *
+ * A plaintext whose inner options are malformed is reported as invalid, even
+ * though its sequence number was already consumed.
+ */
+OSCORE_NONNULL
+enum oscore_unprotect_request_result oscore_unprotect_request_raw(
+        struct oscore_raw_message *message,
+        struct oscore_raw_plaintext *plaintext,
+        oscore_context_t *secctx,
+        oscore_requestid_t *request_id
+        );
+
+/** @brief Decrypt a response in place
+ *
+ * This behaves like @ref oscore_unprotect_response, but works on a message
+ * parsed by @ref oscore_raw_parse.
+ *
+ * @param[inout] message Parsed message; its ciphertext is decrypted in place
+ * @param[out] plaintext Description of the decrypted plaintext
+ * @param[inout] secctx Security context the request was sent in
+ * @param[in] request_id Request ID of the request
+ */
+OSCORE_NONNULL
+enum oscore_unprotect_response_result oscore_unprotect_response_raw(
+        struct oscore_raw_message *message,
+        struct oscore_raw_plaintext *plaintext,
+        oscore_context_t *secctx,
+        oscore_requestid_t *request_id
+        );
+
+/** @brief An outgoing message between preparation and encryption
+ *
+ * All fields are private.
+ */
+struct oscore_raw_outgoing {
+    /** @private */
+    uint8_t *plaintext;
+    /** @private Length of the message up to the plaintext */
+    size_t plaintext_offset;
+    /** @private Bytes available for the plaintext and the tag */
+    size_t available;
+    /** @private */
+    oscore_context_t *secctx;
+    /** @private */
+    oscore_requestid_t request_id;
+    /** @private */
+    oscore_requestid_t partial_iv;
+    /** @private */
+    bool is_request;
+};
+
+/** @brief Prepare a request in a buffer
+ *
+ * @param[inout] buffer Buffer that starts with a CoAP header and token, and
+ *     any outer options with numbers up to 8. Its code is set to POST.
+ * @param[in] size Size of @p buffer
+ * @param[in] outer_length Length of the data already in @p buffer
+ * @param[in] last_outer_option Number of the last option in @p buffer, or 0
+ * @param[out] outgoing Message state to pass to @ref oscore_encrypt_message_raw
+ * @param[inout] secctx Security context to protect the request in
+ * @param[out] request_id Request ID for matching the response
+ * @param[out] plaintext Where the plaintext is to be written
+ * @param[out] plaintext_size Number of bytes available for the plaintext
+ */
+OSCORE_NONNULL
+enum oscore_prepare_result oscore_prepare_request_raw(
+        uint8_t *buffer,
+        size_t size,
+        size_t outer_length,
+        uint16_t last_outer_option,
+        struct oscore_raw_outgoing *outgoing,
+        oscore_context_t *secctx,
+        oscore_requestid_t *request_id,
+        uint8_t **plaintext,
+        size_t *plaintext_size
+        );
+
+/** @brief Prepare a response in a buffer
+ *
+ * Like @ref oscore_prepare_request_raw, but for a response to a request with
+ * @p request_id (which is updated like in @ref oscore_prepare_response). The
+ * outer code is set to 2.05 Content.
+ */
+OSCORE_NONNULL
+enum oscore_prepare_result oscore_prepare_response_raw(
+        uint8_t *buffer,
+        size_t size,
+        size_t outer_length,
+        uint16_t last_outer_option,
+        struct oscore_raw_outgoing *outgoing,
+        oscore_context_t *secctx,
+        oscore_requestid_t *request_id,
+        uint8_t **plaintext,
+        size_t *plaintext_size
+        );
+
+/** @brief Encrypt a prepared message in place
+ *
+ * @param[inout] outgoing Message prepared with @ref oscore_prepare_request_raw
+ *     or @ref oscore_prepare_response_raw
+ * @param[in] plaintext_length Number of bytes written to the plaintext, at
+ *     least 1 (for the code)
+ * @param[out] length Total length of the message to send
+ */
+OSCORE_NONNULL
+enum oscore_finish_result oscore_encrypt_message_raw(
+        struct oscore_raw_outgoing *outgoing,
+        size_t plaintext_length,
+        size_t *length
+        );
+
+/** @} */
+
+#endif
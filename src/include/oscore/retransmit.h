@@ -0,0 +1,241 @@
+#ifndef OSCORE_RETRANSMIT_H
+#define OSCORE_RETRANSMIT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include <oscore_native/message.h>
+#include <oscore/protection.h>
+#include <oscore/helpers.h>
+
+/** @file */
+
+/** @ingroup oscore_api
+ *
+ * @addtogroup oscore_retransmit Retransmission response cache
+ *
+ * @brief Answering retransmitted requests without processing them again
+ *
+ * When a confirmable request is retransmitted because the response was lost,
+ * the server sees the same request twice; the second time, @ref
+ * oscore_unprotect_request reports it as @ref
+ * OSCORE_UNPROTECT_REQUEST_DUPLICATE. Running the handler again would not be
+ * safe for non-idempotent requests (and would cost a full encryption), and the
+ * client can not use an error response.
+ *
+ * This cache keeps copies of recently sent protected responses, keyed by the
+ * security context, the request's Partial IV and the request's AEAD tag. When
+ * a request arrives, its tag is taken with @ref oscore_retransmit_tag_init
+ * right after its OSCORE option was parsed, @ref oscore_retransmit_find can
+ * look it up, and @ref oscore_retransmit_write copies the stored response into
+ * the outgoing message without any cryptographic operation.
+ *
+ * The request is not verified when it is answered from the cache. Matching
+ * the tag ensures that only a copy of the request the response was created
+ * for gets it: a request that reuses the Partial IV with any other content
+ * (which would fail decryption) finds nothing, and is processed (and
+ * rejected) normally. A peer that has a copy of the original request only
+ * gets the response that was already sent for it.
+ *
+ * The cache does not allocate memory; its entries are provided by the
+ * application, and the oldest entry is replaced when a new response is
+ * stored.
+ *
+ * @{
+ */
+
+/** @brief Space for the outer options and payload of a cached response
+ *
+ * Each outer option takes 4 bytes in addition to its value. Responses that do
+ * not fit are not cached.
+ *
+ * The value can be overridden at build time by predefining it.
+ */
+#ifndef OSCORE_RETRANSMIT_MAXLEN
+#define OSCORE_RETRANSMIT_MAXLEN 128
+#endif
+
+/** @brief Maximum length of an AEAD tag kept to recognize a request
+ *
+ * This covers the tags of all algorithms specified for OSCORE. Requests with
+ * longer tags are not cached.
+ *
+ * The value can be overridden at build time by predefining it.
+ */
+#ifndef OSCORE_RETRANSMIT_TAG_MAXLEN
+#define OSCORE_RETRANSMIT_TAG_MAXLEN 16
+#endif
+
+/** @brief AEAD tag of a received request
+ *
+ * All fields are private.
+ */
+struct oscore_retransmit_tag {
+    /** @private */
+    uint8_t tag[OSCORE_RETRANSMIT_TAG_MAXLEN];
+    /** @private */
+    uint8_t tag_len;
+};
+
+/** @brief A cached response
+ *
+ * All fields are private.
+ */
+struct oscore_retransmit_entry {
+    /** @private
+     *
+     * @brief Context the request was received in, or NULL for unused entries
+     */
+    const oscore_context_t *secctx;
+    /** @private
+     *
+     * @brief Request's Partial IV as sent on the wire */
+    uint8_t request_piv[PIV_BYTES];
+    /** @private */
+    uint8_t request_piv_len;
+    /** @private
+     *
+     * @brief Tag of the request the response was created for */
+    struct oscore_retransmit_tag request_tag;
+    /** @private
+     *
+     * @brief Outer code of the response */
+    uint8_t code;
+    /** @private
+     *
+     * @brief Number of bytes in @ref data used for outer options; each is
+     * stored as 2 bytes option number, 2 bytes length and the value.
+     */
+    uint16_t options_length;
+    /** @private
+     *
+     * @brief Number of bytes in @ref data used for the payload (following the
+     * options) */
+    uint16_t payload_length;
+    /** @private */
+    uint8_t data[OSCORE_RETRANSMIT_MAXLEN];
+};
+
+/** @brief Cache of recently sent responses
+ *
+ * All fields are private.
+ */
+struct oscore_retransmit_cache {
+    /** @private */
+    struct oscore_retransmit_entry *entries;
+    /** @private */
+    size_t entries_count;
+    /** @private
+     *
+     * @brief Index of the entry replaced next */
+    size_t next;
+};
+
+/** @brief Set up a cache
+ *
+ * @param[out] cache Cache to initialize
+ * @param[in] entries Memory for the cached responses
+ * @param[in] entries_count Number of elements in @p entries
+ */
+OSCORE_NONNULL
+void oscore_retransmit_init(
+        struct oscore_retransmit_cache *cache,
+        struct oscore_retransmit_entry *entries,
+        size_t entries_count
+        );
+
+/** @brief Take the AEAD tag of a received request
+ *
+ * @param[out] tag Tag to populate
+ * @param[in] secctx Security context the request's OSCORE option points to
+ * @param[in] request Request as received, before it is unprotected (which
+ *     decrypts it in place)
+ *
+ * @return true if the tag was taken, false if the request's payload is too
+ * short to contain one or the tag is longer than @ref
+ * OSCORE_RETRANSMIT_TAG_MAXLEN (then the request is neither looked up nor
+ * cached)
+ */
+OSCORE_NONNULL
+bool oscore_retransmit_tag_init(
+        struct oscore_retransmit_tag *tag,
+        const oscore_context_t *secctx,
+        oscore_msg_native_t request
+        );
+
+/** @brief Keep a copy of a response that is about to be sent
+ *
+ * @param[inout] cache Cache to store the response in
+ * @param[in] secctx Security context the request was received in
+ * @param[in] request_id Request ID the response was prepared with
+ * @param[in] request_tag Tag taken from the request before it was unprotected
+ * @param[in] protected Response, after a successful @ref
+ *     oscore_encrypt_message
+ *
+ * @return true if the response was cached, false if it is too large or its
+ * options could not be read
+ */
+OSCORE_NONNULL
+bool oscore_retransmit_store(
+        struct oscore_retransmit_cache *cache,
+        const oscore_context_t *secctx,
+        const oscore_requestid_t *request_id,
+        const struct oscore_retransmit_tag *request_tag,
+        oscore_msg_native_t protected
+        );
+
+/** @brief Look up the response cached for a request
+ *
+ * @param[in] cache Cache to look the request up in
+ * @param[in] secctx Security context the request's OSCORE option points to
+ * @param[in] header Parsed OSCORE option of the request
+ * @param[in] request_tag Tag taken from the request
+ *
+ * This does not need the request to be unprotected, and is typically called
+ * right after its OSCORE option was parsed and its context was found. Only a
+ * response created for a request with the same Partial IV and the same tag is
+ * found.
+ *
+ * @return the cached response, or NULL if none is found (then the request
+ * needs to be processed normally). The entry is valid until the next call to
+ * @ref oscore_retransmit_store or @ref oscore_retransmit_forget.
+ */
+OSCORE_NONNULL
+const struct oscore_retransmit_entry *oscore_retransmit_find(
+        const struct oscore_retransmit_cache *cache,
+        const oscore_context_t *secctx,
+        const oscore_oscoreoption_t *header,
+        const struct oscore_retransmit_tag *request_tag
+        );
+
+/** @brief Write a cached response into a message
+ *
+ * @param[in] entry Response found by @ref oscore_retransmit_find
+ * @param[inout] response Allocated message with no options set yet, into which
+ *     the outer code, the outer options and the ciphertext are copied
+ *
+ * No cryptographic operations are performed.
+ *
+ * @return true if the message can be sent, false if it was too small
+ */
+OSCORE_NONNULL
+bool oscore_retransmit_write(
+        const struct oscore_retransmit_entry *entry,
+        oscore_msg_native_t response
+        );
+
+/** @brief Remove all responses cached for a security context
+ *
+ * This needs to be called before a security context is released or replaced
+ * by another one at the same address.
+ */
+OSCORE_NONNULL
+void oscore_retransmit_forget(
+        struct oscore_retransmit_cache *cache,
+        const oscore_context_t *secctx
+        );
+
+/** @} */
+
+#endif
@@ -28,6 +28,12 @@
  *  nonlinear function of the maximum key lengths and algorithms; 32 byte will
  *  often suffice as long as no Class-I options are present).
  *
+ *  Deployments that use only a single algorithm can define @ref
+ *  OSCORE_FIXED_AEADALG. Backends that support it then define some of the
+ *  below functions as `static inline` in their `oscore_native/crypto_type.h`
+ *  (the declarations here merely redeclare them), so that algorithm
+ *  properties become compile time constants.
+ *
  * @{
  */
 
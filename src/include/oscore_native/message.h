@@ -13,17 +13,20 @@
  * through the linker, the backend needs to define the @ref
  * oscore_native_msg_types in its `oscore_native/msg_type.h` header file.
  *
- * If the implementer desires to implement oscore_msg_native functions as
- * static inline functions or even macros, it can set the
- * OSCORE_MSG_NATIVE_STATIC define and provide an equivalent definitions in an
- * `oscore_native/msg_full.h` file instead. That usage pattern is not
- * recommended; instead, link time optimization or similar should be used.
+ * Backends may additionally provide some of these functions as `static inline`
+ * definitions in their `oscore_native/msg_type.h`, which allows the compiler
+ * to fold them into the library's message handling even without link time
+ * optimization. This is done when @ref OSCORE_MSG_NATIVE_STATIC is defined;
+ * the declarations below then merely redeclare the inlined functions (which C
+ * permits after a `static` definition), and the backend leaves them out of its
+ * own translation units. Which functions are inlined is up to the backend;
+ * good candidates are the small accessors called for every option and payload
+ * access, like @ref oscore_msg_native_get_code, @ref
+ * oscore_msg_native_map_payload and @ref oscore_msg_native_optiter_next.
  *
  * @{
  */
 
-#ifndef OSCORE_MSG_NATIVE_STATIC
-
 #include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
@@ -194,15 +197,27 @@ oscore_msgerr_native_t oscore_msg_native_trim_payload(
         size_t payload_len
         );
 
+/** @brief Indicate how much of the payload holds data
+ *
+ * @param[inout] msg Message whose payload is being written
+ * @param[in] used_len Number of bytes at the start of the payload (as obtained
+ *     from @ref oscore_msg_native_map_payload) that hold data
+ *
+ * The library calls this before it appends an option to a message whose
+ * payload it has only written partially. Backends that move the payload when
+ * an option is appended can then move only the bytes in use rather than the
+ * whole payload area; others can ignore it.
+ *
+ * The indication holds until the payload is mapped again.
+ */
+void oscore_msg_native_set_payload_used(
+        oscore_msg_native_t msg,
+        size_t used_len
+        );
+
 /** Return true if an error type indicates an unsuccessful operation */
 bool oscore_msgerr_native_is_error(oscore_msgerr_native_t);
 
-#else
-
-#include <oscore_native/msg_full.h>
-
-#endif
-
 /** @} */
 
 #endif
@@ -0,0 +1,63 @@
+#ifndef OSCORE_SRC_INTERNAL_H
+#define OSCORE_SRC_INTERNAL_H
+
+/** @file
+ *
+ * @brief Functions shared between the library's source files
+ *
+ * These are not part of the API. The files that define them include this
+ * too, so that their signatures are checked against these declarations.
+ */
+
+#include <oscore/protection.h>
+#include <oscore/message.h>
+
+/** Maximum length of an OSCORE option value */
+#define OSCOREOPTION_MAXLEN (1 + PIV_BYTES + 1 + OSCORE_KEYIDCONTEXT_MAXLEN + OSCORE_KEYID_MAXLEN)
+
+// Implemented in protection.c
+
+size_t cbor_intsize(size_t input);
+size_t cbor_intencode(size_t input, uint8_t buf[5], uint8_t type);
+size_t cbor_signedintsize(int32_t input);
+size_t cbor_signedintencode(int32_t input, uint8_t buf[5]);
+
+bool extract_requestid(const oscore_oscoreoption_t *option, oscore_requestid_t *request);
+
+bool decrypt_inplace(
+        uint8_t *ciphertext,
+        size_t ciphertext_length,
+        const oscore_requestid_t *partial_iv,
+        enum oscore_context_role piv_kid,
+        oscore_requestid_t *request_id,
+        enum oscore_context_role request_kid,
+        oscore_context_t *secctx,
+        oscore_msg_native_t class_i_source
+        );
+
+bool encrypt_inplace(
+        uint8_t *ciphertext,
+        size_t ciphertext_length,
+        const oscore_requestid_t *partial_iv,
+        enum oscore_context_role nonceprovider_role,
+        oscore_requestid_t *request_id,
+        enum oscore_context_role requester_role,
+        const oscore_context_t *secctx,
+        const struct oscore_aadcache *aadcache,
+        oscore_msg_native_t class_i_source
+        );
+
+// Implemented in oscore_message.c
+
+size_t build_oscoreoption(
+        uint8_t *optionbuffer,
+        const oscore_context_t *secctx,
+        bool is_request,
+        const oscore_requestid_t *piv_source
+        );
+
+#if OSCORE_MSG_PROTECTED_INDEX_SIZE > 0
+void oscore_msg_protected_index_build(oscore_msg_protected_t *msg);
+#endif
+
+#endif
@@ -1,8 +1,11 @@
 #include <assert.h>
 #include <string.h>
 #include <oscore/message.h>
+#include <oscore/coapoption.h>
 #include <oscore_native/message.h>
 
+#include "internal.h"
+
 enum option_behavior {
     /** Place this in Class E unconditionally, and refuse to decrypt messages
      * with this as an outer option
@@ -85,65 +88,25 @@ static enum option_behavior get_option_behaviour(uint16_t option_number) {
 /** Maximum option number (for use with @ref flush_autooptions_*_until) */
 #define OPTNUM_MAX 0xffff
 
-#define OPTPART_OFFSET_1BYTE 13
-#define OPTPART_OFFSET_2BYTE 269
-#define OPTPART_FLAG_1BYTE 13
-#define OPTPART_FLAG_2BYTE 14
-
-/** Length of the extended option delta or option length encoding for the given
- * @p value */
-static uint8_t _optpart_length(uint16_t value) {
-    return (value >= OPTPART_OFFSET_1BYTE) + (value >= OPTPART_OFFSET_2BYTE);
-}
-
-/** Encode an option @p delta and a @p size into a @p buffer, and return the
- * number of bytes written (which is `1 + _optpart_length(delta) +
- * _optpart_length(size)`) */
-static size_t _optparts_encode(uint8_t *buffer, uint16_t delta, uint16_t size) {
-    uint8_t deltalen = _optpart_length(delta);
-    uint8_t sizelen = _optpart_length(size);
-
-    uint8_t *startbuffer = buffer;
-    buffer ++;
-
-    switch (deltalen) {
-        case 0:
-            *startbuffer = delta << 4;
-            break;
-        case 1:
-            *startbuffer = OPTPART_FLAG_1BYTE << 4;
-            delta -= OPTPART_OFFSET_1BYTE;
-            *buffer++ = delta;
-            break;
-        case 2:
-            *startbuffer = OPTPART_FLAG_2BYTE << 4;
-            delta -= OPTPART_OFFSET_2BYTE;
-            *buffer++ = delta >> 8;
-            *buffer++ = delta;
-            break;
-    }
-    switch (sizelen) {
-        case 0:
-            *startbuffer |= size;
-            break;
-        case 1:
-            *startbuffer |= OPTPART_FLAG_1BYTE;
-            size -= OPTPART_OFFSET_1BYTE;
-            *buffer++ = size;
-            break;
-        case 2:
-            *startbuffer |= OPTPART_FLAG_2BYTE;
-            size -= OPTPART_OFFSET_2BYTE;
-            *buffer++ = size >> 8;
-            *buffer++ = size;
-            break;
-    }
-    return buffer - startbuffer;
-}
+static bool parse_option(
+        const uint8_t *option,
+        uint16_t *delta,
+        const uint8_t **value,
+        size_t *value_len
+        );
 
 /** Like @ref oscore_msg_protected_append_option, but without flushing any
  * autooptions, and going into an inner option unconditionally.
  *
+ * Options with a lower number than the last one written are inserted after
+ * the last option with a number not exceeding theirs. Their successor's delta
+ * is re-encoded in place, and everything behind it is moved once.
+ *
+ * If payload was already mapped, it is moved along (and needs to be mapped
+ * again). The payload area then shrinks by the size of the new option, losing
+ * its last bytes. After the payload has been trimmed, OPTION_SEQUENCE is
+ * returned, as the trimmed payload would be cut short.
+ *
  * This is not currently public, but may be eligible for the public API with
  * the adequate warnings about preferably using the regular append_option. */
 oscore_msgerr_protected_t oscore_msg_protected_append_option_inner(
@@ -153,15 +116,13 @@ oscore_msgerr_protected_t oscore_msg_protected_append_option_inner(
         size_t value_len
         )
 {
-        if (option_number < msg->class_e.option_number) {
+        if (msg->flags & OSCORE_MSG_PROTECTED_FLAG_TRIMMED) {
             return OPTION_SEQUENCE;
         }
-        if (msg->payload_offset != 0) {
-            // FIXME (but probably more "extend me"): Allow this case, set the
-            // payload_offset right after, and move any existing memory. (That
-            // should be optional, as this behavior is sufficient in most
-            // applications other than OSCORE-in-OSCORE).
-            return OPTION_SEQUENCE;
+
+        if (value_len > UINT16_MAX) {
+            /* can't be expressed in encoded options */
+            return OPTION_SIZE;
         }
 
         uint8_t *payload;
@@ -171,33 +132,167 @@ oscore_msgerr_protected_t oscore_msg_protected_append_option_inner(
             return NATIVE_ERROR;
         }
 
-        uint16_t delta = option_number - msg->class_e.option_number;
-        size_t total_length = value_len + 1 + \
-                              _optpart_length(delta) + \
-                              _optpart_length(value_len);
-
-        if (
-                /* can't be expressed in encoded options */
-                value_len > UINT16_MAX
-                ||
-                /* overflow occurred -- after the above, this can only happen where size_t == uint16_t */
-                total_length < value_len
-                ||
-                /* Regular 'option too long' */
-                total_length > payload_length - msg->class_e.cursor - 1
-                ) {
-            return OPTION_SIZE;
+        // Find the insertion point (as an index into the payload), the number
+        // of the option before it, and the option after it
+        size_t options_end = 1 + msg->class_e.cursor;
+        size_t insert_at = options_end;
+        uint16_t previous_number = msg->class_e.option_number;
+        // Start and length of the following option's value; the value and
+        // everything after it stays unmodified in content
+        size_t tail_start = options_end;
+        uint16_t next_number = 0;
+        size_t next_len = 0;
+        size_t next_header_old = 0;
+        size_t next_header_new = 0;
+        if (option_number < msg->class_e.option_number) {
+            insert_at = 1;
+            previous_number = 0;
+            while (true) {
+                uint16_t delta;
+                const uint8_t *next_value;
+                // Those were written by us and do not need validation
+                bool parsed = parse_option(&payload[insert_at], &delta, &next_value, &next_len);
+                assert(parsed);
+                (void)parsed;
+                if (previous_number + delta > option_number) {
+                    next_number = previous_number + delta;
+                    tail_start = next_value - payload;
+                    break;
+                }
+                previous_number += delta;
+                insert_at = next_value - payload + next_len;
+                assert(insert_at < options_end);
+            }
+            next_header_old = tail_start - insert_at;
+            next_header_new = oscore_coapoption_header_length(next_number - option_number, next_len);
+        }
+
+        uint16_t delta = option_number - previous_number;
+        size_t total_length = value_len + oscore_coapoption_header_length(delta, value_len);
+        // Can't underflow as the deltas before and after the new option
+        // together need at most as many extension bytes as the old one,
+        // plus one
+        size_t growth = total_length + next_header_new - next_header_old;
+
+        // End of the area that is moved (and limit of what can be grown into)
+        size_t area_end;
+        if (msg->payload_offset != 0) {
+            area_end = payload_length - msg->tag_length;
+            if (
+                    /* overflow occurred -- only possible where size_t == uint16_t */
+                    total_length < value_len
+                    ||
+                    /* Remaining payload area too short */
+                    growth > area_end - msg->payload_offset
+                    ) {
+                return OPTION_SIZE;
+            }
+        } else {
+            area_end = options_end;
+            if (
+                    /* overflow occurred -- only possible where size_t == uint16_t */
+                    total_length < value_len
+                    ||
+                    /* Regular 'option too long' */
+                    growth > payload_length - options_end
+                    ) {
+                return OPTION_SIZE;
+            }
         }
-        size_t opthead = _optparts_encode(&payload[1 + msg->class_e.cursor], delta, value_len);
+
+        // Anything moved beyond the area end is lost (which is only possible
+        // in the payload)
+        size_t move_end = msg->payload_offset != 0 ? area_end - growth : area_end;
+        if (move_end > tail_start) {
+            memmove(&payload[tail_start + growth], &payload[tail_start], move_end - tail_start);
+        }
+
+        size_t opthead = oscore_coapoption_encode_header(&payload[insert_at], delta, value_len);
         if (value_len) {
-            memcpy(&payload[1 + msg->class_e.cursor + opthead], value, value_len);
+            memcpy(&payload[insert_at + opthead], value, value_len);
+        }
+        if (next_header_new != 0) {
+            oscore_coapoption_encode_header(&payload[insert_at + total_length], next_number - option_number, next_len);
         }
 
-        msg->class_e.cursor += opthead + value_len;
-        msg->class_e.option_number = option_number;
+        msg->class_e.cursor += growth;
+        if (option_number > msg->class_e.option_number) {
+            msg->class_e.option_number = option_number;
+        }
+        if (msg->payload_offset != 0) {
+            msg->payload_offset += growth;
+        }
         return OK;
 }
 
+/** Encode the value of the OSCORE option of a message into @p optionbuffer,
+ * and return its length
+ *
+ * @param[out] optionbuffer Buffer of at least OSCOREOPTION_MAXLEN bytes
+ * @param[in] secctx Context the message is protected with
+ * @param[in] is_request true if the message is a request
+ * @param[in] piv_source Request ID providing the Partial IV, or NULL if none is sent
+ */
+size_t build_oscoreoption(
+        uint8_t *optionbuffer,
+        const oscore_context_t *secctx,
+        bool is_request,
+        const oscore_requestid_t *piv_source
+        )
+{
+    uint8_t n = piv_source == NULL ? 0 : piv_source->used_bytes;
+    // In multicast responses, that'd be set as well.
+    // FIXME any other situation? probably context dependent -- ask context?
+    bool k = is_request;
+
+    bool h = oscore_context_emit_kidcontext(secctx, is_request);
+
+    optionbuffer[0] = n | (k << 3) | (h << 4);
+    size_t optionlength = 1;
+    if (n != 0) {
+        memcpy(&optionbuffer[optionlength], &piv_source->bytes[PIV_BYTES - n], n);
+        optionlength += n;
+    }
+
+    if (h) {
+        const uint8_t *kidcontext;
+        size_t kidcontext_len;
+        oscore_context_get_kidcontext(secctx, &kidcontext, &kidcontext_len);
+        optionbuffer[optionlength++] = kidcontext_len;
+        memcpy(&optionbuffer[optionlength], kidcontext, kidcontext_len);
+        optionlength += kidcontext_len;
+    }
+
+    if (k) {
+        const uint8_t *kid;
+        size_t kid_length;
+        oscore_context_get_kid(secctx, OSCORE_ROLE_SENDER, &kid, &kid_length);
+        memcpy(&optionbuffer[optionlength], kid, kid_length);
+        optionlength += kid_length;
+    }
+
+    if (optionlength == 1 && optionbuffer[0] == 0) {
+        // The typical response option is encoded in zero length
+        optionlength = 0;
+    }
+
+    return optionlength;
+}
+
+/** @brief Tell the backend how much of its payload the plaintext occupies
+ *
+ * Before the inner payload is mapped, that is only the code and the inner
+ * options, so that appending an outer option does not move the rest of the
+ * payload area. Afterwards, the application may have written anywhere in it.
+ */
+OSCORE_NONNULL
+static void set_payload_used(oscore_msg_protected_t *msg)
+{
+    if (msg->payload_offset == 0 && !(msg->flags & OSCORE_MSG_PROTECTED_FLAG_TRIMMED)) {
+        oscore_msg_native_set_payload_used(msg->backend, 1 + msg->class_e.cursor);
+    }
+}
+
 /** @brief Set autogenerated outer options on a message up to and including a given number
  *
  * @param[inout] msg The message to work on
@@ -222,53 +317,18 @@ oscore_msgerr_protected_t flush_autooptions_outer_until(oscore_msg_protected_t *
 
         // Write OSCORE option
 
-        uint8_t optionbuffer[1 + PIV_BYTES + 1 + OSCORE_KEYIDCONTEXT_MAXLEN + OSCORE_KEYID_MAXLEN];
-        size_t optionlength = 0;
+        uint8_t optionbuffer[OSCOREOPTION_MAXLEN];
 
-        uint8_t n;
-        oscore_requestid_t *piv_source;
+        const oscore_requestid_t *piv_source;
         if (msg->request_id.is_first_use && !(msg->flags & OSCORE_MSG_PROTECTED_FLAG_REQUEST)) {
-            n = 0;
+            piv_source = NULL;
         } else {
             piv_source = msg->request_id.is_first_use ? &msg->request_id : &msg->partial_iv;
-            n = piv_source->used_bytes;
-        }
-        // In multicast responses, that'd be set as well.
-        // FIXME any other situation? probably context dependent -- ask context?
-        bool k = msg->flags & OSCORE_MSG_PROTECTED_FLAG_REQUEST;
-
-        bool h = oscore_context_emit_kidcontext(msg->secctx,
-                msg->flags & OSCORE_MSG_PROTECTED_FLAG_REQUEST);
-
-        optionbuffer[0] = n | (k << 3) | (h << 4);
-        optionlength = 1;
-        if (n != 0) {
-            memcpy(&optionbuffer[optionlength], &piv_source->bytes[PIV_BYTES - n], n);
-            optionlength += n;
-        }
-
-        if (h) {
-            const uint8_t *kidcontext;
-            size_t kidcontext_len;
-            oscore_context_get_kidcontext(msg->secctx, &kidcontext, &kidcontext_len);
-            optionbuffer[optionlength++] = kidcontext_len;
-            memcpy(&optionbuffer[optionlength], kidcontext, kidcontext_len);
-            optionlength += kidcontext_len;
-        }
-
-        if (k) {
-            const uint8_t *kid;
-            size_t kid_length;
-            oscore_context_get_kid(msg->secctx, OSCORE_ROLE_SENDER, &kid, &kid_length);
-            memcpy(&optionbuffer[optionlength], kid, kid_length);
-            optionlength += kid_length;
-        }
-
-        if (optionlength == 1 && optionbuffer[0] == 0) {
-            // The typical response option is encoded in zero length
-            optionlength = 0;
         }
+        size_t optionlength = build_oscoreoption(optionbuffer, msg->secctx,
+                msg->flags & OSCORE_MSG_PROTECTED_FLAG_REQUEST, piv_source);
 
+        set_payload_used(msg);
         oscore_msgerr_native_t err;
         err = oscore_msg_native_append_option(msg->backend, 9, optionbuffer, optionlength);
         if (oscore_msgerr_native_is_error(err))
@@ -330,37 +390,16 @@ static bool parse_option(
         size_t *value_len
         )
 {
-    if (*option == 0xFF) {
-        return false; // Found payload marker, nothing to do
-    }
-
-    uint16_t d = *option >> 4u;
-    uint16_t l = *option & 0x0Fu;
-    option++;
-
-    if (d == 15 || l == 15) {
-        return false; // Protocol error
-    }
-
-    if (d == 13) {
-        d += *option;
-        option += 1;
-    } else if (d == 14) {
-        d += (option[0] << 8u) + option[1] + 255;
-        option += 2;
-    }
-
-    if (l == 13) {
-        l += *option;
-        option += 1;
-    } else if (l == 14) {
-        l += (option[0] << 8u) + option[1] + 255;
-        option += 2;
+    uint32_t d, l;
+    // The option area is not delimited here; callers stop at the payload marker
+    size_t header_length = oscore_coapoption_decode_header(option, SIZE_MAX, &d, &l);
+    if (header_length == 0) {
+        return false; // Payload marker or protocol error
     }
 
     *delta = d;
     *value_len = l;
-    *value = option;
+    *value = option + header_length;
     return true;
 }
 
@@ -398,6 +437,26 @@ static void optiter_peek_inner_option(
         oscore_msg_protected_optiter_t *iter
         )
 {
+#if OSCORE_MSG_PROTECTED_INDEX_SIZE > 0
+    if (!(msg->flags & OSCORE_MSG_PROTECTED_FLAG_WRITABLE) && msg->index.usable) {
+        if (iter->inner_peeked_value == NULL) {
+            iter->inner_index_position = 0;
+        }
+        if (iter->inner_index_position == msg->index.count) {
+            // payload_offset was set when the index was built
+            iter->inner_peeked_value = NULL;
+            iter->inner_termination_reason = OK;
+            return;
+        }
+        const struct oscore_msg_protected_indexentry *entry =
+            &msg->index.entries[iter->inner_index_position++];
+        iter->inner_peeked_optionnumber = entry->option_number;
+        iter->inner_peeked_value = &msg->index.plaintext[entry->offset];
+        iter->inner_peeked_value_len = entry->length;
+        return;
+    }
+#endif
+
     uint8_t *payload;
     size_t payload_len;
     oscore_msg_native_map_payload(msg->backend, &payload, &payload_len);
@@ -495,6 +554,7 @@ oscore_msgerr_protected_t oscore_msg_protected_append_option(
             }
         }
 
+        set_payload_used(msg);
         oscore_msgerr_native_t err = oscore_msg_native_append_option(
                 msg->backend,
                 option_number,
@@ -515,6 +575,203 @@ oscore_msgerr_protected_t oscore_msg_protected_append_option(
     }
 }
 
+void oscore_msg_protected_template_init(
+        oscore_msg_protected_template_t *template,
+        uint8_t *buffer,
+        size_t buffer_size
+        )
+{
+    template->buffer = buffer;
+    template->buffer_size = buffer_size;
+    template->length = 0;
+    template->first_header_length = 0;
+    template->first_option_number = 0;
+    template->first_value_length = 0;
+    template->last_option_number = 0;
+}
+
+oscore_msgerr_protected_t oscore_msg_protected_template_add(
+        oscore_msg_protected_template_t *template,
+        uint16_t option_number,
+        const uint8_t *value,
+        size_t value_len
+        )
+{
+    enum option_behavior behavior = get_option_behaviour(option_number);
+    if (behavior != ONLY_E && behavior != ONLY_E_IGNORE_OUTER) {
+        return INVALID_ARG_ERROR;
+    }
+    if (option_number < template->last_option_number) {
+        return OPTION_SEQUENCE;
+    }
+    if (value_len > UINT16_MAX) {
+        return OPTION_SIZE;
+    }
+
+    uint16_t delta = option_number - template->last_option_number;
+    size_t header_length = oscore_coapoption_header_length(delta, value_len);
+    if (header_length + value_len > template->buffer_size - template->length) {
+        return OPTION_SIZE;
+    }
+
+    oscore_coapoption_encode_header(&template->buffer[template->length], delta, value_len);
+    if (value_len != 0) {
+        memcpy(&template->buffer[template->length + header_length], value, value_len);
+    }
+
+    if (template->length == 0) {
+        template->first_header_length = header_length;
+        template->first_option_number = option_number;
+        template->first_value_length = value_len;
+    }
+    template->length += header_length + value_len;
+    template->last_option_number = option_number;
+    return OK;
+}
+
+oscore_msgerr_protected_t oscore_msg_protected_template_capture(
+        oscore_msg_protected_template_t *template,
+        uint8_t *buffer,
+        size_t buffer_size,
+        oscore_msg_protected_t *msg
+        )
+{
+    oscore_msg_protected_template_init(template, buffer, buffer_size);
+
+    if (!(msg->flags & OSCORE_MSG_PROTECTED_FLAG_WRITABLE)) {
+        return INVALID_ARG_ERROR;
+    }
+    if (msg->class_e.cursor == 0) {
+        return OK;
+    }
+    if (msg->class_e.cursor > buffer_size) {
+        return OPTION_SIZE;
+    }
+
+    uint8_t *payload;
+    size_t payload_length;
+    oscore_msgerr_native_t err = oscore_msg_native_map_payload(msg->backend, &payload, &payload_length);
+    if (oscore_msgerr_native_is_error(err)) {
+        return NATIVE_ERROR;
+    }
+
+    // Options in a message being written start right after the code, with the
+    // first delta relative to 0 just as in a template
+    memcpy(buffer, &payload[1], msg->class_e.cursor);
+
+    uint16_t delta;
+    const uint8_t *value;
+    size_t value_len;
+    bool parsed = parse_option(buffer, &delta, &value, &value_len);
+    assert(parsed);
+    (void)parsed;
+
+    template->length = msg->class_e.cursor;
+    template->first_header_length = value - buffer;
+    template->first_option_number = delta;
+    template->first_value_length = value_len;
+    template->last_option_number = msg->class_e.option_number;
+    return OK;
+}
+
+oscore_msgerr_protected_t oscore_msg_protected_append_template(
+        oscore_msg_protected_t *msg,
+        const oscore_msg_protected_template_t *template
+        )
+{
+    if (template->length == 0) {
+        return OK;
+    }
+    if (msg->flags & OSCORE_MSG_PROTECTED_FLAG_TRIMMED) {
+        return OPTION_SEQUENCE;
+    }
+
+    oscore_msgerr_protected_t flusherr = flush_autooptions_inner_until(msg, template->first_option_number);
+    if (flusherr != OK) {
+        return flusherr;
+    }
+
+    if (template->first_option_number < msg->class_e.option_number || msg->payload_offset != 0) {
+        // Needs insertion, or moving the payload -- let the regular mechanism
+        // deal with that
+        size_t cursor = 0;
+        uint16_t option_number = 0;
+        while (cursor < template->length) {
+            uint16_t delta;
+            const uint8_t *value;
+            size_t value_len;
+            bool parsed = parse_option(&template->buffer[cursor], &delta, &value, &value_len);
+            assert(parsed);
+            (void)parsed;
+            option_number += delta;
+            oscore_msgerr_protected_t err = oscore_msg_protected_append_option_inner(msg, option_number, value, value_len);
+            if (err != OK) {
+                return err;
+            }
+            cursor = value - template->buffer + value_len;
+        }
+        return OK;
+    }
+
+    uint8_t *payload;
+    size_t payload_length;
+    oscore_msgerr_native_t err = oscore_msg_native_map_payload(msg->backend, &payload, &payload_length);
+    if (oscore_msgerr_native_is_error(err)) {
+        return NATIVE_ERROR;
+    }
+
+    // Only the first option's delta depends on the message
+    size_t rest_length = template->length - template->first_header_length;
+    uint16_t first_delta = template->first_option_number - msg->class_e.option_number;
+    uint16_t first_value_len = template->first_value_length;
+    size_t first_header_length = oscore_coapoption_header_length(first_delta, first_value_len);
+
+    size_t start = 1 + msg->class_e.cursor;
+    if (first_header_length + rest_length > payload_length - start) {
+        return OPTION_SIZE;
+    }
+
+    oscore_coapoption_encode_header(&payload[start], first_delta, first_value_len);
+    memcpy(&payload[start + first_header_length],
+            &template->buffer[template->first_header_length],
+            rest_length);
+
+    msg->class_e.cursor += first_header_length + rest_length;
+    msg->class_e.option_number = template->last_option_number;
+    return OK;
+}
+
+bool oscore_msg_protected_predict_size(
+        const oscore_context_t *secctx,
+        bool is_request,
+        const oscore_requestid_t *request_id,
+        const oscore_msg_protected_template_t *inner_options,
+        size_t payload_len,
+        struct oscore_msg_protected_size *size
+        )
+{
+    // Mirroring oscore_prepare_request and oscore_prepare_response, and the
+    // PIV selection in flush_autooptions_outer_until
+    oscore_requestid_t next;
+    const oscore_requestid_t *piv_source = NULL;
+    if (is_request || !request_id->is_first_use) {
+        if (!oscore_context_peek_seqno(secctx, &next)) {
+            return false;
+        }
+        piv_source = &next;
+    }
+
+    uint8_t optionbuffer[OSCOREOPTION_MAXLEN];
+    size->oscore_option_length = build_oscoreoption(optionbuffer, secctx, is_request, piv_source);
+
+    oscore_crypto_aeadalg_t aeadalg = oscore_context_get_aeadalg(secctx);
+    size->payload_length = 1 /* code */ +
+        (inner_options == NULL ? 0 : inner_options->length) +
+        (payload_len > 0 ? 1 + payload_len : 0) +
+        oscore_crypto_aead_get_taglength(aeadalg);
+    return true;
+}
+
 // FIXME: This will only work if the options have been put in here by the
 // library (which is typically the case for being-sent messages that are the
 // ones being updated as well). That may not even need to be changed, just
@@ -538,47 +795,160 @@ oscore_msgerr_protected_t oscore_msg_protected_update_option(
         );
         return oscore_msgerr_native_is_error(err) ? NATIVE_ERROR : OK;
     } else if (behavior == ONLY_E || behavior == ONLY_E_IGNORE_OUTER) {
-        // Actually we only need those values, consider making them into a
-        // separate struct and making optiter_peek_inner_option take a pointer
-        // to that -- but that's more a small optimization rather than a FIXME
-        oscore_msg_protected_optiter_t iter = {
-                .inner_peeked_optionnumber = 0,
-                .inner_peeked_value = NULL
-        };
-        while (true) {
-            optiter_peek_inner_option(msg, &iter);
-            if (iter.inner_peeked_value == NULL) {
-                // Requested option was not found
-                return INVALID_ARG_ERROR;
-            }
-            if (iter.inner_peeked_optionnumber != option_number) {
-                continue;
-            }
+        const uint8_t *found_value;
+        size_t found_value_len;
+        if (oscore_msg_protected_get_inner_option(msg, option_number,
+                    option_occurrence, &found_value, &found_value_len) != OK) {
+            // Requested option was not found
+            return INVALID_ARG_ERROR;
+        }
 
-            if (option_occurrence == 0) {
-                // Requested option found, now check the length
-                if (value_len != iter.inner_peeked_value_len) {
-                    return INVALID_ARG_ERROR;
-                }
-                if (value_len != 0) {
-                    memcpy((uint8_t *)iter.inner_peeked_value, value, value_len);
-                } else {
-                    // Updating a known-to-be zero-length option with new empty
-                    // values is admittedly unexpected, but the condition is
-                    // still in here to avoid UB when it does happen -- and
-                    // user-facing interfaces are documented to be tolerant of
-                    // zero-length NULL arrays.
-                }
-                return OK;
-            }
-            option_occurrence--;
+        // Requested option found, now check the length
+        if (value_len != found_value_len) {
+            return INVALID_ARG_ERROR;
         }
+        if (value_len != 0) {
+            memcpy((uint8_t *)found_value, value, value_len);
+        } else {
+            // Updating a known-to-be zero-length option with new empty
+            // values is admittedly unexpected, but the condition is
+            // still in here to avoid UB when it does happen -- and
+            // user-facing interfaces are documented to be tolerant of
+            // zero-length NULL arrays.
+        }
+        return OK;
     } else {
         // FIXME: handle special options
         return NOTIMPLEMENTED_ERROR;
     }
 }
 
+oscore_msgerr_protected_t oscore_msg_protected_get_inner_option(
+        oscore_msg_protected_t *msg,
+        uint16_t option_number,
+        size_t option_occurrence,
+        const uint8_t **value,
+        size_t *value_len
+        )
+{
+#if OSCORE_MSG_PROTECTED_INDEX_SIZE > 0
+    if (!(msg->flags & OSCORE_MSG_PROTECTED_FLAG_WRITABLE) && msg->index.usable) {
+        // Find the first entry with that number; entries are sorted by number
+        size_t low = 0;
+        size_t high = msg->index.count;
+        while (low < high) {
+            size_t mid = low + (high - low) / 2;
+            if (msg->index.entries[mid].option_number < option_number) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+
+        if (option_occurrence >= msg->index.count - low) {
+            return INVALID_ARG_ERROR;
+        }
+        const struct oscore_msg_protected_indexentry *entry =
+            &msg->index.entries[low + option_occurrence];
+        if (entry->option_number != option_number) {
+            return INVALID_ARG_ERROR;
+        }
+        *value = &msg->index.plaintext[entry->offset];
+        *value_len = entry->length;
+        return OK;
+    }
+#endif
+
+    // Actually we only need those values, consider making them into a
+    // separate struct and making optiter_peek_inner_option take a pointer
+    // to that -- but that's more a small optimization rather than a FIXME
+    oscore_msg_protected_optiter_t iter = {
+            .inner_peeked_optionnumber = 0,
+            .inner_peeked_value = NULL
+    };
+    while (true) {
+        optiter_peek_inner_option(msg, &iter);
+        if (iter.inner_peeked_value == NULL) {
+            return iter.inner_termination_reason == OK ?
+                INVALID_ARG_ERROR : iter.inner_termination_reason;
+        }
+        if (iter.inner_peeked_optionnumber != option_number) {
+            continue;
+        }
+
+        if (option_occurrence == 0) {
+            *value = iter.inner_peeked_value;
+            *value_len = iter.inner_peeked_value_len;
+            return OK;
+        }
+        option_occurrence--;
+    }
+}
+
+#if OSCORE_MSG_PROTECTED_INDEX_SIZE > 0
+/** Parse the inner options of a freshly decrypted message into its index
+ *
+ * This is not public, but called by the unprotect functions in protection.c
+ * after successful decryption. If the options don't fit or can not be parsed,
+ * the index is marked unusable, and any errors surface when the options are
+ * iterated over. */
+void oscore_msg_protected_index_build(oscore_msg_protected_t *msg)
+{
+    struct oscore_msg_protected_index *index = &msg->index;
+    index->usable = false;
+    index->count = 0;
+
+    uint8_t *payload;
+    size_t payload_len;
+    oscore_msg_native_map_payload(msg->backend, &payload, &payload_len);
+    payload_len -= msg->tag_length;
+    if (payload_len > UINT16_MAX) {
+        // Offsets would not fit
+        return;
+    }
+
+    size_t payload_start;
+    size_t cursor = 1;
+    uint16_t option_number = 0;
+    while (true) {
+        if (cursor == payload_len) {
+            payload_start = payload_len;
+            break;
+        }
+
+        uint16_t delta;
+        const uint8_t *value;
+        size_t value_len;
+        if (!parse_option(&payload[cursor], &delta, &value, &value_len)) {
+            if (payload[cursor] != 0xff) {
+                return;
+            }
+            payload_start = cursor + 1;
+            break;
+        }
+
+        size_t offset = value - payload;
+        if (offset > payload_len || value_len > payload_len - offset ||
+                delta > UINT16_MAX - option_number ||
+                index->count == OSCORE_MSG_PROTECTED_INDEX_SIZE) {
+            return;
+        }
+        option_number += delta;
+
+        index->entries[index->count++] = (struct oscore_msg_protected_indexentry) {
+            .option_number = option_number,
+            .offset = offset,
+            .length = value_len,
+        };
+        cursor = offset + value_len;
+    }
+
+    index->plaintext = payload;
+    index->usable = true;
+    optiter_maybe_set_payload_length(msg, payload_start);
+}
+#endif
+
 void oscore_msg_protected_optiter_init(
         oscore_msg_protected_t *msg,
         oscore_msg_protected_optiter_t *iter
@@ -857,8 +1227,39 @@ oscore_msgerr_protected_t oscore_msg_protected_trim_payload(
             payload_len +
             // tag
             msg->tag_length);
+    if (oscore_msgerr_native_is_error(err)) {
+        return NATIVE_ERROR;
+    }
+
+    msg->flags |= OSCORE_MSG_PROTECTED_FLAG_TRIMMED;
+    return OK;
+}
+
+oscore_msgerr_protected_t oscore_msg_protected_write_payload(
+        oscore_msg_protected_t *msg,
+        const oscore_msg_protected_payloadpart_t *parts,
+        size_t parts_count
+        )
+{
+    uint8_t *payload;
+    size_t payload_len;
+    oscore_msgerr_protected_t err = oscore_msg_protected_map_payload(msg, &payload, &payload_len);
+    if (err != OK) {
+        return err;
+    }
+
+    size_t written = 0;
+    for (size_t i = 0; i < parts_count; ++i) {
+        if (parts[i].len > payload_len - written) {
+            return MESSAGESIZE;
+        }
+        if (parts[i].len != 0) {
+            memcpy(&payload[written], parts[i].data, parts[i].len);
+        }
+        written += parts[i].len;
+    }
 
-    return oscore_msgerr_native_is_error(err) ? NATIVE_ERROR : OK;
+    return oscore_msg_protected_trim_payload(msg, written);
 }
 
 bool oscore_msgerr_protected_is_error(oscore_msgerr_protected_t error)
@@ -0,0 +1,220 @@
+#include <string.h>
+#include <oscore/plaincache.h>
+
+/** Return true if an entry is in use and has not expired at @p now */
+static bool is_fresh(const struct oscore_plaincache_entry *entry, uint32_t now)
+{
+    // Comparison that survives the clock wrapping around
+    return entry->used && (int32_t)(entry->expires - now) > 0;
+}
+
+/** Return true if two keys have the same scope and options */
+static bool key_equal(const struct oscore_plaincache_key *a, const struct oscore_plaincache_key *b)
+{
+    return a->scope == b->scope &&
+        a->length == b->length &&
+        memcmp(a->data, b->data, a->length) == 0;
+}
+
+void oscore_plaincache_init(
+        struct oscore_plaincache *cache,
+        struct oscore_plaincache_entry *entries,
+        size_t entries_count
+        )
+{
+    cache->entries = entries;
+    cache->entries_count = entries_count;
+    cache->next = 0;
+    for (size_t i = 0; i < entries_count; ++i) {
+        entries[i].used = false;
+    }
+}
+
+void oscore_plaincache_key_init(struct oscore_plaincache_key *key, const void *scope)
+{
+    key->scope = scope;
+    key->length = 0;
+}
+
+bool oscore_plaincache_key_add(
+        struct oscore_plaincache_key *key,
+        uint16_t option_number,
+        const uint8_t *value,
+        size_t value_len
+        )
+{
+    if (option_number > UINT8_MAX || value_len > UINT8_MAX ||
+            2 + value_len > OSCORE_PLAINCACHE_KEY_MAXLEN - key->length) {
+        return false;
+    }
+    key->data[key->length++] = option_number;
+    key->data[key->length++] = value_len;
+    if (value_len != 0) {
+        memcpy(&key->data[key->length], value, value_len);
+    }
+    key->length += value_len;
+    return true;
+}
+
+bool oscore_plaincache_key_from_request(
+        struct oscore_plaincache_key *key,
+        oscore_msg_protected_t *request,
+        const void *scope
+        )
+{
+    oscore_plaincache_key_init(key, scope);
+
+    if (oscore_msg_protected_get_code(request) != 1 /* GET */) {
+        return false;
+    }
+
+    // Observation requests need the handler to register them; the others
+    // select a part or variant of the representation that the key does not
+    // capture. (If the options can't be read, neither can the key options.)
+    static const uint16_t uncacheable_options[] = {
+        4 /* ETag */,
+        6 /* Observe */,
+        23 /* Block2 */,
+        27 /* Block1 */,
+        28 /* Size2 */,
+    };
+    const uint8_t *value;
+    size_t value_len;
+    for (size_t i = 0; i < sizeof(uncacheable_options) / sizeof(uncacheable_options[0]); ++i) {
+        if (oscore_msg_protected_get_inner_option(request, uncacheable_options[i], 0, &value, &value_len) != INVALID_ARG_ERROR) {
+            return false;
+        }
+    }
+
+    static const uint16_t key_options[] = {11 /* Uri-Path */, 15 /* Uri-Query */, 17 /* Accept */};
+    for (size_t i = 0; i < sizeof(key_options) / sizeof(key_options[0]); ++i) {
+        for (size_t occurrence = 0; ; ++occurrence) {
+            oscore_msgerr_protected_t err = oscore_msg_protected_get_inner_option(request, key_options[i], occurrence, &value, &value_len);
+            if (err == INVALID_ARG_ERROR) {
+                break;
+            }
+            if (err != OK || !oscore_plaincache_key_add(key, key_options[i], value, value_len)) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+const struct oscore_plaincache_entry *oscore_plaincache_find(
+        struct oscore_plaincache *cache,
+        const struct oscore_plaincache_key *key,
+        uint32_t now
+        )
+{
+    for (size_t i = 0; i < cache->entries_count; ++i) {
+        struct oscore_plaincache_entry *entry = &cache->entries[i];
+        if (!entry->used || !key_equal(&entry->key, key)) {
+            continue;
+        }
+        if (!is_fresh(entry, now)) {
+            entry->used = false;
+            return NULL;
+        }
+        return entry;
+    }
+    return NULL;
+}
+
+oscore_msgerr_protected_t oscore_plaincache_write(
+        const struct oscore_plaincache_entry *entry,
+        oscore_msg_protected_t *response,
+        uint32_t now
+        )
+{
+    oscore_msg_protected_set_code(response, entry->code);
+
+    oscore_msgerr_protected_t err = oscore_msg_protected_append_template(response, &entry->options);
+    if (err != OK) {
+        return err;
+    }
+
+    uint32_t remaining = entry->expires - now;
+    uint8_t max_age[4];
+    size_t max_age_len = remaining > 0xffffff ? 4 : remaining > 0xffff ? 3 : remaining > 0xff ? 2 : remaining > 0 ? 1 : 0;
+    for (size_t i = 0; i < max_age_len; ++i) {
+        max_age[i] = remaining >> (8 * (max_age_len - 1 - i));
+    }
+    // Inserted in sequence even if the cached options go beyond it
+    err = oscore_msg_protected_append_option(response, 14 /* Max-Age */, max_age, max_age_len);
+    if (err != OK) {
+        return err;
+    }
+
+    const oscore_msg_protected_payloadpart_t payload = {
+        &entry->data[entry->options.length],
+        entry->payload_length,
+    };
+    return oscore_msg_protected_write_payload(response, &payload, 1);
+}
+
+bool oscore_plaincache_store(
+        struct oscore_plaincache *cache,
+        const struct oscore_plaincache_key *key,
+        oscore_msg_protected_t *response,
+        uint32_t max_age,
+        uint32_t now
+        )
+{
+    if (cache->entries_count == 0 || max_age == 0) {
+        return false;
+    }
+
+    // Same key, or else a free or expired slot, or else the next in turn
+    struct oscore_plaincache_entry *entry = NULL;
+    for (size_t i = 0; i < cache->entries_count; ++i) {
+        struct oscore_plaincache_entry *candidate = &cache->entries[i];
+        if (candidate->used && key_equal(&candidate->key, key)) {
+            entry = candidate;
+            break;
+        }
+        if (entry == NULL && !is_fresh(candidate, now)) {
+            entry = candidate;
+        }
+    }
+    if (entry == NULL) {
+        entry = &cache->entries[cache->next];
+        cache->next = (cache->next + 1) % cache->entries_count;
+    }
+    entry->used = false;
+
+    oscore_msgerr_protected_t err = oscore_msg_protected_template_capture(&entry->options, entry->data, OSCORE_PLAINCACHE_MAXLEN, response);
+    if (err != OK) {
+        return false;
+    }
+
+    uint8_t *payload;
+    size_t payload_len;
+    err = oscore_msg_protected_map_payload(response, &payload, &payload_len);
+    if (err != OK || payload_len > OSCORE_PLAINCACHE_MAXLEN - entry->options.length) {
+        return false;
+    }
+    memcpy(&entry->data[entry->options.length], payload, payload_len);
+    entry->payload_length = payload_len;
+
+    entry->code = oscore_msg_protected_get_code(response);
+    entry->key = *key;
+    entry->expires = now + max_age;
+    entry->used = true;
+    return true;
+}
+
+void oscore_plaincache_invalidate(
+        struct oscore_plaincache *cache,
+        const struct oscore_plaincache_key *prefix
+        )
+{
+    for (size_t i = 0; i < cache->entries_count; ++i) {
+        struct oscore_plaincache_entry *entry = &cache->entries[i];
+        if (entry->key.length >= prefix->length &&
+                memcmp(entry->key.data, prefix->data, prefix->length) == 0) {
+            entry->used = false;
+        }
+    }
+}
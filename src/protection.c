@@ -5,6 +5,8 @@
 
 #include <oscore_native/crypto.h>
 
+#include "internal.h"
+
 /** Take the Partial IV from the OSCORE option and populate @ref
  * oscore_requestid_t from it (with is_first_use=false). Return true if
  * successful, or false if there was no PartIV in the option.
@@ -90,6 +92,22 @@ size_t cbor_signedintencode(int32_t input, uint8_t buf[5]) {
     return cbor_intencode(input < 0 ? -1 - input : input, buf, input < 0 ? 0x20 : 0x00);
 }
 
+#ifdef OSCORE_FIXED_AEADALG
+#if OSCORE_FIXED_AEADALG < 0 || OSCORE_FIXED_AEADALG > 255
+#error "OSCORE_FIXED_AEADALG is only supported for algorithm numbers 0 to 255"
+#endif
+/** Start of the external AAD, which is constant when only a single algorithm
+ * is built in: array length 5, OSCORE version 1, array of one element, and
+ * the algorithm as a CBOR integer */
+static const uint8_t fixed_external_aad_start[] = {
+    0x85, 0x01, 0x81,
+#if OSCORE_FIXED_AEADALG > 23
+    0x18,
+#endif
+    OSCORE_FIXED_AEADALG,
+};
+#endif
+
 struct aad_sizes {
     size_t class_i_length;
     size_t external_aad_length;
@@ -109,7 +127,7 @@ struct aad_sizes {
 struct aad_sizes predict_aad_size(
         const oscore_context_t *secctx,
         enum oscore_context_role requester_role,
-        oscore_requestid_t *request,
+        const oscore_requestid_t *request,
         oscore_crypto_aeadalg_t aeadalg,
         oscore_msg_native_t class_i_source
         )
@@ -124,17 +142,24 @@ struct aad_sizes predict_aad_size(
     ret.class_i_length = 0;
     (void) class_i_source;
 
+#ifdef OSCORE_FIXED_AEADALG
+    (void)aeadalg;
+    size_t start_length = sizeof(fixed_external_aad_start);
+#else
     int32_t numeric_identifier = 0;
     // error handling to follow when there are string-based algorithms
     // to test this with; until then, the estimate is infallible and errs when
     // feeding.
     oscore_crypto_aead_get_number(aeadalg, &numeric_identifier);
-
-    ret.external_aad_length = \
+    size_t start_length = \
             1 /* array length 5 */ +
             1 /* oscore version 1 */ +
             1 /* 1-long array of of */ +
-                cbor_signedintsize(numeric_identifier) /* FIXME strings? */ +
+                cbor_signedintsize(numeric_identifier) /* FIXME strings? */;
+#endif
+
+    ret.external_aad_length = \
+            start_length +
             cbor_intsize(request_kid_len) + request_kid_len + /* request_kid */
             cbor_intsize(request->used_bytes) + request->used_bytes + /* request_piv */
             cbor_intsize(ret.class_i_length) + ret.class_i_length;
@@ -147,74 +172,120 @@ struct aad_sizes predict_aad_size(
     return ret;
 }
 
-/** Push the AAD for a given message into the en-/decryption state.
+/** Build the AAD for a given message into a buffer.
  *
- * @param[inout] feeder Function with a signature of @ref oscore_crypto_aead_encrypt_feed_aad and @ref oscore_crypto_aead_decrypt_feed_aaj
- * @param[inout] state AEAD en-/decryption state
+ * @param[out] aad Buffer to write the AAD into
+ * @param[out] aad_length Number of bytes written into @p aad
  * @param[in] aad_sizes Predetermined sizes of the various AAD components
  * @param[in] secctx Security context from which to pick the sender role KID
  * @param[in] requester_role Role in @p secctx that created the request
  * @param[in] request The @ref oscore_requestid_t describing the request_piv
  * @param[in] class_i_source The outer message containing all class I options to be considered for this message
  *
+ * @return true on success, false if the algorithm has no number or the AAD
+ * would exceed @ref OSCORE_AADCACHE_MAXLEN (in which case @p aad_length is 0)
  */
-oscore_cryptoerr_t feed_aad(
-        oscore_cryptoerr_t (*feeder)(void *, const uint8_t *, size_t),
-        void *state,
+bool build_aad(
+        uint8_t aad[OSCORE_AADCACHE_MAXLEN],
+        size_t *aad_length,
         struct aad_sizes aad_sizes,
         const oscore_context_t *secctx,
         enum oscore_context_role requester_role,
-        oscore_requestid_t *request,
+        const oscore_requestid_t *request,
         oscore_crypto_aeadalg_t aeadalg,
         oscore_msg_native_t class_i_source
         )
 {
-    oscore_cryptoerr_t err;
-    uint8_t intbuf[5];
+    *aad_length = 0;
+    if (aad_sizes.aad_length > OSCORE_AADCACHE_MAXLEN) {
+        return false;
+    }
+
+    size_t cursor = 0;
 
     // array length 3, "Encrypt0", h''
-    err = feeder(state, (uint8_t*) "\x83\x68" "Encrypt0" "\x40", 11);
-    if (oscore_cryptoerr_is_error(err)) { return err; }
+    memcpy(&aad[cursor], "\x83\x68" "Encrypt0" "\x40", 11);
+    cursor += 11;
 
     // full external AAD length
-    err = feeder(state, intbuf, cbor_intencode(aad_sizes.external_aad_length, intbuf, 0x40));
-    if (oscore_cryptoerr_is_error(err)) { return err; }
+    cursor += cbor_intencode(aad_sizes.external_aad_length, &aad[cursor], 0x40);
+
+    // Used algorithm; with a fixed algorithm, this is only called for
+    // obtaining a success value, and reduces to a constant
+    int32_t numeric_identifier = 0;
+    oscore_cryptoerr_t err = oscore_crypto_aead_get_number(aeadalg, &numeric_identifier);
+    if (oscore_cryptoerr_is_error(err)) { return false; }
 
+#ifdef OSCORE_FIXED_AEADALG
+    assert(numeric_identifier == OSCORE_FIXED_AEADALG);
+    memcpy(&aad[cursor], fixed_external_aad_start, sizeof(fixed_external_aad_start));
+    cursor += sizeof(fixed_external_aad_start);
+#else
     // external AAD array start, constant OSCORE version 1, array of one element
-    err = feeder(state, (uint8_t*) "\x85\x01\x81", 3);
-    if (oscore_cryptoerr_is_error(err)) { return err; }
+    memcpy(&aad[cursor], "\x85\x01\x81", 3);
+    cursor += 3;
 
-    // Used algorithm
-    int32_t numeric_identifier = 0;
-    err = oscore_crypto_aead_get_number(aeadalg, &numeric_identifier);
-    if (oscore_cryptoerr_is_error(err)) { return err; }
-    err = feeder(state, intbuf, cbor_signedintencode(numeric_identifier, intbuf));
-    if (oscore_cryptoerr_is_error(err)) { return err; }
+    cursor += cbor_signedintencode(numeric_identifier, &aad[cursor]);
+#endif
 
     // Request KID
     const uint8_t *request_kid;
     size_t request_kid_len;
     oscore_context_get_kid(secctx, requester_role, &request_kid, &request_kid_len);
 
-    err = feeder(state, intbuf, cbor_intencode(request_kid_len, intbuf, 0x40));
-    if (oscore_cryptoerr_is_error(err)) { return err; }
-    err = feeder(state, request_kid, request_kid_len);
-    if (oscore_cryptoerr_is_error(err)) { return err; }
+    cursor += cbor_intencode(request_kid_len, &aad[cursor], 0x40);
+    memcpy(&aad[cursor], request_kid, request_kid_len);
+    cursor += request_kid_len;
 
     // Request PIV
-    err = feeder(state, intbuf, cbor_intencode(request->used_bytes, intbuf, 0x40));
-    if (oscore_cryptoerr_is_error(err)) { return err; }
-    err = feeder(state, &request->bytes[PIV_BYTES - request->used_bytes], request->used_bytes);
-    if (oscore_cryptoerr_is_error(err)) { return err; }
+    cursor += cbor_intencode(request->used_bytes, &aad[cursor], 0x40);
+    memcpy(&aad[cursor], &request->bytes[PIV_BYTES - request->used_bytes], request->used_bytes);
+    cursor += request->used_bytes;
 
     // Class I options
     assert(aad_sizes.class_i_length == 0);
     // As long as that holds, the Class I source can be disregarded.
     (void) class_i_source;
     // 0 byte string
-    err = feeder(state, (uint8_t*) "\x40", 1);
+    aad[cursor++] = 0x40;
+
+    assert(cursor == aad_sizes.aad_length);
+    *aad_length = cursor;
+    return true;
+}
+
+/** Push the AAD for a given message into the en-/decryption state.
+ *
+ * @param[inout] feeder Function with a signature of @ref oscore_crypto_aead_encrypt_feed_aad and @ref oscore_crypto_aead_decrypt_feed_aaj
+ * @param[inout] state AEAD en-/decryption state
+ * @param[in] aad_sizes Predetermined sizes of the various AAD components
+ * @param[in] secctx Security context from which to pick the sender role KID
+ * @param[in] requester_role Role in @p secctx that created the request
+ * @param[in] request The @ref oscore_requestid_t describing the request_piv
+ * @param[in] class_i_source The outer message containing all class I options to be considered for this message
+ *
+ * The AAD is assembled in a stack buffer and fed in a single call.
+ *
+ * @return true if the AAD could be built and was accepted by @p feeder
+ */
+bool feed_aad(
+        oscore_cryptoerr_t (*feeder)(void *, const uint8_t *, size_t),
+        void *state,
+        struct aad_sizes aad_sizes,
+        const oscore_context_t *secctx,
+        enum oscore_context_role requester_role,
+        oscore_requestid_t *request,
+        oscore_crypto_aeadalg_t aeadalg,
+        oscore_msg_native_t class_i_source
+        )
+{
+    uint8_t aad[OSCORE_AADCACHE_MAXLEN];
+    size_t aad_length;
+    if (!build_aad(aad, &aad_length, aad_sizes, secctx, requester_role, request, aeadalg, class_i_source)) {
+        return false;
+    }
 
-    return err;
+    return !oscore_cryptoerr_is_error(feeder(state, aad, aad_length));
 }
 
 
@@ -321,36 +392,39 @@ void oscore_requestid_clone(oscore_requestid_t *dest, oscore_requestid_t *src)
     dest->is_first_use = false;
 }
 
-/** Do all the decryption preparation common to @ref oscore_prepare_response
- * and @ref oscore_prepare_request
+/** Decrypt and verify a ciphertext in place
+ *
+ * @param[inout] ciphertext Ciphertext including the tag
+ * @param[in] ciphertext_length Length of @p ciphertext; at least one byte more
+ *     than the tag length
+ * @param[in] partial_iv Partial IV to build the nonce from
+ * @param[in] piv_kid Role in @p secctx whose ID goes into the nonce
+ * @param[in] request_id Request ID that goes into the AAD
+ * @param[in] request_kid Role in @p secctx whose ID goes into the AAD
+ * @param[in] secctx Security context to decrypt with
+ * @param[in] class_i_source The outer message containing all class I options to be considered for this message
  *
  * This returns true if decryption was successful.
  */
-bool _decrypt(
-        oscore_msg_native_t protected,
-        oscore_msg_protected_t *unprotected,
-        oscore_context_t *secctx,
+bool decrypt_inplace(
+        uint8_t *ciphertext,
+        size_t ciphertext_length,
+        const oscore_requestid_t *partial_iv,
         enum oscore_context_role piv_kid,
-        enum oscore_context_role request_kid
+        oscore_requestid_t *request_id,
+        enum oscore_context_role request_kid,
+        oscore_context_t *secctx,
+        oscore_msg_native_t class_i_source
         )
 {
     oscore_crypto_aeadalg_t aeadalg = oscore_context_get_aeadalg(secctx);
     size_t tag_length = oscore_crypto_aead_get_taglength(aeadalg);
-    size_t minimum_ciphertext_length = 1 + tag_length;
-
-    uint8_t *ciphertext;
-    size_t ciphertext_length;
-    oscore_msg_native_map_payload(protected, &ciphertext, &ciphertext_length);
-    if (ciphertext_length < minimum_ciphertext_length) {
-        // Ciphertext too short
-        return false;
-    }
-    size_t plaintext_length = ciphertext_length - tag_length; // >= 1
+    size_t plaintext_length = ciphertext_length - tag_length;
 
-    struct aad_sizes aad_sizes = predict_aad_size(secctx, request_kid, &unprotected->request_id, aeadalg, protected);
+    struct aad_sizes aad_sizes = predict_aad_size(secctx, request_kid, request_id, aeadalg, class_i_source);
 
     uint8_t iv[OSCORE_CRYPTO_AEAD_IV_MAXLEN];
-    build_iv(iv, &unprotected->partial_iv, secctx, piv_kid);
+    build_iv(iv, partial_iv, secctx, piv_kid);
 
     oscore_cryptoerr_t err;
     oscore_crypto_aead_decryptstate_t dec;
@@ -362,17 +436,48 @@ bool _decrypt(
             iv,
             oscore_context_get_key(secctx, OSCORE_ROLE_RECIPIENT)
             );
-    if (!oscore_cryptoerr_is_error(err)) {
-        err = feed_aad(oscore_crypto_aead_decrypt_feed_aad, &dec, aad_sizes, secctx, request_kid, &unprotected->request_id, aeadalg, protected);
+    if (oscore_cryptoerr_is_error(err) ||
+            !feed_aad(oscore_crypto_aead_decrypt_feed_aad, &dec, aad_sizes, secctx, request_kid, request_id, aeadalg, class_i_source)) {
+        return false;
     }
-    if (!oscore_cryptoerr_is_error(err)) {
-        err = oscore_crypto_aead_decrypt_inplace(
-                &dec,
-                ciphertext,
-                ciphertext_length);
+    err = oscore_crypto_aead_decrypt_inplace(
+            &dec,
+            ciphertext,
+            ciphertext_length);
+
+    return !oscore_cryptoerr_is_error(err);
+}
+
+/** Do all the decryption preparation common to @ref oscore_prepare_response
+ * and @ref oscore_prepare_request
+ *
+ * This returns true if decryption was successful.
+ */
+bool _decrypt(
+        oscore_msg_native_t protected,
+        oscore_msg_protected_t *unprotected,
+        oscore_context_t *secctx,
+        enum oscore_context_role piv_kid,
+        enum oscore_context_role request_kid
+        )
+{
+    oscore_crypto_aeadalg_t aeadalg = oscore_context_get_aeadalg(secctx);
+    size_t tag_length = oscore_crypto_aead_get_taglength(aeadalg);
+    size_t minimum_ciphertext_length = 1 + tag_length;
+
+    uint8_t *ciphertext;
+    size_t ciphertext_length;
+    oscore_msg_native_map_payload(protected, &ciphertext, &ciphertext_length);
+    if (ciphertext_length < minimum_ciphertext_length) {
+        // Ciphertext too short
+        return false;
     }
 
-    if (oscore_cryptoerr_is_error(err)) {
+    bool success = decrypt_inplace(ciphertext, ciphertext_length,
+            &unprotected->partial_iv, piv_kid,
+            &unprotected->request_id, request_kid,
+            secctx, protected);
+    if (!success) {
         return false;
     }
 
@@ -382,6 +487,11 @@ bool _decrypt(
     unprotected->tag_length = tag_length;
     unprotected->payload_offset = 0;
 
+#if OSCORE_MSG_PROTECTED_INDEX_SIZE > 0
+    // Index the options while the plaintext is still fresh in the cache
+    oscore_msg_protected_index_build(unprotected);
+#endif
+
     return true;
 }
 
@@ -507,6 +617,7 @@ enum oscore_prepare_result _prepare_encrypt(
     unprotected->secctx = secctx;
     unprotected->class_e.cursor = 0;
     unprotected->class_e.option_number = 0;
+    unprotected->aadcache = NULL;
 
     return OSCORE_PREPARE_OK;
 }
@@ -572,13 +683,122 @@ enum oscore_prepare_result oscore_prepare_request(
     return result;
 }
 
+bool oscore_aadcache_init(
+        struct oscore_aadcache *cache,
+        const oscore_context_t *secctx,
+        const oscore_requestid_t *request_id
+        )
+{
+    oscore_crypto_aeadalg_t aeadalg = oscore_context_get_aeadalg(secctx);
+    // There is no message yet; that's fine as long as no Class I options are
+    // supported.
+    oscore_msg_native_t class_i_source = {0};
+    // Responses only: the request was created by the recipient
+    struct aad_sizes aad_sizes = predict_aad_size(secctx, OSCORE_ROLE_RECIPIENT, request_id, aeadalg, class_i_source);
+
+    size_t length;
+    if (!build_aad(cache->aad, &length, aad_sizes, secctx, OSCORE_ROLE_RECIPIENT, request_id, aeadalg, class_i_source)) {
+        return false;
+    }
+    cache->length = length;
+    return true;
+}
+
+void oscore_msg_protected_set_aadcache(
+        oscore_msg_protected_t *unprotected,
+        const struct oscore_aadcache *cache
+        )
+{
+    assert(!(unprotected->flags & OSCORE_MSG_PROTECTED_FLAG_REQUEST));
+    unprotected->aadcache = cache;
+}
+
+/** Encrypt a plaintext in place, appending the tag
+ *
+ * @param[inout] ciphertext Plaintext followed by room for the tag
+ * @param[in] ciphertext_length Length of the plaintext plus the tag length
+ * @param[in] partial_iv Partial IV to build the nonce from
+ * @param[in] nonceprovider_role Role in @p secctx whose ID goes into the nonce
+ * @param[in] request_id Request ID that goes into the AAD
+ * @param[in] requester_role Role in @p secctx whose ID goes into the AAD
+ * @param[in] secctx Security context to encrypt with
+ * @param[in] aadcache Precomputed AAD, or NULL to build it from the above
+ * @param[in] class_i_source The outer message containing all class I options to be considered for this message
+ *
+ * This returns true if encryption was successful.
+ */
+bool encrypt_inplace(
+        uint8_t *ciphertext,
+        size_t ciphertext_length,
+        const oscore_requestid_t *partial_iv,
+        enum oscore_context_role nonceprovider_role,
+        oscore_requestid_t *request_id,
+        enum oscore_context_role requester_role,
+        const oscore_context_t *secctx,
+        const struct oscore_aadcache *aadcache,
+        oscore_msg_native_t class_i_source
+        )
+{
+    oscore_crypto_aeadalg_t aeadalg = oscore_context_get_aeadalg(secctx);
+    size_t plaintext_length = ciphertext_length - oscore_crypto_aead_get_taglength(aeadalg);
+
+    // FIXME optimize this to happen while the message is being built
+    struct aad_sizes aad_sizes;
+    if (aadcache != NULL) {
+        aad_sizes.aad_length = aadcache->length;
+    } else {
+        aad_sizes = predict_aad_size(secctx, requester_role, request_id, aeadalg, class_i_source);
+    }
+
+    uint8_t encrypt_iv[OSCORE_CRYPTO_AEAD_IV_MAXLEN];
+    build_iv(encrypt_iv, partial_iv, secctx, nonceprovider_role);
+
+    oscore_crypto_aead_encryptstate_t enc;
+    oscore_cryptoerr_t err = oscore_crypto_aead_encrypt_start(
+            &enc,
+            aeadalg,
+            aad_sizes.aad_length,
+            plaintext_length,
+            encrypt_iv,
+            oscore_context_get_key(secctx, OSCORE_ROLE_SENDER)
+            );
+
+    if (!oscore_cryptoerr_is_error(err)) {
+        if (aadcache != NULL) {
+            err = oscore_crypto_aead_encrypt_feed_aad(
+                    &enc,
+                    aadcache->aad,
+                    aadcache->length
+                    );
+        } else if (!feed_aad(
+                    oscore_crypto_aead_encrypt_feed_aad,
+                    &enc,
+                    aad_sizes,
+                    secctx,
+                    requester_role,
+                    request_id,
+                    aeadalg,
+                    class_i_source
+                    )) {
+            return false;
+        }
+    }
+    if (!oscore_cryptoerr_is_error(err)) {
+        err = oscore_crypto_aead_encrypt_inplace(
+                &enc,
+                ciphertext,
+                ciphertext_length);
+    }
+
+    return !oscore_cryptoerr_is_error(err);
+}
+
 enum oscore_finish_result oscore_encrypt_message(
         oscore_msg_protected_t *unprotected,
         oscore_msg_native_t *protected
         )
 {
     const oscore_context_t *secctx = unprotected->secctx;
-    oscore_crypto_aeadalg_t aeadalg = oscore_context_get_aeadalg(secctx);
     size_t tag_length = unprotected->tag_length;
 
     bool is_request = (unprotected->flags & OSCORE_MSG_PROTECTED_FLAG_REQUEST);
@@ -608,46 +828,11 @@ enum oscore_finish_result oscore_encrypt_message(
         // Ciphertext too short
         return OSCORE_FINISH_ERROR_SIZE;
     }
-    size_t plaintext_length = ciphertext_length - tag_length; // >= 1
 
-    // FIXME optimize this to happen while the message is being built
-    struct aad_sizes aad_sizes = predict_aad_size(secctx, requester_role, &unprotected->request_id, aeadalg, unprotected->backend);
-
-    uint8_t encrypt_iv[OSCORE_CRYPTO_AEAD_IV_MAXLEN];
-    build_iv(encrypt_iv, &unprotected->partial_iv, secctx, nonceprovider_role);
-
-    oscore_crypto_aead_encryptstate_t enc;
-    oscore_cryptoerr_t err = oscore_crypto_aead_encrypt_start(
-            &enc,
-            oscore_context_get_aeadalg(secctx),
-            aad_sizes.aad_length,
-            plaintext_length,
-            encrypt_iv,
-            oscore_context_get_key(secctx, OSCORE_ROLE_SENDER)
-            );
-
-    if (!oscore_cryptoerr_is_error(err)) {
-        err = feed_aad(
-                oscore_crypto_aead_encrypt_feed_aad,
-                &enc,
-                aad_sizes,
-                secctx,
-                requester_role,
-                &unprotected->request_id,
-                aeadalg,
-                unprotected->backend
-                );
-    }
-    if (!oscore_cryptoerr_is_error(err)) {
-        err = oscore_crypto_aead_encrypt_inplace(
-                &enc,
-                ciphertext,
-                ciphertext_length);
-    }
-
-    if (oscore_cryptoerr_is_error(err)) {
-        return OSCORE_FINISH_ERROR_CRYPTO;
-    }
+    bool success = encrypt_inplace(ciphertext, ciphertext_length,
+            &unprotected->partial_iv, nonceprovider_role,
+            &unprotected->request_id, requester_role,
+            secctx, unprotected->aadcache, unprotected->backend);
 
-    return OSCORE_FINISH_OK;
+    return success ? OSCORE_FINISH_OK : OSCORE_FINISH_ERROR_CRYPTO;
 }
@@ -0,0 +1,359 @@
+#include <assert.h>
+#include <string.h>
+
+#include <oscore/raw.h>
+#include <oscore/coapoption.h>
+#include <oscore_native/crypto.h>
+
+#include "internal.h"
+
+/** Read the option at @p offset of @p buffer (which must be before @p end and
+ * not be a payload marker), and advance @p offset past it.
+ *
+ * @return false if the option is malformed or exceeds @p end
+ */
+static bool next_option(
+        const uint8_t *buffer,
+        size_t *offset,
+        size_t end,
+        uint32_t *number,
+        const uint8_t **value,
+        size_t *value_len
+        )
+{
+    uint32_t delta, length;
+    size_t header_length = oscore_coapoption_decode_header(&buffer[*offset], end - *offset, &delta, &length);
+    if (header_length == 0) {
+        return false;
+    }
+
+    *offset += header_length;
+    *number += delta;
+    *value = &buffer[*offset];
+    *value_len = length;
+    *offset += length;
+    return *number <= UINT16_MAX;
+}
+
+enum oscore_raw_parse_result oscore_raw_parse(
+        uint8_t *buffer,
+        size_t length,
+        struct oscore_raw_message *message
+        )
+{
+    if (length < 4 || (buffer[0] >> 6) != 1 || (buffer[0] & 0xf) > 8 ||
+            length < 4 + (size_t)(buffer[0] & 0xf)) {
+        return OSCORE_RAW_PARSE_INVALID;
+    }
+
+    bool found = false;
+    size_t offset = 4 + (buffer[0] & 0xf);
+    uint32_t number = 0;
+    while (offset < length && buffer[offset] != 0xff) {
+        const uint8_t *value;
+        size_t value_len;
+        if (!next_option(buffer, &offset, length, &number, &value, &value_len)) {
+            return OSCORE_RAW_PARSE_INVALID;
+        }
+        if (number == 9) {
+            if (found || !oscore_oscoreoption_parse(&message->header, value, value_len)) {
+                return OSCORE_RAW_PARSE_INVALID;
+            }
+            found = true;
+        }
+    }
+
+    if (offset < length) {
+        // Skip the payload marker
+        offset += 1;
+        if (offset == length) {
+            return OSCORE_RAW_PARSE_INVALID;
+        }
+    }
+    message->ciphertext = &buffer[offset];
+    message->ciphertext_length = length - offset;
+
+    return found ? OSCORE_RAW_PARSE_OK : OSCORE_RAW_PARSE_NO_OSCORE;
+}
+
+/** Split a decrypted plaintext into its parts
+ *
+ * @return false if the inner options are malformed
+ */
+static bool split_plaintext(
+        uint8_t *plaintext,
+        size_t length,
+        struct oscore_raw_plaintext *out
+        )
+{
+    out->code = plaintext[0];
+    out->options = &plaintext[1];
+
+    size_t offset = 1;
+    uint32_t number = 0;
+    while (offset < length && plaintext[offset] != 0xff) {
+        const uint8_t *value;
+        size_t value_len;
+        if (!next_option(plaintext, &offset, length, &number, &value, &value_len)) {
+            return false;
+        }
+    }
+    out->options_length = offset - 1;
+
+    if (offset + 1 < length) {
+        out->payload = &plaintext[offset + 1];
+        out->payload_length = length - offset - 1;
+    } else if (offset + 1 == length) {
+        // Payload marker without payload
+        return false;
+    } else {
+        out->payload = NULL;
+        out->payload_length = 0;
+    }
+    return true;
+}
+
+/** Decrypt the ciphertext of @p message in place; return true on success */
+static bool decrypt_raw(
+        struct oscore_raw_message *message,
+        oscore_context_t *secctx,
+        const oscore_requestid_t *partial_iv,
+        enum oscore_context_role piv_kid,
+        oscore_requestid_t *request_id,
+        enum oscore_context_role request_kid
+        )
+{
+    size_t tag_length = oscore_crypto_aead_get_taglength(oscore_context_get_aeadalg(secctx));
+    if (message->ciphertext_length < 1 + tag_length) {
+        // Ciphertext too short
+        return false;
+    }
+
+    // Class I options are not supported, so there is no need for a source of
+    // them
+    oscore_msg_native_t class_i_source = {0};
+
+    return decrypt_inplace(message->ciphertext, message->ciphertext_length,
+            partial_iv, piv_kid,
+            request_id, request_kid,
+            secctx, class_i_source);
+}
+
+/** Split the plaintext that @ref decrypt_raw left in @p message */
+static bool split_decrypted(
+        struct oscore_raw_message *message,
+        struct oscore_raw_plaintext *plaintext,
+        const oscore_context_t *secctx
+        )
+{
+    size_t tag_length = oscore_crypto_aead_get_taglength(oscore_context_get_aeadalg(secctx));
+    return split_plaintext(message->ciphertext, message->ciphertext_length - tag_length, plaintext);
+}
+
+enum oscore_unprotect_request_result oscore_unprotect_request_raw(
+        struct oscore_raw_message *message,
+        struct oscore_raw_plaintext *plaintext,
+        oscore_context_t *secctx,
+        oscore_requestid_t *request_id
+        )
+{
+    bool has_request_id = extract_requestid(&message->header, request_id);
+    if (!has_request_id) {
+        return OSCORE_UNPROTECT_REQUEST_INVALID;
+    }
+
+    oscore_requestid_t partial_iv;
+    oscore_requestid_clone(&partial_iv, request_id);
+
+    bool success = decrypt_raw(message, secctx,
+            &partial_iv, OSCORE_ROLE_RECIPIENT,
+            request_id, OSCORE_ROLE_RECIPIENT);
+    if (!success) {
+        return OSCORE_UNPROTECT_REQUEST_INVALID;
+    }
+
+    // Authentic, so the sequence number is used up no matter what is inside
+    oscore_context_strikeout_requestid(secctx, request_id);
+
+    if (!split_decrypted(message, plaintext, secctx)) {
+        return OSCORE_UNPROTECT_REQUEST_INVALID;
+    }
+
+    return request_id->is_first_use ? OSCORE_UNPROTECT_REQUEST_OK : OSCORE_UNPROTECT_REQUEST_DUPLICATE;
+}
+
+enum oscore_unprotect_response_result oscore_unprotect_response_raw(
+        struct oscore_raw_message *message,
+        struct oscore_raw_plaintext *plaintext,
+        oscore_context_t *secctx,
+        oscore_requestid_t *request_id
+        )
+{
+    oscore_requestid_t partial_iv;
+    enum oscore_context_role piv_kid;
+    if (extract_requestid(&message->header, &partial_iv)) {
+        // See oscore_unprotect_response for the choice of roles
+        piv_kid = OSCORE_ROLE_RECIPIENT;
+    } else {
+        oscore_requestid_clone(&partial_iv, request_id);
+        piv_kid = OSCORE_ROLE_SENDER;
+    }
+
+    oscore_requestid_t aad_request_id;
+    oscore_requestid_clone(&aad_request_id, request_id);
+
+    bool success = decrypt_raw(message, secctx,
+            &partial_iv, piv_kid,
+            &aad_request_id, OSCORE_ROLE_SENDER);
+    if (!success || !split_decrypted(message, plaintext, secctx)) {
+        return OSCORE_UNPROTECT_RESPONSE_INVALID;
+    }
+
+    return OSCORE_UNPROTECT_RESPONSE_OK;
+}
+
+/** Write the outer code, the OSCORE option and the payload marker, once the
+ * request ID and Partial IV of @p outgoing are set up */
+static enum oscore_prepare_result prepare_raw(
+        uint8_t *buffer,
+        size_t size,
+        size_t outer_length,
+        uint16_t last_outer_option,
+        struct oscore_raw_outgoing *outgoing,
+        uint8_t **plaintext,
+        size_t *plaintext_size
+        )
+{
+    assert(last_outer_option < 9);
+
+    uint8_t optionbuffer[OSCOREOPTION_MAXLEN];
+    const oscore_requestid_t *piv_source;
+    if (outgoing->request_id.is_first_use && !outgoing->is_request) {
+        piv_source = NULL;
+    } else {
+        piv_source = outgoing->request_id.is_first_use ? &outgoing->request_id : &outgoing->partial_iv;
+    }
+    size_t optionlength = build_oscoreoption(optionbuffer, outgoing->secctx, outgoing->is_request, piv_source);
+
+    size_t tag_length = oscore_crypto_aead_get_taglength(oscore_context_get_aeadalg(outgoing->secctx));
+    size_t needed = outer_length +
+        3 /* option header */ + optionlength +
+        1 /* payload marker */ + 1 /* code */ + tag_length;
+    if (needed > size) {
+        return OSCORE_PREPARE_ERROR_SIZE;
+    }
+
+    buffer[1] = outgoing->is_request ? 0x02 /* POST */ : 0x45 /* 2.05 Content */;
+
+    size_t offset = outer_length;
+    offset += oscore_coapoption_encode_header(&buffer[offset], 9 - last_outer_option, optionlength);
+    memcpy(&buffer[offset], optionbuffer, optionlength);
+    offset += optionlength;
+    buffer[offset++] = 0xff;
+
+    outgoing->plaintext = &buffer[offset];
+    outgoing->plaintext_offset = offset;
+    outgoing->available = size - offset;
+
+    *plaintext = outgoing->plaintext;
+    *plaintext_size = outgoing->available - tag_length;
+    return OSCORE_PREPARE_OK;
+}
+
+enum oscore_prepare_result oscore_prepare_request_raw(
+        uint8_t *buffer,
+        size_t size,
+        size_t outer_length,
+        uint16_t last_outer_option,
+        struct oscore_raw_outgoing *outgoing,
+        oscore_context_t *secctx,
+        oscore_requestid_t *request_id,
+        uint8_t **plaintext,
+        size_t *plaintext_size
+        )
+{
+    // As in oscore_prepare_request
+    bool ok = oscore_context_take_seqno(secctx, &outgoing->request_id);
+    if (!ok) {
+        return OSCORE_PREPARE_SECCTX_UNAVAILABLE;
+    }
+    oscore_requestid_clone(request_id, &outgoing->request_id);
+    oscore_requestid_clone(&outgoing->partial_iv, &outgoing->request_id);
+    outgoing->partial_iv.is_first_use = true;
+
+    outgoing->secctx = secctx;
+    outgoing->is_request = true;
+
+    return prepare_raw(buffer, size, outer_length, last_outer_option, outgoing, plaintext, plaintext_size);
+}
+
+enum oscore_prepare_result oscore_prepare_response_raw(
+        uint8_t *buffer,
+        size_t size,
+        size_t outer_length,
+        uint16_t last_outer_option,
+        struct oscore_raw_outgoing *outgoing,
+        oscore_context_t *secctx,
+        oscore_requestid_t *request_id,
+        uint8_t **plaintext,
+        size_t *plaintext_size
+        )
+{
+    // As in oscore_prepare_response
+    memcpy(&outgoing->request_id, request_id, sizeof(oscore_requestid_t));
+    request_id->is_first_use = false;
+
+    if (!outgoing->request_id.is_first_use) {
+        bool ok = oscore_context_take_seqno(secctx, &outgoing->partial_iv);
+        if (!ok) {
+            return OSCORE_PREPARE_SECCTX_UNAVAILABLE;
+        }
+    } else {
+        oscore_requestid_clone(&outgoing->partial_iv, &outgoing->request_id);
+    }
+    outgoing->partial_iv.is_first_use = true;
+
+    outgoing->secctx = secctx;
+    outgoing->is_request = false;
+
+    return prepare_raw(buffer, size, outer_length, last_outer_option, outgoing, plaintext, plaintext_size);
+}
+
+enum oscore_finish_result oscore_encrypt_message_raw(
+        struct oscore_raw_outgoing *outgoing,
+        size_t plaintext_length,
+        size_t *length
+        )
+{
+    const oscore_context_t *secctx = outgoing->secctx;
+    size_t tag_length = oscore_crypto_aead_get_taglength(oscore_context_get_aeadalg(secctx));
+
+    enum oscore_context_role requester_role = outgoing->is_request ? OSCORE_ROLE_SENDER : OSCORE_ROLE_RECIPIENT;
+    enum oscore_context_role nonceprovider_role = outgoing->is_request ?
+                    OSCORE_ROLE_SENDER : (
+                        outgoing->request_id.is_first_use ?
+                        OSCORE_ROLE_RECIPIENT :
+                        OSCORE_ROLE_SENDER
+                    );
+
+    // Catches encrypting the same preparation twice, as in
+    // oscore_encrypt_message
+    assert(outgoing->partial_iv.is_first_use);
+    outgoing->partial_iv.is_first_use = false;
+
+    if (plaintext_length < 1 || plaintext_length > outgoing->available - tag_length) {
+        return OSCORE_FINISH_ERROR_SIZE;
+    }
+
+    oscore_msg_native_t class_i_source = {0};
+    bool success = encrypt_inplace(outgoing->plaintext, plaintext_length + tag_length,
+            &outgoing->partial_iv, nonceprovider_role,
+            &outgoing->request_id, requester_role,
+            secctx, NULL, class_i_source);
+    if (!success) {
+        return OSCORE_FINISH_ERROR_CRYPTO;
+    }
+
+    *length = outgoing->plaintext_offset + plaintext_length + tag_length;
+    return OSCORE_FINISH_OK;
+}
@@ -0,0 +1,171 @@
+#include <string.h>
+#include <oscore/retransmit.h>
+#include <oscore_native/crypto.h>
+
+void oscore_retransmit_init(
+        struct oscore_retransmit_cache *cache,
+        struct oscore_retransmit_entry *entries,
+        size_t entries_count
+        )
+{
+    cache->entries = entries;
+    cache->entries_count = entries_count;
+    cache->next = 0;
+    for (size_t i = 0; i < entries_count; ++i) {
+        entries[i].secctx = NULL;
+    }
+}
+
+bool oscore_retransmit_tag_init(
+        struct oscore_retransmit_tag *tag,
+        const oscore_context_t *secctx,
+        oscore_msg_native_t request
+        )
+{
+    size_t tag_len = oscore_crypto_aead_get_taglength(oscore_context_get_aeadalg(secctx));
+
+    uint8_t *payload;
+    size_t payload_len;
+    oscore_msgerr_native_t err = oscore_msg_native_map_payload(request, &payload, &payload_len);
+    if (oscore_msgerr_native_is_error(err) || payload_len < tag_len || tag_len > OSCORE_RETRANSMIT_TAG_MAXLEN) {
+        return false;
+    }
+    memcpy(tag->tag, &payload[payload_len - tag_len], tag_len);
+    tag->tag_len = tag_len;
+    return true;
+}
+
+/** Return true if @p a and @p b are the same tag */
+static bool tag_equal(const struct oscore_retransmit_tag *a, const struct oscore_retransmit_tag *b)
+{
+    return a->tag_len == b->tag_len && memcmp(a->tag, b->tag, a->tag_len) == 0;
+}
+
+bool oscore_retransmit_store(
+        struct oscore_retransmit_cache *cache,
+        const oscore_context_t *secctx,
+        const oscore_requestid_t *request_id,
+        const struct oscore_retransmit_tag *request_tag,
+        oscore_msg_native_t protected
+        )
+{
+    if (cache->entries_count == 0) {
+        return false;
+    }
+
+    struct oscore_retransmit_entry *entry = &cache->entries[cache->next];
+    // Whatever was there is dropped even if the new response can not be
+    // stored; it's the oldest anyway.
+    entry->secctx = NULL;
+
+    size_t cursor = 0;
+    bool fits = true;
+
+    oscore_msg_native_optiter_t iter;
+    uint16_t number;
+    const uint8_t *value;
+    size_t value_len;
+    oscore_msg_native_optiter_init(protected, &iter);
+    while (oscore_msg_native_optiter_next(protected, &iter, &number, &value, &value_len)) {
+        if (fits && 4 + value_len <= OSCORE_RETRANSMIT_MAXLEN - cursor) {
+            entry->data[cursor++] = number >> 8;
+            entry->data[cursor++] = number;
+            entry->data[cursor++] = value_len >> 8;
+            entry->data[cursor++] = value_len;
+            memcpy(&entry->data[cursor], value, value_len);
+            cursor += value_len;
+        } else {
+            fits = false;
+        }
+    }
+    oscore_msgerr_native_t err = oscore_msg_native_optiter_finish(protected, &iter);
+    if (oscore_msgerr_native_is_error(err) || !fits) {
+        return false;
+    }
+    entry->options_length = cursor;
+
+    uint8_t *payload;
+    size_t payload_len;
+    err = oscore_msg_native_map_payload(protected, &payload, &payload_len);
+    if (oscore_msgerr_native_is_error(err) || payload_len > OSCORE_RETRANSMIT_MAXLEN - cursor) {
+        return false;
+    }
+    memcpy(&entry->data[cursor], payload, payload_len);
+    entry->payload_length = payload_len;
+
+    entry->code = oscore_msg_native_get_code(protected);
+    entry->request_piv_len = request_id->used_bytes;
+    memcpy(entry->request_piv, &request_id->bytes[PIV_BYTES - request_id->used_bytes], request_id->used_bytes);
+    entry->request_tag = *request_tag;
+    entry->secctx = secctx;
+
+    cache->next = (cache->next + 1) % cache->entries_count;
+    return true;
+}
+
+const struct oscore_retransmit_entry *oscore_retransmit_find(
+        const struct oscore_retransmit_cache *cache,
+        const oscore_context_t *secctx,
+        const oscore_oscoreoption_t *header,
+        const struct oscore_retransmit_tag *request_tag
+        )
+{
+    if (header->partial_iv_len == 0) {
+        // Not a request
+        return NULL;
+    }
+
+    for (size_t i = 0; i < cache->entries_count; ++i) {
+        const struct oscore_retransmit_entry *entry = &cache->entries[i];
+        if (entry->secctx == secctx &&
+                entry->request_piv_len == header->partial_iv_len &&
+                memcmp(entry->request_piv, header->partial_iv, header->partial_iv_len) == 0 &&
+                tag_equal(&entry->request_tag, request_tag)) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+bool oscore_retransmit_write(
+        const struct oscore_retransmit_entry *entry,
+        oscore_msg_native_t response
+        )
+{
+    oscore_msg_native_set_code(response, entry->code);
+
+    oscore_msgerr_native_t err;
+    size_t cursor = 0;
+    while (cursor < entry->options_length) {
+        uint16_t number = (entry->data[cursor] << 8) | entry->data[cursor + 1];
+        size_t value_len = (entry->data[cursor + 2] << 8) | entry->data[cursor + 3];
+        cursor += 4;
+        err = oscore_msg_native_append_option(response, number, &entry->data[cursor], value_len);
+        if (oscore_msgerr_native_is_error(err)) {
+            return false;
+        }
+        cursor += value_len;
+    }
+
+    uint8_t *payload;
+    size_t payload_len;
+    err = oscore_msg_native_map_payload(response, &payload, &payload_len);
+    if (oscore_msgerr_native_is_error(err) || payload_len < entry->payload_length) {
+        return false;
+    }
+    memcpy(payload, &entry->data[cursor], entry->payload_length);
+    err = oscore_msg_native_trim_payload(response, entry->payload_length);
+    return !oscore_msgerr_native_is_error(err);
+}
+
+void oscore_retransmit_forget(
+        struct oscore_retransmit_cache *cache,
+        const oscore_context_t *secctx
+        )
+{
+    for (size_t i = 0; i < cache->entries_count; ++i) {
+        if (cache->entries[i].secctx == secctx) {
+            cache->entries[i].secctx = NULL;
+        }
+    }
+}
@@ -0,0 +1,392 @@
+/* Throughput of the protection path
+ *
+ * For every AEAD algorithm the crypto backend supports and a range of payload
+ * sizes, this times protecting a request and unprotecting a request and a
+ * response, and (once per algorithm) deriving a context and iterating over a
+ * message's options. Results are printed as CSV. The cycles column stays empty
+ * on platforms without a cycle counter.
+ *
+ * Run this through `make bench` in tests/native, which builds it optimized
+ * and without sanitizers.
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_CYCLES 1
+#endif
+
+#include <oscore_native/message.h>
+#include <oscore_native/test.h>
+#include <oscore/protection.h>
+#include <oscore/contextpair.h>
+#include <oscore/context_impl/primitive.h>
+#include <oscore/message.h>
+
+#include "../cases/testhelpers.h"
+
+/** Minimum time each measurement runs for; the number of iterations is
+ * doubled until a run takes at least this long */
+#ifndef BENCH_MIN_NS
+#define BENCH_MIN_NS 100000000
+#endif
+
+/** COSE numbers of all AEAD algorithms tried; those the crypto backend does
+ * not support are skipped */
+static const int32_t algorithms[] = {10, 11, 12, 13, 30, 31, 32, 33, 1, 2, 3, 24};
+
+/** Payload sizes; sizes that do not fit the test messages are skipped */
+static const size_t payload_sizes[] = {0, 16, 64, 256, 768};
+
+/** Largest ciphertext of any request or response that is restored between
+ * iterations */
+#define CIPHERTEXT_MAXLEN 1024
+
+static const uint8_t payload_data[768];
+
+struct fixture {
+    int32_t alg;
+    size_t payload_size;
+
+    struct oscore_context_primitive_immutables client_key;
+    struct oscore_context_primitive_immutables server_key;
+    struct oscore_context_primitive client_primitive;
+    struct oscore_context_primitive server_primitive;
+    oscore_context_t client;
+    oscore_context_t server;
+
+    /** A protected request, and its ciphertext for restoring it after it was
+     * decrypted in place */
+    oscore_msg_native_t request;
+    oscore_oscoreoption_t request_header;
+    uint8_t *request_payload;
+    uint8_t request_ciphertext[CIPHERTEXT_MAXLEN];
+    size_t request_ciphertext_len;
+
+    /** A protected response to @ref request, and the request ID the client
+     * sent it with */
+    oscore_msg_native_t response;
+    oscore_oscoreoption_t response_header;
+    uint8_t *response_payload;
+    uint8_t response_ciphertext[CIPHERTEXT_MAXLEN];
+    size_t response_ciphertext_len;
+    oscore_requestid_t client_rid;
+
+    /** The request, unprotected for option iteration */
+    oscore_msg_protected_t unprotected;
+};
+
+static uint64_t now_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/** Read the CPU's time stamp counter. On current x86 CPUs that runs at a
+ * constant reference rate, which may differ from the core clock under
+ * frequency scaling. */
+static uint64_t now_cycles(void)
+{
+#ifdef HAVE_CYCLES
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/** Run @p operation often enough to get a stable result, and print it as a
+ * line of CSV */
+static void measure(const char *name, struct fixture *f, void (*operation)(struct fixture *))
+{
+    // Warm up caches and lazy initialization
+    operation(f);
+
+    uint64_t iterations = 1;
+    uint64_t elapsed_ns;
+    uint64_t elapsed_cycles;
+    while (true) {
+        uint64_t start_ns = now_ns();
+        uint64_t start_cycles = now_cycles();
+        for (uint64_t i = 0; i < iterations; ++i) {
+            operation(f);
+        }
+        elapsed_cycles = now_cycles() - start_cycles;
+        elapsed_ns = now_ns() - start_ns;
+        if (elapsed_ns >= BENCH_MIN_NS) {
+            break;
+        }
+        iterations *= 2;
+    }
+
+    double ns_per_op = (double)elapsed_ns / iterations;
+    printf("%s,%ld,%zu,%llu,%.1f,%.0f,", name, (long)f->alg, f->payload_size,
+            (unsigned long long)iterations, ns_per_op, 1e9 / ns_per_op);
+#ifdef HAVE_CYCLES
+    printf("%.1f", (double)elapsed_cycles / iterations);
+#else
+    (void)elapsed_cycles;
+#endif
+    printf("\n");
+}
+
+/** Write the options and payload of a typical request into @p plaintext
+ *
+ * @return false if the payload does not fit
+ */
+static bool write_request(oscore_msg_protected_t *plaintext, size_t payload_size)
+{
+    oscore_msgerr_protected_t err;
+    oscore_msg_protected_set_code(plaintext, 2 /* POST */);
+    err = oscore_msg_protected_append_option(plaintext, 11, (const uint8_t *)"sensors", 7);
+    assert(!oscore_msgerr_protected_is_error(err));
+    err = oscore_msg_protected_append_option(plaintext, 11, (const uint8_t *)"temp", 4);
+    assert(!oscore_msgerr_protected_is_error(err));
+    err = oscore_msg_protected_append_option(plaintext, 12, (const uint8_t *)"\x3c", 1);
+    assert(!oscore_msgerr_protected_is_error(err));
+
+    uint8_t *payload;
+    size_t payload_len;
+    err = oscore_msg_protected_map_payload(plaintext, &payload, &payload_len);
+    assert(!oscore_msgerr_protected_is_error(err));
+    if (payload_len < payload_size) {
+        return false;
+    }
+    memcpy(payload, payload_data, payload_size);
+    err = oscore_msg_protected_trim_payload(plaintext, payload_size);
+    assert(!oscore_msgerr_protected_is_error(err));
+    return true;
+}
+
+/** Remember the ciphertext of a protected message */
+static void save_ciphertext(oscore_msg_native_t msg, uint8_t **payload, uint8_t *ciphertext, size_t *ciphertext_len)
+{
+    oscore_msgerr_native_t err = oscore_msg_native_map_payload(msg, payload, ciphertext_len);
+    assert(!oscore_msgerr_native_is_error(err));
+    assert(*ciphertext_len <= CIPHERTEXT_MAXLEN);
+    memcpy(ciphertext, *payload, *ciphertext_len);
+}
+
+static void reset_replay_window(struct fixture *f)
+{
+    f->server_primitive.replay_window_left_edge = 0;
+    f->server_primitive.replay_window = 0;
+}
+
+/** Set up contexts and a request/response pair
+ *
+ * @return false if the payload size does not fit a message
+ */
+static bool fixture_setup(struct fixture *f, oscore_crypto_aeadalg_t aeadalg)
+{
+    size_t keylength = oscore_crypto_aead_get_keylength(aeadalg);
+    size_t ivlength = oscore_crypto_aead_get_ivlength(aeadalg);
+    for (size_t i = 0; i < keylength; ++i) {
+        f->client_key.sender_key[i] = f->server_key.recipient_key[i] = i;
+        f->client_key.recipient_key[i] = f->server_key.sender_key[i] = 0x80 + i;
+    }
+    for (size_t i = 0; i < ivlength; ++i) {
+        f->client_key.common_iv[i] = f->server_key.common_iv[i] = 0x40 + i;
+    }
+    f->client_key.aeadalg = f->server_key.aeadalg = aeadalg;
+    f->client_key.sender_id_len = f->server_key.recipient_id_len = 0;
+    f->client_key.recipient_id_len = f->server_key.sender_id_len = 1;
+    f->client_key.recipient_id[0] = f->server_key.sender_id[0] = 0x01;
+
+    f->client_primitive = (struct oscore_context_primitive){ .immutables = &f->client_key };
+    f->server_primitive = (struct oscore_context_primitive){ .immutables = &f->server_key };
+    f->client = (oscore_context_t){ .type = OSCORE_CONTEXT_PRIMITIVE, .data = (void*)&f->client_primitive };
+    f->server = (oscore_context_t){ .type = OSCORE_CONTEXT_PRIMITIVE, .data = (void*)&f->server_primitive };
+
+    oscore_msg_protected_t plaintext;
+    oscore_msg_native_t out;
+
+    f->request = oscore_test_msg_create();
+    assert(f->request != NULL);
+    enum oscore_prepare_result prepared = oscore_prepare_request(f->request, &plaintext, &f->client, &f->client_rid);
+    assert(prepared == OSCORE_PREPARE_OK);
+    if (!write_request(&plaintext, f->payload_size)) {
+        // There is no way to abort a prepared message, but as this is not
+        // sent, no nonce is reused
+        oscore_test_msg_destroy(f->request);
+        return false;
+    }
+    enum oscore_finish_result finished = oscore_encrypt_message(&plaintext, &out);
+    assert(finished == OSCORE_FINISH_OK);
+    find_oscoreoption(f->request, &f->request_header);
+    save_ciphertext(f->request, &f->request_payload, f->request_ciphertext, &f->request_ciphertext_len);
+
+    oscore_requestid_t server_rid;
+    enum oscore_unprotect_request_result reqresult = oscore_unprotect_request(f->request, &f->unprotected, f->request_header, &f->server, &server_rid);
+    assert(reqresult == OSCORE_UNPROTECT_REQUEST_OK);
+    oscore_release_unprotected(&f->unprotected);
+    memcpy(f->request_payload, f->request_ciphertext, f->request_ciphertext_len);
+
+    f->response = oscore_test_msg_create();
+    assert(f->response != NULL);
+    prepared = oscore_prepare_response(f->response, &plaintext, &f->server, &server_rid);
+    assert(prepared == OSCORE_PREPARE_OK);
+    oscore_msg_protected_set_code(&plaintext, 0x44 /* 2.04 Changed */);
+    uint8_t *payload;
+    size_t payload_len;
+    oscore_msgerr_protected_t err = oscore_msg_protected_map_payload(&plaintext, &payload, &payload_len);
+    assert(!oscore_msgerr_protected_is_error(err) && payload_len >= f->payload_size);
+    memcpy(payload, payload_data, f->payload_size);
+    err = oscore_msg_protected_trim_payload(&plaintext, f->payload_size);
+    assert(!oscore_msgerr_protected_is_error(err));
+    finished = oscore_encrypt_message(&plaintext, &out);
+    assert(finished == OSCORE_FINISH_OK);
+    find_oscoreoption(f->response, &f->response_header);
+    save_ciphertext(f->response, &f->response_payload, f->response_ciphertext, &f->response_ciphertext_len);
+
+    return true;
+}
+
+static void fixture_teardown(struct fixture *f)
+{
+    oscore_test_msg_destroy(f->request);
+    oscore_test_msg_destroy(f->response);
+}
+
+/** Baseline for the message allocation that is part of @ref
+ * bench_prepare_encrypt */
+static void bench_msg_create(struct fixture *f)
+{
+    (void)f;
+    oscore_msg_native_t msg = oscore_test_msg_create();
+    assert(msg != NULL);
+    oscore_test_msg_destroy(msg);
+}
+
+static void bench_prepare_encrypt(struct fixture *f)
+{
+    oscore_msg_native_t msg = oscore_test_msg_create();
+    assert(msg != NULL);
+    oscore_msg_protected_t plaintext;
+    oscore_requestid_t rid;
+    enum oscore_prepare_result prepared = oscore_prepare_request(msg, &plaintext, &f->client, &rid);
+    assert(prepared == OSCORE_PREPARE_OK);
+    bool written = write_request(&plaintext, f->payload_size);
+    assert(written);
+    oscore_msg_native_t out;
+    enum oscore_finish_result finished = oscore_encrypt_message(&plaintext, &out);
+    assert(finished == OSCORE_FINISH_OK);
+    oscore_test_msg_destroy(msg);
+}
+
+/** Unprotect the same request over and over; this includes restoring its
+ * ciphertext and resetting the replay window */
+static void bench_unprotect_request(struct fixture *f)
+{
+    memcpy(f->request_payload, f->request_ciphertext, f->request_ciphertext_len);
+    reset_replay_window(f);
+    oscore_requestid_t rid;
+    enum oscore_unprotect_request_result result = oscore_unprotect_request(f->request, &f->unprotected, f->request_header, &f->server, &rid);
+    assert(result == OSCORE_UNPROTECT_REQUEST_OK);
+    oscore_release_unprotected(&f->unprotected);
+}
+
+/** Unprotect the same response over and over; this includes restoring its
+ * ciphertext */
+static void bench_unprotect_response(struct fixture *f)
+{
+    memcpy(f->response_payload, f->response_ciphertext, f->response_ciphertext_len);
+    oscore_msg_protected_t unprotected;
+    enum oscore_unprotect_response_result result = oscore_unprotect_response(f->response, &unprotected, f->response_header, &f->client, &f->client_rid);
+    assert(result == OSCORE_UNPROTECT_RESPONSE_OK);
+    oscore_release_unprotected(&unprotected);
+}
+
+static void bench_derive(struct fixture *f)
+{
+    oscore_crypto_hkdfalg_t hkdfalg;
+    oscore_cryptoerr_t err = oscore_crypto_hkdf_from_number(&hkdfalg, 5);
+    assert(!oscore_cryptoerr_is_error(err));
+    struct oscore_context_primitive_immutables key = {
+        .aeadalg = f->client_key.aeadalg,
+        .recipient_id_len = 1,
+        .recipient_id = "\x01",
+    };
+    err = oscore_context_primitive_derive(&key, hkdfalg,
+            (const uint8_t *)"\x9e\x7c\xa9\x22\x23\x78\x63\x40", 8,
+            (const uint8_t *)"\x01\x02\x03\x04\x05\x06\x07\x08\x09\x0a\x0b\x0c\x0d\x0e\x0f\x10", 16,
+            NULL, 0);
+    assert(!oscore_cryptoerr_is_error(err));
+}
+
+/** Iterate over all inner and outer options of the unprotected request */
+static void bench_optiter(struct fixture *f)
+{
+    oscore_msg_protected_optiter_t iter;
+    uint16_t number;
+    const uint8_t *value;
+    size_t value_len;
+    size_t count = 0;
+    oscore_msg_protected_optiter_init(&f->unprotected, &iter);
+    while (oscore_msg_protected_optiter_next(&f->unprotected, &iter, &number, &value, &value_len)) {
+        count += 1;
+    }
+    oscore_msgerr_protected_t err = oscore_msg_protected_optiter_finish(&f->unprotected, &iter);
+    assert(!oscore_msgerr_protected_is_error(err) && count == 3);
+}
+
+static struct fixture fixture;
+
+int testmain(int introduce_error)
+{
+    (void)introduce_error;
+
+    oscore_crypto_hkdfalg_t hkdfalg;
+    bool have_hkdf = !oscore_cryptoerr_is_error(oscore_crypto_hkdf_from_number(&hkdfalg, 5));
+
+    printf("operation,alg,payload,iterations,ns_per_op,ops_per_s,cycles_per_op\n");
+
+    fixture.alg = 0;
+    fixture.payload_size = 0;
+    measure("msg_create", &fixture, bench_msg_create);
+
+    for (size_t a = 0; a < sizeof(algorithms) / sizeof(algorithms[0]); ++a) {
+        oscore_crypto_aeadalg_t aeadalg;
+        if (oscore_cryptoerr_is_error(oscore_crypto_aead_from_number(&aeadalg, algorithms[a]))) {
+            continue;
+        }
+
+        for (size_t p = 0; p < sizeof(payload_sizes) / sizeof(payload_sizes[0]); ++p) {
+            memset(&fixture, 0, sizeof(fixture));
+            fixture.alg = algorithms[a];
+            fixture.payload_size = payload_sizes[p];
+            if (!fixture_setup(&fixture, aeadalg)) {
+                continue;
+            }
+
+            measure("prepare_encrypt", &fixture, bench_prepare_encrypt);
+            measure("unprotect_request", &fixture, bench_unprotect_request);
+            measure("unprotect_response", &fixture, bench_unprotect_response);
+
+            if (p == 0) {
+                // Neither of these depends on the payload
+                if (have_hkdf) {
+                    measure("derive", &fixture, bench_derive);
+                }
+
+                reset_replay_window(&fixture);
+                memcpy(fixture.request_payload, fixture.request_ciphertext, fixture.request_ciphertext_len);
+                oscore_requestid_t rid;
+                enum oscore_unprotect_request_result result = oscore_unprotect_request(fixture.request, &fixture.unprotected, fixture.request_header, &fixture.server, &rid);
+                assert(result == OSCORE_UNPROTECT_REQUEST_OK);
+                measure("optiter", &fixture, bench_optiter);
+                oscore_release_unprotected(&fixture.unprotected);
+            }
+
+            fixture_teardown(&fixture);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,765 @@
+/* Loopback load generator
+ *
+ * This runs an OSCORE server with one Appendix B.1 security context per
+ * client, and a number of simulated clients that each send a pipeline of
+ * requests to it over loopback UDP. Request processing follows the plugtest
+ * server's intermediate integration: the context is looked up by KID and
+ * locked (a context in use by another server thread results in an
+ * unprotected 5.03), the replay window is recovered with Echo options, and
+ * the sequence number persistence is simulated after every request.
+ *
+ * Every client runs in a thread of its own on its own socket, and can drop,
+ * reorder and duplicate the datagrams it sends and receives. At the end, the
+ * throughput and latency percentiles of all successful exchanges are printed
+ * as CSV, along with counters of how the other requests ended.
+ *
+ * This needs the posix backend, and is built with the benchmarks there:
+ *
+ *     make bench TESTS_BACKEND=posix
+ *
+ * Run `./loadgen -h` for the options.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/random.h>
+#include <sys/socket.h>
+
+#include <oscore_native/message.h>
+#include <oscore/protection.h>
+#include <oscore/contextpair.h>
+#include <oscore/context_impl/primitive.h>
+#include <oscore/context_impl/b1.h>
+#include <oscore/echo.h>
+#include <oscore/message.h>
+#include <oscore_posix/udp.h>
+
+#ifndef LOADGEN_MAX_CLIENTS
+#define LOADGEN_MAX_CLIENTS 256
+#endif
+#ifndef LOADGEN_MAX_SERVER_THREADS
+#define LOADGEN_MAX_SERVER_THREADS 8
+#endif
+#ifndef LOADGEN_MAX_DEPTH
+#define LOADGEN_MAX_DEPTH 32
+#endif
+
+/** Latency histogram resolution: each power of two is split into this many
+ * buckets, giving about 3% precision */
+#define HISTOGRAM_SUBBUCKETS 32
+#define HISTOGRAM_BUCKETS (60 * HISTOGRAM_SUBBUCKETS)
+
+#define OPTION_OSCORE 9
+#define OPTION_URI_PATH 11
+#define OPTION_ECHO 252
+
+#define CODE_POST 0x02
+#define CODE_CONTENT 0x45
+#define CODE_UNAUTHORIZED 0x81
+#define CODE_BAD_REQUEST 0x80
+#define CODE_BAD_OPTION 0x82
+#define CODE_SERVICE_UNAVAILABLE 0xa3
+
+static struct {
+    size_t clients;
+    size_t server_threads;
+    size_t depth;
+    size_t payload;
+    int32_t alg;
+    unsigned duration;
+    unsigned timeout_ms;
+    /** Probabilities of a datagram being dropped, held back behind the next
+     * one, and sent twice */
+    double loss;
+    double reorder;
+    double duplicate;
+    uint64_t seed;
+} config = {
+    .clients = 16,
+    .server_threads = 1,
+    .depth = 4,
+    .payload = 64,
+    .alg = 10,
+    .duration = 5,
+    .timeout_ms = 200,
+};
+
+/** Stop flags; the server is only stopped when all clients are done */
+static atomic_bool stop_clients;
+static atomic_bool stop_server;
+
+static uint64_t now_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static size_t histogram_index(uint64_t value)
+{
+    if (value < HISTOGRAM_SUBBUCKETS) {
+        return value;
+    }
+    unsigned msb = 63 - __builtin_clzll(value);
+    size_t index = (msb - 4) * HISTOGRAM_SUBBUCKETS + ((value >> (msb - 5)) & (HISTOGRAM_SUBBUCKETS - 1));
+    return index < HISTOGRAM_BUCKETS ? index : HISTOGRAM_BUCKETS - 1;
+}
+
+/** Lower bound of the values counted in a histogram bucket */
+static uint64_t histogram_value(size_t index)
+{
+    if (index < HISTOGRAM_SUBBUCKETS) {
+        return index;
+    }
+    unsigned msb = index / HISTOGRAM_SUBBUCKETS + 4;
+    return (uint64_t)(HISTOGRAM_SUBBUCKETS + index % HISTOGRAM_SUBBUCKETS) << (msb - 5);
+}
+
+static uint64_t histogram_percentile(const uint64_t *histogram, uint64_t count, double percentile)
+{
+    uint64_t rank = count * percentile / 100;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+        seen += histogram[i];
+        if (seen > rank) {
+            return histogram_value(i);
+        }
+    }
+    return 0;
+}
+
+static void find_oscoreoption(oscore_msg_native_t msg, oscore_oscoreoption_t *header, bool *found, bool *parsed)
+{
+    oscore_msg_native_optiter_t iter;
+    uint16_t number;
+    const uint8_t *value;
+    size_t value_length;
+    *found = false;
+    *parsed = false;
+    oscore_msg_native_optiter_init(msg, &iter);
+    while (oscore_msg_native_optiter_next(msg, &iter, &number, &value, &value_length)) {
+        if (number == OPTION_OSCORE) {
+            *found = true;
+            *parsed = oscore_oscoreoption_parse(header, value, value_length);
+        }
+    }
+    oscore_msg_native_optiter_finish(msg, &iter);
+}
+
+/** Derive the key material of client @p index; the server side has sender
+ * and recipient swapped */
+static void derive_key(struct oscore_context_primitive_immutables *key, size_t index, bool server)
+{
+    uint8_t *kid_field = server ? key->recipient_id : key->sender_id;
+    kid_field[0] = index >> 8;
+    kid_field[1] = index;
+    if (server) {
+        key->recipient_id_len = 2;
+        key->sender_id_len = 0;
+    } else {
+        key->sender_id_len = 2;
+        key->recipient_id_len = 0;
+    }
+    bool ok = !oscore_cryptoerr_is_error(oscore_crypto_aead_from_number(&key->aeadalg, config.alg));
+    assert(ok);
+
+    oscore_crypto_hkdfalg_t hkdfalg;
+    ok = !oscore_cryptoerr_is_error(oscore_crypto_hkdf_from_number(&hkdfalg, 5));
+    assert(ok);
+    uint8_t secret[16] = {index >> 8, index, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08,
+        0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x10};
+    oscore_cryptoerr_t err = oscore_context_primitive_derive(key, hkdfalg,
+            (const uint8_t *)"\x9e\x7c\xa9\x22\x23\x78\x63\x40", 8,
+            secret, sizeof(secret), NULL, 0);
+    assert(!oscore_cryptoerr_is_error(err));
+    (void)err;
+}
+
+/* Server */
+
+struct server_context {
+    struct oscore_context_primitive_immutables key;
+    struct oscore_context_b1 b1;
+    oscore_context_t secctx;
+    pthread_mutex_t usage;
+};
+
+static struct server_context server_contexts[LOADGEN_MAX_CLIENTS];
+static struct oscore_echo server_echo;
+static struct oscore_posix_udp_server servers[LOADGEN_MAX_SERVER_THREADS];
+
+static struct {
+    atomic_ulong ok;
+    atomic_ulong echo;
+    atomic_ulong duplicate;
+    atomic_ulong busy;
+    atomic_ulong bad;
+    atomic_ulong failed;
+} server_stats;
+
+/** Turn @p response into an unprotected response with @p code, dropping
+ * anything (eg. an OSCORE option) that was already written into it */
+static void set_error(struct oscore_posix_msg *response, uint8_t code)
+{
+    oscore_posix_msg_clear(response);
+    oscore_msg_native_set_code(response, code);
+    oscore_msg_native_trim_payload(response, 0);
+}
+
+/** Answer a request with the length and sum of its payload */
+static bool server_handler(void *arg, struct oscore_posix_msg *request, const struct sockaddr *peer, socklen_t peer_len, struct oscore_posix_msg *response)
+{
+    (void)arg;
+    (void)peer;
+    (void)peer_len;
+
+    oscore_oscoreoption_t header;
+    bool found, parsed;
+    find_oscoreoption(request, &header, &found, &parsed);
+    if (!found || !parsed) {
+        atomic_fetch_add(&server_stats.bad, 1);
+        set_error(response, CODE_BAD_OPTION);
+        return true;
+    }
+
+    // Like in the intermediate integration, this accesses the KID directly
+    size_t index = header.kid != NULL && header.kid_len == 2 ?
+        (header.kid[0] << 8 | header.kid[1]) : LOADGEN_MAX_CLIENTS;
+    if (index >= config.clients) {
+        atomic_fetch_add(&server_stats.bad, 1);
+        set_error(response, CODE_UNAUTHORIZED);
+        return true;
+    }
+    struct server_context *context = &server_contexts[index];
+
+    if (pthread_mutex_trylock(&context->usage) != 0) {
+        atomic_fetch_add(&server_stats.busy, 1);
+        set_error(response, CODE_SERVICE_UNAVAILABLE);
+        return true;
+    }
+
+    oscore_msg_protected_t unprotected;
+    oscore_requestid_t request_id;
+    enum oscore_unprotect_request_result oscerr = oscore_unprotect_request(request, &unprotected, header, &context->secctx, &request_id);
+    bool respond_401echo = oscore_context_b1_process_request(&context->secctx, &unprotected, &oscerr, &request_id);
+
+    // Persisting is simulated to be instantaneous
+    oscore_context_b1_allow_high(&context->b1, oscore_context_b1_get_wanted(&context->b1));
+
+    if (!respond_401echo && oscerr != OSCORE_UNPROTECT_REQUEST_OK) {
+        pthread_mutex_unlock(&context->usage);
+        if (oscerr == OSCORE_UNPROTECT_REQUEST_DUPLICATE) {
+            atomic_fetch_add(&server_stats.duplicate, 1);
+            set_error(response, CODE_UNAUTHORIZED);
+        } else {
+            atomic_fetch_add(&server_stats.bad, 1);
+            set_error(response, CODE_BAD_REQUEST);
+        }
+        return true;
+    }
+
+    uint8_t summary[6] = {0};
+    if (!respond_401echo) {
+        uint8_t *payload;
+        size_t payload_len;
+        oscore_msgerr_protected_t err = oscore_msg_protected_map_payload(&unprotected, &payload, &payload_len);
+        assert(!oscore_msgerr_protected_is_error(err));
+        (void)err;
+        uint32_t sum = 0;
+        for (size_t i = 0; i < payload_len; ++i) {
+            sum += payload[i];
+        }
+        summary[0] = payload_len >> 8;
+        summary[1] = payload_len;
+        summary[2] = sum >> 24;
+        summary[3] = sum >> 16;
+        summary[4] = sum >> 8;
+        summary[5] = sum;
+    }
+    oscore_release_unprotected(&unprotected);
+
+    bool success;
+    if (respond_401echo) {
+        success = oscore_context_b1_build_401echo(response, &context->secctx, &request_id);
+        if (success) {
+            atomic_fetch_add(&server_stats.echo, 1);
+        }
+    } else {
+        oscore_msg_protected_t plaintext;
+        success = oscore_prepare_response(response, &plaintext, &context->secctx, &request_id) == OSCORE_PREPARE_OK;
+        if (success) {
+            oscore_msg_protected_set_code(&plaintext, CODE_CONTENT);
+            const oscore_msg_protected_payloadpart_t part = {summary, sizeof(summary)};
+            oscore_msgerr_protected_t err = oscore_msg_protected_write_payload(&plaintext, &part, 1);
+            assert(!oscore_msgerr_protected_is_error(err));
+            (void)err;
+            oscore_msg_native_t out;
+            success = oscore_encrypt_message(&plaintext, &out) == OSCORE_FINISH_OK;
+        }
+        if (success) {
+            atomic_fetch_add(&server_stats.ok, 1);
+        }
+    }
+    pthread_mutex_unlock(&context->usage);
+
+    if (!success) {
+        atomic_fetch_add(&server_stats.failed, 1);
+        set_error(response, CODE_SERVICE_UNAVAILABLE);
+    }
+    return true;
+}
+
+static void *server_thread(void *arg)
+{
+    struct oscore_posix_udp_server *server = arg;
+    while (!atomic_load(&stop_server)) {
+        // Receiving times out regularly to look at the stop flag
+        if (!oscore_posix_udp_server_step(server, 0) && errno != EAGAIN && errno != EINTR) {
+            perror("Serving failed");
+            abort();
+        }
+    }
+    return NULL;
+}
+
+/* Clients */
+
+struct slot {
+    bool busy;
+    uint64_t token;
+    uint64_t sent;
+    oscore_requestid_t request_id;
+    uint32_t sum;
+};
+
+struct client {
+    int fd;
+    uint64_t rng;
+
+    struct oscore_context_primitive_immutables key;
+    struct oscore_context_primitive primitive;
+    oscore_context_t secctx;
+
+    /** Echo value to send until a request succeeds */
+    uint8_t echo[40];
+    size_t echo_len;
+
+    uint64_t next_token;
+    uint16_t next_message_id;
+    struct slot slots[LOADGEN_MAX_DEPTH];
+
+    /** A datagram held back to be sent after the next one */
+    uint8_t held[OSCORE_POSIX_UDP_MTU];
+    size_t held_len;
+
+    struct {
+        uint64_t sent;
+        uint64_t ok;
+        uint64_t echo;
+        uint64_t lost;
+        uint64_t stale;
+        uint64_t unavailable;
+        uint64_t rejected;
+        uint64_t failed;
+        uint64_t dropped;
+        uint64_t reordered;
+        uint64_t duplicated;
+    } stats;
+    uint64_t histogram[HISTOGRAM_BUCKETS];
+};
+
+static struct client clients[LOADGEN_MAX_CLIENTS];
+
+static bool chance(struct client *c, double probability)
+{
+    if (probability <= 0) {
+        return false;
+    }
+    // xorshift64*
+    c->rng ^= c->rng >> 12;
+    c->rng ^= c->rng << 25;
+    c->rng ^= c->rng >> 27;
+    uint64_t random = c->rng * 0x2545f4914f6cdd1dULL;
+    return (random >> 11) * (1.0 / 9007199254740992.0) < probability;
+}
+
+static void transmit(struct client *c, const uint8_t *data, size_t len)
+{
+    if (chance(c, config.loss)) {
+        c->stats.dropped += 1;
+        return;
+    }
+    if (c->held_len == 0 && chance(c, config.reorder)) {
+        memcpy(c->held, data, len);
+        c->held_len = len;
+        c->stats.reordered += 1;
+        return;
+    }
+    send(c->fd, data, len, 0);
+    if (chance(c, config.duplicate)) {
+        send(c->fd, data, len, 0);
+        c->stats.duplicated += 1;
+    }
+    if (c->held_len != 0) {
+        send(c->fd, c->held, c->held_len, 0);
+        c->held_len = 0;
+    }
+}
+
+static uint8_t pattern(uint64_t token, size_t index)
+{
+    return (token * 13 + index * 7) & 0xff;
+}
+
+static void send_request(struct client *c, struct slot *slot)
+{
+    uint8_t buf[OSCORE_POSIX_UDP_MTU];
+    slot->token = c->next_token++;
+    uint8_t token[8];
+    for (size_t i = 0; i < 8; ++i) {
+        token[i] = slot->token >> (56 - 8 * i);
+    }
+
+    struct oscore_posix_msg msg;
+    bool initialized = oscore_posix_msg_init_outgoing(&msg, buf, sizeof(buf), 1 /* NON */, c->next_message_id++, token, sizeof(token));
+    assert(initialized);
+    (void)initialized;
+
+    oscore_msg_protected_t plaintext;
+    enum oscore_prepare_result prepared = oscore_prepare_request(&msg, &plaintext, &c->secctx, &slot->request_id);
+    assert(prepared == OSCORE_PREPARE_OK);
+    (void)prepared;
+    oscore_msg_protected_set_code(&plaintext, CODE_POST);
+    oscore_msgerr_protected_t err = oscore_msg_protected_append_option(&plaintext, OPTION_URI_PATH, (const uint8_t *)"load", 4);
+    assert(!oscore_msgerr_protected_is_error(err));
+    if (c->echo_len != 0) {
+        err = oscore_msg_protected_append_option(&plaintext, OPTION_ECHO, c->echo, c->echo_len);
+        assert(!oscore_msgerr_protected_is_error(err));
+    }
+    uint8_t *payload;
+    size_t payload_len;
+    err = oscore_msg_protected_map_payload(&plaintext, &payload, &payload_len);
+    assert(!oscore_msgerr_protected_is_error(err) && payload_len >= config.payload);
+    slot->sum = 0;
+    for (size_t i = 0; i < config.payload; ++i) {
+        payload[i] = pattern(slot->token, i);
+        slot->sum += payload[i];
+    }
+    err = oscore_msg_protected_trim_payload(&plaintext, config.payload);
+    assert(!oscore_msgerr_protected_is_error(err));
+    (void)err;
+    oscore_msg_native_t out;
+    enum oscore_finish_result finished = oscore_encrypt_message(&plaintext, &out);
+    assert(finished == OSCORE_FINISH_OK);
+    (void)finished;
+
+    slot->busy = true;
+    slot->sent = now_ns();
+    c->stats.sent += 1;
+    transmit(c, buf, oscore_posix_msg_length(&msg));
+}
+
+static void handle_response(struct client *c, uint8_t *buf, size_t len)
+{
+    struct oscore_posix_msg msg;
+    if (!oscore_posix_msg_parse(&msg, buf, len)) {
+        c->stats.failed += 1;
+        return;
+    }
+
+    const uint8_t *token;
+    size_t token_len = oscore_posix_msg_get_token(&msg, &token);
+    struct slot *slot = NULL;
+    if (token_len == 8) {
+        uint64_t value = 0;
+        for (size_t i = 0; i < 8; ++i) {
+            value = (value << 8) | token[i];
+        }
+        for (size_t i = 0; i < config.depth; ++i) {
+            if (c->slots[i].busy && c->slots[i].token == value) {
+                slot = &c->slots[i];
+            }
+        }
+    }
+    if (slot == NULL) {
+        // Answer to a duplicate, or to a request that already timed out
+        c->stats.stale += 1;
+        return;
+    }
+    uint64_t latency = now_ns() - slot->sent;
+    slot->busy = false;
+
+    oscore_oscoreoption_t header;
+    bool found, parsed;
+    find_oscoreoption(&msg, &header, &found, &parsed);
+    if (!found) {
+        if (oscore_msg_native_get_code(&msg) == CODE_SERVICE_UNAVAILABLE) {
+            c->stats.unavailable += 1;
+        } else {
+            c->stats.rejected += 1;
+        }
+        return;
+    }
+
+    oscore_msg_protected_t unprotected;
+    if (!parsed || oscore_unprotect_response(&msg, &unprotected, header, &c->secctx, &slot->request_id) != OSCORE_UNPROTECT_RESPONSE_OK) {
+        c->stats.failed += 1;
+        return;
+    }
+
+    uint8_t code = oscore_msg_protected_get_code(&unprotected);
+    if (code == CODE_UNAUTHORIZED) {
+        oscore_msg_protected_optiter_t iter;
+        uint16_t number;
+        const uint8_t *value;
+        size_t value_len;
+        oscore_msg_protected_optiter_init(&unprotected, &iter);
+        while (oscore_msg_protected_optiter_next(&unprotected, &iter, &number, &value, &value_len)) {
+            if (number == OPTION_ECHO && value_len <= sizeof(c->echo)) {
+                memcpy(c->echo, value, value_len);
+                c->echo_len = value_len;
+            }
+        }
+        oscore_msg_protected_optiter_finish(&unprotected, &iter);
+        c->stats.echo += 1;
+    } else {
+        uint8_t *payload;
+        size_t payload_len;
+        oscore_msgerr_protected_t err = oscore_msg_protected_map_payload(&unprotected, &payload, &payload_len);
+        uint8_t expected[6] = {config.payload >> 8, config.payload,
+            slot->sum >> 24, slot->sum >> 16, slot->sum >> 8, slot->sum};
+        if (code == CODE_CONTENT && !oscore_msgerr_protected_is_error(err) &&
+                payload_len == sizeof(expected) && memcmp(payload, expected, sizeof(expected)) == 0) {
+            c->stats.ok += 1;
+            c->histogram[histogram_index(latency)] += 1;
+            c->echo_len = 0;
+        } else {
+            c->stats.failed += 1;
+        }
+    }
+    oscore_release_unprotected(&unprotected);
+}
+
+static void *client_thread(void *arg)
+{
+    struct client *c = arg;
+    uint64_t timeout = (uint64_t)config.timeout_ms * 1000000;
+
+    while (!atomic_load(&stop_clients)) {
+        for (size_t i = 0; i < config.depth; ++i) {
+            if (!c->slots[i].busy) {
+                send_request(c, &c->slots[i]);
+            }
+        }
+        if (c->held_len != 0 && config.depth == 1) {
+            // Nothing else will be sent before this is answered
+            send(c->fd, c->held, c->held_len, 0);
+            c->held_len = 0;
+        }
+
+        uint64_t now = now_ns();
+        uint64_t deadline = UINT64_MAX;
+        for (size_t i = 0; i < config.depth; ++i) {
+            if (c->slots[i].busy && c->slots[i].sent + timeout < deadline) {
+                deadline = c->slots[i].sent + timeout;
+            }
+        }
+        struct pollfd pollfd = { .fd = c->fd, .events = POLLIN };
+        int wait_ms = deadline > now ? (deadline - now + 999999) / 1000000 : 0;
+        if (poll(&pollfd, 1, wait_ms) > 0) {
+            uint8_t buf[OSCORE_POSIX_UDP_MTU];
+            ssize_t received;
+            while ((received = recv(c->fd, buf, sizeof(buf), MSG_DONTWAIT)) > 0) {
+                if (chance(c, config.loss)) {
+                    c->stats.dropped += 1;
+                    continue;
+                }
+                handle_response(c, buf, received);
+            }
+        }
+
+        now = now_ns();
+        for (size_t i = 0; i < config.depth; ++i) {
+            if (c->slots[i].busy && c->slots[i].sent + timeout <= now) {
+                c->slots[i].busy = false;
+                c->stats.lost += 1;
+            }
+        }
+    }
+    return NULL;
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  -c N  number of clients (default %zu, at most %d)\n"
+            "  -t N  number of server threads (default %zu, at most %d)\n"
+            "  -p N  requests each client keeps in flight (default %zu, at most %d)\n"
+            "  -s N  request payload size (default %zu)\n"
+            "  -a N  COSE number of the AEAD algorithm (default %ld)\n"
+            "  -d N  duration in seconds (default %u)\n"
+            "  -T N  time in ms after which a request counts as lost (default %u)\n"
+            "  -l P  percentage of datagrams dropped\n"
+            "  -r P  percentage of datagrams sent after the next one\n"
+            "  -u P  percentage of datagrams sent twice\n"
+            "  -S N  random seed\n",
+            name, config.clients, LOADGEN_MAX_CLIENTS, config.server_threads,
+            LOADGEN_MAX_SERVER_THREADS, config.depth, LOADGEN_MAX_DEPTH,
+            config.payload, (long)config.alg, config.duration, config.timeout_ms);
+}
+
+int main(int argc, char *argv[])
+{
+    int opt;
+    while ((opt = getopt(argc, argv, "c:t:p:s:a:d:T:l:r:u:S:h")) != -1) {
+        switch (opt) {
+        case 'c': config.clients = strtoul(optarg, NULL, 0); break;
+        case 't': config.server_threads = strtoul(optarg, NULL, 0); break;
+        case 'p': config.depth = strtoul(optarg, NULL, 0); break;
+        case 's': config.payload = strtoul(optarg, NULL, 0); break;
+        case 'a': config.alg = strtol(optarg, NULL, 0); break;
+        case 'd': config.duration = strtoul(optarg, NULL, 0); break;
+        case 'T': config.timeout_ms = strtoul(optarg, NULL, 0); break;
+        case 'l': config.loss = strtod(optarg, NULL) / 100; break;
+        case 'r': config.reorder = strtod(optarg, NULL) / 100; break;
+        case 'u': config.duplicate = strtod(optarg, NULL) / 100; break;
+        case 'S': config.seed = strtoull(optarg, NULL, 0); break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    oscore_crypto_aeadalg_t aeadalg;
+    if (config.clients < 1 || config.clients > LOADGEN_MAX_CLIENTS ||
+            config.server_threads < 1 || config.server_threads > LOADGEN_MAX_SERVER_THREADS ||
+            config.depth < 1 || config.depth > LOADGEN_MAX_DEPTH ||
+            config.payload > 1024 ||
+            oscore_cryptoerr_is_error(oscore_crypto_aead_from_number(&aeadalg, config.alg))) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    oscore_crypto_hkdfalg_t hkdfalg;
+    if (oscore_cryptoerr_is_error(oscore_crypto_hkdf_from_number(&hkdfalg, 5))) {
+        fprintf(stderr, "HKDF SHA-256 is not supported by the crypto backend\n");
+        return 1;
+    }
+    uint8_t echo_key[OSCORE_ECHO_KEY_LEN];
+    if (getrandom(echo_key, sizeof(echo_key), 0) != sizeof(echo_key)) {
+        perror("getrandom");
+        return 1;
+    }
+    oscore_echo_init(&server_echo, hkdfalg, echo_key, 1);
+
+    for (size_t i = 0; i < config.clients; ++i) {
+        struct server_context *context = &server_contexts[i];
+        derive_key(&context->key, i, true);
+        oscore_context_b1_initialize(&context->b1, &context->key, 0, NULL);
+        oscore_context_b1_set_stateless_echo(&context->b1, &server_echo);
+        oscore_context_b1_allow_high(&context->b1, oscore_context_b1_get_wanted(&context->b1));
+        context->secctx = (oscore_context_t){ .type = OSCORE_CONTEXT_B1, .data = (void*)&context->b1 };
+        pthread_mutex_init(&context->usage, NULL);
+    }
+
+    int server_fd = socket(AF_INET6, SOCK_DGRAM, 0);
+    struct sockaddr_in6 server_addr = { .sin6_family = AF_INET6, .sin6_addr = IN6ADDR_LOOPBACK_INIT };
+    socklen_t server_addr_len = sizeof(server_addr);
+    if (server_fd < 0 ||
+            bind(server_fd, (struct sockaddr *)&server_addr, sizeof(server_addr)) != 0 ||
+            getsockname(server_fd, (struct sockaddr *)&server_addr, &server_addr_len) != 0) {
+        perror("Creating server socket");
+        return 1;
+    }
+    struct timeval tick = { .tv_usec = 100000 };
+    setsockopt(server_fd, SOL_SOCKET, SO_RCVTIMEO, &tick, sizeof(tick));
+
+    for (size_t i = 0; i < config.clients; ++i) {
+        struct client *c = &clients[i];
+        c->fd = socket(AF_INET6, SOCK_DGRAM, 0);
+        if (c->fd < 0 || connect(c->fd, (struct sockaddr *)&server_addr, server_addr_len) != 0) {
+            perror("Creating client socket");
+            return 1;
+        }
+        // xorshift needs a non-zero state
+        c->rng = (config.seed ^ (i + 1) * 0x9e3779b97f4a7c15ULL) | 1;
+        derive_key(&c->key, i, false);
+        c->primitive = (struct oscore_context_primitive){ .immutables = &c->key };
+        c->secctx = (oscore_context_t){ .type = OSCORE_CONTEXT_PRIMITIVE, .data = (void*)&c->primitive };
+    }
+
+    pthread_t server_threads[LOADGEN_MAX_SERVER_THREADS];
+    pthread_t client_threads[LOADGEN_MAX_CLIENTS];
+    for (size_t i = 0; i < config.server_threads; ++i) {
+        oscore_posix_udp_server_init(&servers[i], server_fd, server_handler, NULL);
+        pthread_create(&server_threads[i], NULL, server_thread, &servers[i]);
+    }
+    uint64_t start = now_ns();
+    for (size_t i = 0; i < config.clients; ++i) {
+        pthread_create(&client_threads[i], NULL, client_thread, &clients[i]);
+    }
+
+    sleep(config.duration);
+    atomic_store(&stop_clients, true);
+    double elapsed = (now_ns() - start) / 1e9;
+    for (size_t i = 0; i < config.clients; ++i) {
+        pthread_join(client_threads[i], NULL);
+    }
+    atomic_store(&stop_server, true);
+    for (size_t i = 0; i < config.server_threads; ++i) {
+        pthread_join(server_threads[i], NULL);
+    }
+
+    static uint64_t histogram[HISTOGRAM_BUCKETS];
+    struct client total = {0};
+    for (size_t i = 0; i < config.clients; ++i) {
+        struct client *c = &clients[i];
+        total.stats.sent += c->stats.sent;
+        total.stats.ok += c->stats.ok;
+        total.stats.echo += c->stats.echo;
+        total.stats.lost += c->stats.lost;
+        total.stats.stale += c->stats.stale;
+        total.stats.unavailable += c->stats.unavailable;
+        total.stats.rejected += c->stats.rejected;
+        total.stats.failed += c->stats.failed;
+        total.stats.dropped += c->stats.dropped;
+        total.stats.reordered += c->stats.reordered;
+        total.stats.duplicated += c->stats.duplicated;
+        for (size_t j = 0; j < HISTOGRAM_BUCKETS; ++j) {
+            histogram[j] += c->histogram[j];
+        }
+        close(c->fd);
+    }
+    close(server_fd);
+
+    printf("clients,server_threads,depth,payload,alg,seconds,sent,ok,requests_per_s,"
+            "p50_us,p99_us,p999_us,echo,lost,stale,unavailable,rejected,failed,"
+            "dropped,reordered,duplicated,server_ok,server_echo,server_duplicate,server_busy,server_bad,server_failed\n");
+    printf("%zu,%zu,%zu,%zu,%ld,%.3f,%llu,%llu,%.0f,%.1f,%.1f,%.1f,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%lu,%lu,%lu,%lu,%lu,%lu\n",
+            config.clients, config.server_threads, config.depth, config.payload, (long)config.alg, elapsed,
+            (unsigned long long)total.stats.sent, (unsigned long long)total.stats.ok, total.stats.ok / elapsed,
+            histogram_percentile(histogram, total.stats.ok, 50) / 1e3,
+            histogram_percentile(histogram, total.stats.ok, 99) / 1e3,
+            histogram_percentile(histogram, total.stats.ok, 99.9) / 1e3,
+            (unsigned long long)total.stats.echo, (unsigned long long)total.stats.lost,
+            (unsigned long long)total.stats.stale, (unsigned long long)total.stats.unavailable,
+            (unsigned long long)total.stats.rejected, (unsigned long long)total.stats.failed,
+            (unsigned long long)total.stats.dropped, (unsigned long long)total.stats.reordered,
+            (unsigned long long)total.stats.duplicated,
+            atomic_load(&server_stats.ok), atomic_load(&server_stats.echo),
+            atomic_load(&server_stats.duplicate), atomic_load(&server_stats.busy),
+            atomic_load(&server_stats.bad), atomic_load(&server_stats.failed));
+
+    return total.stats.failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,840 @@
+/* Offline replay of captured OSCORE traffic
+ *
+ * This reads a pcap or pcapng capture of CoAP over UDP, and feeds every
+ * datagram through the protection path as a server and its clients would:
+ * requests are parsed and unprotected with the server's view of the security
+ * context their KID (and KID context) selects, and responses are unprotected
+ * with the client's view, using the request ID of the request with the same
+ * token between the same endpoints. Optionally (`-r`), every unprotected
+ * response is protected again as the server would have built it; nothing is
+ * sent, so the sequence numbers and nonces used there do not matter.
+ *
+ * Each phase is timed, and the results are printed as CSV, with a row for
+ * every outcome of a phase (eg. how many requests the replay window accepted
+ * or rejected as duplicates). With `-n`, the capture is replayed several times
+ * with freshly derived contexts; the counts and times are summed up.
+ *
+ * Security contexts are described in a text file, one per line:
+ *
+ *     # alg and hkdf default to 10 (AES-CCM-16-64-128) and 5 (HKDF SHA-256)
+ *     alg=10 secret=0102030405060708090a0b0c0d0e0f10 salt=9e7ca92223786340 client= server=01
+ *     secret=0102030405060708090a0b0c0d0e0f10 idcontext=37cbf3210017a2d3 client=01 server=
+ *
+ * `client` and `server` are the Sender IDs of the respective side, and are
+ * required; `idcontext` is only used if present. All values are hex encoded.
+ *
+ * Supported link layers are Ethernet (with VLAN tags), Linux cooked capture
+ * (v1 and v2), BSD loopback and raw IP. Fragmented IP packets are skipped.
+ *
+ * This needs the posix backend, and is best built without sanitizers:
+ *
+ *     make clean
+ *     make pcap-replay TESTS_BACKEND=posix OPTFLAGS=-O2 TESTS_SANITIZE=no
+ *     ./pcap-replay contexts.txt capture.pcapng
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <oscore_native/message.h>
+#include <oscore/protection.h>
+#include <oscore/contextpair.h>
+#include <oscore/context_impl/primitive.h>
+#include <oscore/message.h>
+#include <oscore_posix/msg.h>
+
+#ifndef REPLAY_MAX_CONTEXTS
+#define REPLAY_MAX_CONTEXTS 64
+#endif
+
+/** Number of requests remembered for finding the request ID of a response;
+ * a request is forgotten when a later one lands in the same slot */
+#ifndef REPLAY_EXCHANGES
+#define REPLAY_EXCHANGES 16384
+#endif
+
+#define OPTION_OSCORE 9
+
+/* Configuration */
+
+struct context_pair {
+    int32_t alg;
+    int32_t hkdf;
+    uint8_t secret[64];
+    size_t secret_len;
+    uint8_t salt[64];
+    size_t salt_len;
+    bool has_id_context;
+    uint8_t id_context[32];
+    size_t id_context_len;
+
+    /** Contexts as seen by the server and by the client */
+    struct oscore_context_primitive_immutables server_key;
+    struct oscore_context_primitive_immutables client_key;
+    struct oscore_context_primitive server_primitive;
+    struct oscore_context_primitive client_primitive;
+    oscore_context_t server;
+    oscore_context_t client;
+};
+
+static struct context_pair pairs[REPLAY_MAX_CONTEXTS];
+static size_t pair_count;
+
+/** Decode a hex string into @p out
+ *
+ * @return false if the string is not hex or too long
+ */
+static bool parse_hex(const char *text, uint8_t *out, size_t out_size, size_t *out_len)
+{
+    size_t len = strlen(text);
+    if (len % 2 != 0 || len / 2 > out_size) {
+        return false;
+    }
+    for (size_t i = 0; i < len / 2; ++i) {
+        unsigned value;
+        if (!isxdigit((unsigned char)text[2 * i]) || !isxdigit((unsigned char)text[2 * i + 1]) ||
+                sscanf(&text[2 * i], "%2x", &value) != 1) {
+            return false;
+        }
+        out[i] = value;
+    }
+    *out_len = len / 2;
+    return true;
+}
+
+/** Parse a context file
+ *
+ * @return false (after printing the reason) if the file is unusable
+ */
+static bool load_contexts(const char *filename)
+{
+    FILE *file = fopen(filename, "r");
+    if (file == NULL) {
+        perror(filename);
+        return false;
+    }
+
+    char line[1024];
+    size_t lineno = 0;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        lineno += 1;
+        char *comment = strchr(line, '#');
+        if (comment != NULL) {
+            *comment = '\0';
+        }
+
+        struct context_pair parsed = { .alg = 10, .hkdf = 5 };
+        bool has_client = false, has_server = false, has_any = false, ok = true;
+        for (char *token = strtok(line, " \t\r\n"); token != NULL; token = strtok(NULL, " \t\r\n")) {
+            has_any = true;
+            char *value = strchr(token, '=');
+            if (value == NULL) {
+                ok = false;
+                break;
+            }
+            *value++ = '\0';
+            if (strcmp(token, "alg") == 0) {
+                parsed.alg = strtol(value, NULL, 0);
+            } else if (strcmp(token, "hkdf") == 0) {
+                parsed.hkdf = strtol(value, NULL, 0);
+            } else if (strcmp(token, "secret") == 0) {
+                ok = parse_hex(value, parsed.secret, sizeof(parsed.secret), &parsed.secret_len);
+            } else if (strcmp(token, "salt") == 0) {
+                ok = parse_hex(value, parsed.salt, sizeof(parsed.salt), &parsed.salt_len);
+            } else if (strcmp(token, "idcontext") == 0) {
+                ok = parse_hex(value, parsed.id_context, sizeof(parsed.id_context), &parsed.id_context_len);
+                parsed.has_id_context = true;
+            } else if (strcmp(token, "client") == 0) {
+                ok = parse_hex(value, parsed.client_key.sender_id, OSCORE_KEYID_MAXLEN, &parsed.client_key.sender_id_len);
+                has_client = true;
+            } else if (strcmp(token, "server") == 0) {
+                ok = parse_hex(value, parsed.server_key.sender_id, OSCORE_KEYID_MAXLEN, &parsed.server_key.sender_id_len);
+                has_server = true;
+            } else {
+                ok = false;
+            }
+            if (!ok) {
+                break;
+            }
+        }
+        if (!has_any) {
+            continue;
+        }
+        if (!ok || !has_client || !has_server || parsed.secret_len == 0) {
+            fprintf(stderr, "%s:%zu: Invalid context description\n", filename, lineno);
+            fclose(file);
+            return false;
+        }
+        if (pair_count == REPLAY_MAX_CONTEXTS) {
+            fprintf(stderr, "%s:%zu: Too many contexts\n", filename, lineno);
+            fclose(file);
+            return false;
+        }
+
+        struct context_pair *pair = &pairs[pair_count];
+        *pair = parsed;
+        memcpy(pair->client_key.recipient_id, pair->server_key.sender_id, pair->server_key.sender_id_len);
+        pair->client_key.recipient_id_len = pair->server_key.sender_id_len;
+        memcpy(pair->server_key.recipient_id, pair->client_key.sender_id, pair->client_key.sender_id_len);
+        pair->server_key.recipient_id_len = pair->client_key.sender_id_len;
+        pair_count += 1;
+    }
+    fclose(file);
+
+    if (pair_count == 0) {
+        fprintf(stderr, "%s: No contexts described\n", filename);
+        return false;
+    }
+    return true;
+}
+
+/** Derive the keys of all contexts, which also resets their sequence numbers
+ * and replay windows
+ *
+ * @return false (after printing the reason) if an algorithm is not supported
+ */
+static bool derive_contexts(void)
+{
+    for (size_t i = 0; i < pair_count; ++i) {
+        struct context_pair *pair = &pairs[i];
+        oscore_crypto_hkdfalg_t hkdfalg;
+        if (oscore_cryptoerr_is_error(oscore_crypto_aead_from_number(&pair->server_key.aeadalg, pair->alg)) ||
+                oscore_cryptoerr_is_error(oscore_crypto_aead_from_number(&pair->client_key.aeadalg, pair->alg)) ||
+                oscore_cryptoerr_is_error(oscore_crypto_hkdf_from_number(&hkdfalg, pair->hkdf))) {
+            fprintf(stderr, "Context %zu: Algorithm not supported by the crypto backend\n", i + 1);
+            return false;
+        }
+        const uint8_t *id_context = pair->has_id_context ? pair->id_context : NULL;
+        if (oscore_cryptoerr_is_error(oscore_context_primitive_derive(&pair->server_key, hkdfalg,
+                        pair->salt, pair->salt_len, pair->secret, pair->secret_len,
+                        id_context, pair->id_context_len)) ||
+                oscore_cryptoerr_is_error(oscore_context_primitive_derive(&pair->client_key, hkdfalg,
+                        pair->salt, pair->salt_len, pair->secret, pair->secret_len,
+                        id_context, pair->id_context_len))) {
+            fprintf(stderr, "Context %zu: Key derivation failed\n", i + 1);
+            return false;
+        }
+        pair->server_primitive = (struct oscore_context_primitive){ .immutables = &pair->server_key };
+        pair->client_primitive = (struct oscore_context_primitive){ .immutables = &pair->client_key };
+        pair->server = (oscore_context_t){ .type = OSCORE_CONTEXT_PRIMITIVE, .data = (void*)&pair->server_primitive };
+        pair->client = (oscore_context_t){ .type = OSCORE_CONTEXT_PRIMITIVE, .data = (void*)&pair->client_primitive };
+    }
+    return true;
+}
+
+/** Find the context a request is protected with */
+static struct context_pair *find_pair(const oscore_oscoreoption_t *header)
+{
+    // Like in the plugtest server's intermediate integration, this accesses
+    // the KID directly
+    if (header->kid == NULL) {
+        return NULL;
+    }
+    for (size_t i = 0; i < pair_count; ++i) {
+        struct context_pair *pair = &pairs[i];
+        if (header->kid_len != pair->server_key.recipient_id_len ||
+                memcmp(header->kid, pair->server_key.recipient_id, header->kid_len) != 0) {
+            continue;
+        }
+        if (header->kid_context != NULL && (!pair->has_id_context ||
+                    header->kid_context_len != pair->id_context_len ||
+                    memcmp(header->kid_context, pair->id_context, pair->id_context_len) != 0)) {
+            continue;
+        }
+        return pair;
+    }
+    return NULL;
+}
+
+/* Statistics */
+
+enum phase {
+    PHASE_PARSE,
+    PHASE_UNPROTECT_REQUEST,
+    PHASE_UNPROTECT_RESPONSE,
+    PHASE_REPROTECT_RESPONSE,
+    PHASE_COUNT,
+};
+
+static const char *const phase_names[PHASE_COUNT] = {
+    "parse",
+    "unprotect_request",
+    "unprotect_response",
+    "reprotect_response",
+};
+
+enum verdict {
+    /** Parsed as OSCORE message; unprotected or protected successfully */
+    VERDICT_OK,
+    /** Not a CoAP message */
+    VERDICT_NOT_COAP,
+    /** CoAP message without OSCORE option */
+    VERDICT_PLAIN,
+    /** Unparsable OSCORE option */
+    VERDICT_BAD_OPTION,
+    /** No configured context matches the request's KID */
+    VERDICT_NO_CONTEXT,
+    /** Rejected by the replay window */
+    VERDICT_DUPLICATE,
+    /** Failed to decrypt, or to protect */
+    VERDICT_INVALID,
+    /** No request was seen for the response */
+    VERDICT_UNMATCHED,
+    VERDICT_COUNT,
+};
+
+static const char *const verdict_names[VERDICT_COUNT] = {
+    "ok",
+    "not_coap",
+    "plain",
+    "bad_option",
+    "no_context",
+    "duplicate",
+    "invalid",
+    "unmatched",
+};
+
+static struct {
+    uint64_t count;
+    uint64_t ns;
+} stats[PHASE_COUNT][VERDICT_COUNT];
+
+static struct {
+    uint64_t packets;
+    uint64_t datagrams;
+    uint64_t skipped;
+} capture_stats;
+
+static uint64_t now_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static void record(enum phase phase, enum verdict verdict, uint64_t start)
+{
+    stats[phase][verdict].count += 1;
+    stats[phase][verdict].ns += now_ns() - start;
+}
+
+/* Exchanges */
+
+/** Addresses (IPv4 ones mapped to IPv6) and ports of a client and a server */
+struct endpoints {
+    uint8_t client[18];
+    uint8_t server[18];
+};
+
+struct exchange {
+    bool used;
+    struct endpoints endpoints;
+    uint8_t token[8];
+    size_t token_len;
+    struct context_pair *pair;
+    oscore_requestid_t request_id;
+    /** Copy of the request ID used (and updated) by re-protection */
+    oscore_requestid_t reprotect_request_id;
+};
+
+static struct exchange exchanges[REPLAY_EXCHANGES];
+
+static struct exchange *exchange_slot(const struct endpoints *endpoints, const uint8_t *token, size_t token_len)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    const uint8_t *bytes = (const uint8_t *)endpoints;
+    for (size_t i = 0; i < sizeof(*endpoints); ++i) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    for (size_t i = 0; i < token_len; ++i) {
+        hash = (hash ^ token[i]) * 16777619u;
+    }
+    return &exchanges[hash % REPLAY_EXCHANGES];
+}
+
+/* Processing */
+
+static bool reprotect = false;
+
+/** Build a response from the unprotected content of @p unprotected, as the
+ * server would have protected it */
+static void reprotect_response(struct oscore_posix_msg *captured, oscore_msg_protected_t *unprotected, struct exchange *exchange)
+{
+    uint64_t start = now_ns();
+
+    uint8_t buf[2048];
+    struct oscore_posix_msg msg;
+    const uint8_t *token;
+    size_t token_len = oscore_posix_msg_get_token(captured, &token);
+    bool ok = oscore_posix_msg_init_outgoing(&msg, buf, sizeof(buf),
+            oscore_posix_msg_get_type(captured), oscore_posix_msg_get_message_id(captured),
+            token, token_len);
+
+    oscore_msg_protected_t plaintext;
+    ok = ok && oscore_prepare_response(&msg, &plaintext, &exchange->pair->server, &exchange->reprotect_request_id) == OSCORE_PREPARE_OK;
+    if (!ok) {
+        record(PHASE_REPROTECT_RESPONSE, VERDICT_INVALID, start);
+        return;
+    }
+
+    oscore_msg_protected_set_code(&plaintext, oscore_msg_protected_get_code(unprotected));
+    oscore_msg_protected_optiter_t iter;
+    uint16_t number;
+    const uint8_t *value;
+    size_t value_len;
+    oscore_msg_protected_optiter_init(unprotected, &iter);
+    while (oscore_msg_protected_optiter_next(unprotected, &iter, &number, &value, &value_len)) {
+        ok = ok && !oscore_msgerr_protected_is_error(oscore_msg_protected_append_option(&plaintext, number, value, value_len));
+    }
+    ok = !oscore_msgerr_protected_is_error(oscore_msg_protected_optiter_finish(unprotected, &iter)) && ok;
+
+    uint8_t *payload;
+    size_t payload_len;
+    ok = ok && !oscore_msgerr_protected_is_error(oscore_msg_protected_map_payload(unprotected, &payload, &payload_len));
+    const oscore_msg_protected_payloadpart_t part = {payload, payload_len};
+    ok = ok && !oscore_msgerr_protected_is_error(oscore_msg_protected_write_payload(&plaintext, &part, 1));
+    if (!ok) {
+        // The message is not sent, so it can just be dropped
+        oscore_msg_protected_trim_payload(&plaintext, 0);
+    }
+
+    oscore_msg_native_t out;
+    ok = oscore_encrypt_message(&plaintext, &out) == OSCORE_FINISH_OK && ok;
+    record(PHASE_REPROTECT_RESPONSE, ok ? VERDICT_OK : VERDICT_INVALID, start);
+}
+
+static void process_datagram(const struct endpoints *source_dest, uint8_t *data, size_t len)
+{
+    capture_stats.datagrams += 1;
+
+    uint64_t start = now_ns();
+    struct oscore_posix_msg msg;
+    if (!oscore_posix_msg_parse(&msg, data, len)) {
+        record(PHASE_PARSE, VERDICT_NOT_COAP, start);
+        return;
+    }
+    oscore_oscoreoption_t header;
+    bool found = false, parsed = false;
+    oscore_msg_native_optiter_t iter;
+    uint16_t number;
+    const uint8_t *value;
+    size_t value_length;
+    oscore_msg_native_optiter_init(&msg, &iter);
+    while (oscore_msg_native_optiter_next(&msg, &iter, &number, &value, &value_length)) {
+        if (number == OPTION_OSCORE) {
+            found = true;
+            parsed = oscore_oscoreoption_parse(&header, value, value_length);
+        }
+    }
+    oscore_msg_native_optiter_finish(&msg, &iter);
+    uint8_t code = oscore_msg_native_get_code(&msg);
+    if (!found) {
+        record(PHASE_PARSE, VERDICT_PLAIN, start);
+        return;
+    }
+    if (!parsed) {
+        record(PHASE_PARSE, VERDICT_BAD_OPTION, start);
+        return;
+    }
+    record(PHASE_PARSE, VERDICT_OK, start);
+
+    const uint8_t *token;
+    size_t token_len = oscore_posix_msg_get_token(&msg, &token);
+    oscore_msg_protected_t unprotected;
+
+    if (code >= 0x01 && code < 0x20) {
+        struct context_pair *pair = find_pair(&header);
+        if (pair == NULL) {
+            stats[PHASE_UNPROTECT_REQUEST][VERDICT_NO_CONTEXT].count += 1;
+            return;
+        }
+
+        oscore_requestid_t request_id;
+        start = now_ns();
+        enum oscore_unprotect_request_result result = oscore_unprotect_request(&msg, &unprotected, header, &pair->server, &request_id);
+        if (result == OSCORE_UNPROTECT_REQUEST_INVALID) {
+            record(PHASE_UNPROTECT_REQUEST, VERDICT_INVALID, start);
+            return;
+        }
+        oscore_release_unprotected(&unprotected);
+        record(PHASE_UNPROTECT_REQUEST, result == OSCORE_UNPROTECT_REQUEST_OK ? VERDICT_OK : VERDICT_DUPLICATE, start);
+
+        struct exchange *exchange = exchange_slot(source_dest, token, token_len);
+        exchange->used = true;
+        exchange->endpoints = *source_dest;
+        memcpy(exchange->token, token, token_len);
+        exchange->token_len = token_len;
+        exchange->pair = pair;
+        exchange->request_id = request_id;
+        exchange->reprotect_request_id = request_id;
+    } else if (code >= 0x40) {
+        // Looked up from the request's point of view
+        struct endpoints reversed;
+        memcpy(reversed.client, source_dest->server, sizeof(reversed.client));
+        memcpy(reversed.server, source_dest->client, sizeof(reversed.server));
+        struct exchange *exchange = exchange_slot(&reversed, token, token_len);
+        if (!exchange->used || exchange->token_len != token_len ||
+                memcmp(exchange->token, token, token_len) != 0 ||
+                memcmp(&exchange->endpoints, &reversed, sizeof(reversed)) != 0) {
+            stats[PHASE_UNPROTECT_RESPONSE][VERDICT_UNMATCHED].count += 1;
+            return;
+        }
+
+        start = now_ns();
+        enum oscore_unprotect_response_result result = oscore_unprotect_response(&msg, &unprotected, header, &exchange->pair->client, &exchange->request_id);
+        if (result != OSCORE_UNPROTECT_RESPONSE_OK) {
+            record(PHASE_UNPROTECT_RESPONSE, VERDICT_INVALID, start);
+            return;
+        }
+        record(PHASE_UNPROTECT_RESPONSE, VERDICT_OK, start);
+
+        if (reprotect) {
+            reprotect_response(&msg, &unprotected, exchange);
+        }
+        oscore_release_unprotected(&unprotected);
+    }
+}
+
+/* Capture parsing */
+
+static uint16_t get16(const uint8_t *data, bool swap)
+{
+    uint16_t value;
+    memcpy(&value, data, 2);
+    return swap ? __builtin_bswap16(value) : value;
+}
+
+static uint32_t get32(const uint8_t *data, bool swap)
+{
+    uint32_t value;
+    memcpy(&value, data, 4);
+    return swap ? __builtin_bswap32(value) : value;
+}
+
+/** Network byte order */
+static uint16_t get16be(const uint8_t *data)
+{
+    return data[0] << 8 | data[1];
+}
+
+static void process_udp(const uint8_t *source, const uint8_t *destination, size_t address_len, uint8_t *data, size_t len)
+{
+    if (len < 8) {
+        capture_stats.skipped += 1;
+        return;
+    }
+    size_t udp_len = get16be(&data[4]);
+    if (udp_len < 8 || udp_len > len) {
+        // Truncated by the capture
+        capture_stats.skipped += 1;
+        return;
+    }
+
+    // Addresses are stored as IPv6, mapping IPv4 ones
+    struct endpoints endpoints = { .client = {0}, .server = {0} };
+    if (address_len == 4) {
+        endpoints.client[10] = endpoints.client[11] = 0xff;
+        endpoints.server[10] = endpoints.server[11] = 0xff;
+    }
+    memcpy(&endpoints.client[16 - address_len], source, address_len);
+    memcpy(&endpoints.server[16 - address_len], destination, address_len);
+    memcpy(&endpoints.client[16], &data[0], 2);
+    memcpy(&endpoints.server[16], &data[2], 2);
+
+    process_datagram(&endpoints, &data[8], udp_len - 8);
+}
+
+static void process_ip(uint8_t *data, size_t len)
+{
+    if (len < 1) {
+        capture_stats.skipped += 1;
+        return;
+    }
+    if (data[0] >> 4 == 4) {
+        size_t header_len = (data[0] & 0x0f) * 4;
+        if (len < 20 || header_len < 20 || header_len > len ||
+                (get16be(&data[6]) & 0x3fff) != 0 /* fragmented */ ||
+                data[9] != 17 /* UDP */) {
+            capture_stats.skipped += 1;
+            return;
+        }
+        size_t total_len = get16be(&data[2]);
+        if (total_len < header_len || total_len > len) {
+            capture_stats.skipped += 1;
+            return;
+        }
+        process_udp(&data[12], &data[16], 4, &data[header_len], total_len - header_len);
+    } else if (data[0] >> 4 == 6) {
+        if (len < 40) {
+            capture_stats.skipped += 1;
+            return;
+        }
+        size_t total_len = 40 + get16be(&data[4]);
+        if (total_len > len) {
+            capture_stats.skipped += 1;
+            return;
+        }
+        uint8_t next = data[6];
+        size_t offset = 40;
+        // Skip hop-by-hop, routing and destination options headers
+        while (next == 0 || next == 43 || next == 60) {
+            if (offset + 8 > total_len) {
+                capture_stats.skipped += 1;
+                return;
+            }
+            next = data[offset];
+            offset += 8 + data[offset + 1] * 8;
+        }
+        if (next != 17 || offset > total_len) {
+            capture_stats.skipped += 1;
+            return;
+        }
+        process_udp(&data[8], &data[24], 16, &data[offset], total_len - offset);
+    } else {
+        capture_stats.skipped += 1;
+    }
+}
+
+/** Strip the link layer header of a captured packet */
+static void process_packet(uint32_t linktype, uint8_t *data, size_t len)
+{
+    capture_stats.packets += 1;
+
+    uint16_t ethertype;
+    size_t offset;
+    switch (linktype) {
+    case 0: // BSD loopback: address family in the capturing host's byte order
+        if (len < 4) {
+            break;
+        }
+        process_ip(&data[4], len - 4);
+        return;
+    case 1: // Ethernet
+        offset = 12;
+        if (len < offset + 2) {
+            break;
+        }
+        ethertype = get16be(&data[offset]);
+        while ((ethertype == 0x8100 || ethertype == 0x88a8) && len >= offset + 6) {
+            offset += 4;
+            ethertype = get16be(&data[offset]);
+        }
+        offset += 2;
+        if (ethertype != 0x0800 && ethertype != 0x86dd) {
+            break;
+        }
+        process_ip(&data[offset], len - offset);
+        return;
+    case 101: // Raw IP
+    case 228: // Raw IPv4
+    case 229: // Raw IPv6
+        process_ip(data, len);
+        return;
+    case 113: // Linux cooked capture
+        if (len < 16) {
+            break;
+        }
+        process_ip(&data[16], len - 16);
+        return;
+    case 276: // Linux cooked capture v2
+        if (len < 20) {
+            break;
+        }
+        process_ip(&data[20], len - 20);
+        return;
+    }
+    capture_stats.skipped += 1;
+}
+
+/** Iterate over the packets of a classic pcap file */
+static bool process_pcap(uint8_t *data, size_t len)
+{
+    uint32_t magic = get32(data, false);
+    bool swap = magic == 0xd4c3b2a1 || magic == 0x4d3cb2a1;
+    uint32_t linktype = get32(&data[20], swap) & 0x0fffffff;
+
+    size_t offset = 24;
+    while (offset + 16 <= len) {
+        size_t captured = get32(&data[offset + 8], swap);
+        offset += 16;
+        if (captured > len - offset) {
+            // Typically a capture that is still being written
+            fprintf(stderr, "Capture is truncated, ignoring the last packet\n");
+            break;
+        }
+        process_packet(linktype, &data[offset], captured);
+        offset += captured;
+    }
+    return true;
+}
+
+/** Iterate over the packets of a pcapng file */
+static bool process_pcapng(uint8_t *data, size_t len)
+{
+    // Link types of the interfaces of the current section
+    uint32_t linktypes[64];
+    size_t interfaces = 0;
+    bool swap = false;
+
+    size_t offset = 0;
+    while (offset + 12 <= len) {
+        uint32_t type = get32(&data[offset], swap);
+        if (type == 0x0a0d0d0a) {
+            // Section header: byte order and interfaces start anew
+            uint32_t byte_order = get32(&data[offset + 8], false);
+            if (byte_order != 0x1a2b3c4d && byte_order != 0x4d3c2b1a) {
+                fprintf(stderr, "Malformed pcapng section header\n");
+                return false;
+            }
+            swap = byte_order == 0x4d3c2b1a;
+            interfaces = 0;
+        }
+        size_t block_len = get32(&data[offset + 4], swap);
+        if (block_len < 12 || block_len % 4 != 0) {
+            fprintf(stderr, "Malformed pcapng block\n");
+            return false;
+        }
+        if (block_len > len - offset) {
+            fprintf(stderr, "Capture is truncated, ignoring the last block\n");
+            break;
+        }
+        uint8_t *body = &data[offset + 8];
+        size_t body_len = block_len - 12;
+
+        switch (type) {
+        case 1: // Interface description
+            if (body_len >= 2 && interfaces < sizeof(linktypes) / sizeof(linktypes[0])) {
+                linktypes[interfaces++] = get16(body, swap);
+            }
+            break;
+        case 6: // Enhanced packet
+            if (body_len >= 20) {
+                uint32_t interface = get32(body, swap);
+                size_t captured = get32(&body[12], swap);
+                if (interface < interfaces && captured <= body_len - 20) {
+                    process_packet(linktypes[interface], &body[20], captured);
+                }
+            }
+            break;
+        case 3: // Simple packet, always on the first interface
+            if (body_len >= 4 && interfaces > 0) {
+                size_t captured = get32(body, swap);
+                if (captured > body_len - 4) {
+                    captured = body_len - 4;
+                }
+                process_packet(linktypes[0], &body[4], captured);
+            }
+            break;
+        }
+        offset += block_len;
+    }
+    return true;
+}
+
+/** Replay a capture once
+ *
+ * The file is mapped privately for every pass, as decryption in place
+ * modifies the mapped data.
+ */
+static bool replay(const char *filename)
+{
+    int fd = open(filename, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        perror(filename);
+        return false;
+    }
+    size_t len = st.st_size;
+    if (len < 24) {
+        fprintf(stderr, "%s: Not a capture file\n", filename);
+        close(fd);
+        return false;
+    }
+    uint8_t *data = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        perror(filename);
+        return false;
+    }
+
+    bool result;
+    uint32_t magic = get32(data, false);
+    if (magic == 0xa1b2c3d4 || magic == 0xd4c3b2a1 || magic == 0xa1b23c4d || magic == 0x4d3cb2a1) {
+        result = process_pcap(data, len);
+    } else if (magic == 0x0a0d0d0a) {
+        result = process_pcapng(data, len);
+    } else {
+        fprintf(stderr, "%s: Not a pcap or pcapng file\n", filename);
+        result = false;
+    }
+
+    munmap(data, len);
+    return result;
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "Usage: %s [-r] [-n passes] contexts capture\n"
+            "  -r  protect every response again as the server would have\n"
+            "  -n  number of times the capture is replayed (default 1)\n",
+            name);
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned passes = 1;
+    int opt;
+    while ((opt = getopt(argc, argv, "rn:h")) != -1) {
+        switch (opt) {
+        case 'r': reprotect = true; break;
+        case 'n': passes = strtoul(optarg, NULL, 0); break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (argc - optind != 2 || passes < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (!load_contexts(argv[optind])) {
+        return 1;
+    }
+    for (unsigned i = 0; i < passes; ++i) {
+        memset(exchanges, 0, sizeof(exchanges));
+        if (!derive_contexts() || !replay(argv[optind + 1])) {
+            return 1;
+        }
+    }
+
+    printf("phase,verdict,count,ns_per_op\n");
+    printf("capture,packets,%llu,\n", (unsigned long long)capture_stats.packets);
+    printf("capture,udp,%llu,\n", (unsigned long long)capture_stats.datagrams);
+    printf("capture,skipped,%llu,\n", (unsigned long long)capture_stats.skipped);
+    for (size_t p = 0; p < PHASE_COUNT; ++p) {
+        for (size_t v = 0; v < VERDICT_COUNT; ++v) {
+            if (stats[p][v].count == 0) {
+                continue;
+            }
+            printf("%s,%s,%llu,", phase_names[p], verdict_names[v], (unsigned long long)stats[p][v].count);
+            if (stats[p][v].ns != 0) {
+                printf("%.1f", (double)stats[p][v].ns / stats[p][v].count);
+            }
+            printf("\n");
+        }
+    }
+
+    return 0;
+}
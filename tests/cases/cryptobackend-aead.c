@@ -65,6 +65,13 @@ int test_with(struct testdata *data, int introduce_error)
 {
     oscore_cryptoerr_t err;
 
+#ifdef OSCORE_FIXED_AEADALG
+    // Builds with only a single algorithm can only test that
+    if (data->alg != OSCORE_FIXED_AEADALG) {
+        return 0;
+    }
+#endif
+
     uint8_t arena[sizeof(message) + max_tag_length];
     memcpy(arena, message, sizeof(message));
 
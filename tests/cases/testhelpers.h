@@ -0,0 +1,70 @@
+#ifndef TESTS_CASES_TESTHELPERS_H
+#define TESTS_CASES_TESTHELPERS_H
+
+/** @file
+ *
+ * @brief Fixtures shared by the unit test cases
+ *
+ * The key material here is not derived from anything; both sides of a test
+ * usually use the same key in both directions, which is good enough to get a
+ * message across.
+ */
+
+#include <string.h>
+#include <assert.h>
+
+#include <oscore_native/message.h>
+#include <oscore/protection.h>
+#include <oscore/context_impl/primitive.h>
+
+/** AEAD algorithm of @ref test_key_init: the only one built in if there is
+ * one, and AES-CCM-16-64-128 otherwise */
+#ifdef OSCORE_FIXED_AEADALG
+#define TEST_AEADALG OSCORE_FIXED_AEADALG
+#else
+#define TEST_AEADALG 10
+#endif
+
+/** Set up @p key for @ref TEST_AEADALG, with the same key in both directions
+ * and empty sender and recipient IDs */
+static inline void test_key_init(struct oscore_context_primitive_immutables *key)
+{
+    static const uint8_t common_iv[13] = "\x46\x22\xd4\xdd\x6d\x94\x41\x68\xee\xfb\x54\x98\x7c";
+    static const uint8_t secret[32] = "\xf0\x91\x0e\xd7\x29\x5e\x6a\xd4\xb5\x4f\xc7\x93\x15\x43\x02\xff"
+        "\x1b\x0f\x2e\x65\x3c\xd8\x7a\x91\x04\xc2\x5d\xb6\x88\x31\xe9\x7f";
+
+    memset(key, 0, sizeof(*key));
+    bool ok = !oscore_cryptoerr_is_error(oscore_crypto_aead_from_number(&key->aeadalg, TEST_AEADALG));
+    assert(ok);
+    (void)ok;
+    size_t ivlength = oscore_crypto_aead_get_ivlength(key->aeadalg);
+    size_t keylength = oscore_crypto_aead_get_keylength(key->aeadalg);
+    assert(ivlength <= sizeof(common_iv) && keylength <= sizeof(secret));
+    memcpy(key->common_iv, common_iv, ivlength);
+    memcpy(key->sender_key, secret, keylength);
+    memcpy(key->recipient_key, secret, keylength);
+}
+
+/** Find the OSCORE option in @p msg, which must be present and valid, and
+ * parse it into @p header */
+static inline void find_oscoreoption(oscore_msg_native_t msg, oscore_oscoreoption_t *header)
+{
+    oscore_msg_native_optiter_t iter;
+    uint16_t number;
+    const uint8_t *value;
+    size_t value_length;
+    bool found = false;
+    oscore_msg_native_optiter_init(msg, &iter);
+    while (oscore_msg_native_optiter_next(msg, &iter, &number, &value, &value_length)) {
+        if (number == 9) {
+            bool parsed = oscore_oscoreoption_parse(header, value, value_length);
+            assert(parsed);
+            found = true;
+        }
+    }
+    oscore_msg_native_optiter_finish(msg, &iter);
+    assert(found);
+    (void)found;
+}
+
+#endif
@@ -0,0 +1,113 @@
+#include <string.h>
+#include <assert.h>
+
+#include <oscore_native/message.h>
+#include <oscore_native/test.h>
+#include <oscore/protection.h>
+#include <oscore/contextpair.h>
+#include <oscore/context_impl/primitive.h>
+#include <oscore/message.h>
+
+#include "testhelpers.h"
+
+/** Build a notification, using @p cache if given */
+static oscore_msg_native_t notify(
+        oscore_context_t *server,
+        oscore_requestid_t *request_id,
+        const struct oscore_aadcache *cache
+        )
+{
+    oscore_msg_protected_t plaintext;
+    enum oscore_prepare_result prepared = oscore_prepare_response(oscore_test_msg_create(), &plaintext, server, request_id);
+    assert(prepared == OSCORE_PREPARE_OK);
+    if (cache != NULL) {
+        oscore_msg_protected_set_aadcache(&plaintext, cache);
+    }
+    oscore_msg_protected_set_code(&plaintext, 0x45);
+    oscore_msgerr_protected_t err = oscore_msg_protected_append_option(&plaintext, 6 /* Observe */, (const uint8_t *)"\x02", 1);
+    assert(err == OK);
+    const oscore_msg_protected_payloadpart_t payload = {(const uint8_t *)"21.5", 4};
+    err = oscore_msg_protected_write_payload(&plaintext, &payload, 1);
+    assert(err == OK);
+
+    oscore_msg_native_t out;
+    enum oscore_finish_result finished = oscore_encrypt_message(&plaintext, &out);
+    assert(finished == OSCORE_FINISH_OK);
+    return out;
+}
+
+int testmain(int introduce_error)
+{
+    struct oscore_context_primitive_immutables client_key;
+    test_key_init(&client_key);
+    client_key.sender_id_len = 1;
+    client_key.sender_id[0] = 0x01;
+    struct oscore_context_primitive_immutables server_key = client_key;
+    server_key.sender_id_len = 0;
+    server_key.recipient_id_len = 1;
+    server_key.recipient_id[0] = 0x01;
+    struct oscore_context_primitive client_primitive = { .immutables = &client_key };
+    struct oscore_context_primitive server_primitive = { .immutables = &server_key };
+    oscore_context_t client = { .type = OSCORE_CONTEXT_PRIMITIVE, .data = (void*)&client_primitive };
+    oscore_context_t server = { .type = OSCORE_CONTEXT_PRIMITIVE, .data = (void*)&server_primitive };
+
+    // Registration
+
+    oscore_msg_protected_t plaintext;
+    oscore_requestid_t client_rid, server_rid;
+    enum oscore_prepare_result prepared = oscore_prepare_request(oscore_test_msg_create(), &plaintext, &client, &client_rid);
+    assert(prepared == OSCORE_PREPARE_OK);
+    oscore_msg_protected_set_code(&plaintext, 1 /* GET */);
+    oscore_msgerr_protected_t err = oscore_msg_protected_append_option(&plaintext, 6 /* Observe */, (const uint8_t *)"", 0);
+    assert(err == OK);
+    err = oscore_msg_protected_trim_payload(&plaintext, 0);
+    assert(err == OK);
+    oscore_msg_native_t out;
+    enum oscore_finish_result finished = oscore_encrypt_message(&plaintext, &out);
+    assert(finished == OSCORE_FINISH_OK);
+
+    oscore_oscoreoption_t header;
+    oscore_msg_protected_t request;
+    find_oscoreoption(out, &header);
+    enum oscore_unprotect_request_result reqresult = oscore_unprotect_request(out, &request, header, &server, &server_rid);
+    assert(reqresult == OSCORE_UNPROTECT_REQUEST_OK);
+    oscore_test_msg_destroy(oscore_release_unprotected(&request));
+    server_rid.is_first_use = false;
+
+    struct oscore_aadcache cache;
+    bool ok = oscore_aadcache_init(&cache, &server, &server_rid);
+    assert(ok);
+    assert(cache.length <= OSCORE_AADCACHE_MAXLEN);
+    if (introduce_error == 1) {
+        cache.aad[cache.length - 2] ^= 0x01;
+    }
+
+    // The same notification, once with and once without the cache, from the
+    // same sequence number
+
+    struct oscore_context_primitive server_before = server_primitive;
+    oscore_msg_native_t cached = notify(&server, &server_rid, &cache);
+    server_primitive = server_before;
+    oscore_msg_native_t uncached = notify(&server, &server_rid, NULL);
+
+    uint8_t *cached_payload, *uncached_payload;
+    size_t cached_len, uncached_len;
+    oscore_msg_native_map_payload(cached, &cached_payload, &cached_len);
+    oscore_msg_native_map_payload(uncached, &uncached_payload, &uncached_len);
+    assert(cached_len == uncached_len);
+    assert(memcmp(cached_payload, uncached_payload, cached_len) == 0);
+    oscore_test_msg_destroy(uncached);
+
+    oscore_msg_protected_t response;
+    find_oscoreoption(cached, &header);
+    enum oscore_unprotect_response_result resresult = oscore_unprotect_response(cached, &response, header, &client, &client_rid);
+    assert(resresult == OSCORE_UNPROTECT_RESPONSE_OK);
+    uint8_t *payload;
+    size_t payload_len;
+    err = oscore_msg_protected_map_payload(&response, &payload, &payload_len);
+    assert(err == OK);
+    assert(payload_len == 4 && memcmp(payload, "21.5", 4) == 0);
+    oscore_test_msg_destroy(oscore_release_unprotected(&response));
+
+    return 0;
+}
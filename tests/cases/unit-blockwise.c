@@ -0,0 +1,167 @@
+#include <string.h>
+#include <assert.h>
+
+#include <oscore_native/message.h>
+#include <oscore_native/test.h>
+#include <oscore/protection.h>
+#include <oscore/contextpair.h>
+#include <oscore/context_impl/primitive.h>
+#include <oscore/message.h>
+#include <oscore/blockwise.h>
+
+#include "testhelpers.h"
+
+static uint32_t inner_uint(oscore_msg_protected_t *msg, uint16_t number)
+{
+    const uint8_t *value;
+    size_t value_len;
+    oscore_msgerr_protected_t err = oscore_msg_protected_get_inner_option(msg, number, 0, &value, &value_len);
+    assert(err == OK);
+    uint32_t result = 0;
+    for (size_t i = 0; i < value_len; ++i) {
+        result = (result << 8) | value[i];
+    }
+    return result;
+}
+
+static bool inner_absent(oscore_msg_protected_t *msg, uint16_t number)
+{
+    const uint8_t *value;
+    size_t value_len;
+    return oscore_msg_protected_get_inner_option(msg, number, 0, &value, &value_len) == INVALID_ARG_ERROR;
+}
+
+static uint8_t resource[1300];
+
+/** Send a GET with the given Block2 value (if any) to the server, serve it
+ * from @ref resource, and decrypt the response into @p response */
+static enum oscore_blockwise_result exchange(
+        oscore_context_t *client,
+        oscore_context_t *server,
+        const uint8_t *block2,
+        size_t block2_len,
+        struct oscore_blockwise_block2 *served,
+        oscore_msg_protected_t *response
+        )
+{
+    oscore_msg_protected_t plaintext;
+    oscore_requestid_t client_rid, server_rid;
+    enum oscore_prepare_result prepared = oscore_prepare_request(oscore_test_msg_create(), &plaintext, client, &client_rid);
+    assert(prepared == OSCORE_PREPARE_OK);
+    oscore_msg_protected_set_code(&plaintext, 1 /* GET */);
+    oscore_msgerr_protected_t err;
+    if (block2 != NULL) {
+        err = oscore_msg_protected_append_option(&plaintext, 23, block2, block2_len);
+        assert(err == OK);
+    }
+    err = oscore_msg_protected_trim_payload(&plaintext, 0);
+    assert(err == OK);
+    oscore_msg_native_t out;
+    enum oscore_finish_result finished = oscore_encrypt_message(&plaintext, &out);
+    assert(finished == OSCORE_FINISH_OK);
+
+    oscore_oscoreoption_t header;
+    oscore_msg_protected_t request;
+    find_oscoreoption(out, &header);
+    enum oscore_unprotect_request_result reqresult = oscore_unprotect_request(out, &request, header, server, &server_rid);
+    assert(reqresult == OSCORE_UNPROTECT_REQUEST_OK);
+    bool parsed = oscore_blockwise_parse_block2(&request, served);
+    assert(parsed);
+    oscore_test_msg_destroy(oscore_release_unprotected(&request));
+
+    prepared = oscore_prepare_response(oscore_test_msg_create(), &plaintext, server, &server_rid);
+    assert(prepared == OSCORE_PREPARE_OK);
+    oscore_msg_protected_set_code(&plaintext, 0x45 /* 2.05 Content */);
+    // Content-Format: application/octet-stream, to have an option before Block2
+    err = oscore_msg_protected_append_option(&plaintext, 12, (const uint8_t *)"\x2a", 1);
+    assert(err == OK);
+    enum oscore_blockwise_result result = oscore_blockwise_write_block2(&plaintext, served, sizeof(resource), oscore_blockwise_read_memory, resource);
+    if (result == OSCORE_BLOCKWISE_OUT_OF_RANGE) {
+        oscore_msg_protected_set_code(&plaintext, 0x82 /* 4.02 Bad Option */);
+    }
+    finished = oscore_encrypt_message(&plaintext, &out);
+    assert(finished == OSCORE_FINISH_OK);
+
+    find_oscoreoption(out, &header);
+    enum oscore_unprotect_response_result resresult = oscore_unprotect_response(out, response, header, client, &client_rid);
+    assert(resresult == OSCORE_UNPROTECT_RESPONSE_OK);
+    return result;
+}
+
+int testmain(int introduce_error)
+{
+    for (size_t i = 0; i < sizeof(resource); ++i) {
+        resource[i] = i * 7;
+    }
+
+    struct oscore_context_primitive_immutables key;
+    test_key_init(&key);
+    struct oscore_context_primitive client_primitive = { .immutables = &key };
+    struct oscore_context_primitive server_primitive = { .immutables = &key };
+    oscore_context_t client = { .type = OSCORE_CONTEXT_PRIMITIVE, .data = (void*)&client_primitive };
+    oscore_context_t server = { .type = OSCORE_CONTEXT_PRIMITIVE, .data = (void*)&server_primitive };
+
+    struct oscore_blockwise_block2 served;
+    oscore_msg_protected_t response;
+    enum oscore_blockwise_result result;
+    uint8_t *payload;
+    size_t payload_len;
+    oscore_msgerr_protected_t err;
+
+    // No Block2 in the request: 1024 byte blocks don't fit the 1024 byte test
+    // messages, so the first 512 bytes are sent
+
+    result = exchange(&client, &server, NULL, 0, &served, &response);
+    assert(result == OSCORE_BLOCKWISE_OK);
+    assert(served.num == 0 && served.szx == 5);
+    assert(inner_uint(&response, 23) == ((0 << 4) | 0x8 | 5));
+    assert(inner_uint(&response, 28) == sizeof(resource));
+    assert(inner_uint(&response, 12) == 42);
+    err = oscore_msg_protected_map_payload(&response, &payload, &payload_len);
+    assert(err == OK);
+    assert(payload_len == 512);
+    assert(memcmp(payload, resource, 512) == 0);
+    oscore_test_msg_destroy(oscore_release_unprotected(&response));
+
+    // Second 1024 byte block is served as the third 512 byte block, which is
+    // the last
+
+    const uint8_t block2_1_6[1] = {(1 << 4) | 6};
+    result = exchange(&client, &server, block2_1_6, 1, &served, &response);
+    assert(result == OSCORE_BLOCKWISE_OK);
+    assert(served.num == 2 && served.szx == 5);
+    assert(inner_uint(&response, 23) == ((2 << 4) | 5));
+    assert(inner_absent(&response, 28));
+    err = oscore_msg_protected_map_payload(&response, &payload, &payload_len);
+    assert(err == OK);
+    assert(payload_len == sizeof(resource) - 1024);
+    assert(memcmp(payload, &resource[1024], payload_len) == 0);
+    oscore_test_msg_destroy(oscore_release_unprotected(&response));
+
+    // Small blocks are served as requested
+
+    const uint8_t block2_20_0[2] = {0x01, (introduce_error == 1 ? 0x50 : 0x40) | 0};
+    result = exchange(&client, &server, block2_20_0, 2, &served, &response);
+    assert(result == OSCORE_BLOCKWISE_OK);
+    assert(served.num == 20 && served.szx == 0);
+    assert(inner_uint(&response, 23) == ((20 << 4) | 0x8 | 0));
+    err = oscore_msg_protected_map_payload(&response, &payload, &payload_len);
+    assert(err == OK);
+    assert(payload_len == 16);
+    assert(memcmp(payload, &resource[320], 16) == 0);
+    oscore_test_msg_destroy(oscore_release_unprotected(&response));
+
+    // Behind the end of the resource
+
+    const uint8_t block2_3_5[1] = {(3 << 4) | 5};
+    result = exchange(&client, &server, block2_3_5, 1, &served, &response);
+    assert(result == OSCORE_BLOCKWISE_OUT_OF_RANGE);
+    assert(oscore_msg_protected_get_code(&response) == 0x82);
+    assert(inner_absent(&response, 23));
+    err = oscore_msg_protected_map_payload(&response, &payload, &payload_len);
+    assert(err == OK);
+    assert(payload_len == 0);
+    oscore_test_msg_destroy(oscore_release_unprotected(&response));
+
+    return 0;
+}
@@ -0,0 +1,99 @@
+#include <stdbool.h>
+#include <assert.h>
+
+#include <oscore/contextpair.h>
+#include <oscore/context_impl/b1.h>
+#include <oscore/context_impl/b1_persist.h>
+
+/** Take sequence numbers from @p secctx until @p n were taken or one was
+ * refused, and return the number taken */
+static int take_numbers(oscore_context_t *secctx, int n)
+{
+    oscore_requestid_t id;
+    int taken = 0;
+    while (taken < n && oscore_context_take_seqno(secctx, &id)) {
+        taken += 1;
+    }
+    return taken;
+}
+
+int testmain(int introduce_error)
+{
+    struct oscore_context_primitive_immutables key = {
+        .sender_id_len = 0,
+        .recipient_id_len = 1,
+        .recipient_id = "\x01",
+    };
+    struct oscore_context_b1 b1;
+    oscore_context_t secctx = {
+        .type = OSCORE_CONTEXT_B1,
+        .data = (void*)(&b1),
+    };
+
+    oscore_context_b1_initialize(&b1, &key, 0, NULL);
+
+    struct oscore_context_b1_persist persist;
+    oscore_context_b1_persist_init(&persist, &b1, 10);
+
+    struct oscore_context_b1_persistrecord record;
+
+    // Nothing is staged until the first poll, and nothing usable before that
+    // was completed
+    assert(!oscore_context_b1_persist_take(&persist, &record));
+    assert(take_numbers(&secctx, 1) == 0);
+
+    assert(oscore_context_b1_persist_poll(&persist));
+    assert(!oscore_context_b1_persist_is_idle(&persist));
+    // Already staged, no need for another wake-up
+    assert(!oscore_context_b1_persist_poll(&persist));
+
+    assert(oscore_context_b1_persist_take(&persist, &record));
+    assert(record.seqno == 10);
+    assert(!record.has_replaydata);
+
+    // Taken but not complete: still nothing usable
+    assert(!oscore_context_b1_persist_poll(&persist));
+    assert(take_numbers(&secctx, 1) == 0);
+
+    oscore_context_b1_persist_complete(&persist, &record);
+    assert(oscore_context_b1_persist_is_idle(&persist));
+    assert(!oscore_context_b1_persist_poll(&persist));
+
+    // Half the lease can be used without staging anything
+    assert(take_numbers(&secctx, 5) == 5);
+    assert(!oscore_context_b1_persist_poll(&persist));
+    assert(take_numbers(&secctx, 1) == 1);
+    assert(oscore_context_b1_persist_poll(&persist));
+
+    assert(oscore_context_b1_persist_take(&persist, &record));
+    assert(record.seqno == 16);
+
+    // While that is being written, the remainder of the old lease is usable,
+    // and no further record is needed as the one in flight covers it
+    assert(take_numbers(&secctx, 10) == 4 - (introduce_error == 1));
+    assert(!oscore_context_b1_persist_poll(&persist));
+    struct oscore_context_b1_persistrecord second;
+    assert(!oscore_context_b1_persist_take(&persist, &second));
+
+    oscore_context_b1_persist_complete(&persist, &record);
+    assert(!oscore_context_b1_persist_poll(&persist));
+    assert(take_numbers(&secctx, 2) == 2);
+    assert(oscore_context_b1_persist_poll(&persist));
+
+    assert(oscore_context_b1_persist_take(&persist, &second));
+    assert(second.seqno == 22);
+    oscore_context_b1_persist_complete(&persist, &second);
+
+    // The final record carries the highest requested number along with the
+    // replay window
+    oscore_context_b1_persist_shutdown(&persist);
+    assert(!oscore_context_b1_persist_is_idle(&persist));
+    assert(oscore_context_b1_persist_take(&persist, &record));
+    assert(record.seqno == 22);
+    assert(record.has_replaydata);
+    assert(record.replaydata.left_edge == OSCORE_SEQNO_MAX);
+    oscore_context_b1_persist_complete(&persist, &record);
+    assert(oscore_context_b1_persist_is_idle(&persist));
+
+    return 0;
+}
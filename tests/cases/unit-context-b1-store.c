@@ -0,0 +1,138 @@
+#include <string.h>
+#include <assert.h>
+
+#include <oscore/context_impl/b1_store.h>
+
+#include "testhelpers.h"
+
+static uint32_t crc32(const uint8_t *data, size_t len)
+{
+    uint32_t crc = 0xffffffff;
+    for (size_t i = 0; i < len; ++i) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
+
+/** Serialize a record of the given format the way any build writes it: the
+ * field sizes are spelled out here rather than taken from the build
+ * configuration */
+static void write_by_hand(uint8_t version[148], uint8_t format, const struct oscore_context_primitive_immutables *key, uint64_t seqno)
+{
+    int32_t alg = 0;
+    oscore_crypto_aead_get_number(key->aeadalg, &alg);
+    size_t ivlength = oscore_crypto_aead_get_ivlength(key->aeadalg);
+    size_t keylength = oscore_crypto_aead_get_keylength(key->aeadalg);
+
+    memset(version, 0, 148);
+    version[0] = format;
+    version[4] = 1; // generation
+    for (int i = 0; i < 8; ++i) {
+        version[5 + i] = seqno >> (8 * (7 - i));
+    }
+    // Flags and replay data stay zero
+    for (int i = 0; i < 4; ++i) {
+        version[26 + i] = (uint32_t)alg >> (8 * (3 - i));
+    }
+    memcpy(&version[30], key->common_iv, ivlength);
+    version[46] = key->sender_id_len;
+    memcpy(&version[47], key->sender_id, key->sender_id_len);
+    memcpy(&version[63], key->sender_key, keylength);
+    version[95] = key->recipient_id_len;
+    memcpy(&version[96], key->recipient_id, key->recipient_id_len);
+    memcpy(&version[112], key->recipient_key, keylength);
+    uint32_t checksum = crc32(version, 144);
+    for (int i = 0; i < 4; ++i) {
+        version[144 + i] = checksum >> (8 * (3 - i));
+    }
+}
+
+int testmain(int introduce_error)
+{
+    struct oscore_context_primitive_immutables key;
+    test_key_init(&key);
+    key.recipient_id_len = 1;
+    key.recipient_id[0] = 0x01;
+
+    struct oscore_context_b1_storeslot slot;
+    memset(&slot, 0, sizeof(slot));
+
+    struct oscore_context_primitive_immutables read_key;
+    struct oscore_context_b1_persistrecord read_record;
+
+    // An empty slot holds nothing
+    assert(!oscore_context_b1_store_read(&slot, &read_key, &read_record));
+
+    struct oscore_context_b1_persistrecord record = {
+        .seqno = 100,
+        .has_replaydata = false,
+    };
+    size_t offset, len;
+    oscore_context_b1_store_write(&slot, &key, &record, &offset, &len);
+    assert(len == OSCORE_CONTEXT_B1_STORE_RECORD_SIZE);
+    assert(offset + len <= sizeof(slot));
+
+    assert(oscore_context_b1_store_read(&slot, &read_key, &read_record));
+    assert(read_record.seqno == 100);
+    assert(!read_record.has_replaydata);
+    assert(read_key.recipient_id_len == 1);
+    assert(read_key.recipient_id[0] == 1);
+    assert(memcmp(read_key.sender_key, key.sender_key, 16) == 0);
+    assert(memcmp(read_key.common_iv, key.common_iv, 13) == 0);
+
+    // The second write goes into the other version, and wins
+    size_t first_offset = offset;
+    record.seqno = 200;
+    record.has_replaydata = true;
+    record.replaydata.left_edge = 150;
+    record.replaydata.window = 0x80000001;
+    oscore_context_b1_store_write(&slot, &key, &record, &offset, &len);
+    assert(offset != first_offset);
+
+    assert(oscore_context_b1_store_read(&slot, &read_key, &read_record));
+    assert(read_record.seqno == 200);
+    assert(read_record.has_replaydata);
+    assert(read_record.replaydata.left_edge == 150);
+    assert(read_record.replaydata.window == 0x80000001);
+
+    // A third write that is torn falls back to the second
+    record.seqno = 300;
+    record.has_replaydata = false;
+    oscore_context_b1_store_write(&slot, &key, &record, &offset, &len);
+    assert(offset == first_offset);
+    if (introduce_error != 1) {
+        ((uint8_t*)&slot)[offset + len / 2] ^= 0x01;
+    }
+
+    assert(oscore_context_b1_store_read(&slot, &read_key, &read_record));
+    assert(read_record.seqno == 200);
+
+    // Writing again replaces the broken version and not the good one
+    record.seqno = 400;
+    oscore_context_b1_store_write(&slot, &key, &record, &offset, &len);
+    assert(offset == first_offset);
+    assert(oscore_context_b1_store_read(&slot, &read_key, &read_record));
+    assert(read_record.seqno == 400);
+    assert(!read_record.has_replaydata);
+
+    // The layout is independent of which algorithms are built in
+
+    assert(OSCORE_CONTEXT_B1_STORE_RECORD_SIZE == 148);
+    memset(&slot, 0, sizeof(slot));
+    write_by_hand(slot.versions[0], OSCORE_CONTEXT_B1_STORE_FORMAT, &key, 500);
+    assert(oscore_context_b1_store_read(&slot, &read_key, &read_record));
+    assert(read_record.seqno == 500);
+    assert(read_key.recipient_id_len == 1 && read_key.recipient_id[0] == 1);
+    assert(memcmp(read_key.common_iv, key.common_iv, oscore_crypto_aead_get_ivlength(key.aeadalg)) == 0);
+    assert(memcmp(read_key.recipient_key, key.recipient_key, oscore_crypto_aead_get_keylength(key.aeadalg)) == 0);
+
+    // An intact record of the earlier, configuration dependent format is not
+    // misread
+    write_by_hand(slot.versions[0], 1, &key, 500);
+    assert(!oscore_context_b1_store_read(&slot, &read_key, &read_record));
+
+    return 0;
+}
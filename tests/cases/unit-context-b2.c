@@ -0,0 +1,229 @@
+#include <string.h>
+#include <assert.h>
+
+#include <oscore_native/message.h>
+#include <oscore_native/test.h>
+#include <oscore/protection.h>
+#include <oscore/contextpair.h>
+#include <oscore/context_impl/b2.h>
+#include <oscore/message.h>
+
+#include "testhelpers.h"
+
+/** Protect an empty message with the given inner code into a fresh native message */
+static oscore_msg_native_t build(
+        oscore_context_t *secctx,
+        bool is_request,
+        oscore_requestid_t *request_id,
+        uint8_t code
+        )
+{
+    oscore_msg_native_t msg = oscore_test_msg_create();
+    oscore_msg_protected_t plaintext;
+    enum oscore_prepare_result prepared = is_request ?
+        oscore_prepare_request(msg, &plaintext, secctx, request_id) :
+        oscore_prepare_response(msg, &plaintext, secctx, request_id);
+    assert(prepared == OSCORE_PREPARE_OK);
+
+    oscore_msg_protected_set_code(&plaintext, code);
+    oscore_msgerr_protected_t err = oscore_msg_protected_trim_payload(&plaintext, 0);
+    assert(!oscore_msgerr_protected_is_error(err));
+
+    oscore_msg_native_t out;
+    enum oscore_finish_result finished = oscore_encrypt_message(&plaintext, &out);
+    assert(finished == OSCORE_FINISH_OK);
+    return out;
+}
+
+int testmain(int introduce_error)
+{
+    oscore_crypto_hkdfalg_t hkdf;
+    oscore_cryptoerr_t err = oscore_crypto_hkdf_from_number(&hkdf, 5);
+    assert(!oscore_cryptoerr_is_error(err));
+
+    const uint8_t secret[16] = "\x01\x02\x03\x04\x05\x06\x07\x08\x09\x0a\x0b\x0c\x0d\x0e\x0f\x10";
+    const uint8_t salt[8] = "\x9e\x7c\xa9\x22\x23\x78\x63\x40";
+
+    struct oscore_context_primitive_immutables client_template = {
+        .sender_id_len = 0,
+        .recipient_id_len = 1,
+        .recipient_id = "\x01",
+    };
+    struct oscore_context_primitive_immutables server_template = {
+        .sender_id_len = 1,
+        .sender_id = "\x01",
+        .recipient_id_len = 0,
+    };
+    oscore_crypto_aead_from_number(&client_template.aeadalg, TEST_AEADALG);
+    oscore_crypto_aead_from_number(&server_template.aeadalg, TEST_AEADALG);
+
+    struct oscore_context_b2 client_b2, server_b2;
+    bool ok;
+    ok = oscore_context_b2_initialize(&client_b2, &client_template, hkdf,
+            secret, sizeof(secret), salt, sizeof(salt), NULL, 0);
+    assert(ok);
+    ok = oscore_context_b2_initialize(&server_b2, &server_template, hkdf,
+            secret, sizeof(secret), salt, sizeof(salt), NULL, 0);
+    assert(ok);
+    oscore_context_t client = { .type = OSCORE_CONTEXT_B2, .data = (void*)&client_b2 };
+    oscore_context_t server = { .type = OSCORE_CONTEXT_B2, .data = (void*)&server_b2 };
+
+    assert(!oscore_context_b2_wants_rekey(&client_b2));
+
+    oscore_oscoreoption_t header;
+    oscore_requestid_t client_rid, server_rid;
+    enum oscore_unprotect_request_result reqresult;
+    enum oscore_unprotect_response_result resresult;
+    oscore_msg_protected_t unprotected;
+    oscore_msg_native_t msg;
+
+    // Request #1 carries R1
+
+    const uint8_t r1[8] = "\x11\x12\x13\x14\x15\x16\x17\x18";
+    ok = oscore_context_b2_initiate(&client_b2, r1, sizeof(r1), NULL);
+    assert(ok);
+
+    msg = build(&client, true, &client_rid, 1 /* GET */);
+    find_oscoreoption(msg, &header);
+    assert(header.kid_context != NULL);
+    assert(header.kid_context_len == 8 && memcmp(header.kid_context, r1, 8) == 0);
+
+    ok = oscore_context_b2_process_kidcontext(&server_b2, header.kid_context, header.kid_context_len, true, NULL);
+    assert(ok);
+    reqresult = oscore_unprotect_request(msg, &unprotected, header, &server, &server_rid);
+    assert(reqresult == OSCORE_UNPROTECT_REQUEST_OK);
+    ok = oscore_context_b2_process_request(&server, &reqresult, &server_rid);
+    assert(ok);
+    // Not to be acted on, as it can't be known to be fresh
+    assert(reqresult == OSCORE_UNPROTECT_REQUEST_DUPLICATE);
+    oscore_test_msg_destroy(oscore_release_unprotected(&unprotected));
+
+    // Response #1 carries R1|R2
+
+    const uint8_t r2[8] = "\x21\x22\x23\x24\x25\x26\x27\x28";
+    ok = oscore_context_b2_respond(&server, r2, sizeof(r2), NULL);
+    assert(ok);
+
+    msg = build(&server, false, &server_rid, 0x81 /* 4.01 Unauthorized */);
+    if (introduce_error == 1) {
+        uint8_t *payload;
+        size_t payload_len;
+        oscore_msg_native_map_payload(msg, &payload, &payload_len);
+        payload[0] ^= 0x01;
+    }
+    find_oscoreoption(msg, &header);
+    assert(header.kid_context != NULL && header.kid_context_len == 16);
+    assert(memcmp(header.kid_context, r1, 8) == 0);
+    assert(memcmp(&header.kid_context[8], r2, 8) == 0);
+
+    ok = oscore_context_b2_process_kidcontext(&client_b2, header.kid_context, header.kid_context_len, false, NULL);
+    assert(ok);
+    resresult = oscore_unprotect_response(msg, &unprotected, header, &client, &client_rid);
+    oscore_context_b2_process_response(&client, resresult);
+    assert(resresult == OSCORE_UNPROTECT_RESPONSE_OK);
+    assert(oscore_msg_protected_get_code(&unprotected) == 0x81);
+    oscore_test_msg_destroy(oscore_release_unprotected(&unprotected));
+
+    // Request #2 is protected with the new context and plain again
+
+    msg = build(&client, true, &client_rid, 1 /* GET */);
+    find_oscoreoption(msg, &header);
+    assert(header.kid_context == NULL);
+
+    ok = oscore_context_b2_process_kidcontext(&server_b2, header.kid_context, 0, true, NULL);
+    assert(!ok);
+    reqresult = oscore_unprotect_request(msg, &unprotected, header, &server, &server_rid);
+    assert(reqresult == OSCORE_UNPROTECT_REQUEST_OK);
+    ok = oscore_context_b2_process_request(&server, &reqresult, &server_rid);
+    assert(!ok);
+    assert(reqresult == OSCORE_UNPROTECT_REQUEST_OK);
+    oscore_test_msg_destroy(oscore_release_unprotected(&unprotected));
+
+    msg = build(&server, false, &server_rid, 0x45 /* 2.05 Content */);
+    find_oscoreoption(msg, &header);
+    assert(header.kid_context == NULL);
+    resresult = oscore_unprotect_response(msg, &unprotected, header, &client, &client_rid);
+    assert(resresult == OSCORE_UNPROTECT_RESPONSE_OK);
+    oscore_test_msg_destroy(oscore_release_unprotected(&unprotected));
+
+    // A KID context that does not verify leaves the server where it was
+
+    const uint8_t *kidcontext;
+    size_t kidcontext_len;
+    ok = oscore_context_b2_process_kidcontext(&server_b2, (const uint8_t*)"bogus", 5, true, NULL);
+    assert(ok);
+    reqresult = OSCORE_UNPROTECT_REQUEST_INVALID;
+    ok = oscore_context_b2_process_request(&server, &reqresult, &server_rid);
+    assert(!ok);
+    oscore_context_get_kidcontext(&server, &kidcontext, &kidcontext_len);
+    assert(kidcontext_len == 16 && memcmp(&kidcontext[8], r2, 8) == 0);
+
+    msg = build(&client, true, &client_rid, 1 /* GET */);
+    find_oscoreoption(msg, &header);
+    ok = oscore_context_b2_process_kidcontext(&server_b2, header.kid_context, 0, true, NULL);
+    assert(!ok);
+    reqresult = oscore_unprotect_request(msg, &unprotected, header, &server, &server_rid);
+    assert(reqresult == OSCORE_UNPROTECT_REQUEST_OK);
+    oscore_test_msg_destroy(oscore_release_unprotected(&unprotected));
+
+    // Another procedure with all key material derived ahead of the steps
+
+    struct oscore_context_b2_derived derived;
+    const uint8_t r1b[8] = "\x31\x32\x33\x34\x35\x36\x37\x38";
+    ok = oscore_context_b2_derive(&client_b2, r1b, sizeof(r1b), &derived);
+    assert(ok);
+    ok = oscore_context_b2_initiate(&client_b2, r1b, sizeof(r1b), &derived);
+    assert(ok);
+
+    msg = build(&client, true, &client_rid, 1 /* GET */);
+    find_oscoreoption(msg, &header);
+    assert(header.kid_context_len == 8);
+
+    // Material that was derived for this step is used as it is: a corrupted
+    // copy makes the request fail to verify, and the server reverts
+    ok = oscore_context_b2_derive(&server_b2, header.kid_context, header.kid_context_len, &derived);
+    assert(ok);
+    struct oscore_context_b2_derived corrupted = derived;
+    corrupted.immutables.recipient_key[0] ^= 0x01;
+    ok = oscore_context_b2_process_kidcontext(&server_b2, header.kid_context, header.kid_context_len, true, &corrupted);
+    assert(ok);
+    reqresult = oscore_unprotect_request(msg, &unprotected, header, &server, &server_rid);
+    assert(reqresult == OSCORE_UNPROTECT_REQUEST_INVALID);
+    ok = oscore_context_b2_process_request(&server, &reqresult, &server_rid);
+    assert(!ok);
+    oscore_test_msg_destroy(msg);
+
+    msg = build(&client, true, &client_rid, 1 /* GET */);
+    find_oscoreoption(msg, &header);
+    ok = oscore_context_b2_process_kidcontext(&server_b2, header.kid_context, header.kid_context_len, true, &derived);
+    assert(ok);
+    reqresult = oscore_unprotect_request(msg, &unprotected, header, &server, &server_rid);
+    assert(reqresult == OSCORE_UNPROTECT_REQUEST_OK);
+    ok = oscore_context_b2_process_request(&server, &reqresult, &server_rid);
+    assert(ok);
+    oscore_test_msg_destroy(oscore_release_unprotected(&unprotected));
+
+    const uint8_t r2b[8] = "\x41\x42\x43\x44\x45\x46\x47\x48";
+    uint8_t r1r2[16];
+    oscore_context_get_kidcontext(&server, &kidcontext, &kidcontext_len);
+    assert(kidcontext_len == 8);
+    memcpy(r1r2, kidcontext, 8);
+    memcpy(&r1r2[8], r2b, 8);
+    ok = oscore_context_b2_derive(&server_b2, r1r2, sizeof(r1r2), &derived);
+    assert(ok);
+    ok = oscore_context_b2_respond(&server, r2b, sizeof(r2b), &derived);
+    assert(ok);
+
+    msg = build(&server, false, &server_rid, 0x81 /* 4.01 Unauthorized */);
+    find_oscoreoption(msg, &header);
+    assert(header.kid_context_len == 16 && memcmp(header.kid_context, r1r2, 16) == 0);
+    // Material derived for anything else is not used, but derived again
+    ok = oscore_context_b2_process_kidcontext(&client_b2, header.kid_context, header.kid_context_len, false, &derived);
+    assert(ok);
+    resresult = oscore_unprotect_response(msg, &unprotected, header, &client, &client_rid);
+    oscore_context_b2_process_response(&client, resresult);
+    assert(resresult == OSCORE_UNPROTECT_RESPONSE_OK);
+    oscore_test_msg_destroy(oscore_release_unprotected(&unprotected));
+
+    return 0;
+}
@@ -0,0 +1,52 @@
+#include <assert.h>
+
+#include <oscore/context_impl/rcu.h>
+#include <oscore/context_impl/primitive.h>
+
+int testmain(int introduce_error)
+{
+    // The contexts are never used for protection here, only their identity
+    // matters
+    struct oscore_context_primitive primitive[3];
+    oscore_context_t generation[3];
+    for (int i = 0; i < 3; ++i) {
+        generation[i].type = OSCORE_CONTEXT_PRIMITIVE;
+        generation[i].data = (void*)&primitive[i];
+    }
+
+    struct oscore_context_rcu rcu;
+    oscore_context_rcu_init(&rcu, &generation[0]);
+    assert(oscore_context_rcu_retired_is_idle(&rcu));
+
+    // An exchange in flight across a publication keeps its context
+    oscore_context_t *early = oscore_context_rcu_acquire(&rcu);
+    assert(early->data == &primitive[0]);
+
+    assert(oscore_context_rcu_publish(&rcu, &generation[1]));
+    assert(!oscore_context_rcu_retired_is_idle(&rcu));
+
+    oscore_context_t *late = oscore_context_rcu_acquire(&rcu);
+    assert(late->data == &primitive[1]);
+    assert(early->data == &primitive[0]);
+
+    // The generation before can't be overwritten while it is in use
+    assert(!oscore_context_rcu_publish(&rcu, &generation[2]));
+    assert(early->data == &primitive[0]);
+
+    if (introduce_error != 1) {
+        oscore_context_rcu_release(&rcu, early);
+    }
+    assert(oscore_context_rcu_retired_is_idle(&rcu));
+
+    // Exchanges on the current context don't hold up publication
+    assert(oscore_context_rcu_publish(&rcu, &generation[2]));
+    oscore_context_t *latest = oscore_context_rcu_acquire(&rcu);
+    assert(latest->data == &primitive[2]);
+    assert(late->data == &primitive[1]);
+
+    oscore_context_rcu_release(&rcu, late);
+    oscore_context_rcu_release(&rcu, latest);
+    assert(oscore_context_rcu_retired_is_idle(&rcu));
+
+    return 0;
+}
@@ -0,0 +1,193 @@
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+
+#include <oscore_native/test.h>
+#include <oscore/echo.h>
+#include <oscore/protection.h>
+#include <oscore/context_impl/primitive.h>
+#include <oscore/context_impl/b1.h>
+
+#include "testhelpers.h"
+
+/** A client and a B.1 server that has lost its replay window */
+static oscore_context_t client, server;
+
+/** Send a GET from the client to the server, carrying @p echo as an Echo
+ * option unless it is NULL, and run the server's B.1 processing on it
+ *
+ * @return whether the server needed to answer with a 4.01 Echo response; the
+ * Echo value the client found in there is written to @p new_echo */
+static bool exchange(const uint8_t *echo, uint8_t new_echo[OSCORE_ECHO_VALUE_LEN], enum oscore_unprotect_request_result *result)
+{
+    oscore_msg_protected_t plaintext;
+    oscore_requestid_t client_rid, server_rid;
+    enum oscore_prepare_result prepared = oscore_prepare_request(oscore_test_msg_create(), &plaintext, &client, &client_rid);
+    assert(prepared == OSCORE_PREPARE_OK);
+    oscore_msg_protected_set_code(&plaintext, 1 /* GET */);
+    oscore_msgerr_protected_t err;
+    if (echo != NULL) {
+        err = oscore_msg_protected_append_option(&plaintext, 252 /* Echo */, echo, OSCORE_ECHO_VALUE_LEN);
+        assert(err == OK);
+    }
+    err = oscore_msg_protected_trim_payload(&plaintext, 0);
+    assert(err == OK);
+    oscore_msg_native_t out;
+    enum oscore_finish_result finished = oscore_encrypt_message(&plaintext, &out);
+    assert(finished == OSCORE_FINISH_OK);
+
+    oscore_oscoreoption_t header;
+    oscore_msg_protected_t request;
+    find_oscoreoption(out, &header);
+    *result = oscore_unprotect_request(out, &request, header, &server, &server_rid);
+    assert(*result == OSCORE_UNPROTECT_REQUEST_OK || *result == OSCORE_UNPROTECT_REQUEST_DUPLICATE);
+    bool need_401echo = oscore_context_b1_process_request(&server, &request, result, &server_rid);
+    oscore_test_msg_destroy(oscore_release_unprotected(&request));
+
+    if (!need_401echo) {
+        return false;
+    }
+
+    oscore_msg_native_t response = oscore_test_msg_create();
+    bool built = oscore_context_b1_build_401echo(response, &server, &server_rid);
+    assert(built);
+
+    oscore_msg_protected_t unprotected;
+    find_oscoreoption(response, &header);
+    enum oscore_unprotect_response_result resresult = oscore_unprotect_response(response, &unprotected, header, &client, &client_rid);
+    assert(resresult == OSCORE_UNPROTECT_RESPONSE_OK);
+    assert(oscore_msg_protected_get_code(&unprotected) == 0x81);
+    const uint8_t *value;
+    size_t value_len;
+    err = oscore_msg_protected_get_inner_option(&unprotected, 252, 0, &value, &value_len);
+    assert(err == OK && value_len == OSCORE_ECHO_VALUE_LEN);
+    memcpy(new_echo, value, value_len);
+    oscore_test_msg_destroy(oscore_release_unprotected(&unprotected));
+
+    (void)built;
+    (void)resresult;
+    return true;
+}
+
+int testmain(int introduce_error)
+{
+    struct oscore_context_primitive_immutables key_a = {
+        .sender_id_len = 0,
+        .recipient_id_len = 1,
+        .recipient_id = "\x01",
+    };
+    struct oscore_context_primitive_immutables key_b = {
+        .sender_id_len = 1,
+        .sender_id = "\x01",
+        .recipient_id_len = 0,
+    };
+    oscore_crypto_aead_from_number(&key_a.aeadalg, TEST_AEADALG);
+    oscore_crypto_aead_from_number(&key_b.aeadalg, TEST_AEADALG);
+
+    struct oscore_context_primitive primitive_a = { .immutables = &key_a };
+    struct oscore_context_primitive primitive_b = { .immutables = &key_b };
+    oscore_context_t secctx_a = {
+        .type = OSCORE_CONTEXT_PRIMITIVE,
+        .data = (void*)(&primitive_a),
+    };
+    oscore_context_t secctx_b = {
+        .type = OSCORE_CONTEXT_PRIMITIVE,
+        .data = (void*)(&primitive_b),
+    };
+
+    oscore_crypto_hkdfalg_t alg;
+    oscore_cryptoerr_t err = oscore_crypto_hkdf_from_number(&alg, 5);
+    assert(!oscore_cryptoerr_is_error(err));
+
+    uint8_t serverkey[OSCORE_ECHO_KEY_LEN] = { 0x42 };
+    struct oscore_echo echo;
+    oscore_echo_init(&echo, alg, serverkey, 10);
+    oscore_echo_set_time(&echo, 1000);
+
+    uint8_t value[OSCORE_ECHO_VALUE_LEN];
+    assert(oscore_echo_generate(&echo, &secctx_a, value));
+
+    // Valid for the context it was generated for, and only for that
+    assert(oscore_echo_verify(&echo, &secctx_a, value, sizeof(value)));
+    assert(!oscore_echo_verify(&echo, &secctx_b, value, sizeof(value)));
+    assert(!oscore_echo_verify(&echo, &secctx_a, value, sizeof(value) - 1));
+
+    // Valid for the configured time, and not any longer
+    oscore_echo_set_time(&echo, 1010);
+    assert(oscore_echo_verify(&echo, &secctx_a, value, sizeof(value)));
+    oscore_echo_set_time(&echo, 1011 - (introduce_error == 1));
+    assert(!oscore_echo_verify(&echo, &secctx_a, value, sizeof(value)));
+
+    // Values from the future are not accepted
+    oscore_echo_set_time(&echo, 999);
+    assert(!oscore_echo_verify(&echo, &secctx_a, value, sizeof(value)));
+
+    // Tampering with the time stamp or MAC is detected
+    oscore_echo_set_time(&echo, 1005);
+    assert(oscore_echo_verify(&echo, &secctx_a, value, sizeof(value)));
+    value[3] ^= 0x01;
+    assert(!oscore_echo_verify(&echo, &secctx_a, value, sizeof(value)));
+    value[3] ^= 0x01;
+    value[OSCORE_ECHO_VALUE_LEN - 1] ^= 0x80;
+    assert(!oscore_echo_verify(&echo, &secctx_a, value, sizeof(value)));
+
+    // A different server key does not verify the same value
+    value[OSCORE_ECHO_VALUE_LEN - 1] ^= 0x80;
+    serverkey[0] = 0x43;
+    struct oscore_echo other;
+    oscore_echo_init(&other, alg, serverkey, 10);
+    oscore_echo_set_time(&other, 1005);
+    assert(!oscore_echo_verify(&other, &secctx_a, value, sizeof(value)));
+
+    // A B.1 server without replay window recovers it with a stateless Echo
+
+    struct oscore_context_primitive_immutables client_key, server_key;
+    test_key_init(&client_key);
+    client_key.sender_id_len = 1;
+    client_key.sender_id[0] = 0x01;
+    test_key_init(&server_key);
+    server_key.recipient_id_len = 1;
+    server_key.recipient_id[0] = 0x01;
+    struct oscore_context_primitive client_primitive = { .immutables = &client_key };
+    struct oscore_context_b1 server_b1;
+    client = (oscore_context_t) { .type = OSCORE_CONTEXT_PRIMITIVE, .data = (void*)&client_primitive };
+    server = (oscore_context_t) { .type = OSCORE_CONTEXT_B1, .data = (void*)&server_b1 };
+    oscore_context_b1_initialize(&server_b1, &server_key, 0, NULL);
+    oscore_context_b1_allow_high(&server_b1, 100);
+    oscore_context_b1_set_stateless_echo(&server_b1, &echo);
+    oscore_echo_set_time(&echo, 2000);
+
+    enum oscore_unprotect_request_result result;
+    uint8_t issued[OSCORE_ECHO_VALUE_LEN], reissued[OSCORE_ECHO_VALUE_LEN];
+
+    // The first request is answered with an Echo value, which takes no
+    // sequence number beyond the one of the response
+    uint64_t seqno = server_b1.primitive.sender_sequence_number;
+    assert(exchange(NULL, issued, &result));
+    assert(result == OSCORE_UNPROTECT_REQUEST_DUPLICATE);
+    assert(server_b1.primitive.sender_sequence_number == seqno + 1);
+
+    // A forged value is not accepted
+    uint8_t forged[OSCORE_ECHO_VALUE_LEN];
+    memcpy(forged, issued, sizeof(forged));
+    forged[OSCORE_ECHO_VALUE_LEN - 1] ^= 0x01;
+    assert(exchange(forged, reissued, &result));
+    assert(result == OSCORE_UNPROTECT_REQUEST_DUPLICATE);
+
+    // Neither is a stale one
+    oscore_echo_set_time(&echo, 2011);
+    assert(exchange(issued, reissued, &result));
+    assert(result == OSCORE_UNPROTECT_REQUEST_DUPLICATE);
+
+    // The value from the latest response is accepted, and the replay window
+    // starts at that request
+    oscore_echo_set_time(&echo, 2012 + 10 * (introduce_error == 1));
+    assert(!exchange(reissued, issued, &result));
+    assert(result == OSCORE_UNPROTECT_REQUEST_OK);
+
+    // Later requests need no Echo any more
+    assert(!exchange(NULL, issued, &result));
+    assert(result == OSCORE_UNPROTECT_REQUEST_OK);
+
+    return 0;
+}
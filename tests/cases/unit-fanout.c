@@ -0,0 +1,144 @@
+#include <string.h>
+#include <assert.h>
+
+#include <oscore_native/message.h>
+#include <oscore_native/test.h>
+#include <oscore/protection.h>
+#include <oscore/contextpair.h>
+#include <oscore/context_impl/primitive.h>
+#include <oscore/message.h>
+#include <oscore/fanout.h>
+
+#include "testhelpers.h"
+
+#define OBSERVERS 3
+
+int testmain(int introduce_error)
+{
+    struct oscore_context_primitive_immutables client_keys[OBSERVERS];
+    struct oscore_context_primitive_immutables server_keys[OBSERVERS];
+    struct oscore_context_primitive client_primitives[OBSERVERS];
+    struct oscore_context_primitive server_primitives[OBSERVERS];
+    oscore_context_t clients[OBSERVERS];
+    oscore_context_t servers[OBSERVERS];
+    oscore_requestid_t client_rids[OBSERVERS];
+    oscore_requestid_t server_rids[OBSERVERS];
+
+    for (size_t i = 0; i < OBSERVERS; ++i) {
+        struct oscore_context_primitive_immutables key;
+        test_key_init(&key);
+        key.sender_key[0] += i;
+        key.recipient_key[1] += i;
+
+        client_keys[i] = key;
+        client_keys[i].sender_id_len = 1;
+        client_keys[i].sender_id[0] = i;
+        server_keys[i] = key;
+        memcpy(server_keys[i].sender_key, key.recipient_key, sizeof(key.sender_key));
+        memcpy(server_keys[i].recipient_key, key.sender_key, sizeof(key.sender_key));
+        server_keys[i].recipient_id_len = 1;
+        server_keys[i].recipient_id[0] = i;
+
+        client_primitives[i] = (struct oscore_context_primitive) { .immutables = &client_keys[i] };
+        server_primitives[i] = (struct oscore_context_primitive) { .immutables = &server_keys[i] };
+        clients[i] = (oscore_context_t) { .type = OSCORE_CONTEXT_PRIMITIVE, .data = (void*)&client_primitives[i] };
+        servers[i] = (oscore_context_t) { .type = OSCORE_CONTEXT_PRIMITIVE, .data = (void*)&server_primitives[i] };
+    }
+
+    oscore_msg_protected_t plaintext;
+    oscore_msg_native_t out;
+    oscore_oscoreoption_t header;
+    oscore_msgerr_protected_t err;
+
+    // Registrations
+
+    for (size_t i = 0; i < OBSERVERS; ++i) {
+        enum oscore_prepare_result prepared = oscore_prepare_request(oscore_test_msg_create(), &plaintext, &clients[i], &client_rids[i]);
+        assert(prepared == OSCORE_PREPARE_OK);
+        oscore_msg_protected_set_code(&plaintext, 1 /* GET */);
+        err = oscore_msg_protected_append_option(&plaintext, 6 /* Observe */, (const uint8_t *)"", 0);
+        assert(err == OK);
+        err = oscore_msg_protected_trim_payload(&plaintext, 0);
+        assert(err == OK);
+        enum oscore_finish_result finished = oscore_encrypt_message(&plaintext, &out);
+        assert(finished == OSCORE_FINISH_OK);
+
+        oscore_msg_protected_t request;
+        find_oscoreoption(out, &header);
+        enum oscore_unprotect_request_result reqresult = oscore_unprotect_request(out, &request, header, &servers[i], &server_rids[i]);
+        assert(reqresult == OSCORE_UNPROTECT_REQUEST_OK);
+        oscore_test_msg_destroy(oscore_release_unprotected(&request));
+        // The registration response would be sent here, using up the request's
+        // nonce
+        server_rids[i].is_first_use = false;
+    }
+
+    // Notification
+
+    uint8_t templatebuffer[8];
+    oscore_msg_protected_template_t inner_options;
+    oscore_msg_protected_template_init(&inner_options, templatebuffer, sizeof(templatebuffer));
+    err = oscore_msg_protected_template_add(&inner_options, 12 /* Content-Format */, (const uint8_t *)"\x3c", 1);
+    assert(err == OK);
+    oscore_fanout_notification_t notification = {
+        .code = 0x45,
+        .observe = (const uint8_t *)"\x05",
+        .observe_len = 1,
+        .inner_options = &inner_options,
+        .payload = (const uint8_t *)"\x19\x01\x2c",
+        .payload_len = 3,
+    };
+
+    // One observer has its AAD precomputed
+    struct oscore_aadcache cache;
+    bool ok = oscore_aadcache_init(&cache, &servers[2], &server_rids[2]);
+    assert(ok);
+
+    struct oscore_fanout_target targets[OBSERVERS];
+    for (size_t i = 0; i < OBSERVERS; ++i) {
+        targets[i] = (struct oscore_fanout_target) {
+            .secctx = &servers[i],
+            .request_id = &server_rids[i],
+            .message = oscore_test_msg_create(),
+        };
+    }
+    targets[2].aadcache = &cache;
+    size_t successful = oscore_fanout_notify(&notification, targets, OBSERVERS);
+    assert(successful == OBSERVERS);
+
+    if (introduce_error == 1) {
+        // Observers mixed up
+        oscore_msg_native_t swap = targets[0].message;
+        targets[0].message = targets[1].message;
+        targets[1].message = swap;
+    }
+
+    for (size_t i = 0; i < OBSERVERS; ++i) {
+        assert(targets[i].result == OSCORE_FANOUT_OK);
+
+        oscore_msg_protected_t response;
+        find_oscoreoption(targets[i].message, &header);
+        // Notifications carry their own Partial IV
+        assert(header.partial_iv_len != 0);
+        enum oscore_unprotect_response_result resresult = oscore_unprotect_response(targets[i].message, &response, header, &clients[i], &client_rids[i]);
+        assert(resresult == OSCORE_UNPROTECT_RESPONSE_OK);
+        assert(oscore_msg_protected_get_code(&response) == 0x45);
+
+        const uint8_t *value;
+        size_t value_len;
+        err = oscore_msg_protected_get_inner_option(&response, 6, 0, &value, &value_len);
+        assert(err == OK && value_len == 0);
+        err = oscore_msg_protected_get_inner_option(&response, 12, 0, &value, &value_len);
+        assert(err == OK && value_len == 1 && value[0] == 0x3c);
+
+        uint8_t *payload;
+        size_t payload_len;
+        err = oscore_msg_protected_map_payload(&response, &payload, &payload_len);
+        assert(err == OK);
+        assert(payload_len == 3 && memcmp(payload, "\x19\x01\x2c", 3) == 0);
+
+        oscore_test_msg_destroy(oscore_release_unprotected(&response));
+    }
+
+    return 0;
+}
@@ -0,0 +1,108 @@
+#include <string.h>
+#include <assert.h>
+
+#include <oscore_native/message.h>
+#include <oscore_native/test.h>
+#include <oscore/protection.h>
+#include <oscore/contextpair.h>
+#include <oscore/context_impl/primitive.h>
+#include <oscore/message.h>
+
+#include "testhelpers.h"
+
+int testmain(int introduce_error)
+{
+    // Both sides use the same key in both directions, which is good enough to
+    // get a message across
+    struct oscore_context_primitive_immutables key;
+    test_key_init(&key);
+    struct oscore_context_primitive client_primitive = { .immutables = &key };
+    struct oscore_context_primitive server_primitive = { .immutables = &key };
+    oscore_context_t client = { .type = OSCORE_CONTEXT_PRIMITIVE, .data = (void*)&client_primitive };
+    oscore_context_t server = { .type = OSCORE_CONTEXT_PRIMITIVE, .data = (void*)&server_primitive };
+
+    oscore_msg_native_t msg = oscore_test_msg_create();
+    oscore_msg_protected_t plaintext;
+    oscore_requestid_t request_id;
+    enum oscore_prepare_result prepared = oscore_prepare_request(msg, &plaintext, &client, &request_id);
+    assert(prepared == OSCORE_PREPARE_OK);
+
+    oscore_msgerr_protected_t err;
+    oscore_msg_protected_set_code(&plaintext, 1 /* GET */);
+    err = oscore_msg_protected_append_option(&plaintext, 11, (uint8_t*)"sensors", 7);
+    assert(err == OK);
+    err = oscore_msg_protected_append_option(&plaintext, 11, (uint8_t*)"temp", 4);
+    assert(err == OK);
+    err = oscore_msg_protected_append_option(&plaintext, 17, (uint8_t*)"\x3c", 1);
+    assert(err == OK);
+    // Large enough for an extended option delta
+    err = oscore_msg_protected_append_option(&plaintext, 252, (uint8_t*)"\x01\x02\x03\x04", 4);
+    assert(err == OK);
+
+    uint8_t *payload;
+    size_t payload_len;
+    err = oscore_msg_protected_map_payload(&plaintext, &payload, &payload_len);
+    assert(err == OK && payload_len >= 5);
+    memcpy(payload, "hello", 5);
+    err = oscore_msg_protected_trim_payload(&plaintext, 5);
+    assert(err == OK);
+
+    oscore_msg_native_t out;
+    enum oscore_finish_result finished = oscore_encrypt_message(&plaintext, &out);
+    assert(finished == OSCORE_FINISH_OK);
+
+    oscore_oscoreoption_t header;
+    oscore_msg_protected_t unprotected;
+    oscore_requestid_t server_rid;
+    find_oscoreoption(out, &header);
+    enum oscore_unprotect_request_result unprotected_ok = oscore_unprotect_request(out, &unprotected, header, &server, &server_rid);
+    assert(unprotected_ok == OSCORE_UNPROTECT_REQUEST_OK);
+
+    // Lookups out of sequence, as an application would do them
+
+    const uint8_t *value;
+    size_t value_len;
+    err = oscore_msg_protected_get_inner_option(&unprotected, 17, 0, &value, &value_len);
+    assert(err == OK && value_len == 1 && value[0] == 0x3c);
+    err = oscore_msg_protected_get_inner_option(&unprotected, 11, 1, &value, &value_len);
+    assert(err == OK && value_len == 4 && memcmp(value, "temp", 4) == 0);
+    err = oscore_msg_protected_get_inner_option(&unprotected, 11, 0, &value, &value_len);
+    assert(err == OK && value_len == 7 && memcmp(value, "sensors", 7) == 0);
+    err = oscore_msg_protected_get_inner_option(&unprotected, 11, 2, &value, &value_len);
+    assert(err == INVALID_ARG_ERROR);
+    err = oscore_msg_protected_get_inner_option(&unprotected, 23, 0, &value, &value_len);
+    assert(err == INVALID_ARG_ERROR);
+    err = oscore_msg_protected_get_inner_option(&unprotected, 252, 0, &value, &value_len);
+    assert(err == OK && value_len == 4 && memcmp(value, "\x01\x02\x03\x04", 4) == 0);
+
+    err = oscore_msg_protected_update_option(&unprotected, 17, 0, (uint8_t*)"\x32", 1);
+    assert(err == OK);
+    err = oscore_msg_protected_update_option(&unprotected, 17, 0, (uint8_t*)"\x32\x00", 2);
+    assert(err == INVALID_ARG_ERROR);
+
+    // Payload is found before the options were iterated over
+
+    err = oscore_msg_protected_map_payload(&unprotected, &payload, &payload_len);
+    assert(err == OK);
+    assert(payload_len == 5 && memcmp(payload, "hello", 5) == 0);
+
+    oscore_msg_protected_optiter_t iter;
+    uint16_t number;
+    const uint8_t expected_numbers[] = {11, 11, 17, 252};
+    size_t count = 0;
+    oscore_msg_protected_optiter_init(&unprotected, &iter);
+    while (oscore_msg_protected_optiter_next(&unprotected, &iter, &number, &value, &value_len)) {
+        assert(count < sizeof(expected_numbers));
+        assert(number == expected_numbers[count]);
+        if (number == 17) {
+            assert(value_len == 1 && value[0] == (introduce_error == 1 ? 0x3c : 0x32));
+        }
+        count++;
+    }
+    err = oscore_msg_protected_optiter_finish(&unprotected, &iter);
+    assert(err == OK);
+    assert(count == 4);
+
+    oscore_test_msg_destroy(oscore_release_unprotected(&unprotected));
+    return 0;
+}
@@ -0,0 +1,125 @@
+#include <string.h>
+#include <assert.h>
+
+#include <oscore_native/message.h>
+#include <oscore_native/test.h>
+#include <oscore/protection.h>
+#include <oscore/contextpair.h>
+#include <oscore/context_impl/primitive.h>
+#include <oscore/message.h>
+
+#include "testhelpers.h"
+
+struct option {
+    uint16_t number;
+    const char *value;
+    size_t value_len;
+};
+
+int testmain(int introduce_error)
+{
+    struct oscore_context_primitive_immutables key;
+    test_key_init(&key);
+    struct oscore_context_primitive client_primitive = { .immutables = &key };
+    struct oscore_context_primitive server_primitive = { .immutables = &key };
+    oscore_context_t client = { .type = OSCORE_CONTEXT_PRIMITIVE, .data = (void*)&client_primitive };
+    oscore_context_t server = { .type = OSCORE_CONTEXT_PRIMITIVE, .data = (void*)&server_primitive };
+
+    oscore_msg_native_t msg = oscore_test_msg_create();
+    oscore_msg_protected_t plaintext;
+    oscore_requestid_t request_id;
+    enum oscore_prepare_result prepared = oscore_prepare_request(msg, &plaintext, &client, &request_id);
+    assert(prepared == OSCORE_PREPARE_OK);
+    oscore_msg_protected_set_code(&plaintext, 2 /* POST */);
+
+    // Appended in an order independent modules might produce; the large
+    // numbers make for extended deltas that need re-encoding on insertion
+    const struct option appended[] = {
+        {252, "\xe1", 1},
+        {1, "\x01\x02", 2},
+        {60, "\x10", 1},
+        {258, "\x1a", 1},
+        {11, "a", 1},
+        {11, "b", 1},
+        {4, "etag", 4},
+        {17, "\x3c", 1},
+    };
+    oscore_msgerr_protected_t err;
+    for (size_t i = 0; i < sizeof(appended) / sizeof(appended[0]); ++i) {
+        err = oscore_msg_protected_append_option(&plaintext, appended[i].number,
+                (const uint8_t *)appended[i].value, appended[i].value_len);
+        assert(err == OK);
+    }
+
+    uint8_t *payload;
+    size_t payload_len;
+    err = oscore_msg_protected_map_payload(&plaintext, &payload, &payload_len);
+    assert(err == OK && payload_len >= 3);
+    memcpy(payload, "xyz", 3);
+    size_t mapped_len = payload_len;
+
+    // Payload moves along when options are added late
+    err = oscore_msg_protected_append_option(&plaintext, 12, NULL, 0);
+    assert(err == OK);
+    err = oscore_msg_protected_map_payload(&plaintext, &payload, &payload_len);
+    assert(err == OK);
+    assert(payload_len == mapped_len - 1);
+    assert(memcmp(payload, "xyz", 3) == 0);
+    err = oscore_msg_protected_trim_payload(&plaintext, 3);
+    assert(err == OK);
+
+    // After trimming, options would push the payload out of the message
+    err = oscore_msg_protected_append_option(&plaintext, 4, (const uint8_t *)"late", 4);
+    assert(err == OPTION_SEQUENCE);
+    err = oscore_msg_protected_map_payload(&plaintext, &payload, &payload_len);
+    assert(err == OK);
+    assert(payload_len == 3 && memcmp(payload, "xyz", 3) == 0);
+
+    oscore_msg_native_t out;
+    enum oscore_finish_result finished = oscore_encrypt_message(&plaintext, &out);
+    assert(finished == OSCORE_FINISH_OK);
+
+    oscore_oscoreoption_t header;
+    oscore_msg_protected_t unprotected;
+    oscore_requestid_t server_rid;
+    find_oscoreoption(out, &header);
+    enum oscore_unprotect_request_result unprotected_ok = oscore_unprotect_request(out, &unprotected, header, &server, &server_rid);
+    assert(unprotected_ok == OSCORE_UNPROTECT_REQUEST_OK);
+
+    const struct option expected[] = {
+        {1, "\x01\x02", 2},
+        {4, "etag", 4},
+        {11, "a", 1},
+        {11, introduce_error == 1 ? "a" : "b", 1},
+        {12, "", 0},
+        {17, "\x3c", 1},
+        {60, "\x10", 1},
+        {252, "\xe1", 1},
+        {258, "\x1a", 1},
+    };
+    const size_t expected_count = sizeof(expected) / sizeof(expected[0]);
+
+    oscore_msg_protected_optiter_t iter;
+    uint16_t number;
+    const uint8_t *value;
+    size_t value_len;
+    size_t count = 0;
+    oscore_msg_protected_optiter_init(&unprotected, &iter);
+    while (oscore_msg_protected_optiter_next(&unprotected, &iter, &number, &value, &value_len)) {
+        assert(count < expected_count);
+        assert(number == expected[count].number);
+        assert(value_len == expected[count].value_len);
+        assert(memcmp(value, expected[count].value, value_len) == 0);
+        count++;
+    }
+    err = oscore_msg_protected_optiter_finish(&unprotected, &iter);
+    assert(err == OK);
+    assert(count == expected_count);
+
+    err = oscore_msg_protected_map_payload(&unprotected, &payload, &payload_len);
+    assert(err == OK);
+    assert(payload_len == 3 && memcmp(payload, "xyz", 3) == 0);
+
+    oscore_test_msg_destroy(oscore_release_unprotected(&unprotected));
+    return 0;
+}
@@ -0,0 +1,98 @@
+#include <string.h>
+#include <assert.h>
+
+#include <oscore_native/message.h>
+#include <oscore_native/test.h>
+#include <oscore/protection.h>
+#include <oscore/contextpair.h>
+#include <oscore/context_impl/primitive.h>
+#include <oscore/message.h>
+
+#include "testhelpers.h"
+
+int testmain(int introduce_error)
+{
+    struct oscore_context_primitive_immutables key;
+    test_key_init(&key);
+    struct oscore_context_primitive client_primitive = { .immutables = &key };
+    struct oscore_context_primitive server_primitive = { .immutables = &key };
+    oscore_context_t client = { .type = OSCORE_CONTEXT_PRIMITIVE, .data = (void*)&client_primitive };
+    oscore_context_t server = { .type = OSCORE_CONTEXT_PRIMITIVE, .data = (void*)&server_primitive };
+
+    oscore_msg_protected_t plaintext;
+    oscore_requestid_t request_id;
+    enum oscore_prepare_result prepared = oscore_prepare_request(oscore_test_msg_create(), &plaintext, &client, &request_id);
+    assert(prepared == OSCORE_PREPARE_OK);
+    oscore_msg_protected_set_code(&plaintext, 2 /* POST */);
+    oscore_msgerr_protected_t err = oscore_msg_protected_append_option(&plaintext, 12, (uint8_t*)"\x3c", 1);
+    assert(err == OK);
+
+    // Header, cached blob and generated tail
+    const uint8_t tail[2] = {0x18, introduce_error == 1 ? 0x2b : 0x2a};
+    const oscore_msg_protected_payloadpart_t parts[] = {
+        {(const uint8_t *)"\xa2\x01", 2},
+        {NULL, 0},
+        {(const uint8_t *)"\x63" "abc" "\x02", 5},
+        {tail, sizeof(tail)},
+    };
+
+    // Does not fit any message
+    uint8_t large[4096] = {0};
+    const oscore_msg_protected_payloadpart_t too_large[] = {
+        parts[0],
+        {large, sizeof(large)},
+    };
+    oscore_msg_protected_t rejected;
+    oscore_requestid_t rejected_id;
+    prepared = oscore_prepare_request(oscore_test_msg_create(), &rejected, &client, &rejected_id);
+    assert(prepared == OSCORE_PREPARE_OK);
+    err = oscore_msg_protected_write_payload(&rejected, too_large, 2);
+    assert(err == MESSAGESIZE);
+    oscore_test_msg_destroy(rejected.backend);
+
+    err = oscore_msg_protected_write_payload(&plaintext, parts, sizeof(parts) / sizeof(parts[0]));
+    assert(err == OK);
+
+    oscore_msg_native_t out;
+    enum oscore_finish_result finished = oscore_encrypt_message(&plaintext, &out);
+    assert(finished == OSCORE_FINISH_OK);
+
+    oscore_oscoreoption_t header;
+    oscore_msg_protected_t unprotected;
+    oscore_requestid_t server_rid;
+    find_oscoreoption(out, &header);
+    enum oscore_unprotect_request_result unprotected_ok = oscore_unprotect_request(out, &unprotected, header, &server, &server_rid);
+    assert(unprotected_ok == OSCORE_UNPROTECT_REQUEST_OK);
+
+    uint8_t *payload;
+    size_t payload_len;
+    err = oscore_msg_protected_map_payload(&unprotected, &payload, &payload_len);
+    assert(err == OK);
+    assert(payload_len == 9);
+    assert(memcmp(payload, "\xa2\x01\x63" "abc" "\x02\x18\x2a", 9) == 0);
+
+    oscore_test_msg_destroy(oscore_release_unprotected(&unprotected));
+
+    // A payload that is used to its end needs no trimming
+
+    prepared = oscore_prepare_request(oscore_test_msg_create(), &plaintext, &client, &request_id);
+    assert(prepared == OSCORE_PREPARE_OK);
+    oscore_msg_protected_set_code(&plaintext, 2 /* POST */);
+    err = oscore_msg_protected_map_payload(&plaintext, &payload, &payload_len);
+    assert(err == OK);
+    size_t full_len = payload_len;
+    memset(payload, 'z', full_len);
+    finished = oscore_encrypt_message(&plaintext, &out);
+    assert(finished == OSCORE_FINISH_OK);
+
+    find_oscoreoption(out, &header);
+    unprotected_ok = oscore_unprotect_request(out, &unprotected, header, &server, &server_rid);
+    assert(unprotected_ok == OSCORE_UNPROTECT_REQUEST_OK);
+    err = oscore_msg_protected_map_payload(&unprotected, &payload, &payload_len);
+    assert(err == OK);
+    assert(payload_len == full_len);
+    assert(payload[0] == 'z' && payload[full_len - 1] == 'z');
+
+    oscore_test_msg_destroy(oscore_release_unprotected(&unprotected));
+    return 0;
+}
@@ -0,0 +1,131 @@
+#include <string.h>
+#include <assert.h>
+
+#include <oscore_native/message.h>
+#include <oscore_native/test.h>
+#include <oscore/protection.h>
+#include <oscore/contextpair.h>
+#include <oscore/context_impl/primitive.h>
+#include <oscore/message.h>
+
+#include "testhelpers.h"
+
+static size_t oscoreoption_length(oscore_msg_native_t msg)
+{
+    oscore_msg_native_optiter_t iter;
+    uint16_t number;
+    const uint8_t *value;
+    size_t value_length;
+    size_t found = SIZE_MAX;
+    oscore_msg_native_optiter_init(msg, &iter);
+    while (oscore_msg_native_optiter_next(msg, &iter, &number, &value, &value_length)) {
+        if (number == 9) {
+            found = value_length;
+        }
+    }
+    oscore_msg_native_optiter_finish(msg, &iter);
+    assert(found != SIZE_MAX);
+    return found;
+}
+
+/** Build a message with the template and payload length, and compare its
+ * sizes with the prediction */
+static void build_and_compare(
+        oscore_context_t *secctx,
+        bool is_request,
+        oscore_requestid_t *request_id,
+        const oscore_msg_protected_template_t *template,
+        size_t payload_len,
+        const struct oscore_msg_protected_size *predicted
+        )
+{
+    oscore_msg_native_t msg = oscore_test_msg_create();
+    oscore_msg_protected_t plaintext;
+    enum oscore_prepare_result prepared = is_request ?
+        oscore_prepare_request(msg, &plaintext, secctx, request_id) :
+        oscore_prepare_response(msg, &plaintext, secctx, request_id);
+    assert(prepared == OSCORE_PREPARE_OK);
+    oscore_msg_protected_set_code(&plaintext, is_request ? 1 : 0x45);
+
+    oscore_msgerr_protected_t err;
+    if (template != NULL) {
+        err = oscore_msg_protected_append_template(&plaintext, template);
+        assert(err == OK);
+    }
+    uint8_t *payload;
+    size_t available;
+    err = oscore_msg_protected_map_payload(&plaintext, &payload, &available);
+    assert(err == OK && available >= payload_len);
+    memset(payload, 'x', payload_len);
+    err = oscore_msg_protected_trim_payload(&plaintext, payload_len);
+    assert(err == OK);
+
+    oscore_msg_native_t out;
+    enum oscore_finish_result finished = oscore_encrypt_message(&plaintext, &out);
+    assert(finished == OSCORE_FINISH_OK);
+
+    uint8_t *ciphertext;
+    size_t ciphertext_len;
+    oscore_msg_native_map_payload(out, &ciphertext, &ciphertext_len);
+    assert(ciphertext_len == predicted->payload_length);
+    assert(oscoreoption_length(out) == predicted->oscore_option_length);
+
+    oscore_test_msg_destroy(out);
+}
+
+int testmain(int introduce_error)
+{
+    struct oscore_context_primitive_immutables key;
+    test_key_init(&key);
+    key.sender_id_len = 1;
+    key.sender_id[0] = 0x42;
+    struct oscore_context_primitive primitive = {
+        .immutables = &key,
+        // Large enough for a 2-byte Partial IV
+        .sender_sequence_number = 300,
+    };
+    oscore_context_t secctx = { .type = OSCORE_CONTEXT_PRIMITIVE, .data = (void*)&primitive };
+    size_t taglength = oscore_crypto_aead_get_taglength(key.aeadalg);
+
+    uint8_t buffer[16];
+    oscore_msg_protected_template_t template;
+    oscore_msg_protected_template_init(&template, buffer, sizeof(buffer));
+    oscore_msgerr_protected_t err;
+    err = oscore_msg_protected_template_add(&template, 11, (uint8_t*)"temp", 4);
+    assert(err == OK);
+    err = oscore_msg_protected_template_add(&template, 17, (uint8_t*)"\x3c", 1);
+    assert(err == OK);
+
+    struct oscore_msg_protected_size size;
+    oscore_requestid_t request_id;
+    bool ok;
+
+    // Request: flags, 2 byte PIV, KID; code, options, marker, payload, tag
+    ok = oscore_msg_protected_predict_size(&secctx, true, NULL, &template, 20, &size);
+    assert(ok);
+    assert(size.oscore_option_length == 1 + 2 + 1);
+    assert(size.payload_length == 1 + 7 + 1 + 20 + taglength);
+    build_and_compare(&secctx, true, &request_id, &template, introduce_error == 1 ? 21 : 20, &size);
+
+    // Response that can use the request's nonce
+    request_id.is_first_use = true;
+    ok = oscore_msg_protected_predict_size(&secctx, false, &request_id, NULL, 0, &size);
+    assert(ok);
+    assert(size.oscore_option_length == 0);
+    assert(size.payload_length == 1 + taglength);
+    build_and_compare(&secctx, false, &request_id, NULL, 0, &size);
+
+    // Response that needs a sequence number of its own
+    assert(!request_id.is_first_use);
+    ok = oscore_msg_protected_predict_size(&secctx, false, &request_id, &template, 1, &size);
+    assert(ok);
+    assert(size.oscore_option_length == 1 + 2);
+    build_and_compare(&secctx, false, &request_id, &template, 1, &size);
+
+    // Exhausted context
+    primitive.sender_sequence_number = OSCORE_SEQNO_MAX;
+    ok = oscore_msg_protected_predict_size(&secctx, true, NULL, NULL, 0, &size);
+    assert(!ok);
+
+    return 0;
+}
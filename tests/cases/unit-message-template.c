@@ -0,0 +1,129 @@
+#include <string.h>
+#include <assert.h>
+
+#include <oscore_native/message.h>
+#include <oscore_native/test.h>
+#include <oscore/protection.h>
+#include <oscore/contextpair.h>
+#include <oscore/context_impl/primitive.h>
+#include <oscore/message.h>
+
+#include "testhelpers.h"
+
+struct option {
+    uint16_t number;
+    const char *value;
+    size_t value_len;
+};
+
+static const struct option expected[] = {
+    {1, "\x01", 1},
+    {4, "\xa0\xa1\xa2\xa3", 4},
+    {12, "\x3c", 1},
+    {14, "\x0e\x10", 2},
+    {17, "\x3c", 1},
+};
+
+/** Send the prepared request over to the server, and check that its options
+ * come out as expected */
+static void check(
+        oscore_msg_protected_t *plaintext,
+        oscore_context_t *server
+        )
+{
+    oscore_msgerr_protected_t err = oscore_msg_protected_trim_payload(plaintext, 0);
+    assert(err == OK);
+
+    oscore_msg_native_t out;
+    enum oscore_finish_result finished = oscore_encrypt_message(plaintext, &out);
+    assert(finished == OSCORE_FINISH_OK);
+
+    oscore_oscoreoption_t header;
+    oscore_msg_protected_t unprotected;
+    oscore_requestid_t server_rid;
+    find_oscoreoption(out, &header);
+    enum oscore_unprotect_request_result unprotected_ok = oscore_unprotect_request(out, &unprotected, header, server, &server_rid);
+    assert(unprotected_ok == OSCORE_UNPROTECT_REQUEST_OK);
+
+    oscore_msg_protected_optiter_t iter;
+    uint16_t number;
+    const uint8_t *value;
+    size_t value_len;
+    size_t count = 0;
+    oscore_msg_protected_optiter_init(&unprotected, &iter);
+    while (oscore_msg_protected_optiter_next(&unprotected, &iter, &number, &value, &value_len)) {
+        assert(count < sizeof(expected) / sizeof(expected[0]));
+        assert(number == expected[count].number);
+        assert(value_len == expected[count].value_len);
+        assert(memcmp(value, expected[count].value, value_len) == 0);
+        count++;
+    }
+    err = oscore_msg_protected_optiter_finish(&unprotected, &iter);
+    assert(err == OK);
+    assert(count == sizeof(expected) / sizeof(expected[0]));
+
+    oscore_test_msg_destroy(oscore_release_unprotected(&unprotected));
+}
+
+int testmain(int introduce_error)
+{
+    struct oscore_context_primitive_immutables key;
+    test_key_init(&key);
+    struct oscore_context_primitive client_primitive = { .immutables = &key };
+    struct oscore_context_primitive server_primitive = { .immutables = &key };
+    oscore_context_t client = { .type = OSCORE_CONTEXT_PRIMITIVE, .data = (void*)&client_primitive };
+    oscore_context_t server = { .type = OSCORE_CONTEXT_PRIMITIVE, .data = (void*)&server_primitive };
+
+    uint8_t buffer[16];
+    oscore_msg_protected_template_t template;
+    oscore_msg_protected_template_init(&template, buffer, sizeof(buffer));
+
+    oscore_msgerr_protected_t err;
+    err = oscore_msg_protected_template_add(&template, 4, (uint8_t*)"\xa0\xa1\xa2\xa3", 4);
+    assert(err == OK);
+    err = oscore_msg_protected_template_add(&template, 12, (uint8_t*)"\x3c", 1);
+    assert(err == OK);
+    err = oscore_msg_protected_template_add(&template, 14, (uint8_t*)(introduce_error == 1 ? "\x0e\x11" : "\x0e\x10"), 2);
+    assert(err == OK);
+    // Out of sequence
+    err = oscore_msg_protected_template_add(&template, 8, (uint8_t*)"x", 1);
+    assert(err == OPTION_SEQUENCE);
+    // Not an inner option
+    err = oscore_msg_protected_template_add(&template, 39, (uint8_t*)"coap", 4);
+    assert(err == INVALID_ARG_ERROR);
+    // Exceeding the buffer
+    err = oscore_msg_protected_template_add(&template, 20, (uint8_t*)"0123456789", 10);
+    assert(err == OPTION_SIZE);
+
+    oscore_msg_protected_t plaintext;
+    oscore_requestid_t request_id;
+    enum oscore_prepare_result prepared;
+
+    // Template continues the options in sequence
+
+    prepared = oscore_prepare_request(oscore_test_msg_create(), &plaintext, &client, &request_id);
+    assert(prepared == OSCORE_PREPARE_OK);
+    oscore_msg_protected_set_code(&plaintext, 1 /* GET */);
+    err = oscore_msg_protected_append_option(&plaintext, 1, (uint8_t*)"\x01", 1);
+    assert(err == OK);
+    err = oscore_msg_protected_append_template(&plaintext, &template);
+    assert(err == OK);
+    err = oscore_msg_protected_append_option(&plaintext, 17, (uint8_t*)"\x3c", 1);
+    assert(err == OK);
+    check(&plaintext, &server);
+
+    // Template options are inserted between others
+
+    prepared = oscore_prepare_request(oscore_test_msg_create(), &plaintext, &client, &request_id);
+    assert(prepared == OSCORE_PREPARE_OK);
+    oscore_msg_protected_set_code(&plaintext, 1 /* GET */);
+    err = oscore_msg_protected_append_option(&plaintext, 1, (uint8_t*)"\x01", 1);
+    assert(err == OK);
+    err = oscore_msg_protected_append_option(&plaintext, 17, (uint8_t*)"\x3c", 1);
+    assert(err == OK);
+    err = oscore_msg_protected_append_template(&plaintext, &template);
+    assert(err == OK);
+    check(&plaintext, &server);
+
+    return 0;
+}
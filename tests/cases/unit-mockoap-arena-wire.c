@@ -0,0 +1,151 @@
+#include <string.h>
+#include <assert.h>
+
+#include <oscore_native/message.h>
+#include <oscore_native/test.h>
+#include <oscore/protection.h>
+#include <oscore/contextpair.h>
+#include <oscore/context_impl/primitive.h>
+#include <oscore/message.h>
+#include <mockoap_arena.h>
+
+#include "testhelpers.h"
+
+static _Alignas(max_align_t) uint8_t wire_arena_memory[4096];
+static struct mock_arena wire_arena;
+
+/** Write @p msg to the wire, parse it back from there, and check that the
+ * parsed message serializes to the same bytes */
+static struct mock_message *roundtrip(const struct mock_message *msg, uint8_t *wire, size_t wire_size, size_t *wire_len)
+{
+    *wire_len = mock_message_serialize(msg, wire, wire_size);
+    assert(*wire_len != 0);
+    // Too short to contain the full message
+    assert(mock_message_serialize(msg, wire, *wire_len - 1) == 0);
+
+    struct mock_message *parsed = mock_message_parse(&wire_arena, wire, *wire_len);
+    assert(parsed != NULL);
+    assert(parsed->type == msg->type && parsed->message_id == msg->message_id);
+    assert(parsed->token_len == msg->token_len && memcmp(parsed->token, msg->token, msg->token_len) == 0);
+    assert(parsed->options_count == msg->options_count);
+
+    uint8_t again[512];
+    size_t again_len = mock_message_serialize(parsed, again, sizeof(again));
+    assert(again_len == *wire_len && memcmp(again, wire, again_len) == 0);
+    (void)again_len;
+
+    return parsed;
+}
+
+int testmain(int introduce_error)
+{
+    mock_arena_init(&wire_arena, wire_arena_memory, sizeof(wire_arena_memory));
+    uint8_t wire[512];
+    size_t wire_len;
+    oscore_msgerr_native_t nerr;
+
+    // Options that need one and two bytes of extended delta and length
+
+    struct mock_message *plain = mock_message_create(&wire_arena, 4, 400, 16);
+    assert(plain != NULL);
+    plain->type = 1;
+    plain->message_id = 0xabcd;
+    plain->token_len = 2;
+    memcpy(plain->token, "\x12\x34", 2);
+    oscore_msg_native_set_code(plain, 0x45);
+    uint8_t long_value[300];
+    memset(long_value, 'v', sizeof(long_value));
+    nerr = oscore_msg_native_append_option(plain, 11, long_value, 20);
+    assert(!oscore_msgerr_native_is_error(nerr));
+    nerr = oscore_msg_native_append_option(plain, 2048, long_value, sizeof(long_value));
+    assert(!oscore_msgerr_native_is_error(nerr));
+    uint8_t *payload;
+    size_t payload_len;
+    oscore_msg_native_map_payload(plain, &payload, &payload_len);
+    memcpy(payload, "data", 4);
+    oscore_msg_native_trim_payload(plain, 4);
+
+    struct mock_message *parsed = roundtrip(plain, wire, sizeof(wire), &wire_len);
+    assert(oscore_msg_native_get_code(parsed) == 0x45);
+    assert(parsed->options[0].number == 11 && parsed->options[0].data_len == 20);
+    assert(parsed->options[1].number == 2048 && parsed->options[1].data_len == sizeof(long_value));
+    assert(memcmp(parsed->options[1].data, long_value, sizeof(long_value)) == 0);
+    assert(parsed->payload_len == 4 && memcmp(parsed->payload, "data", 4) == 0);
+
+    // Truncated anywhere inside the second option, it is rejected
+
+    size_t second_option = 4 + 2 + 1 + 1 + 20;
+    size_t options_end = wire_len - 5;
+    for (size_t truncated = second_option + 1; truncated < options_end; ++truncated) {
+        assert(mock_message_parse(&wire_arena, wire, truncated) == NULL);
+    }
+
+    mock_arena_reset(&wire_arena);
+
+    // A protected request survives the trip through the wire format
+
+    struct oscore_context_primitive_immutables key;
+    test_key_init(&key);
+    struct oscore_context_primitive client_primitive = { .immutables = &key };
+    struct oscore_context_primitive server_primitive = { .immutables = &key };
+    oscore_context_t client = { .type = OSCORE_CONTEXT_PRIMITIVE, .data = (void*)&client_primitive };
+    oscore_context_t server = { .type = OSCORE_CONTEXT_PRIMITIVE, .data = (void*)&server_primitive };
+
+    oscore_msg_native_t request = oscore_test_msg_create();
+    request->message_id = 0x1001;
+    oscore_requestid_t client_rid, server_rid;
+    oscore_msg_protected_t plaintext;
+    enum oscore_prepare_result prepared = oscore_prepare_request(request, &plaintext, &client, &client_rid);
+    assert(prepared == OSCORE_PREPARE_OK);
+    oscore_msg_protected_set_code(&plaintext, 1 /* GET */);
+    oscore_msgerr_protected_t err;
+    err = oscore_msg_protected_append_option(&plaintext, 3 /* Uri-Host */, (const uint8_t *)"sensor.example.com", 18);
+    assert(err == OK);
+    err = oscore_msg_protected_append_option(&plaintext, 11 /* Uri-Path */, (const uint8_t *)"temperature", 11);
+    assert(err == OK);
+    const oscore_msg_protected_payloadpart_t part = {(const uint8_t *)"celsius", 7};
+    err = oscore_msg_protected_write_payload(&plaintext, &part, 1);
+    assert(err == OK);
+    oscore_msg_native_t out;
+    enum oscore_finish_result finished = oscore_encrypt_message(&plaintext, &out);
+    assert(finished == OSCORE_FINISH_OK);
+
+    struct mock_message *received = roundtrip(out, wire, sizeof(wire), &wire_len);
+    oscore_test_msg_destroy(out);
+
+    if (introduce_error == 1) {
+        received->payload[0] ^= 0x01;
+    }
+
+    oscore_oscoreoption_t header;
+    find_oscoreoption(received, &header);
+    oscore_msg_protected_t unprotected;
+    enum oscore_unprotect_request_result reqresult = oscore_unprotect_request(received, &unprotected, header, &server, &server_rid);
+    assert(reqresult == OSCORE_UNPROTECT_REQUEST_OK);
+    assert(oscore_msg_protected_get_code(&unprotected) == 1);
+
+    oscore_msg_protected_optiter_t iter;
+    uint16_t number;
+    const uint8_t *value;
+    size_t value_len;
+    bool seen_host = false, seen_path = false;
+    oscore_msg_protected_optiter_init(&unprotected, &iter);
+    while (oscore_msg_protected_optiter_next(&unprotected, &iter, &number, &value, &value_len)) {
+        if (number == 3) {
+            seen_host = value_len == 18 && memcmp(value, "sensor.example.com", 18) == 0;
+        }
+        if (number == 11) {
+            seen_path = value_len == 11 && memcmp(value, "temperature", 11) == 0;
+        }
+    }
+    err = oscore_msg_protected_optiter_finish(&unprotected, &iter);
+    assert(err == OK);
+    assert(seen_host && seen_path);
+
+    err = oscore_msg_protected_map_payload(&unprotected, &payload, &payload_len);
+    assert(err == OK);
+    assert(payload_len == 7 && memcmp(payload, "celsius", 7) == 0);
+    oscore_release_unprotected(&unprotected);
+
+    return 0;
+}
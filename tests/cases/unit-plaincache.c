@@ -0,0 +1,211 @@
+#include <string.h>
+#include <assert.h>
+
+#include <oscore_native/message.h>
+#include <oscore_native/test.h>
+#include <oscore/protection.h>
+#include <oscore/contextpair.h>
+#include <oscore/context_impl/primitive.h>
+#include <oscore/message.h>
+#include <oscore/plaincache.h>
+
+#include "testhelpers.h"
+
+/** Two clients, each with its security context pair */
+static oscore_context_t clients[2], servers[2];
+static struct oscore_plaincache cache;
+static int handler_runs;
+
+/** Send a request for /temp?unit=c (asking for the block described by the
+ * one-byte Block2 value @p block2 if not NULL) from client @p peer to the
+ * server, which serves it from the cache if possible, and return the
+ * decrypted response */
+static void exchange(size_t peer, uint8_t code, bool observe, const uint8_t *block2, uint32_t now, oscore_msg_protected_t *response)
+{
+    oscore_context_t *client = &clients[peer];
+    oscore_context_t *server = &servers[peer];
+    oscore_msg_protected_t plaintext;
+    oscore_requestid_t client_rid, server_rid;
+    enum oscore_prepare_result prepared = oscore_prepare_request(oscore_test_msg_create(), &plaintext, client, &client_rid);
+    assert(prepared == OSCORE_PREPARE_OK);
+    oscore_msg_protected_set_code(&plaintext, code);
+    oscore_msgerr_protected_t err;
+    if (observe) {
+        err = oscore_msg_protected_append_option(&plaintext, 6, (const uint8_t *)"", 0);
+        assert(err == OK);
+    }
+    err = oscore_msg_protected_append_option(&plaintext, 11, (const uint8_t *)"temp", 4);
+    assert(err == OK);
+    err = oscore_msg_protected_append_option(&plaintext, 15, (const uint8_t *)"unit=c", 6);
+    assert(err == OK);
+    if (block2 != NULL) {
+        err = oscore_msg_protected_append_option(&plaintext, 23, block2, 1);
+        assert(err == OK);
+    }
+    err = oscore_msg_protected_trim_payload(&plaintext, 0);
+    assert(err == OK);
+    oscore_msg_native_t out;
+    enum oscore_finish_result finished = oscore_encrypt_message(&plaintext, &out);
+    assert(finished == OSCORE_FINISH_OK);
+
+    oscore_oscoreoption_t header;
+    oscore_msg_protected_t request;
+    find_oscoreoption(out, &header);
+    enum oscore_unprotect_request_result reqresult = oscore_unprotect_request(out, &request, header, server, &server_rid);
+    assert(reqresult == OSCORE_UNPROTECT_REQUEST_OK);
+
+    struct oscore_plaincache_key key;
+    bool cacheable = oscore_plaincache_key_from_request(&key, &request, server);
+    oscore_test_msg_destroy(oscore_release_unprotected(&request));
+    const struct oscore_plaincache_entry *entry = cacheable ? oscore_plaincache_find(&cache, &key, now) : NULL;
+
+    prepared = oscore_prepare_response(oscore_test_msg_create(), &plaintext, server, &server_rid);
+    assert(prepared == OSCORE_PREPARE_OK);
+    if (entry != NULL) {
+        err = oscore_plaincache_write(entry, &plaintext, now);
+        assert(err == OK);
+    } else {
+        handler_runs += 1;
+        oscore_msg_protected_set_code(&plaintext, 0x45);
+        err = oscore_msg_protected_append_option(&plaintext, 4 /* ETag */, (const uint8_t *)"\x01\x02", 2);
+        assert(err == OK);
+        err = oscore_msg_protected_append_option(&plaintext, 12 /* Content-Format */, (const uint8_t *)"", 0);
+        assert(err == OK);
+        err = oscore_msg_protected_append_option(&plaintext, 28 /* Size2 */, (const uint8_t *)"\x04", 1);
+        assert(err == OK);
+        const oscore_msg_protected_payloadpart_t payload = {(const uint8_t *)"21.5", 4};
+        err = oscore_msg_protected_write_payload(&plaintext, &payload, 1);
+        assert(err == OK);
+        if (cacheable) {
+            bool stored = oscore_plaincache_store(&cache, &key, &plaintext, 30, now);
+            assert(stored);
+        }
+    }
+    finished = oscore_encrypt_message(&plaintext, &out);
+    assert(finished == OSCORE_FINISH_OK);
+
+    find_oscoreoption(out, &header);
+    enum oscore_unprotect_response_result resresult = oscore_unprotect_response(out, response, header, client, &client_rid);
+    assert(resresult == OSCORE_UNPROTECT_RESPONSE_OK);
+}
+
+/** Check the response to be the cached representation, with a Max-Age of @p
+ * max_age (or none if negative) */
+static void check_response(oscore_msg_protected_t *response, int max_age)
+{
+    assert(oscore_msg_protected_get_code(response) == 0x45);
+
+    const uint8_t *value;
+    size_t value_len;
+    oscore_msgerr_protected_t err;
+    err = oscore_msg_protected_get_inner_option(response, 4, 0, &value, &value_len);
+    assert(err == OK && value_len == 2 && memcmp(value, "\x01\x02", 2) == 0);
+    err = oscore_msg_protected_get_inner_option(response, 12, 0, &value, &value_len);
+    assert(err == OK && value_len == 0);
+    err = oscore_msg_protected_get_inner_option(response, 28, 0, &value, &value_len);
+    assert(err == OK && value_len == 1 && value[0] == 4);
+    err = oscore_msg_protected_get_inner_option(response, 14, 0, &value, &value_len);
+    if (max_age < 0) {
+        assert(err == INVALID_ARG_ERROR);
+    } else {
+        assert(err == OK && value_len == 1 && value[0] == max_age);
+    }
+
+    uint8_t *payload;
+    size_t payload_len;
+    err = oscore_msg_protected_map_payload(response, &payload, &payload_len);
+    assert(err == OK);
+    assert(payload_len == 4 && memcmp(payload, "21.5", 4) == 0);
+
+    oscore_test_msg_destroy(oscore_release_unprotected(response));
+}
+
+int testmain(int introduce_error)
+{
+    struct oscore_context_primitive_immutables keys[2];
+    struct oscore_context_primitive client_primitives[2];
+    struct oscore_context_primitive server_primitives[2];
+    for (size_t i = 0; i < 2; ++i) {
+        test_key_init(&keys[i]);
+        keys[i].sender_key[0] += i;
+        keys[i].recipient_key[0] += i;
+        client_primitives[i] = (struct oscore_context_primitive) { .immutables = &keys[i] };
+        server_primitives[i] = (struct oscore_context_primitive) { .immutables = &keys[i] };
+        clients[i] = (oscore_context_t) { .type = OSCORE_CONTEXT_PRIMITIVE, .data = (void*)&client_primitives[i] };
+        servers[i] = (oscore_context_t) { .type = OSCORE_CONTEXT_PRIMITIVE, .data = (void*)&server_primitives[i] };
+    }
+
+    struct oscore_plaincache_entry entries[2];
+    oscore_plaincache_init(&cache, entries, 2);
+
+    oscore_msg_protected_t response;
+
+    // Miss, then hits with decreasing Max-Age
+
+    exchange(0, 1 /* GET */, false, NULL, 100, &response);
+    check_response(&response, -1);
+    assert(handler_runs == 1);
+
+    exchange(0, 1 /* GET */, false, NULL, 110, &response);
+    check_response(&response, introduce_error == 1 ? 30 : 20);
+    assert(handler_runs == 1);
+
+    exchange(0, 1 /* GET */, false, NULL, 129, &response);
+    check_response(&response, 1);
+    assert(handler_runs == 1);
+
+    // Other methods and observations always go to the handler
+
+    exchange(0, 5 /* FETCH */, false, NULL, 129, &response);
+    check_response(&response, -1);
+    exchange(0, 1 /* GET */, true, NULL, 129, &response);
+    check_response(&response, -1);
+    assert(handler_runs == 3);
+
+    // Requests for a block are not served the cached response, not even for
+    // the first block, which may need to be smaller
+
+    exchange(0, 1 /* GET */, false, (const uint8_t *)"\x10", 129, &response);
+    check_response(&response, -1);
+    exchange(0, 1 /* GET */, false, (const uint8_t *)"\x00", 129, &response);
+    check_response(&response, -1);
+    assert(handler_runs == 5);
+
+    // Expired
+
+    exchange(0, 1 /* GET */, false, NULL, 130, &response);
+    check_response(&response, -1);
+    assert(handler_runs == 6);
+
+    exchange(0, 1 /* GET */, false, NULL, 131, &response);
+    check_response(&response, 29);
+    assert(handler_runs == 6);
+
+    // Another security context does not get the first one's response
+
+    exchange(1, 1 /* GET */, false, NULL, 131, &response);
+    check_response(&response, -1);
+    assert(handler_runs == 7);
+
+    exchange(1, 1 /* GET */, false, NULL, 132, &response);
+    check_response(&response, 29);
+    exchange(0, 1 /* GET */, false, NULL, 132, &response);
+    check_response(&response, 28);
+    assert(handler_runs == 7);
+
+    // Invalidated by the resource's path, in all scopes
+
+    struct oscore_plaincache_key resource;
+    oscore_plaincache_key_init(&resource, NULL);
+    bool added = oscore_plaincache_key_add(&resource, 11, (const uint8_t *)"temp", 4);
+    assert(added);
+    oscore_plaincache_invalidate(&cache, &resource);
+
+    exchange(0, 1 /* GET */, false, NULL, 133, &response);
+    check_response(&response, -1);
+    exchange(1, 1 /* GET */, false, NULL, 133, &response);
+    check_response(&response, -1);
+    assert(handler_runs == 9);
+
+    return 0;
+}
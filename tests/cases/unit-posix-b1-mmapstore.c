@@ -0,0 +1,102 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <string.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <oscore/context_impl/b1.h>
+#include <oscore_posix/b1_mmapstore.h>
+
+#include "testhelpers.h"
+
+#define SLOTS 4
+
+static struct oscore_context_b1 contexts[SLOTS];
+static struct oscore_context_primitive_immutables immutables[SLOTS];
+static struct oscore_context_b1_persistrecord records[SLOTS];
+static bool found[SLOTS];
+
+/** Open the store file at @p path and restore all contexts from it */
+static void reopen_and_restore(struct oscore_posix_b1_mmapstore *store, const char *path)
+{
+    bool ok = oscore_posix_b1_mmapstore_open(store, path, SLOTS);
+    assert(ok);
+    ok = oscore_posix_b1_mmapstore_restore(store, contexts, immutables, records, found);
+    assert(ok);
+    (void)ok;
+}
+
+int testmain(int introduce_error)
+{
+    char path[] = "/tmp/unit-posix-b1-mmapstore-XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    close(fd);
+
+    struct oscore_context_primitive_immutables key;
+    test_key_init(&key);
+    key.recipient_id_len = 1;
+    key.recipient_id[0] = 0x01;
+
+    // A fresh (empty) file is extended to hold all slots
+
+    struct oscore_posix_b1_mmapstore store;
+    bool ok = oscore_posix_b1_mmapstore_open(&store, path, SLOTS);
+    assert(ok);
+
+    struct oscore_context_b1_persistrecord record = {
+        .seqno = 100,
+        .has_replaydata = false,
+    };
+    ok = oscore_posix_b1_mmapstore_commit(&store, 1, &key, &record);
+    assert(ok);
+    record.seqno = 200;
+    record.has_replaydata = true;
+    record.replaydata.left_edge = 150;
+    record.replaydata.window = 0x80000001;
+    ok = oscore_posix_b1_mmapstore_commit(&store, 1, &key, &record);
+    assert(ok);
+    record.seqno = 50;
+    record.has_replaydata = false;
+    ok = oscore_posix_b1_mmapstore_commit(&store, 3, &key, &record);
+    assert(ok);
+    oscore_posix_b1_mmapstore_close(&store);
+
+    // Restored with replay data where it was stored
+
+    reopen_and_restore(&store, path);
+    assert(!found[0] && found[1] && !found[2] && found[3]);
+    assert(records[1].seqno == 200 && records[1].has_replaydata);
+    assert(memcmp(immutables[1].recipient_key, key.recipient_key, sizeof(key.recipient_key)) == 0);
+    assert(contexts[1].high_sequence_number == 200);
+    assert(contexts[1].primitive.replay_window_left_edge == 150);
+    assert(contexts[1].primitive.replay_window == 0x80000001);
+    assert(records[3].seqno == 50 && !records[3].has_replaydata);
+    assert(contexts[3].primitive.replay_window_left_edge == OSCORE_SEQNO_MAX);
+    oscore_posix_b1_mmapstore_close(&store);
+
+    // The replay data was removed from the file when it was used
+
+    reopen_and_restore(&store, path);
+    assert(found[1] && records[1].seqno == 200);
+    assert(records[1].has_replaydata == (introduce_error == 1));
+    assert(contexts[1].primitive.replay_window_left_edge == OSCORE_SEQNO_MAX);
+
+    // A newer version that was torn while being written is ignored
+
+    struct oscore_context_b1_storeslot before = store.slots[1];
+    record.seqno = 300;
+    ok = oscore_posix_b1_mmapstore_commit(&store, 1, &key, &record);
+    assert(ok);
+    size_t changed = memcmp(before.versions[0], store.slots[1].versions[0], sizeof(before.versions[0])) != 0 ? 0 : 1;
+    store.slots[1].versions[changed][10] ^= 0x01;
+    oscore_posix_b1_mmapstore_close(&store);
+
+    reopen_and_restore(&store, path);
+    assert(found[1] && records[1].seqno == 200);
+    oscore_posix_b1_mmapstore_close(&store);
+
+    unlink(path);
+    return 0;
+}
@@ -0,0 +1,212 @@
+#define _GNU_SOURCE
+
+#include <string.h>
+#include <assert.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <oscore_native/message.h>
+#include <oscore/protection.h>
+#include <oscore/contextpair.h>
+#include <oscore/context_impl/primitive.h>
+#include <oscore/message.h>
+#include <oscore_posix/tcp.h>
+
+#include "testhelpers.h"
+
+#define REQUESTS 3
+
+/** Payload sizes that need no, a 2-byte and a 4-byte extended length */
+static const size_t payload_sizes[REQUESTS] = {5, 1000, 70000};
+
+static uint8_t request_buffers[REQUESTS][72 * 1024];
+static uint8_t server_rx[128 * 1024];
+static uint8_t client_rx[1024];
+
+static uint8_t pattern(size_t request, size_t index)
+{
+    return (request * 31 + index * 7) & 0xff;
+}
+
+static void expect_csm(int fd, struct oscore_posix_tcp_reader *reader, uint32_t max_message_size)
+{
+    struct oscore_posix_msg msg;
+    int received = oscore_posix_tcp_receive(fd, reader, &msg);
+    assert(received == 1);
+    assert(oscore_msg_native_get_code(&msg) == 0xe1);
+
+    oscore_msg_native_optiter_t iter;
+    uint16_t number;
+    const uint8_t *value;
+    size_t value_length;
+    oscore_msg_native_optiter_init(&msg, &iter);
+    bool found = oscore_msg_native_optiter_next(&msg, &iter, &number, &value, &value_length);
+    assert(found && number == 2);
+    uint32_t announced = 0;
+    for (size_t i = 0; i < value_length; ++i) {
+        announced = (announced << 8) | value[i];
+    }
+    assert(announced == max_message_size);
+    oscore_msg_native_optiter_finish(&msg, &iter);
+}
+
+/** Receive a request, and answer with its payload's length and sum */
+static void serve_one(int fd, struct oscore_posix_tcp_reader *reader, oscore_context_t *server)
+{
+    struct oscore_posix_msg request;
+    int received = oscore_posix_tcp_receive(fd, reader, &request);
+    assert(received == 1);
+
+    oscore_oscoreoption_t header;
+    find_oscoreoption(&request, &header);
+    oscore_requestid_t rid;
+    oscore_msg_protected_t unprotected;
+    enum oscore_unprotect_request_result reqresult = oscore_unprotect_request(&request, &unprotected, header, server, &rid);
+    assert(reqresult == OSCORE_UNPROTECT_REQUEST_OK);
+    assert(oscore_msg_protected_get_code(&unprotected) == 2 /* POST */);
+
+    uint8_t *payload;
+    size_t payload_len;
+    oscore_msgerr_protected_t err = oscore_msg_protected_map_payload(&unprotected, &payload, &payload_len);
+    assert(err == OK);
+    uint8_t summary[5] = {payload_len >> 24, payload_len >> 16, payload_len >> 8, payload_len, 0};
+    for (size_t i = 0; i < payload_len; ++i) {
+        summary[4] += payload[i];
+    }
+    oscore_release_unprotected(&unprotected);
+
+    const uint8_t *token;
+    size_t token_len = oscore_posix_msg_get_token(&request, &token);
+    uint8_t response_buffer[64];
+    struct oscore_posix_msg response;
+    bool initialized = oscore_posix_tcp_msg_init_outgoing(&response, response_buffer, sizeof(response_buffer), token, token_len);
+    assert(initialized);
+
+    oscore_msg_protected_t plaintext;
+    enum oscore_prepare_result prepared = oscore_prepare_response(&response, &plaintext, server, &rid);
+    assert(prepared == OSCORE_PREPARE_OK);
+    oscore_msg_protected_set_code(&plaintext, 0x44 /* 2.04 Changed */);
+    const oscore_msg_protected_payloadpart_t part = {summary, sizeof(summary)};
+    err = oscore_msg_protected_write_payload(&plaintext, &part, 1);
+    assert(err == OK);
+    oscore_msg_native_t out;
+    enum oscore_finish_result finished = oscore_encrypt_message(&plaintext, &out);
+    assert(finished == OSCORE_FINISH_OK);
+
+    int sent = oscore_posix_tcp_send(fd, &response);
+    assert(sent == 0);
+}
+
+int testmain(int introduce_error)
+{
+    // ChaCha20/Poly1305, as AES-CCM-16-64-128 can not protect more than 64KiB
+    // in a single message
+    struct oscore_context_primitive_immutables key = {
+        .common_iv = "d\xf0\xbd" "1MK\xe0<'\x0c+\x1c",
+        .sender_key = "\xd5" "0\x1e\xb1\x8d\x06xI\x95\x08\x93\xba*\xc8\x91" "A|\x89\xae\t\xdfJ8U\xaa\x00\n\xc9\xff\xf3\x87Q",
+        .recipient_key = "\xd5" "0\x1e\xb1\x8d\x06xI\x95\x08\x93\xba*\xc8\x91" "A|\x89\xae\t\xdfJ8U\xaa\x00\n\xc9\xff\xf3\x87Q",
+    };
+    bool ok = !oscore_cryptoerr_is_error(oscore_crypto_aead_from_number(&key.aeadalg, 24));
+    assert(ok);
+    struct oscore_context_primitive client_primitive = { .immutables = &key };
+    struct oscore_context_primitive server_primitive = { .immutables = &key };
+    oscore_context_t client = { .type = OSCORE_CONTEXT_PRIMITIVE, .data = (void*)&client_primitive };
+    oscore_context_t server = { .type = OSCORE_CONTEXT_PRIMITIVE, .data = (void*)&server_primitive };
+
+    int fds[2];
+    int result = socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    assert(result == 0);
+    int client_fd = fds[0];
+    int server_fd = fds[1];
+
+    struct oscore_posix_tcp_reader client_reader;
+    struct oscore_posix_tcp_reader server_reader;
+    oscore_posix_tcp_reader_init(&client_reader, client_rx, sizeof(client_rx));
+    oscore_posix_tcp_reader_init(&server_reader, server_rx, sizeof(server_rx));
+
+    result = oscore_posix_tcp_send_csm(client_fd, sizeof(client_rx));
+    assert(result == 0);
+    result = oscore_posix_tcp_send_csm(server_fd, sizeof(server_rx));
+    assert(result == 0);
+
+    // The client sends all its requests back to back; each large payload is
+    // protected in a single message
+
+    oscore_requestid_t client_rid[REQUESTS];
+    for (uint8_t i = 0; i < REQUESTS; ++i) {
+        struct oscore_posix_msg msg;
+        bool initialized = oscore_posix_tcp_msg_init_outgoing(&msg, request_buffers[i], sizeof(request_buffers[i]), &i, 1);
+        assert(initialized);
+
+        oscore_msg_protected_t plaintext;
+        enum oscore_prepare_result prepared = oscore_prepare_request(&msg, &plaintext, &client, &client_rid[i]);
+        assert(prepared == OSCORE_PREPARE_OK);
+        oscore_msg_protected_set_code(&plaintext, 2 /* POST */);
+        uint8_t *payload;
+        size_t payload_len;
+        oscore_msgerr_protected_t err = oscore_msg_protected_map_payload(&plaintext, &payload, &payload_len);
+        assert(err == OK && payload_len >= payload_sizes[i]);
+        for (size_t j = 0; j < payload_sizes[i]; ++j) {
+            payload[j] = pattern(i, j);
+        }
+        err = oscore_msg_protected_trim_payload(&plaintext, payload_sizes[i]);
+        assert(err == OK);
+        oscore_msg_native_t out;
+        enum oscore_finish_result finished = oscore_encrypt_message(&plaintext, &out);
+        assert(finished == OSCORE_FINISH_OK);
+
+        if (introduce_error == 1 && i == 2) {
+            oscore_msg_native_map_payload(&msg, &payload, &payload_len);
+            payload[payload_len / 2] ^= 0x01;
+        }
+
+        int sent = oscore_posix_tcp_send(client_fd, &msg);
+        assert(sent == 0);
+    }
+
+    expect_csm(server_fd, &server_reader, sizeof(client_rx));
+    for (size_t i = 0; i < REQUESTS; ++i) {
+        serve_one(server_fd, &server_reader, &server);
+    }
+
+    // Responses arrive in order
+
+    expect_csm(client_fd, &client_reader, sizeof(server_rx));
+    for (uint8_t i = 0; i < REQUESTS; ++i) {
+        struct oscore_posix_msg msg;
+        int received = oscore_posix_tcp_receive(client_fd, &client_reader, &msg);
+        assert(received == 1);
+        const uint8_t *token;
+        size_t token_len = oscore_posix_msg_get_token(&msg, &token);
+        assert(token_len == 1 && token[0] == i);
+
+        oscore_oscoreoption_t header;
+        find_oscoreoption(&msg, &header);
+        oscore_msg_protected_t received_msg;
+        enum oscore_unprotect_response_result resresult = oscore_unprotect_response(&msg, &received_msg, header, &client, &client_rid[i]);
+        assert(resresult == OSCORE_UNPROTECT_RESPONSE_OK);
+        assert(oscore_msg_protected_get_code(&received_msg) == 0x44);
+        uint8_t *payload;
+        size_t payload_len;
+        oscore_msgerr_protected_t err = oscore_msg_protected_map_payload(&received_msg, &payload, &payload_len);
+        assert(err == OK);
+        uint8_t sum = 0;
+        for (size_t j = 0; j < payload_sizes[i]; ++j) {
+            sum += pattern(i, j);
+        }
+        uint8_t expected[5] = {payload_sizes[i] >> 24, payload_sizes[i] >> 16, payload_sizes[i] >> 8, payload_sizes[i], sum};
+        assert(payload_len == 5 && memcmp(payload, expected, 5) == 0);
+        oscore_release_unprotected(&received_msg);
+    }
+
+    // An orderly shutdown is reported as such
+
+    close(server_fd);
+    struct oscore_posix_msg msg;
+    int received = oscore_posix_tcp_receive(client_fd, &client_reader, &msg);
+    assert(received == 0);
+
+    close(client_fd);
+
+    return 0;
+}
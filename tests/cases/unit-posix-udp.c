@@ -0,0 +1,208 @@
+#define _GNU_SOURCE
+
+#include <string.h>
+#include <assert.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <oscore_native/message.h>
+#include <oscore/protection.h>
+#include <oscore/contextpair.h>
+#include <oscore/context_impl/primitive.h>
+#include <oscore/message.h>
+#include <oscore_posix/udp.h>
+
+#include "testhelpers.h"
+
+#define REQUESTS 5
+
+/** Answer every request with its own payload, reversed */
+static bool handler(void *arg, struct oscore_posix_msg *request, const struct sockaddr *peer, socklen_t peer_len, struct oscore_posix_msg *response)
+{
+    oscore_context_t *server = arg;
+    (void)peer;
+    (void)peer_len;
+
+    oscore_oscoreoption_t header;
+    find_oscoreoption(request, &header);
+    oscore_requestid_t rid;
+    oscore_msg_protected_t unprotected;
+    enum oscore_unprotect_request_result reqresult = oscore_unprotect_request(request, &unprotected, header, server, &rid);
+    assert(reqresult == OSCORE_UNPROTECT_REQUEST_OK);
+
+    uint8_t *payload;
+    size_t payload_len;
+    oscore_msgerr_protected_t err = oscore_msg_protected_map_payload(&unprotected, &payload, &payload_len);
+    assert(err == OK);
+    uint8_t reversed[16];
+    assert(payload_len <= sizeof(reversed));
+    for (size_t i = 0; i < payload_len; ++i) {
+        reversed[i] = payload[payload_len - 1 - i];
+    }
+    oscore_release_unprotected(&unprotected);
+
+    oscore_msg_protected_t plaintext;
+    enum oscore_prepare_result prepared = oscore_prepare_response(response, &plaintext, server, &rid);
+    assert(prepared == OSCORE_PREPARE_OK);
+    oscore_msg_protected_set_code(&plaintext, 0x45 /* 2.05 Content */);
+    const oscore_msg_protected_payloadpart_t part = {reversed, payload_len};
+    err = oscore_msg_protected_write_payload(&plaintext, &part, 1);
+    assert(err == OK);
+    oscore_msg_native_t out;
+    enum oscore_finish_result finished = oscore_encrypt_message(&plaintext, &out);
+    assert(finished == OSCORE_FINISH_OK);
+    assert(out == response);
+
+    return true;
+}
+
+static struct oscore_posix_udp_server server_loop;
+static struct oscore_posix_udp_batch client_batch;
+
+int testmain(int introduce_error)
+{
+    struct oscore_context_primitive_immutables key;
+    test_key_init(&key);
+    struct oscore_context_primitive client_primitive = { .immutables = &key };
+    struct oscore_context_primitive server_primitive = { .immutables = &key };
+    oscore_context_t client = { .type = OSCORE_CONTEXT_PRIMITIVE, .data = (void*)&client_primitive };
+    oscore_context_t server = { .type = OSCORE_CONTEXT_PRIMITIVE, .data = (void*)&server_primitive };
+
+    int server_fd = socket(AF_INET6, SOCK_DGRAM, 0);
+    int client_fd = socket(AF_INET6, SOCK_DGRAM, 0);
+    assert(server_fd >= 0 && client_fd >= 0);
+    struct sockaddr_in6 server_addr = { .sin6_family = AF_INET6, .sin6_addr = IN6ADDR_LOOPBACK_INIT };
+    int result = bind(server_fd, (struct sockaddr *)&server_addr, sizeof(server_addr));
+    assert(result == 0);
+    socklen_t server_addr_len = sizeof(server_addr);
+    result = getsockname(server_fd, (struct sockaddr *)&server_addr, &server_addr_len);
+    assert(result == 0);
+
+    oscore_posix_udp_server_init(&server_loop, server_fd, handler, &server);
+
+    // A batch of confirmable requests, plus one datagram that is no CoAP
+    // message at all
+
+    oscore_requestid_t client_rid[REQUESTS];
+    oscore_posix_udp_batch_clear(&client_batch);
+    for (uint8_t i = 0; i < REQUESTS; ++i) {
+        struct oscore_posix_msg *msg = oscore_posix_udp_batch_add(&client_batch,
+                (struct sockaddr *)&server_addr, server_addr_len, 0, 0x1000 + i, &i, 1);
+        assert(msg != NULL);
+
+        oscore_msg_protected_t plaintext;
+        enum oscore_prepare_result prepared = oscore_prepare_request(msg, &plaintext, &client, &client_rid[i]);
+        assert(prepared == OSCORE_PREPARE_OK);
+        oscore_msg_protected_set_code(&plaintext, 2 /* POST */);
+        uint8_t text[4] = {'a', 'b', 'c', '0' + i};
+        const oscore_msg_protected_payloadpart_t payload = {text, sizeof(text)};
+        oscore_msgerr_protected_t err = oscore_msg_protected_write_payload(&plaintext, &payload, 1);
+        assert(err == OK);
+        oscore_msg_native_t out;
+        enum oscore_finish_result finished = oscore_encrypt_message(&plaintext, &out);
+        assert(finished == OSCORE_FINISH_OK);
+    }
+
+    if (introduce_error == 1) {
+        uint8_t *payload;
+        size_t payload_len;
+        oscore_msg_native_map_payload(oscore_posix_udp_batch_message(&client_batch, 2), &payload, &payload_len);
+        payload[0] ^= 0x01;
+    }
+
+    bool sent = oscore_posix_udp_send(client_fd, &client_batch);
+    assert(sent);
+    assert(oscore_posix_udp_batch_count(&client_batch) == 0);
+    ssize_t garbage = sendto(client_fd, "\xff\xff", 2, 0, (struct sockaddr *)&server_addr, server_addr_len);
+    assert(garbage == 2);
+
+    bool stepped = oscore_posix_udp_server_step(&server_loop, 0);
+    assert(stepped);
+
+    // All responses arrive (loopback does not reorder or drop), and can be
+    // decrypted
+
+    size_t received_count = 0;
+    while (received_count < REQUESTS) {
+        bool received = oscore_posix_udp_receive(client_fd, &client_batch, MSG_WAITFORONE);
+        assert(received);
+
+        for (size_t j = 0; j < oscore_posix_udp_batch_count(&client_batch); ++j) {
+            struct oscore_posix_msg *msg = oscore_posix_udp_batch_message(&client_batch, j);
+            assert(oscore_posix_msg_get_type(msg) == 2 /* ACK */);
+            const uint8_t *token;
+            size_t token_len = oscore_posix_msg_get_token(msg, &token);
+            assert(token_len == 1 && token[0] < REQUESTS);
+            uint8_t i = token[0];
+            assert(oscore_posix_msg_get_message_id(msg) == 0x1000 + i);
+
+            oscore_oscoreoption_t header;
+            find_oscoreoption(msg, &header);
+            oscore_msg_protected_t received_msg;
+            enum oscore_unprotect_response_result resresult = oscore_unprotect_response(msg, &received_msg, header, &client, &client_rid[i]);
+            assert(resresult == OSCORE_UNPROTECT_RESPONSE_OK);
+            assert(oscore_msg_protected_get_code(&received_msg) == 0x45);
+            uint8_t *payload;
+            size_t payload_len;
+            oscore_msgerr_protected_t err = oscore_msg_protected_map_payload(&received_msg, &payload, &payload_len);
+            assert(err == OK);
+            uint8_t expected[4] = {'0' + i, 'c', 'b', 'a'};
+            assert(payload_len == 4 && memcmp(payload, expected, 4) == 0);
+            oscore_release_unprotected(&received_msg);
+
+            received_count += 1;
+        }
+    }
+
+    // Nothing else was sent
+
+    bool received = oscore_posix_udp_receive(client_fd, &client_batch, MSG_DONTWAIT);
+    assert(!received);
+
+    close(client_fd);
+    close(server_fd);
+
+    // A message can be started over, keeping only its header and token
+
+    uint8_t buf[64];
+    struct oscore_posix_msg msg;
+    bool ok = oscore_posix_msg_init_outgoing(&msg, buf, sizeof(buf), 2, 0x4242, (const uint8_t *)"tk", 2);
+    assert(ok);
+    oscore_msg_native_set_code(&msg, 0x45);
+    oscore_msgerr_native_t nerr = oscore_msg_native_append_option(&msg, 9, (const uint8_t *)"\x09\x01", 2);
+    assert(!oscore_msgerr_native_is_error(nerr));
+    oscore_posix_msg_clear(&msg);
+    oscore_msg_native_set_code(&msg, 0xa3 /* 5.03 Service Unavailable */);
+    nerr = oscore_msg_native_trim_payload(&msg, 0);
+    assert(!oscore_msgerr_native_is_error(nerr));
+    assert(oscore_posix_msg_length(&msg) == 4 + 2);
+    assert(memcmp(buf, "\x62\xa3\x42\x42tk", 6) == 0);
+
+    // Appending an option moves only the part of the payload that is in use
+
+    for (size_t i = 0; i < sizeof(buf); ++i) {
+        buf[i] = i;
+    }
+    ok = oscore_posix_msg_init_outgoing(&msg, buf, sizeof(buf), 0, 0x4242, NULL, 0);
+    assert(ok);
+    uint8_t *payload;
+    size_t payload_len;
+    oscore_msg_native_map_payload(&msg, &payload, &payload_len);
+    memcpy(payload, "abc", 3);
+    oscore_msg_native_set_payload_used(&msg, 3);
+    nerr = oscore_msg_native_append_option(&msg, 11, (const uint8_t *)"path", 4);
+    assert(!oscore_msgerr_native_is_error(nerr));
+    assert(buf[sizeof(buf) - 1] == (uint8_t)(sizeof(buf) - 1 - 5 * (introduce_error == 1)));
+    oscore_msg_native_map_payload(&msg, &payload, &payload_len);
+    assert(payload_len == sizeof(buf) - 4 - 5 - 1);
+    assert(memcmp(payload, "abc", 3) == 0);
+    nerr = oscore_msg_native_trim_payload(&msg, 3);
+    assert(!oscore_msgerr_native_is_error(nerr));
+    assert(oscore_posix_msg_length(&msg) == 4 + 5 + 4);
+    assert(memcmp(buf, "\x40\x00\x42\x42\xb4path\xff" "abc", 13) == 0);
+    (void)ok;
+    (void)nerr;
+
+    return 0;
+}
@@ -0,0 +1,115 @@
+#include <string.h>
+#include <assert.h>
+
+#include <oscore/protection.h>
+#include <oscore/contextpair.h>
+#include <oscore/context_impl/primitive.h>
+#include <oscore/raw.h>
+
+#include "testhelpers.h"
+
+int testmain(int introduce_error)
+{
+    struct oscore_context_primitive_immutables key;
+    test_key_init(&key);
+    struct oscore_context_primitive client_primitive = { .immutables = &key };
+    struct oscore_context_primitive server_primitive = { .immutables = &key };
+    oscore_context_t client = { .type = OSCORE_CONTEXT_PRIMITIVE, .data = (void*)&client_primitive };
+    oscore_context_t server = { .type = OSCORE_CONTEXT_PRIMITIVE, .data = (void*)&server_primitive };
+
+    // Client: CON request with token 0x42 and an outer Uri-Host, protecting a
+    // GET /temp
+
+    uint8_t request[64] = {0x41, 0x00, 0x12, 0x34, 0x42, 0x34, 'h', 'o', 's', 't', 0x00, 0x00, 0x00};
+    struct oscore_raw_outgoing outgoing;
+    oscore_requestid_t client_rid;
+    uint8_t *plaintext;
+    size_t plaintext_size;
+    enum oscore_prepare_result prepared = oscore_prepare_request_raw(
+            request, sizeof(request), 10, 3 /* Uri-Host */,
+            &outgoing, &client, &client_rid, &plaintext, &plaintext_size);
+    assert(prepared == OSCORE_PREPARE_OK);
+    assert(request[1] == 0x02);
+    assert(plaintext_size >= 6);
+    memcpy(plaintext, "\x01\xb4temp", 6);
+    size_t request_length;
+    enum oscore_finish_result finished = oscore_encrypt_message_raw(&outgoing, 6, &request_length);
+    assert(finished == OSCORE_FINISH_OK);
+    assert(request_length <= sizeof(request));
+    // Outer options are untouched
+    assert(memcmp(request, "\x41\x02\x12\x34\x42\x34host", 10) == 0);
+
+    if (introduce_error == 1) {
+        request[request_length - 1] ^= 0x01;
+    }
+
+    // Server: locate, decrypt, and detect a replay of the same datagram
+
+    uint8_t replayed[sizeof(request)];
+    memcpy(replayed, request, request_length);
+
+    struct oscore_raw_message message;
+    enum oscore_raw_parse_result parsed = oscore_raw_parse(request, request_length, &message);
+    assert(parsed == OSCORE_RAW_PARSE_OK);
+    struct oscore_raw_plaintext unprotected;
+    oscore_requestid_t server_rid;
+    enum oscore_unprotect_request_result reqresult = oscore_unprotect_request_raw(&message, &unprotected, &server, &server_rid);
+    assert(reqresult == OSCORE_UNPROTECT_REQUEST_OK);
+    assert(unprotected.code == 0x01);
+    assert(unprotected.options_length == 5 && memcmp(unprotected.options, "\xb4temp", 5) == 0);
+    assert(unprotected.payload == NULL && unprotected.payload_length == 0);
+
+    struct oscore_raw_message replayed_message;
+    parsed = oscore_raw_parse(replayed, request_length, &replayed_message);
+    assert(parsed == OSCORE_RAW_PARSE_OK);
+    oscore_requestid_t replayed_rid;
+    reqresult = oscore_unprotect_request_raw(&replayed_message, &unprotected, &server, &replayed_rid);
+    assert(reqresult == OSCORE_UNPROTECT_REQUEST_DUPLICATE);
+
+    // Server: piggybacked response, built in a buffer starting with the
+    // header and token
+
+    uint8_t response[64] = {0x61, 0x00, 0x12, 0x34, 0x42};
+    prepared = oscore_prepare_response_raw(
+            response, sizeof(response), 5, 0,
+            &outgoing, &server, &server_rid, &plaintext, &plaintext_size);
+    assert(prepared == OSCORE_PREPARE_OK);
+    // Not sending a Partial IV: the OSCORE option is empty
+    assert(response[1] == 0x45 && response[5] == 0x90 && response[6] == 0xff);
+    memcpy(plaintext, "\x45\xff" "22.5", 6);
+    size_t response_length;
+    finished = oscore_encrypt_message_raw(&outgoing, 6, &response_length);
+    assert(finished == OSCORE_FINISH_OK);
+
+    // Client: the response matches the request
+
+    parsed = oscore_raw_parse(response, response_length, &message);
+    assert(parsed == OSCORE_RAW_PARSE_OK);
+    enum oscore_unprotect_response_result resresult = oscore_unprotect_response_raw(&message, &unprotected, &client, &client_rid);
+    assert(resresult == OSCORE_UNPROTECT_RESPONSE_OK);
+    assert(unprotected.code == 0x45);
+    assert(unprotected.options_length == 0);
+    assert(unprotected.payload_length == 4 && memcmp(unprotected.payload, "22.5", 4) == 0);
+
+    // Too small buffers are reported before anything is written
+
+    uint8_t tiny[16] = {0x41, 0x00, 0x12, 0x35, 0x43};
+    prepared = oscore_prepare_request_raw(
+            tiny, sizeof(tiny), 5, 0,
+            &outgoing, &client, &client_rid, &plaintext, &plaintext_size);
+    assert(prepared == OSCORE_PREPARE_ERROR_SIZE);
+    assert(tiny[1] == 0x00);
+
+    // Messages without OSCORE option, and malformed ones
+
+    uint8_t plain[] = {0x40, 0x01, 0x00, 0x01, 0xb4, 't', 'e', 'm', 'p'};
+    parsed = oscore_raw_parse(plain, sizeof(plain), &message);
+    assert(parsed == OSCORE_RAW_PARSE_NO_OSCORE);
+    parsed = oscore_raw_parse(plain, sizeof(plain) - 1, &message);
+    assert(parsed == OSCORE_RAW_PARSE_INVALID);
+    uint8_t empty_payload[] = {0x40, 0x01, 0x00, 0x01, 0xff};
+    parsed = oscore_raw_parse(empty_payload, sizeof(empty_payload), &message);
+    assert(parsed == OSCORE_RAW_PARSE_INVALID);
+
+    return 0;
+}
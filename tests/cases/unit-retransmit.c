@@ -0,0 +1,185 @@
+#include <string.h>
+#include <assert.h>
+
+#include <oscore_native/message.h>
+#include <oscore_native/test.h>
+#include <oscore/protection.h>
+#include <oscore/contextpair.h>
+#include <oscore/context_impl/primitive.h>
+#include <oscore/message.h>
+#include <oscore/retransmit.h>
+
+#include "testhelpers.h"
+
+static oscore_msg_native_t build_request(oscore_context_t *client, oscore_requestid_t *client_rid)
+{
+    oscore_msg_protected_t plaintext;
+    enum oscore_prepare_result prepared = oscore_prepare_request(oscore_test_msg_create(), &plaintext, client, client_rid);
+    assert(prepared == OSCORE_PREPARE_OK);
+    oscore_msg_protected_set_code(&plaintext, 2 /* POST */);
+    const oscore_msg_protected_payloadpart_t payload = {(const uint8_t *)"on", 2};
+    oscore_msgerr_protected_t err = oscore_msg_protected_write_payload(&plaintext, &payload, 1);
+    assert(err == OK);
+    oscore_msg_native_t out;
+    enum oscore_finish_result finished = oscore_encrypt_message(&plaintext, &out);
+    assert(finished == OSCORE_FINISH_OK);
+    return out;
+}
+
+/** Build a message with the outer options of @p request and the given
+ * ciphertext */
+static oscore_msg_native_t copy_request(oscore_msg_native_t request, const uint8_t *ciphertext, size_t ciphertext_len)
+{
+    oscore_msg_native_t copy = oscore_test_msg_create();
+    oscore_msg_native_set_code(copy, oscore_msg_native_get_code(request));
+
+    oscore_msg_native_optiter_t iter;
+    uint16_t number;
+    const uint8_t *value;
+    size_t value_len;
+    oscore_msg_native_optiter_init(request, &iter);
+    while (oscore_msg_native_optiter_next(request, &iter, &number, &value, &value_len)) {
+        oscore_msgerr_native_t err = oscore_msg_native_append_option(copy, number, value, value_len);
+        assert(!oscore_msgerr_native_is_error(err));
+        (void)err;
+    }
+    oscore_msg_native_optiter_finish(request, &iter);
+
+    uint8_t *payload;
+    size_t payload_len;
+    oscore_msg_native_map_payload(copy, &payload, &payload_len);
+    assert(payload_len >= ciphertext_len);
+    memcpy(payload, ciphertext, ciphertext_len);
+    oscore_msg_native_trim_payload(copy, ciphertext_len);
+    return copy;
+}
+
+int testmain(int introduce_error)
+{
+    struct oscore_context_primitive_immutables key;
+    test_key_init(&key);
+    struct oscore_context_primitive client_primitive = { .immutables = &key };
+    struct oscore_context_primitive server_primitive = { .immutables = &key };
+    oscore_context_t client = { .type = OSCORE_CONTEXT_PRIMITIVE, .data = (void*)&client_primitive };
+    oscore_context_t server = { .type = OSCORE_CONTEXT_PRIMITIVE, .data = (void*)&server_primitive };
+
+    struct oscore_retransmit_entry entries[2];
+    struct oscore_retransmit_cache cache;
+    oscore_retransmit_init(&cache, entries, 2);
+
+    oscore_requestid_t client_rid, server_rid;
+    oscore_oscoreoption_t header;
+    struct oscore_retransmit_tag tag;
+    bool ok;
+
+    // First transmission is processed and answered
+
+    oscore_msg_native_t request = build_request(&client, &client_rid);
+    find_oscoreoption(request, &header);
+    ok = oscore_retransmit_tag_init(&tag, &server, request);
+    assert(ok);
+    assert(oscore_retransmit_find(&cache, &server, &header, &tag) == NULL);
+
+    // Keep a copy of the request as sent before it is decrypted in place
+    uint8_t *request_payload;
+    size_t request_len;
+    oscore_msg_native_map_payload(request, &request_payload, &request_len);
+    uint8_t request_copy[64];
+    assert(request_len <= sizeof(request_copy));
+    memcpy(request_copy, request_payload, request_len);
+
+    oscore_msg_protected_t unprotected;
+    enum oscore_unprotect_request_result reqresult = oscore_unprotect_request(request, &unprotected, header, &server, &server_rid);
+    assert(reqresult == OSCORE_UNPROTECT_REQUEST_OK);
+    oscore_release_unprotected(&unprotected);
+
+    oscore_msg_protected_t plaintext;
+    enum oscore_prepare_result prepared = oscore_prepare_response(oscore_test_msg_create(), &plaintext, &server, &server_rid);
+    assert(prepared == OSCORE_PREPARE_OK);
+    oscore_msg_protected_set_code(&plaintext, 0x44 /* 2.04 Changed */);
+    oscore_msgerr_protected_t err = oscore_msg_protected_append_option(&plaintext, 12, (const uint8_t *)"\x00", 1);
+    assert(err == OK);
+    const oscore_msg_protected_payloadpart_t payload = {(const uint8_t *)"switched", 8};
+    err = oscore_msg_protected_write_payload(&plaintext, &payload, 1);
+    assert(err == OK);
+    oscore_msg_native_t response;
+    enum oscore_finish_result finished = oscore_encrypt_message(&plaintext, &response);
+    assert(finished == OSCORE_FINISH_OK);
+
+    bool stored = oscore_retransmit_store(&cache, &server, &server_rid, &tag, response);
+    assert(stored);
+    // The original response is lost on the way
+
+    // The retransmission is answered from the cache; request's OSCORE option
+    // is still intact after in-place decryption
+
+    oscore_msg_native_t retransmission = copy_request(request, request_copy, request_len);
+    uint8_t *retransmission_payload;
+    size_t retransmission_len;
+    oscore_msg_native_map_payload(retransmission, &retransmission_payload, &retransmission_len);
+    struct oscore_retransmit_tag retransmission_tag;
+    ok = oscore_retransmit_tag_init(&retransmission_tag, &server, retransmission);
+    assert(ok);
+
+    const struct oscore_retransmit_entry *entry = oscore_retransmit_find(&cache, &server, &header, &retransmission_tag);
+    assert(entry != NULL);
+    // Other contexts don't match
+    assert(oscore_retransmit_find(&cache, &client, &header, &retransmission_tag) == NULL);
+
+    // A request that only reuses the Partial IV does not get the response
+    retransmission_payload[request_len - 1] ^= 0x01;
+    ok = oscore_retransmit_tag_init(&retransmission_tag, &server, retransmission);
+    assert(ok);
+    assert(oscore_retransmit_find(&cache, &server, &header, &retransmission_tag) == NULL);
+    oscore_test_msg_destroy(retransmission);
+
+    oscore_msg_native_t replayed = oscore_test_msg_create();
+    bool written = oscore_retransmit_write(entry, replayed);
+    assert(written);
+
+    uint8_t *original_payload, *replayed_payload;
+    size_t original_len, replayed_len;
+    oscore_msg_native_map_payload(response, &original_payload, &original_len);
+    oscore_msg_native_map_payload(replayed, &replayed_payload, &replayed_len);
+    assert(original_len == replayed_len);
+    assert(memcmp(original_payload, replayed_payload, original_len) == 0);
+    assert(oscore_msg_native_get_code(replayed) == oscore_msg_native_get_code(response));
+    oscore_test_msg_destroy(response);
+
+    if (introduce_error == 1) {
+        replayed_payload[0] ^= 0x01;
+    }
+
+    oscore_msg_protected_t received;
+    find_oscoreoption(replayed, &header);
+    enum oscore_unprotect_response_result resresult = oscore_unprotect_response(replayed, &received, header, &client, &client_rid);
+    assert(resresult == OSCORE_UNPROTECT_RESPONSE_OK);
+    assert(oscore_msg_protected_get_code(&received) == 0x44);
+    uint8_t *received_payload;
+    size_t received_len;
+    err = oscore_msg_protected_map_payload(&received, &received_payload, &received_len);
+    assert(err == OK);
+    assert(received_len == 8 && memcmp(received_payload, "switched", 8) == 0);
+    oscore_test_msg_destroy(oscore_release_unprotected(&received));
+
+    // A new request is not in the cache
+
+    oscore_msg_native_t request2 = build_request(&client, &client_rid);
+    oscore_oscoreoption_t header2;
+    find_oscoreoption(request2, &header2);
+    struct oscore_retransmit_tag tag2;
+    ok = oscore_retransmit_tag_init(&tag2, &server, request2);
+    assert(ok);
+    assert(oscore_retransmit_find(&cache, &server, &header2, &tag2) == NULL);
+    oscore_test_msg_destroy(request2);
+
+    // Forgetting the context drops its responses
+
+    find_oscoreoption(request, &header);
+    assert(oscore_retransmit_find(&cache, &server, &header, &tag) != NULL);
+    oscore_retransmit_forget(&cache, &server);
+    assert(oscore_retransmit_find(&cache, &server, &header, &tag) == NULL);
+    oscore_test_msg_destroy(request);
+
+    return 0;
+}